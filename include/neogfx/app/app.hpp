@@ -66,6 +66,7 @@ namespace neogfx
         std::optional<size_u32> dpi_override() const final;
         bool turbo() const final;
         bool nest() const final;
+        bool offscreen() const final;
     private:
         boost::program_options::variables_map iOptions;
     };
@@ -41,6 +41,7 @@ namespace neogfx::game
         mutable cache_state state;
         mutable vec2u32 meshVertexArrayIndices;
         mutable std::vector<vec2u32> patchVertexArrayIndices;
+        mutable std::optional<aabbf> untransformedAabb;
 
         struct meta : i_component_data::meta
         {
@@ -56,7 +57,7 @@ namespace neogfx::game
             }
             static std::uint32_t field_count()
             {
-                return 3;
+                return 4;
             }
             static component_data_field_type field_type(std::uint32_t aFieldIndex)
             {
@@ -68,6 +69,8 @@ namespace neogfx::game
                     return component_data_field_type::Vec2u32 | component_data_field_type::Internal;
                 case 2:
                     return component_data_field_type::Vec2u32 | component_data_field_type::Array | component_data_field_type::Internal;
+                case 3:
+                    return component_data_field_type::Aabbf | component_data_field_type::Optional | component_data_field_type::Internal;
                 default:
                     throw invalid_field_index();
                 }
@@ -78,7 +81,8 @@ namespace neogfx::game
                 {
                     "State",
                     "Mesh Vertex Array Indices",
-                    "Patch Vertex Array Indices"
+                    "Patch Vertex Array Indices",
+                    "AABB (Untransformed)"
                 };
                 return sFieldNames[aFieldIndex];
             }
@@ -22,6 +22,8 @@
 #include <neogfx/neogfx.hpp>
 
 #include <type_traits>
+#include <cstdint>
+#include <span>
 
 #include <neolib/app/i_setting_value.hpp>
 
@@ -36,6 +38,20 @@ namespace neogfx
     scalar sRGB_to_linear(scalar s, scalar scale = 1.0);
     scalar linear_to_sRGB(scalar l, scalar scale = 1.0);
 
+    struct bad_pixel_buffer : std::logic_error { bad_pixel_buffer() : std::logic_error("neogfx::bad_pixel_buffer") {} };
+
+    // Batch conversions of interleaved RGBA pixel buffers (four components per pixel, alpha last); the
+    // source and destination must have the same number of components and alpha is passed through
+    // unconverted. Table driven and vectorized for the host CPU; encoded colour components are the
+    // correctly rounded 8-bit values.
+    void sRGB_to_linear(std::span<std::uint8_t const> aSource, std::span<float> aDestination);
+    void linear_to_sRGB(std::span<float const> aSource, std::span<std::uint8_t> aDestination);
+    void premultiply(std::span<std::uint8_t> aPixels);
+    void premultiply(std::span<float> aPixels);
+    void unpremultiply(std::span<std::uint8_t> aPixels);
+    void unpremultiply(std::span<float> aPixels);
+    void swap_red_blue(std::span<std::uint8_t> aPixels); // RGBA <-> BGRA
+
     inline scalar to_sRGB(color_space srcSpace, scalar srcValue, scalar scale)
     {
         switch (srcSpace)
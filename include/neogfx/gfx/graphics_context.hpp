@@ -29,6 +29,8 @@ namespace neogfx
     {
     public:
         struct not_implemented : std::logic_error { not_implemented() : std::logic_error("neogfx::graphics_context::not_implemented") {} };
+        struct already_recording : std::logic_error { already_recording() : std::logic_error("neogfx::graphics_context::already_recording") {} };
+        struct not_recording : std::logic_error { not_recording() : std::logic_error("neogfx::graphics_context::not_recording") {} };
     private:
         friend class generic_surface;
         // exceptions
@@ -51,6 +53,9 @@ namespace neogfx
         graphics_operation::queue& queue() const final;
         void enqueue(graphics_operation::operation const& aOperation) final;
         void flush() final;
+        void begin_recording(graphics_operation::recording& aRecording) final;
+        void end_recording() final;
+        void replay(graphics_operation::recording const& aRecording, vec2 const& aOffset, double aOpacity) final;
         // i_rendering_context
     public:
         neogfx::logical_coordinates logical_coordinates() const final;
@@ -74,6 +79,12 @@ namespace neogfx
         // state
     public:
         void flush() const final;
+        // recording
+    public:
+        bool recording() const final;
+        void begin_recording(graphics_operation::recording& aRecording) const final;
+        void end_recording() const final;
+        void replay(graphics_operation::recording const& aRecording, point const& aPosition = {}, double aOpacity = 1.0) const final;
         // layers
     public:
         layer_t layer() const final;
@@ -269,6 +280,7 @@ namespace neogfx
         mutable std::unique_ptr<i_rendering_context> iNativeGraphicsContext;
         mutable font iDefaultFont;
         mutable point iOrigin;
+        vec2 iOffset;
         mutable size iExtents;
         mutable std::int32_t iLayer;
         mutable std::optional<neogfx::logical_coordinate_system> iLogicalCoordinateSystem;
@@ -284,5 +296,6 @@ namespace neogfx
         mutable std::optional<std::string> iPassword;
         mutable std::optional<size> iPreviousPingPongBufferSize;
         mutable std::vector<ssbo_range> iSsboRanges;
+        mutable graphics_operation::recording* iRecording;
     };
 }
\ No newline at end of file
@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <ranges>
+#include <memory>
 
 #include <neolib/core/variant.hpp>
 
@@ -389,6 +390,7 @@ namespace neogfx
         bool batchable(const operation& aLeft, const operation& aRight);
         bool batchable(text_format const& aLeft, text_format const& aRight);
         bool batchable(i_glyph_text const& lhsText, i_glyph_text const& rhsText, glyph_char const& lhs, glyph_char const& rhs);
+        optional_rect bounding_rect(const operation& aOperation);
 
         class i_queue
         {
@@ -403,5 +405,50 @@ namespace neogfx
         };
 
         using batch = std::ranges::subrange<operation const*>;
+
+        std::uint32_t batch_count(const queue& aQueue);
+        std::uint32_t reorder(queue& aQueue);
+
+        // What a rendering backend makes of a recording when it is compiled: typically the recording's
+        // vertices already tessellated and the shader and texture state to draw them with.
+        class i_compiled_recording
+        {
+        public:
+            virtual ~i_compiled_recording() = default;
+        };
+
+        // A sequence of operations captured once and replayed any number of times; batch boundaries
+        // are computed when the recording is compiled and path vertices uploaded during capture are
+        // owned by the recording so replay does not have to re-tessellate them.
+        class recording
+        {
+        public:
+            recording() = default;
+            recording(recording const&) = delete;
+            recording(recording&& aOther) noexcept;
+            ~recording();
+        public:
+            recording& operator=(recording const&) = delete;
+            recording& operator=(recording&& aOther) noexcept;
+        public:
+            bool empty() const;
+            void clear();
+            point const& origin() const;
+            void set_origin(point const& aOrigin);
+            queue const& operations() const;
+            void push_back(operation const& aOperation);
+            void adopt(ssbo_range const& aVertices);
+            std::uint32_t compile(bool aReorder);
+            std::size_t batch_count() const;
+            batch batch_at(std::size_t aIndex) const;
+            i_compiled_recording const* compiled() const;
+            void set_compiled(std::unique_ptr<i_compiled_recording> aCompiled);
+        private:
+            queue iOperations;
+            std::vector<std::size_t> iBatchEnds;
+            std::vector<ssbo_range> iVertices;
+            point iOrigin;
+            std::unique_ptr<i_compiled_recording> iCompiled;
+        };
     }
 }
\ No newline at end of file
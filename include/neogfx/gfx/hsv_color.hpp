@@ -21,6 +21,9 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <cstdint>
+#include <span>
+
 namespace neogfx
 {
     template <color_space ColorSpace, typename BaseComponent, typename ViewComponent, typename Derived>
@@ -72,6 +75,11 @@ namespace neogfx
         {
             return from_rgb(aColor.template red<scalar>(), aColor.template green<scalar>(), aColor.template blue<scalar>(), aColor.template alpha<scalar>());
         }
+        // Batch conversions of interleaved pixel buffers of four components per pixel (hue in degrees,
+        // alpha last); the hue of an achromatic colour is zero.
+        static void to_rgb(std::span<float const> aHsva, std::span<float> aRgba);
+        static void to_rgb(std::span<float const> aHsva, std::span<std::uint8_t> aRgba);
+        static void from_rgb(std::span<float const> aRgba, std::span<float> aHsva);
     public:
         static double undefined_hue();
     public:
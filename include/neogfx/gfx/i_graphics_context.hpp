@@ -156,6 +156,12 @@ namespace neogfx
         // state
     public:
         virtual void flush() const = 0;
+        // recording
+    public:
+        virtual bool recording() const = 0;
+        virtual void begin_recording(graphics_operation::recording& aRecording) const = 0;
+        virtual void end_recording() const = 0;
+        virtual void replay(graphics_operation::recording const& aRecording, point const& aPosition = {}, double aOpacity = 1.0) const = 0;
         // layers
     public:
         virtual layer_t layer() const = 0;
@@ -27,11 +27,20 @@
 
 namespace neogfx
 {
+    class decoded_image;
+
     enum class color_format
     {
         RGBA8
     };
 
+    enum class resampling_filter : std::uint32_t
+    {
+        None,       // nearest neighbour
+        Box,        // area average
+        Lanczos3    // windowed sinc; sharpest but slowest
+    };
+
     class i_image : public i_resource
     {
     public:
@@ -51,5 +60,7 @@ namespace neogfx
         virtual void* pixels() = 0;
         virtual color get_pixel(const point& aPoint) const = 0;
         virtual void set_pixel(const point& aPoint, const color& aColor) = 0;
+    public:
+        virtual std::shared_ptr<decoded_image> decoding() const = 0; // null unless rows are still arriving from the image decoder
     };
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+// i_image_decoder.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <neogfx/core/event.hpp>
+#include <neogfx/core/geometrical.hpp>
+#include <neogfx/gfx/i_texture.hpp>
+#include <neogfx/app/i_resource.hpp>
+
+namespace neogfx
+{
+    class image_decoder;
+
+    enum class decode_status : std::uint32_t
+    {
+        Queued,
+        Decoding,
+        Decoded,
+        Failed,
+        Cancelled
+    };
+
+    // The pixels of a PNG or JPEG image decoded into an upload ready buffer of the requested texture data
+    // format. A decoder thread writes the buffer a batch of rows at a time: rows [0, decoded_row_count())
+    // are complete. The extents are known once decode_async() returns if the image header could be read
+    // and otherwise once the status is no longer Queued; they may be read from any thread. The pixels of
+    // rows reported by decoded_row_count() or RowsDecoded may be read from any thread. Events are
+    // triggered on the thread that requested the decode.
+    class decoded_image
+    {
+        friend class image_decoder;
+    public:
+        define_event(RowsDecoded, rows_decoded, std::uint32_t /* aFirstRow */, std::uint32_t /* aRowCount */)
+        define_event(Decoded, decoded)
+        define_event(DecodeFailed, decode_failed, std::string const& /* aError */)
+    public:
+        decoded_image(texture_data_format aFormat, bool aPremultiplied);
+        decoded_image(decoded_image const&) = delete;
+        decoded_image& operator=(decoded_image const&) = delete;
+    public:
+        decode_status status() const;
+        bool finished() const;
+        std::string const& error() const;
+        texture_data_format format() const;
+        bool premultiplied() const;
+        size_u32 extents() const;
+        std::uint32_t stride() const;
+        std::uint32_t decoded_row_count() const;
+        std::uint8_t const* pixels() const;
+        std::size_t size() const;
+        void cancel();
+    private:
+        texture_data_format iFormat;
+        bool iPremultiplied;
+        ref_ptr<i_resource> iSource;
+        std::uint8_t const* iSourceData;
+        std::size_t iSourceSize;
+        mutable std::mutex iExtentsMutex;
+        size_u32 iExtents;
+        std::vector<std::uint8_t> iPixels;
+        std::string iError;
+        std::atomic<decode_status> iStatus;
+        std::atomic<std::uint32_t> iDecodedRows;
+        std::atomic<bool> iCancelled;
+        std::uint32_t iNotifiedRows;
+    };
+
+    class i_image_decoder : public i_service
+    {
+    public:
+        struct unsupported_data_format : std::logic_error { unsupported_data_format() : std::logic_error("neogfx::i_image_decoder::unsupported_data_format") {} };
+    public:
+        virtual ~i_image_decoder() = default;
+    public:
+        // Decodes on the calling thread; no events are triggered.
+        virtual std::shared_ptr<decoded_image> decode(i_resource const& aSource, texture_data_format aFormat = texture_data_format::RGBA, bool aPremultiplied = false) = 0;
+        // Queues a decode for a worker thread; the resource is kept alive until the decode finishes.
+        virtual std::shared_ptr<decoded_image> decode_async(i_resource& aSource, texture_data_format aFormat = texture_data_format::RGBA, bool aPremultiplied = false) = 0;
+    public:
+        static uuid const& iid() { static uuid const sIid{ 0x6b1d0f3e, 0x52c7, 0x4a8e, 0x9d61, { 0x1f, 0x7a, 0xc4, 0x08, 0x3b, 0x95 } }; return sIid; }
+    };
+}
@@ -46,6 +46,9 @@ namespace neogfx
         virtual graphics_operation::queue& queue() const = 0;
         virtual void enqueue(const graphics_operation::operation& aOperation) = 0;
         virtual void flush() = 0;
+        virtual void begin_recording(graphics_operation::recording& aRecording) = 0;
+        virtual void end_recording() = 0;
+        virtual void replay(const graphics_operation::recording& aRecording, const vec2& aOffset, double aOpacity) = 0;
     public:
         virtual neogfx::logical_coordinate_system logical_coordinate_system() const = 0;
         virtual neogfx::logical_coordinates logical_coordinates() const = 0;
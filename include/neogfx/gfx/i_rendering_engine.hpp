@@ -31,6 +31,7 @@
 #include <neogfx/gfx/i_shader.hpp>
 #include <neogfx/gfx/i_standard_shader_program.hpp>
 #include <neogfx/gfx/i_vertex_buffer.hpp>
+#include <neogfx/gfx/rendering_statistics.hpp>
 
 namespace neogfx
 {
@@ -85,6 +86,7 @@ namespace neogfx
         virtual void initialize() = 0;
         virtual void cleanup() = 0;
         virtual pixel_format_t set_pixel_format(const i_render_target& aTarget) = 0;
+        virtual bool preserves_back_buffer(const i_render_target& aTarget) const = 0;
         virtual const i_render_target* active_target() const = 0;
         virtual void activate_context(const i_render_target& aTarget) = 0;
         virtual void deactivate_context() = 0;
@@ -165,6 +167,20 @@ namespace neogfx
         virtual bool is_subpixel_rendering_on() const = 0;
         virtual void subpixel_rendering_on() = 0;
         virtual void subpixel_rendering_off() = 0;
+    public:
+        virtual bool operation_reordering_enabled() const = 0;
+        virtual void enable_operation_reordering(bool aEnable) = 0;
+        virtual std::uint32_t draw_calls_saved() const = 0;
+        virtual void add_draw_calls_saved(std::uint32_t aDrawCalls) = 0;
+        virtual bool instanced_shapes_enabled() const = 0;
+        virtual void enable_instanced_shapes(bool aEnable) = 0;
+        virtual bool parallel_mesh_generation_enabled() const = 0;
+        virtual void enable_parallel_mesh_generation(bool aEnable) = 0;
+        virtual std::uint64_t texture_upload_budget() const = 0;
+        virtual void set_texture_upload_budget(std::uint64_t aBytesPerFrame) = 0;
+    public:
+        virtual rendering_statistics const& statistics() const = 0;
+        virtual rendering_statistics& frame_statistics() = 0;
     public:
         virtual void render_now() = 0;
         virtual bool frame_rate_limited() const = 0;
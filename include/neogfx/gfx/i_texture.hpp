@@ -21,6 +21,8 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <functional>
+
 #include <neolib/core/i_vector.hpp>
 
 #include <neogfx/core/geometrical.hpp>
@@ -114,6 +116,11 @@ namespace neogfx
         virtual void set_pixels(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::uint32_t aStride = 0u, std::uint32_t aPackAlignment = 4u) = 0;
         virtual void set_pixels(const i_image& aImage) = 0;
         virtual void set_pixels(const i_image& aImage, const rect& aImagePart) = 0;
+        // Like set_pixels but the pixel data is staged and uploaded later, at most a frame's upload budget at
+        // a time; until then the affected area samples as transparent. Rendering to, reading back or
+        // synchronously setting pixels of the texture issues its staged uploads first. aPixelData need not
+        // outlive the call.
+        virtual void set_pixels_async(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded = {}, std::uint32_t aStride = 0u, std::uint32_t aPackAlignment = 4u) = 0;
         virtual void set_pixel(const point& aPosition, const color& aColor) = 0;
         virtual color get_pixel(const point& aPosition) const = 0;
         virtual i_vector<texture_line_segment> const& intersection(texture_line_segment const& aLine, rect const& aBoundingBox, vec2 const& aSampleSize = { 1.0, 1.0 }, scalar aTolerance = 0.0) const = 0;
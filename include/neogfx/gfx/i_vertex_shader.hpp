@@ -53,5 +53,6 @@ namespace neogfx
         virtual void set_projection_matrix(const optional_mat44& aProjectionMatrix) = 0;
         virtual void set_transformation_matrix(const optional_mat44& aProjectionMatrix) = 0;
         virtual void set_opacity(scalar aOpacity) = 0;
+        virtual void set_instanced(bool aInstanced) = 0;
     };
 }
\ No newline at end of file
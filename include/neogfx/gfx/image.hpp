@@ -24,12 +24,19 @@
 #include <vector>
 #include <unordered_map>
 #include <optional>
+#include <memory>
 
 #include <neogfx/core/event.hpp>
 #include <neogfx/gfx/i_image.hpp>
 
 namespace neogfx
 {
+    enum class image_decoding
+    {
+        Synchronous,
+        Asynchronous    // the image has its final extents but is transparent until rows arrive from the image decoder
+    };
+
     class image : public reference_counted<i_image>
     {
     public:
@@ -39,7 +46,8 @@ namespace neogfx
         enum image_type_e
         {
             UnknownImage,
-            PngImage
+            PngImage,
+            JpegImage
         };
     public:
         typedef neolib::vector<std::uint8_t> data_type;
@@ -47,10 +55,12 @@ namespace neogfx
     private:
         struct error_parsing_image_pattern : std::logic_error { error_parsing_image_pattern() : std::logic_error("neogfx::image::error_parsing_image_pattern") {} };
         struct no_resource : std::logic_error { no_resource() : std::logic_error("neogfx::image::no_resource") {} };
+        struct bad_mip_level : std::logic_error { bad_mip_level() : std::logic_error("neogfx::image::bad_mip_level") {} };
     public:
         image(dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(const neogfx::size& aSize, const color& aColor = color::Black, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(std::string const& aUri, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
+        image(std::string const& aUri, image_decoding aDecoding, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(std::string const& aImagePattern, const std::unordered_map<std::string, color>& aColorMap, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(std::string const& aUri, std::string const& aImagePattern, const std::unordered_map<std::string, color>& aColorMap, dimension aDpiScaleFactor = 1.0, texture_sampling aSampling = texture_sampling::NormalMipmap, neogfx::color_space aColorSpace = neogfx::color_space::sRGB);
         image(image const& aOther);
@@ -85,12 +95,26 @@ namespace neogfx
         void* pixels() override;
         color get_pixel(const point& aPoint) const override;
         void set_pixel(const point& aPoint, const color& aColor) override;
+    public:
+        std::shared_ptr<decoded_image> decoding() const override;
+    public:
+        // Level 0 of the mip chain is the image itself and each further level halves its extents; levels
+        // are resampled from the previous level on first use and cached per filter. Copies of an image
+        // share its pixels and cached levels until either is modified.
+        std::uint32_t mip_level_count() const;
+        neogfx::size mip_level_extents(std::uint32_t aLevel) const;
+        std::uint32_t mip_level_for(const neogfx::size& aExtents) const; // smallest level covering aExtents
+        const image& mip_level(std::uint32_t aLevel, resampling_filter aFilter = resampling_filter::Box) const;
     private:
         bool has_resource() const;
         const i_resource& resource() const;
         image_type_e recognize() const;
         bool load();
-        bool load_png();
+        bool load_decoded();
+        data_type const& pixel_data() const;
+        data_type& unshared_pixel_data();
+        void load_async();
+        void follow_decoding();
     private:
         ref_ptr<i_resource> iResource;
         string iUri;
@@ -98,9 +122,13 @@ namespace neogfx
         dimension iDpiScaleFactor;
         neogfx::color_space iColorSpace;
         neogfx::color_format iColorFormat;
-        data_type iData;
+        std::shared_ptr<data_type> iData; // shared by copies until either is modified
         mutable cache<data_type> iHash;
         texture_sampling iSampling;
         neogfx::size iSize;
+        struct mip_chain;
+        mutable std::shared_ptr<mip_chain> iMipChain;
+        std::shared_ptr<decoded_image> iDecoding;
+        sink iSink;
     };
 }
\ No newline at end of file
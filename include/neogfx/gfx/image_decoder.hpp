@@ -0,0 +1,66 @@
+// image_decoder.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <neogfx/gui/widget/timer.hpp>
+#include <neogfx/gfx/i_image_decoder.hpp>
+
+namespace neogfx
+{
+    // Decodes images on a pool of worker threads, started on first use. Each decoded batch of rows is
+    // converted to the requested format while still in cache; progress and completion are delivered
+    // by a timer on the thread that requested the decode which only runs while decodes are active.
+    class image_decoder : public i_image_decoder
+    {
+    public:
+        static constexpr std::uint32_t RowBatch = 16u;
+    public:
+        image_decoder();
+        ~image_decoder();
+    public:
+        std::shared_ptr<decoded_image> decode(i_resource const& aSource, texture_data_format aFormat = texture_data_format::RGBA, bool aPremultiplied = false) override;
+        std::shared_ptr<decoded_image> decode_async(i_resource& aSource, texture_data_format aFormat = texture_data_format::RGBA, bool aPremultiplied = false) override;
+    private:
+        void work();
+        void notify();
+        static std::shared_ptr<decoded_image> create(i_resource const& aSource, texture_data_format aFormat, bool aPremultiplied);
+        static void decode(decoded_image& aImage);
+        static bool decode_png(decoded_image& aImage);
+        static bool decode_jpeg(decoded_image& aImage);
+        static std::uint8_t* begin_rows(decoded_image& aImage, std::uint32_t aWidth, std::uint32_t aHeight);
+        static bool publish_rows(decoded_image& aImage, std::uint32_t aRowCount);
+    private:
+        std::mutex iMutex;
+        std::condition_variable iWorkAvailable;
+        std::deque<decoded_image*> iQueue;
+        std::vector<std::shared_ptr<decoded_image>> iActive;
+        std::vector<std::thread> iWorkers;
+        bool iStopping;
+        neolib::callback_timer iTimer;
+    };
+}
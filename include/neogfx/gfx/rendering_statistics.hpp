@@ -0,0 +1,59 @@
+// rendering_statistics.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <variant>
+
+#include <neogfx/gfx/graphics_operations.hpp>
+
+namespace neogfx
+{
+    std::size_t constexpr RenderingStatisticsOperationTypeCount = std::variant_size_v<graphics_operation::operation>;
+
+    struct rendering_statistics
+    {
+        std::uint64_t frame = 0ull;
+        std::uint32_t flushes = 0u;
+        std::uint64_t queueLength = 0ull;
+        std::uint32_t batches = 0u;
+        std::array<std::uint32_t, RenderingStatisticsOperationTypeCount> batchesByOperation = {};
+        std::uint32_t drawCalls = 0u;
+        std::uint32_t drawCallsSaved = 0u;
+        std::uint64_t verticesUploaded = 0ull; // written to vertex buffers this frame; cached vertices that are only redrawn do not count
+        std::uint64_t instancesDrawn = 0ull;
+        std::uint32_t textureUploads = 0u;
+        std::uint64_t textureUploadBytes = 0ull;
+        std::uint32_t textureUploadsPending = 0u;
+        std::chrono::nanoseconds flushTime = {};
+        std::uint32_t damageRegions = 0u;
+        std::uint64_t pixelsRepainted = 0ull;
+        std::uint32_t entitiesDrawn = 0u;
+        std::uint32_t entitiesCulled = 0u;
+    };
+
+    std::string rendering_statistics_csv_header();
+    std::string to_csv(rendering_statistics const& aStatistics);
+    std::string to_json(rendering_statistics const& aStatistics);
+}
@@ -0,0 +1,39 @@
+// resampling.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <cstdint>
+#include <span>
+
+#include <neogfx/core/geometrical.hpp>
+#include <neogfx/gfx/color_bits.hpp>
+#include <neogfx/gfx/i_image.hpp>
+
+namespace neogfx
+{
+    // Resamples an interleaved RGBA8 pixel buffer to new extents. Filtering is done on premultiplied,
+    // linear intensities so that neither transparent pixels nor the transfer function of aColorSpace
+    // darken the result. Rows are processed in bands on multiple threads using vectorized kernels for
+    // the host CPU; the result does not depend on either.
+    void resample(std::span<std::uint8_t const> aSource, size_u32 const& aSourceExtents, std::span<std::uint8_t> aDestination, size_u32 const& aDestinationExtents, resampling_filter aFilter, color_space aColorSpace = color_space::sRGB);
+}
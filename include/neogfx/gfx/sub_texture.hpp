@@ -63,6 +63,7 @@ namespace neogfx
         void set_pixels(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::uint32_t aStride = 0u, std::uint32_t aPackAlignment = 4u) final;
         void set_pixels(i_image const& aImage) final;
         void set_pixels(i_image const& aImage, rect const& aImagePart) final;
+        void set_pixels_async(rect const& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded = {}, std::uint32_t aStride = 0u, std::uint32_t aPackAlignment = 4u) final;
         void set_pixel(point const& aPosition, color const& aColor) final;
         color get_pixel(point const& aPosition) const final;
         i_vector<texture_line_segment> const& intersection(texture_line_segment const& aLine, rect const& aBoundingBox, vec2 const& aSampleSize = { 1.0, 1.0 }, scalar aTolerance = 0.0) const final;
@@ -22,6 +22,7 @@
 #include <neogfx/neogfx.hpp>
 
 #include <map>
+#include <array>
 
 #include <neogfx/gfx/i_texture_manager.hpp>
 #include <neogfx/gfx/i_texture_atlas.hpp>
@@ -34,6 +35,7 @@ namespace neogfx
     private:
         typedef std::map<dimension, std::string> sets;
         typedef std::map<std::u32string, sets> emojis;
+        typedef std::array<std::uint64_t, 4> emoji_page;
     public:
         emoji_atlas();
     public:
@@ -48,5 +50,7 @@ namespace neogfx
         std::unique_ptr<i_texture_atlas> iTextureAtlas;
         emojis iEmojis;
         mutable std::map<std::u32string, std::optional<emoji_id>> iEmojiMap;
+        std::array<std::uint16_t, 0x1100> iSingleEmojiPageIndex = {};
+        std::vector<emoji_page> iSingleEmojiPages;
     };
 }
\ No newline at end of file
@@ -23,6 +23,7 @@
 
 #include <unordered_map>
 #include <set>
+#include <list>
 
 #include <neolib/core/jar.hpp>
 #include <neolib/core/string_ci.hpp>
@@ -30,6 +31,7 @@
 #include <neogfx/gfx/texture_atlas.hpp>
 #include <neogfx/gfx/text/emoji_atlas.hpp>
 #include <neogfx/gfx/text/i_font_manager.hpp>
+#include <neogfx/gfx/text/glyph_text.hpp>
 
 typedef struct FT_LibraryRec_* FT_Library;
 
@@ -56,6 +58,32 @@ namespace neogfx
         using font_family_list = std::map<string, std::vector<native_font_list::iterator>, neolib::ci_less>;
         using id_cache_entry = font ;
         using id_cache = neolib::small_jar<id_cache_entry>;
+        struct shaped_text_key
+        {
+            std::string text;
+            font_id font;
+            std::uint32_t flags;
+
+            bool operator==(shaped_text_key const&) const = default;
+        };
+        struct shaped_text_key_hash
+        {
+            std::size_t operator()(shaped_text_key const& aKey) const noexcept;
+        };
+        using shaped_text_lru = std::list<shaped_text_key const*>;
+        // Only the shaping result is kept, not a glyph_text, as that would hold references to its fonts and
+        // keep their faces from ever being released; entries are evicted when any font they use is released.
+        struct shaped_text_entry
+        {
+            std::vector<glyph_char> glyphs;
+            std::vector<glyph_text::size_type> lineBreaks;
+            scalar baseline;
+            neogfx::size extents;
+            std::vector<font_id> fonts;
+            std::size_t bytes;
+            shaped_text_lru::iterator lru;
+        };
+        using shaped_text_cache = std::unordered_map<shaped_text_key, shaped_text_entry, shaped_text_key_hash>;
     public:
         struct error_initializing_font_library : std::runtime_error { error_initializing_font_library() : std::runtime_error("neogfx::font_manager::error_initializing_font_library") {} };
         struct no_matching_font_found : std::runtime_error { no_matching_font_found() : std::runtime_error("neogfx::font_manager::no_matching_font_found") {} };
@@ -97,6 +125,18 @@ namespace neogfx
         const font& font_from_id(font_id aId) const final;
     public:
         i_glyph_text_factory& glyph_text_factory() const final;
+        glyph_text cached_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, font const& aFont) final;
+        shaped_text_cache_statistics shaped_text_cache_stats() const final;
+        void set_shaped_text_cache_capacity(std::size_t aCapacity) final;
+        void clear_shaped_text_cache() final;
+        bool parallel_shaping() const final;
+        void set_parallel_shaping(bool aParallelShaping) final;
+    public:
+        void prefetch_glyphs(glyph_text const& aText) final;
+        void prefetch_glyphs(font const& aFont, char32_t const* aCodePointsBegin, char32_t const* aCodePointsEnd) final;
+        void upload_prefetched_glyphs() final;
+        i_string const& glyph_disk_cache_directory() const final;
+        void set_glyph_disk_cache_directory(i_string const& aDirectory) final;
     public:
         const i_texture_atlas& glyph_atlas() const final;
         i_texture_atlas& glyph_atlas() final;
@@ -113,6 +153,10 @@ namespace neogfx
     private:
         i_native_font_face& add_font(const ref_ptr<i_native_font_face>& aNewFont);
         void cleanup();
+        void evict_shaped_text(std::size_t aCapacity);
+        void evict_shaped_text(std::vector<font_id> const& aFonts);
+        static glyph_text to_glyph_text(shaped_text_entry const& aEntry, font const& aFont);
+        void prefetch_glyphs(i_native_font_face& aFace, std::vector<std::uint32_t> const& aGlyphIndices);
     private:
         mutable std::unordered_map<system_font_role, optional<font_info>> iDefaultSystemFontInfo;
         mutable std::optional<fallback_font_info> iDefaultFallbackFontInfo;
@@ -124,5 +168,11 @@ namespace neogfx
         std::unique_ptr<i_glyph_text_factory> iGlyphTextFactory;
         texture_atlas iGlyphAtlas;
         neogfx::emoji_atlas iEmojiAtlas;
+        shaped_text_cache iShapedText;
+        shaped_text_lru iShapedTextLru;
+        shaped_text_cache_statistics iShapedTextStats;
+        bool iParallelShaping = false;
+        std::vector<ref_ptr<i_native_font_face>> iPrefetchingFaces;
+        string iGlyphDiskCacheDirectory;
     };
 }
\ No newline at end of file
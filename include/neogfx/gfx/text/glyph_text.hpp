@@ -620,6 +620,9 @@ namespace neogfx
         virtual glyph_text create_glyph_text(font const& aFont) = 0;
         virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) = 0;
         virtual glyph_text to_glyph_text(i_graphics_context const& aContext, char const* aUtf8Begin, char const* aUtf8End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) = 0;
+        // shapes text with its primary fonts ahead of a later to_glyph_text() of the same text; may be called from a worker thread 
+        // if the font selector only reads a snapshot; mnemonics and password masking are not applied
+        virtual void preshape(char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector) = 0;
     public:
         glyph_text to_glyph_text(i_graphics_context const& aContext, char32_t const* aUtf32Begin, char32_t const* aUtf32End, std::function<font(std::size_t)> aFontSelector, bool aAlignBaselines = true)
         {
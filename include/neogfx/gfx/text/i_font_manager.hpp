@@ -36,6 +36,18 @@ namespace neogfx
     class i_emoji_atlas;
 
     class i_glyph_text_factory;
+    class glyph_text;
+    class i_graphics_context;
+
+    struct shaped_text_cache_statistics
+    {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t evictions;
+        std::size_t entries;
+        std::size_t bytes;
+        std::size_t capacity;
+    };
 
     enum class system_font_role : std::uint32_t
     {
@@ -98,6 +110,18 @@ namespace neogfx
         virtual const font& font_from_id(font_id aId) const = 0;
     public:
         virtual i_glyph_text_factory& glyph_text_factory() const = 0;
+        virtual glyph_text cached_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, font const& aFont) = 0;
+        virtual shaped_text_cache_statistics shaped_text_cache_stats() const = 0;
+        virtual void set_shaped_text_cache_capacity(std::size_t aCapacity) = 0;
+        virtual void clear_shaped_text_cache() = 0;
+        virtual bool parallel_shaping() const = 0;
+        virtual void set_parallel_shaping(bool aParallelShaping) = 0;
+    public:
+        virtual void prefetch_glyphs(glyph_text const& aText) = 0;
+        virtual void prefetch_glyphs(font const& aFont, char32_t const* aCodePointsBegin, char32_t const* aCodePointsEnd) = 0;
+        virtual void upload_prefetched_glyphs() = 0;
+        virtual i_string const& glyph_disk_cache_directory() const = 0;
+        virtual void set_glyph_disk_cache_directory(i_string const& aDirectory) = 0;
     public:
         virtual const i_texture_atlas& glyph_atlas() const = 0;
         virtual i_texture_atlas& glyph_atlas() = 0;
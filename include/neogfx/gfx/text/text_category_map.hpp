@@ -21,6 +21,7 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <array>
 #include <neogfx/gfx/text/glyph_text.hpp>
 #include "i_emoji_atlas.hpp"
 
@@ -29,7 +30,7 @@ namespace neogfx
     namespace detail
     {
         typedef std::pair<std::uint32_t, text_category> text_category_MAP_VALUE_TYPE;
-        const text_category_MAP_VALUE_TYPE text_category_MAP[] =
+        constexpr text_category_MAP_VALUE_TYPE text_category_MAP[] =
         {
 			{ 0x00000, text_category::Whitespace },
 			{ 0x00021, text_category::None },
@@ -2187,6 +2188,83 @@ namespace neogfx
 			{ 0x100001, text_category::Unknown },
 			{ 0x10FFFD, text_category::LTR }, 
 		};
+
+        // Two-stage lookup table generated from text_category_MAP: the first stage maps each block of
+        // code points either directly to a category (when the whole block shares one) or to a second
+        // stage block holding a category per code point.
+        constexpr std::size_t text_category_MAP_SIZE = sizeof(text_category_MAP) / sizeof(text_category_MAP[0]);
+        constexpr std::uint32_t text_category_BLOCK_BITS = 8u;
+        constexpr std::uint32_t text_category_BLOCK_SIZE = 1u << text_category_BLOCK_BITS;
+        constexpr std::uint32_t text_category_BLOCK_COUNT = 0x110000u >> text_category_BLOCK_BITS;
+        constexpr std::uint16_t text_category_UNIFORM_BLOCK = 0x8000u;
+
+        constexpr bool text_category_block_is_uniform(std::size_t& aRange, std::uint32_t aBlock)
+        {
+            std::uint32_t const first = aBlock << text_category_BLOCK_BITS;
+            while (aRange + 1u < text_category_MAP_SIZE && text_category_MAP[aRange + 1u].first <= first)
+                ++aRange;
+            return aRange + 1u == text_category_MAP_SIZE || text_category_MAP[aRange + 1u].first >= first + text_category_BLOCK_SIZE;
+        }
+
+        constexpr std::size_t text_category_mixed_block_count()
+        {
+            std::size_t result = 0u;
+            std::size_t range = 0u;
+            for (std::uint32_t block = 0u; block < text_category_BLOCK_COUNT; ++block)
+                if (!text_category_block_is_uniform(range, block))
+                    ++result;
+            return result;
+        }
+
+        struct text_category_TABLE_TYPE
+        {
+            std::array<std::uint16_t, text_category_BLOCK_COUNT> stage1;
+            std::array<std::array<text_category, text_category_BLOCK_SIZE>, text_category_mixed_block_count()> stage2;
+        };
+
+        constexpr text_category_TABLE_TYPE make_text_category_table()
+        {
+            text_category_TABLE_TYPE result = {};
+            std::size_t range = 0u;
+            std::uint16_t nextMixedBlock = 0u;
+            for (std::uint32_t block = 0u; block < text_category_BLOCK_COUNT; ++block)
+            {
+                if (text_category_block_is_uniform(range, block))
+                {
+                    result.stage1[block] = text_category_UNIFORM_BLOCK | static_cast<std::uint16_t>(text_category_MAP[range].second);
+                    continue;
+                }
+                auto& mixedBlock = result.stage2[nextMixedBlock];
+                result.stage1[block] = nextMixedBlock++;
+                std::uint32_t const first = block << text_category_BLOCK_BITS;
+                std::size_t blockRange = range;
+                for (std::uint32_t offset = 0u; offset < text_category_BLOCK_SIZE; ++offset)
+                {
+                    while (blockRange + 1u < text_category_MAP_SIZE && text_category_MAP[blockRange + 1u].first <= first + offset)
+                        ++blockRange;
+                    mixedBlock[offset] = text_category_MAP[blockRange].second;
+                }
+            }
+            return result;
+        }
+
+        inline constexpr text_category_TABLE_TYPE text_category_TABLE = make_text_category_table();
+
+        constexpr text_category text_category_lookup(char32_t aCodePoint)
+        {
+            if (aCodePoint >= 0x110000u)
+                return text_category_MAP[text_category_MAP_SIZE - 1u].second;
+            auto const stage1 = text_category_TABLE.stage1[aCodePoint >> text_category_BLOCK_BITS];
+            if (stage1 & text_category_UNIFORM_BLOCK)
+                return static_cast<text_category>(stage1 & ~text_category_UNIFORM_BLOCK);
+            return text_category_TABLE.stage2[stage1][aCodePoint & (text_category_BLOCK_SIZE - 1u)];
+        }
+
+        static_assert(text_category_lookup(U' ') == text_category::Whitespace);
+        static_assert(text_category_lookup(U'7') == text_category::Digit);
+        static_assert(text_category_lookup(U'a') == text_category::LTR);
+        static_assert(text_category_lookup(U'\u05D0') == text_category::RTL);
+        static_assert(text_category_lookup(U'\u0300') == text_category::Mark);
     }
 
     inline text_category get_text_category(const i_emoji_atlas& aEmojiAtlas, const char32_t* aCodePoint, const char32_t* aCodePointEnd)
@@ -2196,17 +2274,7 @@ namespace neogfx
             return text_category::Emoji;
         else if (ch == 0xFE0F || ch == 0xFE0E)
             return text_category::Control;
-        const detail::text_category_MAP_VALUE_TYPE* rangeStart = std::lower_bound(
-            &detail::text_category_MAP[0], 
-            &detail::text_category_MAP[0] + sizeof(detail::text_category_MAP) / sizeof(detail::text_category_MAP[0]),
-            detail::text_category_MAP_VALUE_TYPE(ch, text_category::Unknown),
-            [](const detail::text_category_MAP_VALUE_TYPE& lhs, const detail::text_category_MAP_VALUE_TYPE& rhs) -> bool
-        {
-            return lhs.first < rhs.first;
-        });
-        if (rangeStart != &detail::text_category_MAP[0] && ch < rangeStart->first)
-            --rangeStart;
-        return rangeStart->second;
+        return detail::text_category_lookup(ch);
     }
 
     inline text_category get_text_category(const i_emoji_atlas& aEmojiAtlas, char32_t aCodePoint)
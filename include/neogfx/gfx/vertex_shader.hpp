@@ -83,6 +83,7 @@ namespace neogfx
         void set_projection_matrix(const optional_mat44& aProjectionMatrix) final;
         void set_transformation_matrix(const optional_mat44& aTransformationMatrix) final;
         void set_opacity(scalar aOpacity) final;
+        void set_instanced(bool aInstanced) final;
     public:
         void prepare_uniforms(const i_rendering_context& aContext, i_shader_program& aProgram) override;
         void generate_code(const i_shader_program& aProgram, shader_language aLanguage, i_string& aOutput) const override;
@@ -90,10 +91,12 @@ namespace neogfx
         optional_mat44 iProjectionMatrix;
         optional_mat44 iTransformationMatrix;
         scalar iOpacity;
+        bool iInstanced;
     private:
         cache_uniform(uProjectionMatrix)
         cache_uniform(uTransformationMatrix)
         cache_uniform(uOpacity)
+        cache_uniform(uInstanced)
         optional_logical_coordinates iLogicalCoordinates;
         optional_vec2 iOffset;
     };
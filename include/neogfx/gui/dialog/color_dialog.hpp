@@ -155,6 +155,7 @@ namespace neogfx
             vertical_layout iLayout;
             std::optional<image> iImage;
             mutable std::array<std::array<avec4u8, 256>, 256> iPixels;
+            std::vector<float> iHsvPixels;
             image_widget iCanvas;
             mutable texture iTexture;
             bool iTracking;
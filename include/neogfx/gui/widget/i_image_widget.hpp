@@ -37,5 +37,7 @@ namespace neogfx
         virtual void set_aspect_ratio(neogfx::aspect_ratio aAspectRatio) = 0;
         virtual void set_placement(cardinal aPlacement) = 0;
         virtual void set_dpi_auto_scale(bool aDpiAutoScale) = 0;
+        virtual neogfx::resampling_filter resampling_filter() const = 0;
+        virtual void set_resampling_filter(neogfx::resampling_filter aFilter) = 0;
     };
 }
\ No newline at end of file
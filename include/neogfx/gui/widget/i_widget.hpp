@@ -186,6 +186,9 @@ namespace neogfx
         virtual void paint_non_client(i_graphics_context& aGc) const = 0;
         virtual void paint_non_client_after(i_graphics_context& aGc) const = 0;
         virtual void paint(i_graphics_context& aGc) const = 0;
+        virtual bool cache_as_texture() const = 0;
+        virtual void set_cache_as_texture(bool aCacheAsTexture) = 0;
+        virtual void invalidate_render_cache() = 0;
     public:
         virtual double opacity() const = 0;
         virtual void set_opacity(double aOpacity) = 0;
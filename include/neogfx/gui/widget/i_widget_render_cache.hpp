@@ -0,0 +1,50 @@
+// i_widget_render_cache.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/core/geometrical.hpp>
+#include <neogfx/gfx/i_texture.hpp>
+
+namespace neogfx
+{
+    class i_widget;
+
+    // Offscreen textures holding the rendered output of widgets that opt in to being cached as a texture;
+    // total texture memory is capped by a budget with least recently used entries evicted first.
+    class i_widget_render_cache : public i_service
+    {
+    public:
+        virtual ~i_widget_render_cache() = default;
+    public:
+        virtual std::uint64_t budget() const = 0;
+        virtual void set_budget(std::uint64_t aBudget) = 0;
+        virtual std::uint64_t usage() const = 0;
+        virtual std::uint32_t count() const = 0;
+    public:
+        virtual i_texture const* find(i_widget const& aWidget) = 0;
+        virtual i_texture const* acquire(i_widget const& aWidget, size const& aExtents) = 0;
+        virtual void release(i_widget const& aWidget) = 0;
+        virtual void clear() = 0;
+    public:
+        static uuid const& iid() { static uuid const sIid{ 0x4b521e8f, 0xa775, 0x41f7, 0xba57, { 0x20, 0x45, 0x5a, 0x57, 0x8f, 0xb4 } }; return sIid; }
+    };
+}
@@ -20,9 +20,11 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <future>
 #include <neolib/core/i_enum.hpp>
 
 #include <neogfx/gui/widget/widget.hpp>
+#include <neogfx/gui/widget/timer.hpp>
 #include <neogfx/gfx/image.hpp>
 #include <neogfx/gfx/texture.hpp>
 #include <neogfx/gui/widget/i_image_widget.hpp>
@@ -35,6 +37,12 @@ namespace neogfx
     public:
         define_event(ImageChanged, image_changed)
         define_event(ImageGeometryChanged, image_geometry_changed)
+    private:
+        struct scaled_pixels
+        {
+            size extents;
+            std::vector<std::uint8_t> data; // bottom-up RGBA rows
+        };
     public:
         image_widget(const i_texture& aTexture = texture{}, aspect_ratio aAspectRatio = aspect_ratio::Keep, cardinal aPlacement = cardinal::Center);
         image_widget(const i_image& aImage, aspect_ratio aAspectRatio = aspect_ratio::Keep, cardinal aPlacement = cardinal::Center);
@@ -45,6 +53,8 @@ namespace neogfx
     public:
         neogfx::size_policy size_policy() const override;
         size minimum_size(optional_size const& aAvailableSpace = optional_size{}) const override;
+    public:
+        void resized() override;
     public:
         void paint(i_graphics_context& aGc) const override;
     public:
@@ -57,13 +67,34 @@ namespace neogfx
         void set_aspect_ratio(neogfx::aspect_ratio aAspectRatio) override;
         void set_placement(cardinal aPlacement) override;
         void set_dpi_auto_scale(bool aDpiAutoScale) override;
+        neogfx::resampling_filter resampling_filter() const override;
+        void set_resampling_filter(neogfx::resampling_filter aFilter) override;
     public:
         rect placement_rect() const;
     private:
-        texture iTexture;
+        bool has_image() const;
+        size image_extents() const;
+        dimension image_dpi_scale_factor() const;
+        const texture* scaled_image(const size& aExtents) const;
+        void rescale(std::uint32_t aLevel, bool aForce = false) const;
+        void scaled_pixels_ready() const;
+        void notify_image_changed(const size& aOldMinimumSize, const size& aOldImageExtents);
+    private:
+        // images are kept on the CPU so that a mip level close to the on-screen size can be uploaded
+        // instead of the full size image; the full size texture is only created if it is drawn or asked for.
+        // Mip levels are resampled on the thread pool and uploaded asynchronously; the level being drawn is
+        // only replaced once its successor has landed.
+        std::optional<neogfx::image> iImage;
+        mutable texture iTexture;
+        mutable std::optional<std::pair<std::uint32_t, texture>> iScaledImage;
+        mutable std::optional<std::uint32_t> iRescalingLevel;
+        mutable std::future<scaled_pixels> iRescaling;
+        mutable std::optional<texture> iUploadingScaledImage;
+        mutable std::optional<widget_timer> iRescalingPoller;
         color_or_gradient iColor;
         neogfx::aspect_ratio iAspectRatio;
         cardinal iPlacement;
         bool iDpiAutoScale;
+        neogfx::resampling_filter iResamplingFilter;
     };
 }
\ No newline at end of file
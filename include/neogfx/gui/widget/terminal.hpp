@@ -24,6 +24,7 @@
 #include <neogfx/gui/widget/scrollable_widget.hpp>
 #include <neogfx/gui/widget/cursor.hpp>
 #include <neogfx/gui/widget/i_terminal.hpp>
+#include <neogfx/gui/widget/terminal_scrollback.hpp>
 
 namespace neogfx
 {
@@ -44,13 +45,11 @@ namespace neogfx
             bool blink = false;
             bool underline = false;
             font_style style = font_style::Normal;
+
+            bool operator==(attribute const&) const = default;
         };
-        struct buffer_line
-        {
-            std::u32string text;
-            mutable optional_glyph_text glyphs;
-            std::vector<attribute> attributes;
-        };
+        typedef basic_terminal_line<attribute> buffer_line;
+        typedef basic_terminal_scrollback<attribute> buffer_lines;
         struct scrolling_region { coordinate_type top; coordinate_type bottom; };
         enum class character_set
         {
@@ -83,7 +82,7 @@ namespace neogfx
         };
         struct buffer : buffer_state
         {
-            std::vector<buffer_line> lines;
+            buffer_lines lines;
             std::vector<buffer_savable_state> saved;
             mutable neogfx::cursor cursor;
 
@@ -107,6 +106,11 @@ namespace neogfx
         bool use_scrollbar_container_updater() const override;
     public:
         void paint(i_graphics_context& aGc) const override;
+        std::size_t glyph_cache_budget() const;
+        void set_glyph_cache_budget(std::size_t aBudget);
+        std::size_t scrollback_line_limit() const;
+        std::size_t scrollback_byte_limit() const;
+        void set_scrollback_limits(std::size_t aLineLimit, std::size_t aByteLimit);
         color palette_color(color_role aColorRole) const override;
     public:
         using base_type::font;
@@ -150,14 +154,18 @@ namespace neogfx
         void erase_in_display(point_type const& aBufferPosStart, point_type const& aBufferPosEnd);
         char32_t to_unicode(char32_t aCharacter) const;
         buffer_line& line(coordinate_type aLine);
-        char32_t& character(point_type const& aBufferPos);
         void output_character(char32_t aCharacter, std::optional<attribute> const& aAttribute = {});
+        void output_characters(std::u32string_view aCharacters, std::optional<attribute> const& aAttribute = {});
+        void damage_line(coordinate_type aLine);
+        void shape_line(i_graphics_context& aGc, buffer_line const& aLine) const;
+        void evict_glyphs(std::size_t aKeep) const;
         point_type buffer_origin() const;
         void set_buffer_origin(point_type aBufferOrigin);
         point_type buffer_pos() const;
         point_type to_buffer_pos(point_type aCursorPos) const;
         point_type cursor_pos() const;
         bool set_cursor_pos(point_type aCursorPos, bool aExtendBuffer = true);
+        void position_cursor();
         void update_cursor();
         rect cursor_rect() const;
         void make_cursor_visible(bool aToBufferOrigin = true);
@@ -165,6 +173,8 @@ namespace neogfx
     private:
         size_type iTerminalSize;
         size_type iBufferSize;
+        std::size_t iScrollbackByteLimit;
+        std::size_t iGlyphCacheBudget;
         mutable optional_font iNormalFont;
         mutable optional_font iBoldFont;
         mutable optional_font iItalicFont;
@@ -175,6 +185,8 @@ namespace neogfx
         buffer iAlternateBuffer = {};
         buffer* iActiveBuffer = &iPrimaryBuffer;
         std::optional<std::string> iEscapeSequence;
+        std::optional<std::pair<coordinate_type, coordinate_type>> iDamagedLines;
+        bool iDamagedAll = false;
         mutable bool iOutputting = false;
         std::uint64_t iCursorAnimationStartTime;
         widget_timer iAnimator;
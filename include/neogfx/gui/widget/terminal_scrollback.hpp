@@ -0,0 +1,657 @@
+// terminal_scrollback.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2022 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <array>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <string_view>
+
+#include <neogfx/gfx/text/glyph_text.hpp>
+
+namespace neogfx
+{
+    // Pooled arena for terminal line text: blocks are carved from large slabs in power of two size classes and
+    // recycled through per-class free lists so appending and trimming lines never touches the general heap.
+    class terminal_text_pool
+    {
+    public:
+        typedef char32_t value_type;
+    private:
+        static constexpr std::size_t MinimumBlockSize = 16u;
+        static constexpr std::size_t SizeClassCount = 20u;
+        static constexpr std::size_t SlabSize = 64u * 1024u;
+    public:
+        terminal_text_pool() = default;
+        terminal_text_pool(terminal_text_pool const&) = delete;
+        terminal_text_pool& operator=(terminal_text_pool const&) = delete;
+    public:
+        std::size_t bytes_in_use() const
+        {
+            return iBytesInUse;
+        }
+        std::size_t bytes_reserved() const
+        {
+            return iBytesReserved;
+        }
+        value_type* allocate(std::size_t aSize, std::size_t& aCapacity)
+        {
+            if (aSize > class_capacity(SizeClassCount - 1u))
+            {
+                // too big for any size class so sized exactly and returned to the heap on deallocation
+                auto block = std::make_unique<value_type[]>(aSize);
+                auto const result = block.get();
+                iOversizeBlocks.emplace(result, std::move(block));
+                aCapacity = aSize;
+                iBytesInUse += aCapacity * sizeof(value_type);
+                iBytesReserved += aCapacity * sizeof(value_type);
+                return result;
+            }
+            auto const sizeClass = size_class(aSize);
+            aCapacity = class_capacity(sizeClass);
+            iBytesInUse += aCapacity * sizeof(value_type);
+            auto& freeList = iFreeLists[sizeClass];
+            if (!freeList.empty())
+            {
+                auto const block = freeList.back();
+                freeList.pop_back();
+                return block;
+            }
+            if (aCapacity > SlabSize)
+            {
+                iSlabs.push_back(std::make_unique<value_type[]>(aCapacity));
+                iBytesReserved += aCapacity * sizeof(value_type);
+                return iSlabs.back().get();
+            }
+            if (iSlabRemaining < aCapacity)
+            {
+                iSlabs.push_back(std::make_unique<value_type[]>(SlabSize));
+                iBytesReserved += SlabSize * sizeof(value_type);
+                iSlabNext = iSlabs.back().get();
+                iSlabRemaining = SlabSize;
+            }
+            auto const block = iSlabNext;
+            iSlabNext += aCapacity;
+            iSlabRemaining -= aCapacity;
+            return block;
+        }
+        void deallocate(value_type* aBlock, std::size_t aCapacity)
+        {
+            iBytesInUse -= aCapacity * sizeof(value_type);
+            if (aCapacity > class_capacity(SizeClassCount - 1u))
+            {
+                iBytesReserved -= aCapacity * sizeof(value_type);
+                iOversizeBlocks.erase(aBlock);
+                return;
+            }
+            iFreeLists[size_class(aCapacity)].push_back(aBlock);
+        }
+    private:
+        static std::size_t size_class(std::size_t aSize)
+        {
+            std::size_t sizeClass = 0u;
+            while (class_capacity(sizeClass) < aSize)
+                ++sizeClass;
+            return sizeClass;
+        }
+        static std::size_t class_capacity(std::size_t aSizeClass)
+        {
+            return MinimumBlockSize << aSizeClass;
+        }
+    private:
+        std::vector<std::unique_ptr<value_type[]>> iSlabs;
+        std::array<std::vector<value_type*>, SizeClassCount> iFreeLists;
+        std::unordered_map<value_type*, std::unique_ptr<value_type[]>> iOversizeBlocks;
+        value_type* iSlabNext = nullptr;
+        std::size_t iSlabRemaining = 0u;
+        std::size_t iBytesInUse = 0u;
+        std::size_t iBytesReserved = 0u;
+    };
+
+    // Glyph runs shaped for terminal lines, most recently used first. Lines register their runs here so that
+    // usage stays exact as lines are reshaped, cleared or recycled, and eviction starts with the stalest line
+    // without visiting the rest of the scrollback.
+    class terminal_glyph_cache
+    {
+    public:
+        struct entry;
+        typedef std::list<entry> entry_list;
+        typedef entry_list::iterator handle;
+        struct entry
+        {
+            glyph_text glyphs;
+            std::size_t bytes;
+            std::optional<handle>* owner;
+        };
+    public:
+        terminal_glyph_cache() = default;
+        terminal_glyph_cache(terminal_glyph_cache const&) = delete;
+        terminal_glyph_cache& operator=(terminal_glyph_cache const&) = delete;
+    public:
+        std::size_t usage() const
+        {
+            return iUsage;
+        }
+        std::size_t size() const
+        {
+            return iEntries.size();
+        }
+        handle add(glyph_text&& aGlyphs, std::optional<handle>& aOwner)
+        {
+            auto const bytes = aGlyphs.size() * sizeof(glyph_char);
+            iEntries.push_front(entry{ std::move(aGlyphs), bytes, &aOwner });
+            iUsage += bytes;
+            return iEntries.begin();
+        }
+        void touch(handle aEntry)
+        {
+            if (aEntry != iEntries.begin())
+                iEntries.splice(iEntries.begin(), iEntries, aEntry);
+        }
+        void relocate(handle aEntry, std::optional<handle>& aOwner)
+        {
+            aEntry->owner = &aOwner;
+        }
+        void remove(handle aEntry)
+        {
+            iUsage -= aEntry->bytes;
+            iEntries.erase(aEntry);
+        }
+        // Evicts least recently used runs until usage is within aBudget, always keeping the aKeep most recently
+        // used runs.
+        void evict(std::size_t aBudget, std::size_t aKeep)
+        {
+            while (iUsage > aBudget && iEntries.size() > aKeep)
+            {
+                auto& stalest = iEntries.back();
+                *stalest.owner = std::nullopt;
+                iUsage -= stalest.bytes;
+                iEntries.pop_back();
+            }
+        }
+    private:
+        entry_list iEntries;
+        std::size_t iUsage = 0u;
+    };
+
+    // A terminal line: text lives in the owning scrollback's pool and attributes are run-length encoded.
+    template <typename Attribute>
+    class basic_terminal_line
+    {
+    public:
+        typedef Attribute attribute_type;
+        struct attribute_run
+        {
+            std::uint32_t length;
+            attribute_type attribute;
+        };
+        typedef std::vector<attribute_run> attribute_runs;
+    public:
+        basic_terminal_line(terminal_text_pool& aPool, terminal_glyph_cache& aGlyphCache) :
+            iPool{ &aPool },
+            iGlyphCache{ &aGlyphCache }
+        {
+        }
+        basic_terminal_line(basic_terminal_line&& aOther) noexcept :
+            iPool{ aOther.iPool },
+            iGlyphCache{ aOther.iGlyphCache },
+            iText{ aOther.iText },
+            iSize{ aOther.iSize },
+            iCapacity{ aOther.iCapacity },
+            iAttributes{ std::move(aOther.iAttributes) },
+            iGlyphs{ std::exchange(aOther.iGlyphs, std::nullopt) }
+        {
+            aOther.iText = nullptr;
+            aOther.iSize = 0u;
+            aOther.iCapacity = 0u;
+            if (iGlyphs)
+                iGlyphCache->relocate(*iGlyphs, iGlyphs);
+        }
+        ~basic_terminal_line()
+        {
+            release();
+            reset_glyphs();
+        }
+    public:
+        basic_terminal_line& operator=(basic_terminal_line&& aOther) noexcept
+        {
+            if (&aOther == this)
+                return *this;
+            release();
+            reset_glyphs();
+            iPool = aOther.iPool;
+            iGlyphCache = aOther.iGlyphCache;
+            iText = aOther.iText;
+            iSize = aOther.iSize;
+            iCapacity = aOther.iCapacity;
+            iAttributes = std::move(aOther.iAttributes);
+            iGlyphs = std::exchange(aOther.iGlyphs, std::nullopt);
+            aOther.iText = nullptr;
+            aOther.iSize = 0u;
+            aOther.iCapacity = 0u;
+            if (iGlyphs)
+                iGlyphCache->relocate(*iGlyphs, iGlyphs);
+            return *this;
+        }
+    public:
+        std::size_t size() const
+        {
+            return iSize;
+        }
+        bool empty() const
+        {
+            return iSize == 0u;
+        }
+        std::size_t capacity() const
+        {
+            return iCapacity;
+        }
+        std::u32string_view text() const
+        {
+            return std::u32string_view{ iText, iSize };
+        }
+        char32_t character(std::size_t aIndex) const
+        {
+            if (aIndex >= iSize)
+                throw std::out_of_range("neogfx::basic_terminal_line::character");
+            return iText[aIndex];
+        }
+        attribute_type const& attribute(std::size_t aIndex) const
+        {
+            for (auto const& run : iAttributes)
+            {
+                if (aIndex < run.length)
+                    return run.attribute;
+                aIndex -= run.length;
+            }
+            throw std::out_of_range("neogfx::basic_terminal_line::attribute");
+        }
+        attribute_runs const& attributes() const
+        {
+            return iAttributes;
+        }
+        bool shaped() const
+        {
+            return iGlyphs.has_value();
+        }
+        // Marks the line's glyph runs as most recently used.
+        glyph_text& glyphs() const
+        {
+            if (!iGlyphs)
+                throw std::logic_error("neogfx::basic_terminal_line::glyphs: not shaped");
+            iGlyphCache->touch(*iGlyphs);
+            return (*iGlyphs)->glyphs;
+        }
+        void set_glyphs(glyph_text&& aGlyphs) const
+        {
+            reset_glyphs();
+            iGlyphs = iGlyphCache->add(std::move(aGlyphs), iGlyphs);
+        }
+        void reset_glyphs() const
+        {
+            if (iGlyphs)
+                iGlyphCache->remove(*std::exchange(iGlyphs, std::nullopt));
+        }
+    public:
+        void set(std::size_t aIndex, char32_t aCharacter, attribute_type const& aAttribute, attribute_type const& aFill)
+        {
+            if (aIndex >= iSize)
+                insert(iSize, aIndex + 1u - iSize, U' ', aFill);
+            iText[aIndex] = aCharacter;
+            set_attribute(aIndex, aAttribute);
+            reset_glyphs();
+        }
+        void replace(std::size_t aIndex, std::u32string_view const& aCharacters, attribute_type const& aAttribute, attribute_type const& aFill)
+        {
+            if (aCharacters.empty())
+                return;
+            auto const end = aIndex + aCharacters.size();
+            if (end > iSize)
+                insert(iSize, end - iSize, U' ', aFill);
+            std::copy(aCharacters.begin(), aCharacters.end(), iText + aIndex);
+            set_attribute(aIndex, end, aAttribute);
+            reset_glyphs();
+        }
+        void set_attribute(std::size_t aIndex, attribute_type const& aAttribute)
+        {
+            if (aIndex >= iSize)
+                throw std::out_of_range("neogfx::basic_terminal_line::set_attribute");
+            if (attribute(aIndex) == aAttribute)
+                return;
+            set_attribute(aIndex, aIndex + 1u, aAttribute);
+        }
+        void set_attribute(std::size_t aFirst, std::size_t aLast, attribute_type const& aAttribute)
+        {
+            aLast = std::min(aLast, iSize);
+            if (aFirst >= aLast)
+                return;
+            auto const firstRun = split(aFirst);
+            auto const lastRun = split(aLast);
+            iAttributes.erase(std::next(iAttributes.begin(), firstRun), std::next(iAttributes.begin(), lastRun));
+            iAttributes.insert(std::next(iAttributes.begin(), firstRun), attribute_run{ static_cast<std::uint32_t>(aLast - aFirst), aAttribute });
+            coalesce(firstRun > 0u ? firstRun - 1u : 0u, firstRun + 2u);
+            reset_glyphs();
+        }
+        void insert(std::size_t aPos, std::size_t aCount, char32_t aCharacter, attribute_type const& aAttribute)
+        {
+            if (aCount == 0u)
+                return;
+            aPos = std::min(aPos, iSize);
+            reserve(iSize + aCount);
+            std::copy_backward(iText + aPos, iText + iSize, iText + iSize + aCount);
+            std::fill(iText + aPos, iText + aPos + aCount, aCharacter);
+            iSize += aCount;
+            auto const run = split(aPos);
+            iAttributes.insert(std::next(iAttributes.begin(), run), attribute_run{ static_cast<std::uint32_t>(aCount), aAttribute });
+            coalesce(run > 0u ? run - 1u : 0u, run + 2u);
+            reset_glyphs();
+        }
+        void erase(std::size_t aFirst, std::size_t aLast)
+        {
+            aLast = std::min(aLast, iSize);
+            if (aFirst >= aLast)
+                return;
+            std::copy(iText + aLast, iText + iSize, iText + aFirst);
+            iSize -= (aLast - aFirst);
+            auto const firstRun = split(aFirst);
+            auto const lastRun = split(aLast);
+            iAttributes.erase(std::next(iAttributes.begin(), firstRun), std::next(iAttributes.begin(), lastRun));
+            coalesce(firstRun > 0u ? firstRun - 1u : 0u, firstRun + 1u);
+            reset_glyphs();
+        }
+        void truncate(std::size_t aSize)
+        {
+            erase(aSize, iSize);
+        }
+        void clear()
+        {
+            release();
+            iAttributes.clear();
+            reset_glyphs();
+        }
+        void reserve(std::size_t aCapacity)
+        {
+            if (aCapacity <= iCapacity)
+                return;
+            std::size_t newCapacity = 0u;
+            auto const newText = iPool->allocate(aCapacity, newCapacity);
+            if (iText)
+            {
+                std::copy(iText, iText + iSize, newText);
+                iPool->deallocate(iText, iCapacity);
+            }
+            iText = newText;
+            iCapacity = newCapacity;
+        }
+    private:
+        void release()
+        {
+            if (iText)
+                iPool->deallocate(iText, iCapacity);
+            iText = nullptr;
+            iSize = 0u;
+            iCapacity = 0u;
+        }
+        // Ensures a run boundary at aIndex, returning the index of the run starting there.
+        std::size_t split(std::size_t aIndex)
+        {
+            std::size_t run = 0u;
+            for (; run < iAttributes.size(); ++run)
+            {
+                if (aIndex == 0u)
+                    return run;
+                if (aIndex < iAttributes[run].length)
+                {
+                    auto const tail = attribute_run{ iAttributes[run].length - static_cast<std::uint32_t>(aIndex), iAttributes[run].attribute };
+                    iAttributes[run].length = static_cast<std::uint32_t>(aIndex);
+                    iAttributes.insert(std::next(iAttributes.begin(), run + 1u), tail);
+                    return run + 1u;
+                }
+                aIndex -= iAttributes[run].length;
+            }
+            return run;
+        }
+        void coalesce(std::size_t aFirstRun, std::size_t aLastRun)
+        {
+            aLastRun = std::min(aLastRun, iAttributes.size());
+            for (auto run = aFirstRun; run + 1u < aLastRun && run + 1u < iAttributes.size();)
+            {
+                if (iAttributes[run].length == 0u)
+                {
+                    iAttributes.erase(std::next(iAttributes.begin(), run));
+                    --aLastRun;
+                }
+                else if (iAttributes[run + 1u].length == 0u || iAttributes[run].attribute == iAttributes[run + 1u].attribute)
+                {
+                    iAttributes[run].length += iAttributes[run + 1u].length;
+                    iAttributes.erase(std::next(iAttributes.begin(), run + 1u));
+                    --aLastRun;
+                }
+                else
+                    ++run;
+            }
+        }
+    private:
+        terminal_text_pool* iPool;
+        terminal_glyph_cache* iGlyphCache;
+        char32_t* iText = nullptr;
+        std::size_t iSize = 0u;
+        std::size_t iCapacity = 0u;
+        attribute_runs iAttributes;
+        mutable std::optional<terminal_glyph_cache::handle> iGlyphs;
+    };
+
+    // Fixed capacity ring of terminal lines; memory is capped by both a line limit and a byte limit.
+    template <typename Attribute>
+    class basic_terminal_scrollback
+    {
+    public:
+        typedef Attribute attribute_type;
+        typedef basic_terminal_line<attribute_type> line_type;
+    public:
+        basic_terminal_scrollback(std::size_t aLineLimit = 250u, std::size_t aByteLimit = 64u * 1024u * 1024u) :
+            iPool{ std::make_unique<terminal_text_pool>() },
+            iGlyphCache{ std::make_unique<terminal_glyph_cache>() },
+            iLineLimit{ std::max<std::size_t>(aLineLimit, 1u) },
+            iByteLimit{ aByteLimit }
+        {
+            iSlots.reserve(iLineLimit);
+        }
+        basic_terminal_scrollback(basic_terminal_scrollback&&) = default;
+        basic_terminal_scrollback& operator=(basic_terminal_scrollback&& aOther) noexcept
+        {
+            if (&aOther == this)
+                return *this;
+            // lines must be released back into our pool before the pool itself is replaced...
+            iSlots.clear();
+            iPool = std::move(aOther.iPool);
+            iGlyphCache = std::move(aOther.iGlyphCache);
+            iSlots = std::move(aOther.iSlots);
+            iHead = std::exchange(aOther.iHead, 0u);
+            iSize = std::exchange(aOther.iSize, 0u);
+            iLineLimit = aOther.iLineLimit;
+            iByteLimit = aOther.iByteLimit;
+            return *this;
+        }
+    public:
+        std::size_t size() const
+        {
+            return iSize;
+        }
+        bool empty() const
+        {
+            return iSize == 0u;
+        }
+        bool full() const
+        {
+            return iSize == iLineLimit;
+        }
+        std::size_t line_limit() const
+        {
+            return iLineLimit;
+        }
+        std::size_t byte_limit() const
+        {
+            return iByteLimit;
+        }
+        terminal_glyph_cache& glyph_cache() const
+        {
+            return *iGlyphCache;
+        }
+        std::size_t bytes() const
+        {
+            return iPool->bytes_in_use() + iSlots.capacity() * sizeof(line_type);
+        }
+        void set_limits(std::size_t aLineLimit, std::size_t aByteLimit)
+        {
+            aLineLimit = std::max<std::size_t>(aLineLimit, 1u);
+            if (iSize > aLineLimit)
+                pop_front(iSize - aLineLimit);
+            linearize();
+            if (iSlots.size() > aLineLimit)
+                iSlots.erase(std::next(iSlots.begin(), aLineLimit), iSlots.end());
+            iLineLimit = aLineLimit;
+            iByteLimit = aByteLimit;
+            iSlots.reserve(iLineLimit);
+        }
+    public:
+        line_type const& operator[](std::size_t aIndex) const
+        {
+            return iSlots[physical(aIndex)];
+        }
+        line_type& operator[](std::size_t aIndex)
+        {
+            return iSlots[physical(aIndex)];
+        }
+        line_type const& back() const
+        {
+            return (*this)[iSize - 1u];
+        }
+        line_type& back()
+        {
+            return (*this)[iSize - 1u];
+        }
+    public:
+        // Appends a blank line, recycling the oldest line if the ring is full.
+        line_type& push_back()
+        {
+            if (full())
+                pop_front();
+            return acquire_slot();
+        }
+        // Inserts a blank line before aIndex; if the ring is full the oldest line is recycled first so the
+        // inserted line's final index may be one less than requested.
+        line_type& insert(std::size_t aIndex)
+        {
+            if (full())
+            {
+                pop_front();
+                if (aIndex > 0u)
+                    --aIndex;
+            }
+            aIndex = std::min(aIndex, iSize);
+            acquire_slot();
+            for (auto i = iSize - 1u; i > aIndex; --i)
+                std::swap(iSlots[physical(i)], iSlots[physical(i - 1u)]);
+            return (*this)[aIndex];
+        }
+        void erase(std::size_t aIndex)
+        {
+            erase(aIndex, aIndex + 1u);
+        }
+        void erase(std::size_t aFirst, std::size_t aLast)
+        {
+            aLast = std::min(aLast, iSize);
+            if (aFirst >= aLast)
+                return;
+            auto const count = aLast - aFirst;
+            if (aFirst == 0u)
+            {
+                pop_front(count);
+                return;
+            }
+            for (auto i = aFirst; i < aLast; ++i)
+                (*this)[i].clear();
+            for (auto i = aLast; i < iSize; ++i)
+                std::swap(iSlots[physical(i - count)], iSlots[physical(i)]);
+            iSize -= count;
+        }
+        void pop_front(std::size_t aCount = 1u)
+        {
+            aCount = std::min(aCount, iSize);
+            for (std::size_t i = 0u; i < aCount; ++i)
+                (*this)[i].clear();
+            if (!iSlots.empty())
+                iHead = (iHead + aCount) % iSlots.size();
+            iSize -= aCount;
+        }
+        void clear()
+        {
+            pop_front(iSize);
+            iHead = 0u;
+        }
+        // Drops the oldest lines until the byte limit is honoured, always keeping at least aMinimumLines lines.
+        std::size_t trim(std::size_t aMinimumLines = 0u)
+        {
+            std::size_t trimmed = 0u;
+            while (iSize > aMinimumLines && bytes() > iByteLimit)
+            {
+                pop_front();
+                ++trimmed;
+            }
+            return trimmed;
+        }
+    private:
+        std::size_t physical(std::size_t aIndex) const
+        {
+            return (iHead + aIndex) % iSlots.size();
+        }
+        line_type& acquire_slot()
+        {
+            if (iSize == iSlots.size())
+            {
+                linearize();
+                iSlots.emplace_back(*iPool, *iGlyphCache);
+            }
+            ++iSize;
+            return back();
+        }
+        void linearize()
+        {
+            if (iHead != 0u)
+                std::rotate(iSlots.begin(), std::next(iSlots.begin(), iHead), iSlots.end());
+            iHead = 0u;
+        }
+    private:
+        std::unique_ptr<terminal_text_pool> iPool;
+        std::unique_ptr<terminal_glyph_cache> iGlyphCache;
+        std::vector<line_type> iSlots;
+        std::size_t iHead = 0u;
+        std::size_t iSize = 0u;
+        std::size_t iLineLimit;
+        std::size_t iByteLimit;
+    };
+}
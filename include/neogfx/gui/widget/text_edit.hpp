@@ -22,6 +22,7 @@
 #include <neogfx/neogfx.hpp>
 
 #include <functional>
+#include <limits>
 
 #include <neolib/core/gap_vector.hpp>
 #include <neolib/core/jar.hpp>
@@ -289,6 +290,43 @@ namespace neogfx
 
         class multiple_text_changes;
 
+        // Paragraph heights in fixed size chunks with Fenwick trees over chunk paragraph counts and chunk heights so
+        // that paragraph y positions resolve in O(log n) and inserting or erasing paragraphs only touches one or two
+        // chunks; the trees are only rebuilt (lazily) when a chunk is split or removed.
+        class paragraph_positions
+        {
+        private:
+            static constexpr std::size_t ChunkSize = 64u;
+            struct chunk
+            {
+                std::vector<dimension> heights;
+                dimension total = 0.0;
+            };
+        public:
+            std::size_t size() const;
+            void reset(std::size_t aCount);
+            void insert(std::size_t aIndex, std::size_t aCount);
+            void erase(std::size_t aFirst, std::size_t aLast);
+            dimension height(std::size_t aIndex) const;
+            void set_height(std::size_t aIndex, dimension aHeight);
+            coordinate ypos(std::size_t aIndex) const;
+            dimension total() const;
+            std::size_t find(coordinate aYpos) const;
+            coordinate offset() const;
+            void set_offset(coordinate aOffset);
+        private:
+            std::pair<std::size_t, std::size_t> locate(std::size_t aIndex) const;
+            void split(std::size_t aChunk);
+            void rebuild() const;
+        private:
+            std::vector<chunk> iChunks;
+            std::size_t iSize = 0u;
+            mutable std::vector<std::ptrdiff_t> iCountTree;
+            mutable std::vector<dimension> iHeightTree;
+            mutable bool iDirty = true;
+            coordinate iOffset = 0.0;
+        };
+
         struct document_char
         {
             char32_t character;
@@ -332,7 +370,6 @@ namespace neogfx
 
             text_edit* owner;
             document_span span;
-            coordinate ypos;
             mutable height_map heightMap;
             column_breaks columnBreaks;
             line_breaks lineBreaks;
@@ -392,7 +429,8 @@ namespace neogfx
         struct glyph_line
         {
             text_edit* owner;
-            std::size_t paragraphIndex;
+            std::size_t paragraphIndex; // encoded, see glyph_column::split
+
             std::size_t columnIndex;
             document_span span;
             coordinate yoffset;
@@ -400,9 +438,13 @@ namespace neogfx
             font_id majorFont;
             scalar baseline;
 
+            std::size_t paragraph_index() const
+            {
+                return column().paragraph_index(*this, owner->iGlyphParagraphs.size());
+            }
             glyph_paragraph& paragraph() const
             {
-                return owner->iGlyphParagraphs[paragraphIndex];
+                return owner->iGlyphParagraphs[paragraph_index()];
             }
             glyph_column& column() const
             {
@@ -446,14 +488,14 @@ namespace neogfx
             }
             paragraph_line_span paragraph_span() const
             {
-                paragraph_line_span result = { paragraphIndex, paragraph().span, span };
+                paragraph_line_span result = { paragraph_index(), paragraph().span, span };
                 if (glyph_end() != owner->glyphs().end() && is_line_breaking_whitespace(*glyph_end()))
                     ++result.lineSpan.glyphsLast;
                 return result;
             }
             coordinate ypos() const
             {
-                return yoffset + paragraph().ypos;
+                return yoffset + owner->iParagraphPositions.ypos(paragraph_index());
             }
         };
         using glyph_lines = neolib::vecarray<glyph_line, 8, -1>;
@@ -463,11 +505,31 @@ namespace neogfx
             text_edit* owner;
             glyph_lines lines;
             dimension width = 0.0;
+            // Lines before the split hold their paragraph index and lines from the split onwards hold it counted back
+            // from the paragraph count, so paragraphs inserted or removed at the split leave every stored index valid
+            // and an edit only re-encodes the lines between it and the previous edit.
+            std::size_t split = std::numeric_limits<std::size_t>::max();
 
             std::size_t index() const
             {
                 return std::distance(&*owner->iGlyphColumns.cbegin(), this);
             }
+            void clear()
+            {
+                lines.clear();
+                split = std::numeric_limits<std::size_t>::max();
+            }
+            std::size_t paragraph_index(glyph_line const& aLine, std::size_t aParagraphCount) const
+            {
+                return aLine.index() < split ? aLine.paragraphIndex : aParagraphCount - aLine.paragraphIndex;
+            }
+            void move_split(std::size_t aSplit, std::size_t aParagraphCount)
+            {
+                auto const oldSplit = std::min(split, lines.size());
+                for (auto i = std::min(aSplit, oldSplit); i < std::max(aSplit, oldSplit); ++i)
+                    lines[i].paragraphIndex = aParagraphCount - lines[i].paragraphIndex;
+                split = aSplit;
+            }
         };
         using glyph_columns = neolib::vecarray<glyph_column, 4, -1>;
 
@@ -475,6 +537,10 @@ namespace neogfx
 
     private:
         class dragger;
+        class preshaping_job;
+        static constexpr std::size_t AsyncShapingThreshold = 256u * 1024u;
+        static constexpr std::size_t AsyncShapingChunkSize = 16u * 1024u;
+        static constexpr std::chrono::milliseconds AsyncShapingTimeSlice{ 8 };
 
     public:
         using position_type = document_text::difference_type;
@@ -574,6 +640,10 @@ namespace neogfx
         void set_read_only(bool aReadOnly = true);
         bool word_wrap() const;
         void set_word_wrap(bool aWordWrap = true);
+        bool incremental_reflow() const;
+        void set_incremental_reflow(bool aIncrementalReflow = true);
+        bool async_shaping() const;
+        void set_async_shaping(bool aAsyncShaping = true);
         std::uint32_t grow_lines() const;
         void set_grow_lines(std::uint32_t aGrowLines = 5u);
         bool password() const;
@@ -658,8 +728,21 @@ namespace neogfx
         std::optional<glyph_lines::const_iterator> next_line(std::optional<glyph_lines::const_iterator> const& aFrom) const;
         std::optional<glyph_lines::const_iterator> previous_line(std::optional<glyph_lines::const_iterator> const& aFrom) const;
         void refresh_paragraph(document_text::const_iterator aWhere, ptrdiff_t aDelta);
+        std::size_t shape_paragraphs(document_text::const_iterator aFirst, document_text::const_iterator aLast, document_glyphs::const_iterator& aGlyphsInsertPos, 
+            glyph_paragraphs::const_iterator& aParagraphsInsertPos, std::ptrdiff_t& aCharsInserted, std::ptrdiff_t& aGlyphsInserted);
+        neogfx::font character_font(document_text::const_iterator aParagraph, std::vector<std::u32string::difference_type> const& aColumnDelimiters, std::u32string::size_type aSourceIndex) const;
+        document_text::const_iterator shaping_boundary(document_text::const_iterator aFrom, std::size_t aMaxParagraphs, std::size_t aMaxCharacters) const;
+        void shape_next_chunk(std::optional<position_type> const& aUntil = {});
+        void preshape_chunk(document_text::const_iterator aFirst, document_text::const_iterator aLast);
+        position_type shaped_text_size() const;
+        void ensure_shaped(position_type aPosition);
+        void refresh_paragraphs(std::size_t aFirstParagraph, std::size_t aRemovedParagraphs, std::size_t aAddedParagraphs, bool aReflow);
+        void estimate_text_extents();
         void refresh_columns();
         void refresh_lines();
+        bool reflow_paragraphs(std::size_t aFirstParagraph, std::size_t aRemovedParagraphs, std::size_t aAddedParagraphs);
+        dimension layout_paragraph(glyph_paragraphs::iterator aParagraph, dimension aAvailableWidth);
+        void align_paragraphs();
         void animate();
         void update_cursor();
         void make_cursor_visible(bool aForcePreviewScroll = false);
@@ -692,6 +775,7 @@ namespace neogfx
         mutable std::optional<document_glyphs> iGlyphs;
         glyph_paragraphs iGlyphParagraphs;
         glyph_columns iGlyphColumns;
+        paragraph_positions iParagraphPositions;
         optional_size iTextExtents;
         std::uint64_t iCursorAnimationStartTime;
         neogfx::size_hint iSizeHint;
@@ -701,6 +785,9 @@ namespace neogfx
         mutable std::optional<std::pair<neogfx::font, neogfx::tab_stops>> iCalculatedTabStops;
         basic_point<std::optional<dimension>> iCursorHint;
         widget_timer iAnimator;
+        std::optional<position_type> iShapingPosition;
+        std::optional<widget_timer> iShaper;
+        std::unique_ptr<preshaping_job> iPreshaper;
         std::unique_ptr<dragger> iDragger;
         std::unique_ptr<neogfx::context_menu> iMenu;
         std::uint32_t iSuppressTextChangedNotification;
@@ -711,6 +798,8 @@ namespace neogfx
     public:
         define_property(property_category::other, bool, ReadOnly, read_only, false)
         define_property(property_category::other, bool, WordWrap, word_wrap, (iCaps & text_edit_caps::MultiLine) == text_edit_caps::MultiLine)
+        define_property(property_category::other, bool, IncrementalReflow, incremental_reflow, false)
+        define_property(property_category::other, bool, AsyncShaping, async_shaping, false)
         define_property(property_category::other, std::uint32_t, GrowLines, grow_lines, 5u)
         define_property(property_category::other, bool, Password, password, false)
         define_property(property_category::other, string, PasswordMask, password_mask)
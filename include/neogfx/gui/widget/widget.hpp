@@ -210,6 +210,9 @@ namespace neogfx
         void paint_non_client(i_graphics_context& aGc) const override;
         void paint(i_graphics_context& aGc) const override;
         void paint_non_client_after(i_graphics_context& aGc) const override;
+        bool cache_as_texture() const override;
+        void set_cache_as_texture(bool aCacheAsTexture) override;
+        void invalidate_render_cache() override;
     public:
         double opacity() const override;
         void set_opacity(double aOpacity) override;
@@ -285,6 +288,9 @@ namespace neogfx
     public:
         const i_widget& widget_for_mouse_event(const point& aPosition, bool aForHitTest = false) const override;
         i_widget& widget_for_mouse_event(const point& aPosition, bool aForHitTest = false) override;
+    private:
+        bool render_cached(i_graphics_context& aGc) const;
+        void render_uncached(i_graphics_context& aGc) const;
         // helpers
     public:
         using base_type::set_size_policy;
@@ -380,6 +386,7 @@ namespace neogfx
         std::int32_t iLayer;
         optional_view iView;
         std::optional<std::int32_t> iRenderLayer;
+        mutable bool iRenderCacheValid;
         // properties / anchors
     public:
         define_property(property_category::hard_geometry, optional_logical_coordinate_system, LogicalCoordinateSystem, logical_coordinate_system)
@@ -387,6 +394,7 @@ namespace neogfx
         define_property(property_category::other_appearance, bool, Enabled, enabled, true)
         define_property(property_category::other, optional_focus_policy, FocusPolicy, focus_policy)
         define_property(property_category::other_appearance, double, Opacity, opacity, 1.0)
+        define_property(property_category::other_appearance, bool, CacheAsTexture, cache_as_texture, false)
         define_property(property_category::other_appearance, optional<double>, BackgroundOpacity, background_opacity)
         define_property(property_category::other_appearance, optional<neogfx::palette>, Palette, palette)
         define_property(property_category::font, optional_font_role, FontRole, font_role)
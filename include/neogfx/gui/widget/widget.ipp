@@ -25,6 +25,7 @@
 #include <neogfx/app/i_app.hpp>
 #include <neogfx/gfx/graphics_context.hpp>
 #include <neogfx/gui/widget/widget.hpp>
+#include <neogfx/gui/widget/i_widget_render_cache.hpp>
 #include <neogfx/gui/layout/i_async_layout.hpp>
 #include <neogfx/gui/layout/i_layout.hpp>
 #include <neogfx/gui/layout/i_layout_item_cache.hpp>
@@ -44,7 +45,8 @@ namespace neogfx
         iResizing{ false },
         iLayoutPending{ false },
         iLayoutInProgress{ 0 },
-        iLayer{ LayerWidget }
+        iLayer{ LayerWidget },
+        iRenderCacheValid{ false }
     {
         base_type::Position.Changed([this](const point&) { moved(); });
         base_type::Size.Changed([this](const size&) { resized(); });
@@ -62,7 +64,8 @@ namespace neogfx
         iResizing{ false },
         iLayoutPending{ false },
         iLayoutInProgress{ 0 },
-        iLayer{ LayerWidget }
+        iLayer{ LayerWidget },
+        iRenderCacheValid{ false }
     {
         base_type::Position.Changed([this](const point&) { moved(); });
         base_type::Size.Changed([this](const size&) { resized(); });
@@ -81,7 +84,8 @@ namespace neogfx
         iResizing{ false },
         iLayoutPending{ false },
         iLayoutInProgress{ 0 },
-        iLayer{ LayerWidget }
+        iLayer{ LayerWidget },
+        iRenderCacheValid{ false }
     {
         base_type::Position.Changed([this](const point&) { moved(); });
         base_type::Size.Changed([this](const size&) { resized(); });
@@ -92,6 +96,8 @@ namespace neogfx
     template <WidgetInterface Interface>
     inline widget<Interface>::~widget()
     {
+        if (CacheAsTexture)
+            service<i_widget_render_cache>().release(*this);
         unlink();
         if (service<i_keyboard>().is_keyboard_grabbed_by(*this))
             service<i_keyboard>().ungrab_keyboard(*this);
@@ -1207,6 +1213,13 @@ namespace neogfx
             return false;
         if (aUpdateRect.empty())
             return false;
+        for (i_widget* w = this;; w = &w->parent())
+        {
+            if (w->cache_as_texture())
+                w->invalidate_render_cache();
+            if (!w->has_parent())
+                break;
+        }
         surface().invalidate_surface(to_window_coordinates(aUpdateRect));
         return true;
     }
@@ -1248,13 +1261,76 @@ namespace neogfx
     template <WidgetInterface Interface>
     inline void widget<Interface>::render(i_graphics_context& aGc) const
     {
-        auto& self = *this;
-
         if (effectively_hidden())
             return;
         if (!requires_update())
             return;
 
+        if (cache_as_texture() && render_cached(aGc))
+            return;
+
+        render_uncached(aGc);
+    }
+
+    template <WidgetInterface Interface>
+    inline bool widget<Interface>::render_cached(i_graphics_context& aGc) const
+    {
+        auto& self = *this;
+
+        scoped_units su{ *this, units::Pixels };
+
+        iDefaultNonClientClipRect = invalid;
+        iDefaultClientClipRect = invalid;
+
+        auto& renderCache = service<i_widget_render_cache>();
+        rect const nonClientRect = non_client_rect();
+        rect const wholeRect = to_client_coordinates(nonClientRect);
+        rect const updateRect = update_rect();
+
+        i_texture const* cachedTexture = iRenderCacheValid ? renderCache.find(*this) : nullptr;
+        if (cachedTexture != nullptr && cachedTexture->extents() != nonClientRect.extents().ceil())
+            cachedTexture = nullptr;
+        if (cachedTexture == nullptr)
+        {
+            iRenderCacheValid = false;
+            // only a fully visible widget that is being repainted in its entirety can be captured...
+            if (updateRect != wholeRect || default_clip_rect(true) != wholeRect)
+                return false;
+            cachedTexture = renderCache.acquire(*this, nonClientRect.extents());
+            if (cachedTexture == nullptr)
+                return false;
+            iRenderCacheValid = true;
+            aGc.flush();
+            {
+                graphics_context cacheGc{ *cachedTexture };
+                scoped_render_target srt{ cacheGc };
+                cacheGc.set_logical_coordinate_system(aGc.logical_coordinate_system());
+                cacheGc.clear(color{ vec4{ 0.0, 0.0, 0.0, 0.0 } });
+                cacheGc.clear_depth_buffer();
+                cacheGc.clear_stencil_buffer();
+                cacheGc.set_offset((-nonClientRect.top_left()).to_vec2());
+                render_uncached(cacheGc);
+            }
+            iDefaultNonClientClipRect = invalid;
+            iDefaultClientClipRect = invalid;
+        }
+
+        aGc.set_extents(self.extents());
+        aGc.set_origin(self.origin());
+
+        scoped_snap_to_pixel snap{ aGc };
+        scoped_scissor scissor{ aGc, default_clip_rect(true).intersection(updateRect) };
+        scoped_blending_mode sbm{ aGc, neogfx::blending_mode::Blit };
+        aGc.draw_texture(rect{ wholeRect.top_left(), cachedTexture->extents() }, *cachedTexture);
+
+        return true;
+    }
+
+    template <WidgetInterface Interface>
+    inline void widget<Interface>::render_uncached(i_graphics_context& aGc) const
+    {
+        auto& self = *this;
+
         scoped_units su{ *this, units::Pixels };
 
         iDefaultNonClientClipRect = invalid;
@@ -1465,6 +1541,34 @@ namespace neogfx
         // do nothing
     }
 
+    template <WidgetInterface Interface>
+    inline bool widget<Interface>::cache_as_texture() const
+    {
+        return CacheAsTexture;
+    }
+
+    template <WidgetInterface Interface>
+    inline void widget<Interface>::set_cache_as_texture(bool aCacheAsTexture)
+    {
+        if (CacheAsTexture != aCacheAsTexture)
+        {
+            CacheAsTexture = aCacheAsTexture;
+            iRenderCacheValid = false;
+            if (!aCacheAsTexture)
+                service<i_widget_render_cache>().release(*this);
+            update(true);
+        }
+    }
+
+    template <WidgetInterface Interface>
+    inline void widget<Interface>::invalidate_render_cache()
+    {
+        if (!iRenderCacheValid)
+            return;
+        iRenderCacheValid = false;
+        update(true);
+    }
+
     template <WidgetInterface Interface>
     inline double widget<Interface>::opacity() const
     {
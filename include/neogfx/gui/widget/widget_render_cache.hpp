@@ -0,0 +1,67 @@
+// widget_render_cache.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <list>
+#include <unordered_map>
+
+#include <neogfx/gfx/texture.hpp>
+#include <neogfx/gui/widget/i_widget_render_cache.hpp>
+
+namespace neogfx
+{
+    class widget_render_cache : public i_widget_render_cache
+    {
+    public:
+        static constexpr std::uint64_t DefaultBudget = 64ull * 1024ull * 1024ull;
+    private:
+        struct entry
+        {
+            i_widget const* widget;
+            neogfx::texture texture;
+            std::uint64_t bytes;
+            std::uint64_t lastUsedFrame;
+        };
+        typedef std::list<entry> entry_list;
+        typedef std::unordered_map<i_widget const*, entry_list::iterator> entry_map;
+    public:
+        widget_render_cache();
+    public:
+        std::uint64_t budget() const final;
+        void set_budget(std::uint64_t aBudget) final;
+        std::uint64_t usage() const final;
+        std::uint32_t count() const final;
+    public:
+        i_texture const* find(i_widget const& aWidget) final;
+        i_texture const* acquire(i_widget const& aWidget, size const& aExtents) final;
+        void release(i_widget const& aWidget) final;
+        void clear() final;
+    private:
+        bool evict(std::uint64_t aBudget);
+        void erase(entry_list::iterator aEntry);
+    private:
+        std::uint64_t iBudget;
+        std::uint64_t iUsage;
+        entry_list iEntries;
+        entry_map iIndex;
+    };
+}
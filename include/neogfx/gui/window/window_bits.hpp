@@ -58,6 +58,7 @@ namespace neogfx
         InitiallyCentered           = 0x04000000,    // Center on desktop or parent
         InitiallyRenderable         = 0x08000000,
         SizeToContents              = 0x10000000,
+        Offscreen                   = 0x20000000,    // The window has no desktop presence and renders into an offscreen bitmap (headless)
         Weak                        = 0x80000000,
         Default                     = Main | TitleBar | SystemMenu | Menu | MinimizeBox | MaximizeBox | Resize | SizeGrip | Close | DropShadow | InitiallyCentered | InitiallyRenderable,
         DefaultDialog               = (Default | Dialog) & ~(InitiallyRenderable | Main | Menu),
@@ -124,6 +125,7 @@ declare_enum_string(neogfx::window_style, HideOnParentClick)
 declare_enum_string(neogfx::window_style, InitiallyHidden)
 declare_enum_string(neogfx::window_style, InitiallyCentered)
 declare_enum_string(neogfx::window_style, DropShadow)
+declare_enum_string(neogfx::window_style, Offscreen)
 declare_enum_string(neogfx::window_style, Weak)
 declare_enum_string(neogfx::window_style, Default)
 declare_enum_string(neogfx::window_style, DefaultDialog)
@@ -32,12 +32,14 @@ namespace neogfx
     class i_rendering_engine;
     class i_rendering_context;
     class i_widget;
+    class i_image;
 
     class i_native_surface : public i_render_target, public i_property_owner, public i_reference_counted
     {
     public:
         struct context_mismatch : std::logic_error { context_mismatch() : std::logic_error("neogfx::i_native_surface::context_mismatch") {} };
         struct no_invalidated_area : std::logic_error { no_invalidated_area() : std::logic_error("neogfx::i_native_surface::no_invalidated_area") {} };
+        struct nothing_rendered : std::logic_error { nothing_rendered() : std::logic_error("neogfx::i_native_surface::nothing_rendered") {} };
     public:
         typedef i_native_surface abstract_type;
     public:
@@ -50,12 +52,16 @@ namespace neogfx
         virtual void invalidate(const rect& aInvalidatedRect) = 0;
         virtual bool has_invalidated_area() const = 0;
         virtual const rect& invalidated_area() const = 0;
+        virtual std::size_t invalidated_region_count() const = 0;
+        virtual const rect& invalidated_region(std::size_t aIndex) const = 0;
         virtual rect validate() = 0;
         virtual bool can_render() const = 0;
         virtual void render(bool aOOBRequest = false) = 0;
         virtual void pause() = 0;
         virtual void resume() = 0;
         virtual bool is_rendering() const = 0;
+        // Copies the most recently rendered frame into aImage as unpremultiplied RGBA8 with the top row first.
+        virtual void snapshot(i_image& aImage) const = 0;
         using i_render_target::create_graphics_context;
         virtual std::unique_ptr<i_rendering_context> create_graphics_context(const i_widget& aWidget, blending_mode aBlendingMode = blending_mode::Default) const = 0; // todo: use ref_ptr
     public:
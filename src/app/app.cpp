@@ -32,12 +32,14 @@
 #include <neolib/app/power.hpp>
 #include <neogfx/gfx/image.hpp>
 #include <neogfx/gfx/i_gradient_manager.hpp>
+#include <neogfx/gfx/i_image_decoder.hpp>
 #include <neogfx/app/app.hpp>
 #include <neogfx/hid/surface_manager.hpp>
 #include <neogfx/hid/i_hid_devices.hpp>
 #include <neogfx/app/resource_manager.hpp>
 #include <neogfx/gui/window/window.hpp>
 #include <neogfx/gui/widget/i_menu.hpp>
+#include <neogfx/gui/widget/i_widget_render_cache.hpp>
 #include <neogfx/app/i_clipboard.hpp>
 #include <neogfx/core/i_transition_animator.hpp>
 #include <neogfx/gui/window/i_native_window.hpp>
@@ -62,6 +64,7 @@ namespace neogfx
             ("fullscreen", boost::program_options::value<std::string>()->implicit_value(""s), "run full screen")
             ("dpi", boost::program_options::value<std::string>()->implicit_value(""s), "DPI override")
             ("nest", "display child windows nested within main window rather than using the main desktop")
+            ("offscreen", "render windows into offscreen bitmaps rather than onto the desktop (headless, uses software renderer)")
             ("vulkan", "use Vulkan renderer")
             ("directx", "use DirectX (ANGLE) renderer")
             ("software", "use software renderer")
@@ -88,7 +91,7 @@ namespace neogfx
             return neogfx::renderer::Vulkan;
         else if (options().count("directx") == 1)
             return neogfx::renderer::DirectX;
-        else if (options().count("software") == 1)
+        else if (options().count("software") == 1 || options().count("offscreen") == 1)
             return neogfx::renderer::Software;
         else
             return neogfx::renderer::OpenGL;
@@ -150,6 +153,11 @@ namespace neogfx
         return options().count("nest") == 1;
     }
 
+    bool program_options::offscreen() const
+    {
+        return options().count("offscreen") == 1;
+    }
+
     namespace
     {
         std::atomic<app*> sFirstInstance;
@@ -182,6 +190,8 @@ namespace neogfx
         iApp.plugin_manager().unload_plugins();
         iApp.iThread.reset();
         teardown_service<i_animator>();
+        teardown_service<i_image_decoder>();
+        teardown_service<i_widget_render_cache>();
         teardown_service<i_gradient_manager>();
         teardown_service<i_rendering_engine>();
         app* tp = &iApp;
@@ -28,6 +28,7 @@
 #include "../../hid/native/windows_mouse.hpp"
 #include "../../hid/native/windows_window_manager.hpp"
 #include "../../gfx/native/windows_renderer.hpp"
+#include "../../gfx/native/software/software_renderer.hpp"
 #include "windows_drag_drop.hpp"
 //#include "../../audio/native/windows_audio.hpp"
 #include "windows_accessibility.hpp"
@@ -65,12 +66,23 @@ template<> neogfx::i_mouse& services::start_service<neogfx::i_mouse>()
 template<> neogfx::i_rendering_engine& services::start_service<neogfx::i_rendering_engine>()
 { 
     auto const& programOptions = service<neogfx::i_app>().program_options();
+    if (programOptions.renderer() == neogfx::renderer::Software)
+    {
+        static neogfx::software_renderer sSoftwareRenderer{ programOptions.renderer() };
+        return sSoftwareRenderer;
+    }
     static neogfx::native::windows::renderer sWindowsRenderer{ programOptions.renderer() };
     return sWindowsRenderer; 
 }
 
 template<> void services::teardown_service<neogfx::i_rendering_engine>()
 {
+    if (auto softwareRenderer = dynamic_cast<neogfx::software_renderer*>(&service<neogfx::i_rendering_engine>()))
+    {
+        softwareRenderer->~software_renderer();
+        new(softwareRenderer) neogfx::software_renderer{ neogfx::renderer::None };
+        return;
+    }
     static_cast<neogfx::native::windows::renderer&>(service<neogfx::i_rendering_engine>()).~renderer();
     new(&service<neogfx::i_rendering_engine>()) neogfx::native::windows::renderer{ neogfx::renderer::None };
 }
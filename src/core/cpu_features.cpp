@@ -0,0 +1,65 @@
+// cpu_features.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "cpu_features.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        cpu_features detect_cpu_features()
+        {
+            cpu_features result{};
+#if defined(NEOGFX_X86)
+#if defined(_MSC_VER)
+            int info[4] = {};
+            __cpuid(info, 0);
+            int const maxLeaf = info[0];
+            __cpuid(info, 1);
+            result.sse2 = (info[3] & (1 << 26)) != 0;
+            result.sse41 = (info[2] & (1 << 19)) != 0;
+            bool const osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6u) == 0x6u;
+            if (maxLeaf >= 7 && osSavesYmm)
+            {
+                __cpuidex(info, 7, 0);
+                result.avx2 = (info[1] & (1 << 5)) != 0;
+            }
+#else
+            __builtin_cpu_init();
+            result.sse2 = __builtin_cpu_supports("sse2");
+            result.sse41 = __builtin_cpu_supports("sse4.1");
+            result.avx2 = __builtin_cpu_supports("avx2");
+#endif
+#endif
+            return result;
+        }
+    }
+
+    cpu_features const& host_cpu_features()
+    {
+        static cpu_features const sFeatures = detect_cpu_features();
+        return sFeatures;
+    }
+}
@@ -0,0 +1,49 @@
+// cpu_features.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NEOGFX_X86
+#include <immintrin.h>
+#endif
+
+// Functions using instructions beyond the compiler's baseline must be marked for GCC/Clang; MSVC
+// accepts intrinsics for any instruction set so the markers expand to nothing there.
+#if defined(NEOGFX_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NEOGFX_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define NEOGFX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define NEOGFX_TARGET_SSE41
+#define NEOGFX_TARGET_AVX2
+#endif
+
+namespace neogfx
+{
+    struct cpu_features
+    {
+        bool sse2;
+        bool sse41;
+        bool avx2;
+    };
+
+    cpu_features const& host_cpu_features();
+}
@@ -20,6 +20,9 @@
 #include <neogfx/neogfx.hpp>
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <tuple>
 #include <iomanip>
 #include <boost/lexical_cast.hpp>
@@ -28,6 +31,7 @@
 #include <neolib/core/string_ci.hpp>
 #include <neogfx/core/numerical.hpp>
 #include <neogfx/gfx/color.hpp>
+#include "color_conversion.hpp"
 
 namespace neogfx
 {
@@ -49,6 +53,383 @@ namespace neogfx
             return std::pow(l, 1 / 2.4) * 1.055 - 0.055 * scale;
     }
 
+    namespace
+    {
+        // Encoding uses a table of the 8-bit value at the start of each of LinearBuckets equal buckets
+        // of linear intensity plus the linear thresholds at which the rounded 8-bit value steps up; no
+        // bucket contains more than one threshold so one comparison gives the correctly rounded result.
+        std::size_t constexpr LinearBuckets = 16384u;
+
+        struct sRGB_tables
+        {
+            std::array<float, 256> toLinear;
+            std::array<float, 257> thresholds;
+            std::array<std::uint8_t, LinearBuckets + 4u> fromLinear; // padded for 32-bit gathers
+
+            sRGB_tables()
+            {
+                for (std::size_t value = 0u; value < 256u; ++value)
+                    toLinear[value] = static_cast<float>(sRGB_to_linear(value / 255.0));
+                thresholds[0u] = -std::numeric_limits<float>::infinity();
+                for (std::size_t value = 1u; value < 256u; ++value)
+                {
+                    // rounded up so that comparing a float with it is the same as comparing with the exact value
+                    double const threshold = sRGB_to_linear((value - 0.5) / 255.0);
+                    thresholds[value] = static_cast<float>(threshold);
+                    if (thresholds[value] < threshold)
+                        thresholds[value] = std::nextafter(thresholds[value], std::numeric_limits<float>::infinity());
+                }
+                thresholds[256u] = std::numeric_limits<float>::infinity();
+                fromLinear.fill(0xFFu);
+                std::size_t value = 0u;
+                for (std::size_t bucket = 0u; bucket <= LinearBuckets; ++bucket)
+                {
+                    while (thresholds[value + 1u] <= static_cast<float>(bucket) / LinearBuckets)
+                        ++value;
+                    fromLinear[bucket] = static_cast<std::uint8_t>(value);
+                }
+            }
+            static sRGB_tables const& instance()
+            {
+                static sRGB_tables const sTables;
+                return sTables;
+            }
+        };
+
+        inline std::uint32_t div255(std::uint32_t aValue)
+        {
+            aValue += 128u;
+            return (aValue + (aValue >> 8u)) >> 8u;
+        }
+
+        void sRGB_to_linear_scalar(std::uint8_t const* aSource, float* aDestination, std::size_t aCount)
+        {
+            auto const& tables = sRGB_tables::instance();
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                aDestination[i] = tables.toLinear[aSource[i]];
+                aDestination[i + 1u] = tables.toLinear[aSource[i + 1u]];
+                aDestination[i + 2u] = tables.toLinear[aSource[i + 2u]];
+                aDestination[i + 3u] = aSource[i + 3u] * (1.0f / 255.0f);
+            }
+        }
+
+        void linear_to_sRGB_scalar(float const* aSource, std::uint8_t* aDestination, std::size_t aCount)
+        {
+            auto const& tables = sRGB_tables::instance();
+            for (std::size_t i = 0u; i < aCount; ++i)
+            {
+                if (i % 4u == 3u)
+                    aDestination[i] = detail::to_component(aSource[i]);
+                else
+                {
+                    float const source = detail::saturate(aSource[i]);
+                    std::uint32_t const value = tables.fromLinear[static_cast<std::size_t>(source * LinearBuckets)];
+                    aDestination[i] = static_cast<std::uint8_t>(value + (source >= tables.thresholds[value + 1u] ? 1u : 0u));
+                }
+            }
+        }
+
+        void premultiply_scalar(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                std::uint32_t const alpha = aPixels[i + 3u];
+                for (std::size_t component = 0u; component < 3u; ++component)
+                    aPixels[i + component] = static_cast<std::uint8_t>(div255(aPixels[i + component] * alpha));
+            }
+        }
+
+        void premultiply_scalar(float* aPixels, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                float const alpha = aPixels[i + 3u];
+                for (std::size_t component = 0u; component < 3u; ++component)
+                    aPixels[i + component] *= alpha;
+            }
+        }
+
+        void unpremultiply_scalar(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                float const alpha = aPixels[i + 3u];
+                for (std::size_t component = 0u; component < 3u; ++component)
+                    aPixels[i + component] = alpha == 0.0f ? 0u :
+                        static_cast<std::uint8_t>(std::min(aPixels[i + component] * 255.0f / alpha + 0.5f, 255.0f));
+            }
+        }
+
+        void unpremultiply_scalar(float* aPixels, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                float const alpha = aPixels[i + 3u];
+                for (std::size_t component = 0u; component < 3u; ++component)
+                    aPixels[i + component] = alpha == 0.0f ? 0.0f : aPixels[i + component] / alpha;
+            }
+        }
+
+        void swap_red_blue_scalar(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+                std::swap(aPixels[i], aPixels[i + 2u]);
+        }
+
+#ifdef NEOGFX_X86
+        inline __m128i div255_epi16(__m128i aValue)
+        {
+            __m128i const biased = _mm_add_epi16(aValue, _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_add_epi16(biased, _mm_srli_epi16(biased, 8)), 8);
+        }
+
+        // Multiplies the colour components of two pixels widened to 16 bits by their alpha.
+        inline __m128i premultiply_epi16(__m128i aPixels)
+        {
+            __m128i const alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(aPixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m128i const factor = _mm_or_si128(_mm_and_si128(alpha, _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1)), _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+            return div255_epi16(_mm_mullo_epi16(aPixels, factor));
+        }
+
+        void premultiply_sse2(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            std::size_t i = 0u;
+            for (; i + 16u <= aCount; i += 16u)
+            {
+                __m128i const pixels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(aPixels + i));
+                __m128i const lo = premultiply_epi16(_mm_unpacklo_epi8(pixels, zero));
+                __m128i const hi = premultiply_epi16(_mm_unpackhi_epi8(pixels, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(aPixels + i), _mm_packus_epi16(lo, hi));
+            }
+            premultiply_scalar(aPixels + i, aCount - i);
+        }
+
+        // Returns the alpha of a pixel in every lane but the alpha lane, which is one.
+        inline __m128 color_factor_ps(__m128 aPixel)
+        {
+            __m128 const alpha = _mm_shuffle_ps(aPixel, aPixel, _MM_SHUFFLE(3, 3, 3, 3));
+            return _mm_or_ps(_mm_and_ps(alpha, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1))), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+        }
+
+        void premultiply_sse2(float* aPixels, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                __m128 const pixel = _mm_loadu_ps(aPixels + i);
+                _mm_storeu_ps(aPixels + i, _mm_mul_ps(pixel, color_factor_ps(pixel)));
+            }
+        }
+
+        // Computes the same expression as unpremultiply_scalar for one pixel widened to 32 bits.
+        inline __m128i unpremultiply_epi32(__m128i aPixel)
+        {
+            __m128 const pixel = _mm_cvtepi32_ps(aPixel);
+            __m128 const alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+            __m128 const result = _mm_min_ps(_mm_add_ps(_mm_div_ps(_mm_mul_ps(pixel, _mm_set1_ps(255.0f)), alpha), _mm_set1_ps(0.5f)), _mm_set1_ps(255.0f));
+            return _mm_cvttps_epi32(_mm_andnot_ps(_mm_cmpeq_ps(alpha, _mm_setzero_ps()), result));
+        }
+
+        void unpremultiply_sse2(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const alphaBytes = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+            std::size_t i = 0u;
+            for (; i + 16u <= aCount; i += 16u)
+            {
+                __m128i const pixels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(aPixels + i));
+                __m128i const lo = _mm_unpacklo_epi8(pixels, zero);
+                __m128i const hi = _mm_unpackhi_epi8(pixels, zero);
+                __m128i const result = _mm_packus_epi16(
+                    _mm_packs_epi32(unpremultiply_epi32(_mm_unpacklo_epi16(lo, zero)), unpremultiply_epi32(_mm_unpackhi_epi16(lo, zero))),
+                    _mm_packs_epi32(unpremultiply_epi32(_mm_unpacklo_epi16(hi, zero)), unpremultiply_epi32(_mm_unpackhi_epi16(hi, zero))));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(aPixels + i), _mm_or_si128(_mm_andnot_si128(alphaBytes, result), _mm_and_si128(alphaBytes, pixels)));
+            }
+            unpremultiply_scalar(aPixels + i, aCount - i);
+        }
+
+        void unpremultiply_sse2(float* aPixels, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                __m128 const pixel = _mm_loadu_ps(aPixels + i);
+                __m128 const factor = color_factor_ps(pixel);
+                __m128 const transparent = _mm_cmpeq_ps(_mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3)), _mm_setzero_ps());
+                _mm_storeu_ps(aPixels + i, _mm_andnot_ps(transparent, _mm_div_ps(pixel, factor)));
+            }
+        }
+
+        void swap_red_blue_sse2(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            __m128i const redBlue = _mm_set1_epi32(0x00FF00FF);
+            std::size_t i = 0u;
+            for (; i + 16u <= aCount; i += 16u)
+            {
+                __m128i const pixels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(aPixels + i));
+                __m128i const swapped = _mm_and_si128(pixels, redBlue);
+                __m128i const result = _mm_or_si128(_mm_andnot_si128(redBlue, pixels), _mm_or_si128(_mm_slli_epi32(swapped, 16), _mm_srli_epi32(swapped, 16)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(aPixels + i), result);
+            }
+            swap_red_blue_scalar(aPixels + i, aCount - i);
+        }
+
+        NEOGFX_TARGET_AVX2 void sRGB_to_linear_avx2(std::uint8_t const* aSource, float* aDestination, std::size_t aCount)
+        {
+            auto const& tables = sRGB_tables::instance();
+            __m256 const alphaScale = _mm256_set1_ps(1.0f / 255.0f);
+            std::size_t i = 0u;
+            for (; i + 8u <= aCount; i += 8u)
+            {
+                __m256i const source = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(aSource + i)));
+                __m256 const color = _mm256_i32gather_ps(tables.toLinear.data(), source, 4);
+                __m256 const alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(source), alphaScale);
+                _mm256_storeu_ps(aDestination + i, _mm256_blend_ps(color, alpha, 0x88));
+            }
+            sRGB_to_linear_scalar(aSource + i, aDestination + i, aCount - i);
+        }
+
+        NEOGFX_TARGET_AVX2 void linear_to_sRGB_avx2(float const* aSource, std::uint8_t* aDestination, std::size_t aCount)
+        {
+            auto const& tables = sRGB_tables::instance();
+            __m256 const zero = _mm256_setzero_ps();
+            __m256 const one = _mm256_set1_ps(1.0f);
+            __m256 const buckets = _mm256_set1_ps(static_cast<float>(LinearBuckets));
+            std::size_t i = 0u;
+            for (; i + 8u <= aCount; i += 8u)
+            {
+                __m256 const source = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(aSource + i), zero), one);
+                __m256i const bucket = _mm256_cvttps_epi32(_mm256_mul_ps(source, buckets));
+                __m256i const value = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<int const*>(tables.fromLinear.data()), bucket, 1), _mm256_set1_epi32(0xFF));
+                __m256 const threshold = _mm256_i32gather_ps(tables.thresholds.data(), _mm256_add_epi32(value, _mm256_set1_epi32(1)), 4);
+                __m256i const color = _mm256_sub_epi32(value, _mm256_castps_si256(_mm256_cmp_ps(source, threshold, _CMP_GE_OQ)));
+                __m256i const alpha = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(source, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+                __m256i const result = _mm256_blend_epi32(color, alpha, 0x88);
+                __m128i const packed = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(aDestination + i), _mm_packus_epi16(packed, packed));
+            }
+            linear_to_sRGB_scalar(aSource + i, aDestination + i, aCount - i);
+        }
+
+        NEOGFX_TARGET_AVX2 inline __m256i div255_epi16(__m256i aValue)
+        {
+            __m256i const biased = _mm256_add_epi16(aValue, _mm256_set1_epi16(128));
+            return _mm256_srli_epi16(_mm256_add_epi16(biased, _mm256_srli_epi16(biased, 8)), 8);
+        }
+
+        NEOGFX_TARGET_AVX2 inline __m256i premultiply_epi16(__m256i aPixels)
+        {
+            __m256i const alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(aPixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m256i const factor = _mm256_or_si256(
+                _mm256_and_si256(alpha, _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1)),
+                _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0));
+            return div255_epi16(_mm256_mullo_epi16(aPixels, factor));
+        }
+
+        NEOGFX_TARGET_AVX2 void premultiply_avx2(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            __m256i const zero = _mm256_setzero_si256();
+            std::size_t i = 0u;
+            for (; i + 32u <= aCount; i += 32u)
+            {
+                __m256i const pixels = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(aPixels + i));
+                __m256i const lo = premultiply_epi16(_mm256_unpacklo_epi8(pixels, zero));
+                __m256i const hi = premultiply_epi16(_mm256_unpackhi_epi8(pixels, zero));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(aPixels + i), _mm256_packus_epi16(lo, hi));
+            }
+            premultiply_sse2(aPixels + i, aCount - i);
+        }
+
+        NEOGFX_TARGET_AVX2 void swap_red_blue_avx2(std::uint8_t* aPixels, std::size_t aCount)
+        {
+            __m256i const shuffle = _mm256_setr_epi8(
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            std::size_t i = 0u;
+            for (; i + 32u <= aCount; i += 32u)
+            {
+                __m256i const pixels = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(aPixels + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(aPixels + i), _mm256_shuffle_epi8(pixels, shuffle));
+            }
+            swap_red_blue_sse2(aPixels + i, aCount - i);
+        }
+#endif
+
+        detail::color_kernels const& select_color_kernels()
+        {
+            static detail::color_kernels const sKernels = detail::color_kernels_for(host_cpu_features());
+            return sKernels;
+        }
+    }
+
+    namespace detail
+    {
+        color_kernels color_kernels_for(cpu_features const& aFeatures)
+        {
+            color_kernels kernels{ &sRGB_to_linear_scalar, &linear_to_sRGB_scalar, &premultiply_scalar, &premultiply_scalar, &unpremultiply_scalar, &unpremultiply_scalar, &swap_red_blue_scalar };
+#ifdef NEOGFX_X86
+            if (aFeatures.sse2)
+            {
+                kernels.premultiply8 = &premultiply_sse2;
+                kernels.premultiplyFloat = &premultiply_sse2;
+                kernels.unpremultiply8 = &unpremultiply_sse2;
+                kernels.unpremultiplyFloat = &unpremultiply_sse2;
+                kernels.swapRedBlue = &swap_red_blue_sse2;
+            }
+            if (aFeatures.sse2 && aFeatures.avx2)
+            {
+                kernels.sRGBToLinear = &sRGB_to_linear_avx2;
+                kernels.linearToSRGB = &linear_to_sRGB_avx2;
+                kernels.premultiply8 = &premultiply_avx2;
+                kernels.swapRedBlue = &swap_red_blue_avx2;
+            }
+#endif
+            return kernels;
+        }
+    }
+
+    void sRGB_to_linear(std::span<std::uint8_t const> aSource, std::span<float> aDestination)
+    {
+        detail::check_pixel_buffer(aSource.size(), aDestination.size());
+        select_color_kernels().sRGBToLinear(aSource.data(), aDestination.data(), aSource.size());
+    }
+
+    void linear_to_sRGB(std::span<float const> aSource, std::span<std::uint8_t> aDestination)
+    {
+        detail::check_pixel_buffer(aSource.size(), aDestination.size());
+        select_color_kernels().linearToSRGB(aSource.data(), aDestination.data(), aSource.size());
+    }
+
+    void premultiply(std::span<std::uint8_t> aPixels)
+    {
+        detail::check_pixel_buffer(aPixels.size(), aPixels.size());
+        select_color_kernels().premultiply8(aPixels.data(), aPixels.size());
+    }
+
+    void premultiply(std::span<float> aPixels)
+    {
+        detail::check_pixel_buffer(aPixels.size(), aPixels.size());
+        select_color_kernels().premultiplyFloat(aPixels.data(), aPixels.size());
+    }
+
+    void unpremultiply(std::span<std::uint8_t> aPixels)
+    {
+        detail::check_pixel_buffer(aPixels.size(), aPixels.size());
+        select_color_kernels().unpremultiply8(aPixels.data(), aPixels.size());
+    }
+
+    void unpremultiply(std::span<float> aPixels)
+    {
+        detail::check_pixel_buffer(aPixels.size(), aPixels.size());
+        select_color_kernels().unpremultiplyFloat(aPixels.data(), aPixels.size());
+    }
+
+    void swap_red_blue(std::span<std::uint8_t> aPixels)
+    {
+        detail::check_pixel_buffer(aPixels.size(), aPixels.size());
+        select_color_kernels().swapRedBlue(aPixels.data(), aPixels.size());
+    }
+
     sRGB_color sRGB_color::from_linear(const linear_color& aLinear)
     {
         return sRGB_color{ linear_to_sRGB(aLinear.x), linear_to_sRGB(aLinear.y), linear_to_sRGB(aLinear.z), aLinear[3] };
@@ -0,0 +1,235 @@
+// color_conversion.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <neogfx/gfx/color.hpp>
+#include "../core/cpu_features.hpp"
+
+namespace neogfx::detail
+{
+    // Helpers shared by the batch pixel conversions. A converter is a type with a static convert
+    // function taking the first three components of a pixel by reference (and, on x86, an overload
+    // taking those components of four pixels as vectors) that must perform the same floating point
+    // operations in both so that results do not depend on the code path taken; alpha is never touched.
+
+    // The RGBA pixel buffer kernels behind sRGB_to_linear, premultiply and friends; the implementation
+    // used is chosen once for the host CPU but color_kernels_for can give those of any feature set
+    // (features the host lacks must not be requested).
+    struct color_kernels
+    {
+        void(*sRGBToLinear)(std::uint8_t const*, float*, std::size_t);
+        void(*linearToSRGB)(float const*, std::uint8_t*, std::size_t);
+        void(*premultiply8)(std::uint8_t*, std::size_t);
+        void(*premultiplyFloat)(float*, std::size_t);
+        void(*unpremultiply8)(std::uint8_t*, std::size_t);
+        void(*unpremultiplyFloat)(float*, std::size_t);
+        void(*swapRedBlue)(std::uint8_t*, std::size_t);
+    };
+
+    color_kernels color_kernels_for(cpu_features const& aFeatures);
+
+    inline void check_pixel_buffer(std::size_t aSourceSize, std::size_t aDestinationSize)
+    {
+        if (aSourceSize != aDestinationSize || aSourceSize % 4u != 0u)
+            throw bad_pixel_buffer();
+    }
+
+    inline float saturate(float aValue)
+    {
+        return std::min(std::max(0.0f, aValue), 1.0f); // NaN becomes 0
+    }
+
+    inline std::uint8_t to_component(float aValue)
+    {
+        return static_cast<std::uint8_t>(saturate(aValue) * 255.0f + 0.5f);
+    }
+
+    // Hue in degrees of an RGB colour given its largest component and chroma; zero if achromatic.
+    inline float hue_from_rgb(float aRed, float aGreen, float aBlue, float aMax, float aChroma)
+    {
+        if (aChroma == 0.0f)
+            return 0.0f;
+        float sector;
+        if (aMax == aRed)
+            sector = (aGreen - aBlue) / aChroma;
+        else if (aMax == aGreen)
+            sector = (aBlue - aRed) / aChroma + 2.0f;
+        else
+            sector = (aRed - aGreen) / aChroma + 4.0f;
+        float const hue = sector * 60.0f;
+        return hue < 0.0f ? hue + 360.0f : hue;
+    }
+
+    // Hue in degrees wrapped to sextants of the colour wheel in the range [0, 6].
+    inline float hue_sextant(float aHue)
+    {
+        float const sextant = aHue / 60.0f;
+        return sextant - 6.0f * std::floor(sextant / 6.0f);
+    }
+
+    template <typename Converter>
+    void convert_pixels_scalar(float const* aSource, float* aDestination, std::size_t aCount)
+    {
+        for (std::size_t i = 0u; i < aCount; i += 4u)
+        {
+            float component0 = aSource[i];
+            float component1 = aSource[i + 1u];
+            float component2 = aSource[i + 2u];
+            Converter::convert(component0, component1, component2);
+            aDestination[i] = component0;
+            aDestination[i + 1u] = component1;
+            aDestination[i + 2u] = component2;
+            aDestination[i + 3u] = aSource[i + 3u];
+        }
+    }
+
+    template <typename Converter>
+    void convert_pixels_scalar(float const* aSource, std::uint8_t* aDestination, std::size_t aCount)
+    {
+        for (std::size_t i = 0u; i < aCount; i += 4u)
+        {
+            float component0 = aSource[i];
+            float component1 = aSource[i + 1u];
+            float component2 = aSource[i + 2u];
+            Converter::convert(component0, component1, component2);
+            aDestination[i] = to_component(component0);
+            aDestination[i + 1u] = to_component(component1);
+            aDestination[i + 2u] = to_component(component2);
+            aDestination[i + 3u] = to_component(aSource[i + 3u]);
+        }
+    }
+
+#ifdef NEOGFX_X86
+    inline __m128 select_ps(__m128 aMask, __m128 aTrue, __m128 aFalse)
+    {
+        return _mm_or_ps(_mm_and_ps(aMask, aTrue), _mm_andnot_ps(aMask, aFalse));
+    }
+
+    inline __m128 abs_ps(__m128 aValue)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), aValue);
+    }
+
+    // SSE2 has no rounding instructions; valid for magnitudes below 2^31.
+    inline __m128 floor_ps(__m128 aValue)
+    {
+        __m128 const truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(aValue));
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, aValue), _mm_set1_ps(1.0f)));
+    }
+
+    inline __m128 saturate_ps(__m128 aValue)
+    {
+        return _mm_min_ps(_mm_max_ps(aValue, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    }
+
+    inline __m128i to_components_epi32(__m128 aValue)
+    {
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(saturate_ps(aValue), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+    }
+
+    inline __m128 hue_from_rgb_ps(__m128 aRed, __m128 aGreen, __m128 aBlue, __m128 aMax, __m128 aChroma)
+    {
+        __m128 const sector = select_ps(_mm_cmpeq_ps(aMax, aRed), _mm_div_ps(_mm_sub_ps(aGreen, aBlue), aChroma),
+            select_ps(_mm_cmpeq_ps(aMax, aGreen),
+                _mm_add_ps(_mm_div_ps(_mm_sub_ps(aBlue, aRed), aChroma), _mm_set1_ps(2.0f)),
+                _mm_add_ps(_mm_div_ps(_mm_sub_ps(aRed, aGreen), aChroma), _mm_set1_ps(4.0f))));
+        __m128 hue = _mm_mul_ps(sector, _mm_set1_ps(60.0f));
+        hue = _mm_add_ps(hue, _mm_and_ps(_mm_cmplt_ps(hue, _mm_setzero_ps()), _mm_set1_ps(360.0f)));
+        return _mm_andnot_ps(_mm_cmpeq_ps(aChroma, _mm_setzero_ps()), hue);
+    }
+
+    inline __m128 hue_sextant_ps(__m128 aHue)
+    {
+        __m128 const sextant = _mm_div_ps(aHue, _mm_set1_ps(60.0f));
+        return _mm_sub_ps(sextant, _mm_mul_ps(_mm_set1_ps(6.0f), floor_ps(_mm_div_ps(sextant, _mm_set1_ps(6.0f)))));
+    }
+
+    // Four pixels at a time transposed so that each vector holds one component of all four.
+    template <typename Converter>
+    void convert_pixels_sse2(float const* aSource, float* aDestination, std::size_t aCount)
+    {
+        std::size_t i = 0u;
+        for (; i + 16u <= aCount; i += 16u)
+        {
+            __m128 component0 = _mm_loadu_ps(aSource + i);
+            __m128 component1 = _mm_loadu_ps(aSource + i + 4u);
+            __m128 component2 = _mm_loadu_ps(aSource + i + 8u);
+            __m128 component3 = _mm_loadu_ps(aSource + i + 12u);
+            _MM_TRANSPOSE4_PS(component0, component1, component2, component3);
+            Converter::convert(component0, component1, component2);
+            _MM_TRANSPOSE4_PS(component0, component1, component2, component3);
+            _mm_storeu_ps(aDestination + i, component0);
+            _mm_storeu_ps(aDestination + i + 4u, component1);
+            _mm_storeu_ps(aDestination + i + 8u, component2);
+            _mm_storeu_ps(aDestination + i + 12u, component3);
+        }
+        convert_pixels_scalar<Converter>(aSource + i, aDestination + i, aCount - i);
+    }
+
+    template <typename Converter>
+    void convert_pixels_sse2(float const* aSource, std::uint8_t* aDestination, std::size_t aCount)
+    {
+        std::size_t i = 0u;
+        for (; i + 16u <= aCount; i += 16u)
+        {
+            __m128 component0 = _mm_loadu_ps(aSource + i);
+            __m128 component1 = _mm_loadu_ps(aSource + i + 4u);
+            __m128 component2 = _mm_loadu_ps(aSource + i + 8u);
+            __m128 component3 = _mm_loadu_ps(aSource + i + 12u);
+            _MM_TRANSPOSE4_PS(component0, component1, component2, component3);
+            Converter::convert(component0, component1, component2);
+            _MM_TRANSPOSE4_PS(component0, component1, component2, component3);
+            __m128i const lo = _mm_packs_epi32(to_components_epi32(component0), to_components_epi32(component1));
+            __m128i const hi = _mm_packs_epi32(to_components_epi32(component2), to_components_epi32(component3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aDestination + i), _mm_packus_epi16(lo, hi));
+        }
+        convert_pixels_scalar<Converter>(aSource + i, aDestination + i, aCount - i);
+    }
+#endif
+
+    // The pixel buffer kernels behind the hsv_color and hsl_color to_rgb and from_rgb overloads; as with
+    // color_kernels_for, hsv_kernels_for and hsl_kernels_for can give those of any feature set.
+    struct hue_kernels
+    {
+        void(*toRgb)(float const*, float*, std::size_t);
+        void(*toRgb8)(float const*, std::uint8_t*, std::size_t);
+        void(*fromRgb)(float const*, float*, std::size_t);
+    };
+
+    hue_kernels hsv_kernels_for(cpu_features const& aFeatures);
+    hue_kernels hsl_kernels_for(cpu_features const& aFeatures);
+
+    template <typename ToRgb, typename FromRgb>
+    hue_kernels hue_kernels_for(cpu_features const& aFeatures)
+    {
+#ifdef NEOGFX_X86
+        if (aFeatures.sse2)
+            return hue_kernels{ &convert_pixels_sse2<ToRgb>, &convert_pixels_sse2<ToRgb>, &convert_pixels_sse2<FromRgb> };
+#endif
+        return hue_kernels{ &convert_pixels_scalar<ToRgb>, &convert_pixels_scalar<ToRgb>, &convert_pixels_scalar<FromRgb> };
+    }
+}
@@ -105,7 +105,8 @@ namespace neogfx
         iOpacity{ 1.0 },
         iBlendingMode{ neogfx::blending_mode::Default },
         iSmoothingMode{ neogfx::smoothing_mode::None },
-        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() }
+        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() },
+        iRecording{ nullptr }
     {
     }
 
@@ -120,7 +121,8 @@ namespace neogfx
         iOpacity{ 1.0 },
         iBlendingMode{ neogfx::blending_mode::Default },
         iSmoothingMode{ neogfx::smoothing_mode::None },
-        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() }
+        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() },
+        iRecording{ nullptr }
     {
     }
 
@@ -136,7 +138,8 @@ namespace neogfx
         iOpacity{ 1.0 },
         iBlendingMode{ neogfx::blending_mode::Default },
         iSmoothingMode{ neogfx::smoothing_mode::None },
-        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() }
+        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() },
+        iRecording{ nullptr }
     {
         set_logical_coordinate_system(aWidget.logical_coordinate_system());
     }
@@ -152,7 +155,8 @@ namespace neogfx
         iOpacity{ 1.0 },
         iBlendingMode{ neogfx::blending_mode::Default },
         iSmoothingMode{ neogfx::smoothing_mode::None },
-        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() }
+        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() },
+        iRecording{ nullptr }
     {
     }
 
@@ -171,7 +175,8 @@ namespace neogfx
         iOpacity{ 1.0 },
         iBlendingMode{ neogfx::blending_mode::Default },
         iSmoothingMode{ neogfx::smoothing_mode::None },
-        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() }
+        iSubpixelRendering{ service<i_rendering_engine>().is_subpixel_rendering_on() },
+        iRecording{ nullptr }
     {
     }
 
@@ -219,6 +224,21 @@ namespace neogfx
             native_context().flush();
     }
 
+    void graphics_context::begin_recording(graphics_operation::recording& aRecording)
+    {
+        std::as_const(*this).begin_recording(aRecording);
+    }
+
+    void graphics_context::end_recording()
+    {
+        std::as_const(*this).end_recording();
+    }
+
+    void graphics_context::replay(graphics_operation::recording const& aRecording, vec2 const& aOffset, double aOpacity)
+    {
+        native_context().replay(aRecording, aOffset, aOpacity);
+    }
+
     delta graphics_context::to_device_units(delta const& aValue) const
     {
         return units_converter{ *this }.to_device_units(aValue);
@@ -336,12 +356,15 @@ namespace neogfx
 
     vec2 graphics_context::offset() const
     {
-        throw not_implemented();
+        return iOffset;
     }
 
     void graphics_context::set_offset(optional_vec2 const& aOffset)
     {
-        throw not_implemented();
+        // the offset (device units) is folded into the origin so it applies to every operation enqueued...
+        auto const currentOrigin = origin();
+        iOffset = aOffset.value_or(vec2{});
+        set_origin(currentOrigin);
     }
 
     bool graphics_context::gradient_set() const
@@ -371,16 +394,17 @@ namespace neogfx
 
     void graphics_context::set_origin(point const& aOrigin) const
     {
-        if (iOrigin != to_device_units(aOrigin))
+        auto const newOrigin = to_device_units(aOrigin) + point{ iOffset.x, iOffset.y };
+        if (iOrigin != newOrigin)
         {
-            iOrigin = to_device_units(aOrigin);
+            iOrigin = newOrigin;
             native_context().enqueue(graphics_operation::set_origin{ iOrigin });
         }
     }
 
     point graphics_context::origin() const
     {
-        return from_device_units(iOrigin);
+        return from_device_units(iOrigin - point{ iOffset.x, iOffset.y });
     }
 
     void graphics_context::clear_gradient()
@@ -490,7 +514,10 @@ namespace neogfx
         for (auto const& subPath : aPath.sub_paths())
         {
             ssbo_range vertices = path_to_vertices(path, subPath);
-            iSsboRanges.push_back(vertices);
+            if (recording())
+                iRecording->adopt(vertices);
+            else
+                iSsboRanges.push_back(vertices);
             draw_path(vertices, path.shape(), path.bounding_rect(), aPen, aFill);
         }
     }
@@ -584,7 +611,7 @@ namespace neogfx
 
     size graphics_context::text_extent(std::string::const_iterator aTextBegin, std::string::const_iterator aTextEnd, font const& aFont) const
     {
-        return text_extent(aTextBegin, aTextEnd, [&aFont](std::size_t) { return aFont; });
+        return glyph_text_extent(service<i_font_manager>().cached_glyph_text(*this, std::to_address(aTextBegin), std::to_address(aTextEnd), aFont));
     }
 
     size graphics_context::text_extent(std::string::const_iterator aTextBegin, std::string::const_iterator aTextEnd, std::function<font(std::size_t)> aFontSelector) const
@@ -695,7 +722,7 @@ namespace neogfx
 
     void graphics_context::draw_text(vec3 const& aPoint, std::string::const_iterator aTextBegin, std::string::const_iterator aTextEnd, font const& aFont, text_format const& aTextFormat) const
     {
-        draw_glyph_text(aPoint, to_glyph_text(aTextBegin, aTextEnd, aTextFormat.apply(aFont)), aTextFormat);
+        draw_glyph_text(aPoint, service<i_font_manager>().cached_glyph_text(*this, std::to_address(aTextBegin), std::to_address(aTextEnd), aTextFormat.apply(aFont)), aTextFormat);
     }
 
     void graphics_context::draw_multiline_text(point const& aPoint, std::string const& aText, text_format const& aTextFormat, alignment aAlignment) const
@@ -735,7 +762,8 @@ namespace neogfx
     
     void graphics_context::draw_multiline_text(vec3 const& aPoint, std::string const& aText, font const& aFont, dimension aMaxWidth, text_format const& aTextFormat, alignment aAlignment) const
     {
-        draw_multiline_glyph_text(aPoint, to_multiline_glyph_text(aText, aTextFormat.apply(aFont), aMaxWidth, aAlignment), aTextFormat);
+        draw_multiline_glyph_text(aPoint, to_multiline_glyph_text(
+            service<i_font_manager>().cached_glyph_text(*this, aText.data(), aText.data() + aText.size(), aTextFormat.apply(aFont)), aMaxWidth, aAlignment), aTextFormat);
     }
 
     void graphics_context::draw_glyph_text(point const& aPoint, glyph_text const& aText, text_format const& aTextFormat) const
@@ -863,6 +891,37 @@ namespace neogfx
         native_context().flush();
     }
 
+    bool graphics_context::recording() const
+    {
+        return iRecording != nullptr;
+    }
+
+    void graphics_context::begin_recording(graphics_operation::recording& aRecording) const
+    {
+        if (recording())
+            throw already_recording();
+        aRecording.clear();
+        aRecording.set_origin(iOrigin);
+        iRecording = &aRecording;
+        native_context().begin_recording(aRecording);
+    }
+
+    void graphics_context::end_recording() const
+    {
+        if (!recording())
+            throw not_recording();
+        native_context().end_recording();
+        iRecording = nullptr;
+    }
+
+    void graphics_context::replay(graphics_operation::recording const& aRecording, point const& aPosition, double aOpacity) const
+    {
+        if (recording())
+            throw already_recording();
+        auto const translation = to_device_units(aPosition) + iOrigin - aRecording.origin();
+        native_context().replay(aRecording, translation.to_vec2(), aOpacity);
+    }
+
     void graphics_context::set_viewport(optional_rect const& aViewport) const
     {
         if (aViewport)
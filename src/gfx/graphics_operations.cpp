@@ -20,6 +20,7 @@
 #include <neogfx/neogfx.hpp>
 
 #include <neogfx/gfx/graphics_operations.hpp>
+#include <neogfx/gfx/i_rendering_engine.hpp>
 #include "native/i_native_texture.hpp"
 
 namespace neogfx
@@ -33,7 +34,9 @@ namespace neogfx
             case Invalid: return "Invalid";
             case SetLogicalCoordinateSystem: return "SetLogicalCoordinateSystem";
             case SetLogicalCoordinates: return "SetLogicalCoordinates";
+            case SetOrigin: return "SetOrigin";
             case SetViewport: return "SetViewport";
+            case SetViewTransformation: return "SetViewTransformation";
             case ScissorOn: return "ScissorOn";
             case ScissorOff: return "ScissorOff";
             case SnapToPixelOn: return "SnapToPixelOn";
@@ -50,14 +53,21 @@ namespace neogfx
             case Clear: return "Clear";
             case ClearDepthBuffer: return "ClearDepthBuffer";
             case ClearStencilBuffer: return "ClearStencilBuffer";
+            case ClearGradient: return "ClearGradient";
+            case SetGradient: return "SetGradient";
             case SetPixel: return "SetPixel";
             case DrawPixel: return "DrawPixel";
             case DrawLine: return "DrawLine";
+            case DrawTriangle: return "DrawTriangle";
             case DrawRect: return "DrawRect";
             case DrawRoundedRect: return "DrawRoundedRect";
+            case DrawEllipseRect: return "DrawEllipseRect";
             case DrawCheckerboard: return "DrawCheckerboard";
             case DrawCircle: return "DrawCircle";
+            case DrawEllipse: return "DrawEllipse";
+            case DrawPie: return "DrawPie";
             case DrawArc: return "DrawArc";
+            case DrawCubicBezier: return "DrawCubicBezier";
             case DrawPath: return "DrawPath";
             case DrawShape: return "DrawShape";
             case DrawEntities: return "DrawEntities";
@@ -231,5 +241,352 @@ namespace neogfx
                 return false;
             }
         }
+
+        namespace
+        {
+            // maximum number of operations a draw operation may be moved past when reordering
+            std::size_t constexpr ReorderWindow = 64u;
+
+            rect normalized_rect(const point& aP0, const point& aP1)
+            {
+                return rect{ aP0.min(aP1), aP0.max(aP1) };
+            }
+
+            rect normalized_rect(const rect& aRect)
+            {
+                return normalized_rect(aRect.top_left(), aRect.bottom_right());
+            }
+
+            rect stroked(const rect& aRect, const pen& aPen)
+            {
+                // allow for pen width and anti-aliasing
+                return aRect.inflated(aPen.width() + 1.0, aPen.width() + 1.0);
+            }
+
+            rect stroked(const point& aCenter, dimension aRadiusX, dimension aRadiusY, const pen& aPen)
+            {
+                return stroked(normalized_rect(aCenter - point{ aRadiusX, aRadiusY }, aCenter + point{ aRadiusX, aRadiusY }), aPen);
+            }
+
+            optional_rect glyphs_bounding_rect(const draw_glyphs& aDrawGlyphs)
+            {
+                optional_rect result;
+                auto a = aDrawGlyphs.attributes.begin();
+                for (auto g = aDrawGlyphs.begin; g != aDrawGlyphs.end; ++g)
+                {
+                    while (a != aDrawGlyphs.attributes.end() && (g - aDrawGlyphs.begin) >= a->end)
+                        ++a;
+                    auto const& glyphChar = *g;
+                    rect glyphRect{ to_aabb_2d(glyphChar.cell.begin(), glyphChar.cell.end()) };
+                    glyphRect.translate(point{ aDrawGlyphs.point });
+                    // glyph shapes can overhang their cell (italics, accents, emoji) so be generous
+                    dimension margin = glyphRect.cy / 2.0 + 1.0;
+                    if (a != aDrawGlyphs.attributes.end() && (g - aDrawGlyphs.begin) >= a->start && a->attributes.effect())
+                    {
+                        auto const& effect = a->attributes.effect().value();
+                        margin += effect.width() + std::max(std::abs(effect.offset().x), std::abs(effect.offset().y));
+                    }
+                    glyphRect.inflate(margin, margin);
+                    result = result ? result->combined(glyphRect) : glyphRect;
+                }
+                return result;
+            }
+        }
+
+        optional_rect bounding_rect(const operation& aOperation)
+        {
+            switch (static_cast<operation_type>(aOperation.index()))
+            {
+            case operation_type::SetPixel:
+                {
+                    auto const& op = static_variant_cast<const set_pixel&>(aOperation);
+                    return rect{ op.point, size{ 1.0 } }.inflated(1.0, 1.0);
+                }
+            case operation_type::DrawPixel:
+                {
+                    auto const& op = static_variant_cast<const draw_pixel&>(aOperation);
+                    return rect{ op.point, size{ 1.0 } }.inflated(1.0, 1.0);
+                }
+            case operation_type::DrawLine:
+                {
+                    auto const& op = static_variant_cast<const draw_line&>(aOperation);
+                    return stroked(normalized_rect(op.from, op.to), op.pen);
+                }
+            case operation_type::DrawTriangle:
+                {
+                    auto const& op = static_variant_cast<const draw_triangle&>(aOperation);
+                    return stroked(normalized_rect(op.p0.min(op.p1).min(op.p2), op.p0.max(op.p1).max(op.p2)), op.pen);
+                }
+            case operation_type::DrawRect:
+                {
+                    auto const& op = static_variant_cast<const draw_rect&>(aOperation);
+                    return stroked(normalized_rect(op.rect), op.pen);
+                }
+            case operation_type::DrawRoundedRect:
+                {
+                    auto const& op = static_variant_cast<const draw_rounded_rect&>(aOperation);
+                    return stroked(normalized_rect(op.rect), op.pen);
+                }
+            case operation_type::DrawEllipseRect:
+                {
+                    auto const& op = static_variant_cast<const draw_ellipse_rect&>(aOperation);
+                    return stroked(normalized_rect(op.rect), op.pen);
+                }
+            case operation_type::DrawCheckerboard:
+                {
+                    auto const& op = static_variant_cast<const draw_checkerboard&>(aOperation);
+                    return stroked(normalized_rect(op.rect), op.pen);
+                }
+            case operation_type::DrawCircle:
+                {
+                    auto const& op = static_variant_cast<const draw_circle&>(aOperation);
+                    return stroked(op.center, op.radius, op.radius, op.pen);
+                }
+            case operation_type::DrawEllipse:
+                {
+                    auto const& op = static_variant_cast<const draw_ellipse&>(aOperation);
+                    return stroked(op.center, op.radiusA, op.radiusB, op.pen);
+                }
+            case operation_type::DrawPie:
+                {
+                    auto const& op = static_variant_cast<const draw_pie&>(aOperation);
+                    return stroked(op.center, op.radius, op.radius, op.pen);
+                }
+            case operation_type::DrawArc:
+                {
+                    auto const& op = static_variant_cast<const draw_arc&>(aOperation);
+                    return stroked(op.center, op.radius, op.radius, op.pen);
+                }
+            case operation_type::DrawCubicBezier:
+                {
+                    // a cubic bezier lies within the convex hull of its control points
+                    auto const& op = static_variant_cast<const draw_cubic_bezier&>(aOperation);
+                    return stroked(normalized_rect(op.p0.min(op.p1).min(op.p2).min(op.p3), op.p0.max(op.p1).max(op.p2).max(op.p3)), op.pen);
+                }
+            case operation_type::DrawPath:
+                {
+                    auto const& op = static_variant_cast<const draw_path&>(aOperation);
+                    return stroked(normalized_rect(op.boundingRect), op.pen);
+                }
+            case operation_type::DrawShape:
+                {
+                    auto const& op = static_variant_cast<const draw_shape&>(aOperation);
+                    if (op.mesh.vertices.empty())
+                        return {};
+                    point minVertex{ op.mesh.vertices[0] };
+                    point maxVertex{ op.mesh.vertices[0] };
+                    for (auto const& v : op.mesh.vertices)
+                    {
+                        minVertex = minVertex.min(point{ v });
+                        maxVertex = maxVertex.max(point{ v });
+                    }
+                    return stroked(normalized_rect(minVertex, maxVertex).translated(point{ op.position }), op.pen);
+                }
+            case operation_type::DrawGlyph:
+                return glyphs_bounding_rect(static_variant_cast<const draw_glyphs&>(aOperation));
+            default:
+                // state changes, clears, entities and transformed meshes act as barriers
+                return {};
+            }
+        }
+
+        std::uint32_t batch_count(const queue& aQueue)
+        {
+            std::uint32_t result = 0u;
+            for (auto batchStart = aQueue.begin(); batchStart != aQueue.end(); ++result)
+            {
+                auto batchEnd = std::next(batchStart);
+                while (batchEnd != aQueue.end() && batchable(*batchStart, *batchEnd))
+                    ++batchEnd;
+                batchStart = batchEnd;
+            }
+            return result;
+        }
+
+        std::uint32_t reorder(queue& aQueue)
+        {
+            if (aQueue.size() < 3u)
+                return 0u;
+
+            thread_local std::vector<optional_rect> bounds;
+            thread_local std::vector<bool> scheduled;
+            thread_local std::vector<std::size_t> order;
+            thread_local std::vector<rect> skipped;
+            bounds.clear();
+            scheduled.assign(aQueue.size(), false);
+            order.clear();
+
+            for (auto const& op : aQueue)
+                bounds.push_back(bounding_rect(op));
+
+            // Within a run of draw operations sharing the same state each operation may be moved
+            // earlier to join the batch of a preceding operation provided it does not overlap any
+            // operation it is moved past; state changes and operations without bounds are barriers.
+            for (std::size_t segmentStart = 0u; segmentStart < aQueue.size();)
+            {
+                auto segmentEnd = segmentStart;
+                while (segmentEnd < aQueue.size() && bounds[segmentEnd])
+                    ++segmentEnd;
+                for (auto head = segmentStart; head < segmentEnd; ++head)
+                {
+                    if (scheduled[head])
+                        continue;
+                    scheduled[head] = true;
+                    order.push_back(head);
+                    skipped.clear();
+                    for (auto candidate = head + 1u; candidate < segmentEnd && skipped.size() < ReorderWindow; ++candidate)
+                    {
+                        if (scheduled[candidate])
+                            continue;
+                        auto const& candidateBounds = *bounds[candidate];
+                        if (batchable(aQueue[head], aQueue[candidate]) &&
+                            std::none_of(skipped.begin(), skipped.end(), [&](rect const& r) { return r.intersects(candidateBounds); }))
+                        {
+                            scheduled[candidate] = true;
+                            order.push_back(candidate);
+                        }
+                        else
+                            skipped.push_back(candidateBounds);
+                    }
+                }
+                if (segmentEnd < aQueue.size())
+                {
+                    scheduled[segmentEnd] = true;
+                    order.push_back(segmentEnd);
+                }
+                segmentStart = segmentEnd + 1u;
+            }
+
+            bool changed = false;
+            for (std::size_t i = 0u; !changed && i < order.size(); ++i)
+                changed = (order[i] != i);
+            if (!changed)
+                return 0u;
+
+            auto const before = batch_count(aQueue);
+            queue reordered;
+            reordered.reserve(aQueue.size());
+            for (auto i : order)
+                reordered.push_back(std::move(aQueue[i]));
+            aQueue.swap(reordered);
+            auto const after = batch_count(aQueue);
+            return before > after ? before - after : 0u;
+        }
+
+        recording::recording(recording&& aOther) noexcept :
+            iOperations{ std::move(aOther.iOperations) },
+            iBatchEnds{ std::move(aOther.iBatchEnds) },
+            iVertices{ std::move(aOther.iVertices) },
+            iOrigin{ aOther.iOrigin },
+            iCompiled{ std::move(aOther.iCompiled) }
+        {
+            aOther.iVertices.clear();
+            aOther.clear();
+        }
+
+        recording::~recording()
+        {
+            clear();
+        }
+
+        recording& recording::operator=(recording&& aOther) noexcept
+        {
+            if (&aOther != this)
+            {
+                clear();
+                iOperations = std::move(aOther.iOperations);
+                iBatchEnds = std::move(aOther.iBatchEnds);
+                iVertices = std::move(aOther.iVertices);
+                iOrigin = aOther.iOrigin;
+                iCompiled = std::move(aOther.iCompiled);
+                aOther.iVertices.clear();
+                aOther.clear();
+            }
+            return *this;
+        }
+
+        bool recording::empty() const
+        {
+            return iOperations.empty();
+        }
+
+        void recording::clear()
+        {
+            iCompiled.reset();
+            iOperations.clear();
+            iBatchEnds.clear();
+            if (!iVertices.empty())
+            {
+                auto& ssbo = service<i_rendering_engine>().default_shader_program().shape_shader().shape_vertices();
+                for (auto const& range : iVertices)
+                    ssbo.free(range);
+                iVertices.clear();
+            }
+            iOrigin = {};
+        }
+
+        point const& recording::origin() const
+        {
+            return iOrigin;
+        }
+
+        void recording::set_origin(point const& aOrigin)
+        {
+            iOrigin = aOrigin;
+        }
+
+        queue const& recording::operations() const
+        {
+            return iOperations;
+        }
+
+        void recording::push_back(operation const& aOperation)
+        {
+            iOperations.push_back(aOperation);
+            iBatchEnds.clear();
+            iCompiled.reset();
+        }
+
+        void recording::adopt(ssbo_range const& aVertices)
+        {
+            iVertices.push_back(aVertices);
+        }
+
+        std::uint32_t recording::compile(bool aReorder)
+        {
+            std::uint32_t const saved = aReorder ? reorder(iOperations) : 0u;
+            iBatchEnds.clear();
+            iCompiled.reset();
+            for (auto batchStart = iOperations.begin(); batchStart != iOperations.end();)
+            {
+                auto batchEnd = std::next(batchStart);
+                while (batchEnd != iOperations.end() && batchable(*batchStart, *batchEnd))
+                    ++batchEnd;
+                iBatchEnds.push_back(static_cast<std::size_t>(batchEnd - iOperations.begin()));
+                batchStart = batchEnd;
+            }
+            return saved;
+        }
+
+        std::size_t recording::batch_count() const
+        {
+            return iBatchEnds.size();
+        }
+
+        batch recording::batch_at(std::size_t aIndex) const
+        {
+            auto const begin = aIndex == 0u ? 0u : iBatchEnds[aIndex - 1u];
+            return batch{ iOperations.data() + begin, iOperations.data() + iBatchEnds[aIndex] };
+        }
+
+        i_compiled_recording const* recording::compiled() const
+        {
+            return iCompiled.get();
+        }
+
+        void recording::set_compiled(std::unique_ptr<i_compiled_recording> aCompiled)
+        {
+            iCompiled = std::move(aCompiled);
+        }
     }
 }
\ No newline at end of file
@@ -22,6 +22,7 @@
 #include <neolib/core/string_utils.hpp>
 
 #include <neogfx/gfx/color.hpp>
+#include "color_conversion.hpp"
 
 namespace neogfx
 {
@@ -213,4 +214,111 @@ namespace neogfx
     {
         return std::make_tuple(hue(), saturation(), lightness(), alpha()) < std::make_tuple(aOther.hue(), aOther.saturation(), aOther.lightness(), aOther.alpha());
     }
+
+    namespace
+    {
+        struct rgb_to_hsl
+        {
+            static void convert(float& aComponent0, float& aComponent1, float& aComponent2)
+            {
+                float const red = aComponent0;
+                float const green = aComponent1;
+                float const blue = aComponent2;
+                float const max = std::max(std::max(red, green), blue);
+                float const min = std::min(std::min(red, green), blue);
+                float const chroma = max - min;
+                float const lightness = detail::saturate(0.5f * (max + min));
+                aComponent0 = detail::hue_from_rgb(red, green, blue, max, chroma);
+                aComponent1 = chroma == 0.0f ? 0.0f : detail::saturate(chroma / (1.0f - std::abs(2.0f * lightness - 1.0f)));
+                aComponent2 = lightness;
+            }
+#ifdef NEOGFX_X86
+            static void convert(__m128& aComponent0, __m128& aComponent1, __m128& aComponent2)
+            {
+                __m128 const max = _mm_max_ps(_mm_max_ps(aComponent0, aComponent1), aComponent2);
+                __m128 const min = _mm_min_ps(_mm_min_ps(aComponent0, aComponent1), aComponent2);
+                __m128 const chroma = _mm_sub_ps(max, min);
+                __m128 const lightness = detail::saturate_ps(_mm_mul_ps(_mm_set1_ps(0.5f), _mm_add_ps(max, min)));
+                __m128 const hue = detail::hue_from_rgb_ps(aComponent0, aComponent1, aComponent2, max, chroma);
+                __m128 const divisor = _mm_sub_ps(_mm_set1_ps(1.0f), detail::abs_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), lightness), _mm_set1_ps(1.0f))));
+                aComponent0 = hue;
+                aComponent1 = _mm_andnot_ps(_mm_cmpeq_ps(chroma, _mm_setzero_ps()), detail::saturate_ps(_mm_div_ps(chroma, divisor)));
+                aComponent2 = lightness;
+            }
+#endif
+        };
+
+        // f(n) = l - a * max(-1, min(k - 3, 9 - k, 1)) where k = (n + h / 30) mod 12 and a = s * min(l, 1 - l)
+        struct hsl_to_rgb
+        {
+            static float component(float aN, float aSextant, float aLightness, float aA)
+            {
+                float k = aN + 2.0f * aSextant;
+                if (k >= 12.0f)
+                    k -= 12.0f;
+                return aLightness - aA * std::max(-1.0f, std::min(std::min(k - 3.0f, 9.0f - k), 1.0f));
+            }
+            static void convert(float& aComponent0, float& aComponent1, float& aComponent2)
+            {
+                float const sextant = detail::hue_sextant(aComponent0);
+                float const lightness = aComponent2;
+                float const a = aComponent1 * std::min(lightness, 1.0f - lightness);
+                aComponent0 = component(0.0f, sextant, lightness, a);
+                aComponent1 = component(8.0f, sextant, lightness, a);
+                aComponent2 = component(4.0f, sextant, lightness, a);
+            }
+#ifdef NEOGFX_X86
+            static __m128 component(float aN, __m128 aSextant, __m128 aLightness, __m128 aA)
+            {
+                __m128 const twelve = _mm_set1_ps(12.0f);
+                __m128 k = _mm_add_ps(_mm_set1_ps(aN), _mm_mul_ps(_mm_set1_ps(2.0f), aSextant));
+                k = _mm_sub_ps(k, _mm_and_ps(_mm_cmpge_ps(k, twelve), twelve));
+                __m128 const factor = _mm_max_ps(_mm_set1_ps(-1.0f),
+                    _mm_min_ps(_mm_min_ps(_mm_sub_ps(k, _mm_set1_ps(3.0f)), _mm_sub_ps(_mm_set1_ps(9.0f), k)), _mm_set1_ps(1.0f)));
+                return _mm_sub_ps(aLightness, _mm_mul_ps(aA, factor));
+            }
+            static void convert(__m128& aComponent0, __m128& aComponent1, __m128& aComponent2)
+            {
+                __m128 const sextant = detail::hue_sextant_ps(aComponent0);
+                __m128 const lightness = aComponent2;
+                __m128 const a = _mm_mul_ps(aComponent1, _mm_min_ps(lightness, _mm_sub_ps(_mm_set1_ps(1.0f), lightness)));
+                aComponent0 = component(0.0f, sextant, lightness, a);
+                aComponent1 = component(8.0f, sextant, lightness, a);
+                aComponent2 = component(4.0f, sextant, lightness, a);
+            }
+#endif
+        };
+
+        detail::hue_kernels const& select_hsl_kernels()
+        {
+            static detail::hue_kernels const sKernels = detail::hsl_kernels_for(host_cpu_features());
+            return sKernels;
+        }
+    }
+
+    namespace detail
+    {
+        hue_kernels hsl_kernels_for(cpu_features const& aFeatures)
+        {
+            return hue_kernels_for<hsl_to_rgb, rgb_to_hsl>(aFeatures);
+        }
+    }
+
+    void hsl_color::to_rgb(std::span<float const> aHsla, std::span<float> aRgba)
+    {
+        detail::check_pixel_buffer(aHsla.size(), aRgba.size());
+        select_hsl_kernels().toRgb(aHsla.data(), aRgba.data(), aHsla.size());
+    }
+
+    void hsl_color::to_rgb(std::span<float const> aHsla, std::span<std::uint8_t> aRgba)
+    {
+        detail::check_pixel_buffer(aHsla.size(), aRgba.size());
+        select_hsl_kernels().toRgb8(aHsla.data(), aRgba.data(), aHsla.size());
+    }
+
+    void hsl_color::from_rgb(std::span<float const> aRgba, std::span<float> aHsla)
+    {
+        detail::check_pixel_buffer(aRgba.size(), aHsla.size());
+        select_hsl_kernels().fromRgb(aRgba.data(), aHsla.data(), aRgba.size());
+    }
 }
\ No newline at end of file
@@ -22,6 +22,7 @@
 #include <neolib/core/string_utils.hpp>
 
 #include <neogfx/gfx/color.hpp>
+#include "color_conversion.hpp"
 
 namespace neogfx
 {
@@ -221,4 +222,107 @@ namespace neogfx
     {
         return std::make_tuple(hue(), saturation(), value(), alpha()) < std::make_tuple(aOther.hue(), aOther.saturation(), aOther.value(), aOther.alpha());
     }
+
+    namespace
+    {
+        struct rgb_to_hsv
+        {
+            static void convert(float& aComponent0, float& aComponent1, float& aComponent2)
+            {
+                float const red = aComponent0;
+                float const green = aComponent1;
+                float const blue = aComponent2;
+                float const max = std::max(std::max(red, green), blue);
+                float const chroma = max - std::min(std::min(red, green), blue);
+                float const value = detail::saturate(max);
+                aComponent0 = detail::hue_from_rgb(red, green, blue, max, chroma);
+                aComponent1 = chroma == 0.0f ? 0.0f : detail::saturate(chroma / value);
+                aComponent2 = value;
+            }
+#ifdef NEOGFX_X86
+            static void convert(__m128& aComponent0, __m128& aComponent1, __m128& aComponent2)
+            {
+                __m128 const max = _mm_max_ps(_mm_max_ps(aComponent0, aComponent1), aComponent2);
+                __m128 const chroma = _mm_sub_ps(max, _mm_min_ps(_mm_min_ps(aComponent0, aComponent1), aComponent2));
+                __m128 const value = detail::saturate_ps(max);
+                __m128 const hue = detail::hue_from_rgb_ps(aComponent0, aComponent1, aComponent2, max, chroma);
+                aComponent0 = hue;
+                aComponent1 = _mm_andnot_ps(_mm_cmpeq_ps(chroma, _mm_setzero_ps()), detail::saturate_ps(_mm_div_ps(chroma, value)));
+                aComponent2 = value;
+            }
+#endif
+        };
+
+        // f(n) = v - vs * max(0, min(k, 4 - k, 1)) where k = (n + h / 60) mod 6
+        struct hsv_to_rgb
+        {
+            static float component(float aN, float aSextant, float aValue, float aChroma)
+            {
+                float k = aN + aSextant;
+                if (k >= 6.0f)
+                    k -= 6.0f;
+                return aValue - aChroma * std::max(0.0f, std::min(std::min(k, 4.0f - k), 1.0f));
+            }
+            static void convert(float& aComponent0, float& aComponent1, float& aComponent2)
+            {
+                float const sextant = detail::hue_sextant(aComponent0);
+                float const value = aComponent2;
+                float const chroma = value * aComponent1;
+                aComponent0 = component(5.0f, sextant, value, chroma);
+                aComponent1 = component(3.0f, sextant, value, chroma);
+                aComponent2 = component(1.0f, sextant, value, chroma);
+            }
+#ifdef NEOGFX_X86
+            static __m128 component(float aN, __m128 aSextant, __m128 aValue, __m128 aChroma)
+            {
+                __m128 const six = _mm_set1_ps(6.0f);
+                __m128 k = _mm_add_ps(_mm_set1_ps(aN), aSextant);
+                k = _mm_sub_ps(k, _mm_and_ps(_mm_cmpge_ps(k, six), six));
+                __m128 const factor = _mm_max_ps(_mm_setzero_ps(), _mm_min_ps(_mm_min_ps(k, _mm_sub_ps(_mm_set1_ps(4.0f), k)), _mm_set1_ps(1.0f)));
+                return _mm_sub_ps(aValue, _mm_mul_ps(aChroma, factor));
+            }
+            static void convert(__m128& aComponent0, __m128& aComponent1, __m128& aComponent2)
+            {
+                __m128 const sextant = detail::hue_sextant_ps(aComponent0);
+                __m128 const value = aComponent2;
+                __m128 const chroma = _mm_mul_ps(value, aComponent1);
+                aComponent0 = component(5.0f, sextant, value, chroma);
+                aComponent1 = component(3.0f, sextant, value, chroma);
+                aComponent2 = component(1.0f, sextant, value, chroma);
+            }
+#endif
+        };
+
+        detail::hue_kernels const& select_hsv_kernels()
+        {
+            static detail::hue_kernels const sKernels = detail::hsv_kernels_for(host_cpu_features());
+            return sKernels;
+        }
+    }
+
+    namespace detail
+    {
+        hue_kernels hsv_kernels_for(cpu_features const& aFeatures)
+        {
+            return hue_kernels_for<hsv_to_rgb, rgb_to_hsv>(aFeatures);
+        }
+    }
+
+    void hsv_color::to_rgb(std::span<float const> aHsva, std::span<float> aRgba)
+    {
+        detail::check_pixel_buffer(aHsva.size(), aRgba.size());
+        select_hsv_kernels().toRgb(aHsva.data(), aRgba.data(), aHsva.size());
+    }
+
+    void hsv_color::to_rgb(std::span<float const> aHsva, std::span<std::uint8_t> aRgba)
+    {
+        detail::check_pixel_buffer(aHsva.size(), aRgba.size());
+        select_hsv_kernels().toRgb8(aHsva.data(), aRgba.data(), aHsva.size());
+    }
+
+    void hsv_color::from_rgb(std::span<float const> aRgba, std::span<float> aHsva)
+    {
+        detail::check_pixel_buffer(aRgba.size(), aHsva.size());
+        select_hsv_kernels().fromRgb(aRgba.data(), aHsva.data(), aRgba.size());
+    }
 }
\ No newline at end of file
@@ -19,17 +19,27 @@
 
 #include <neogfx/neogfx.hpp>
 
-#include <libpng/png.h>
+#include <cmath>
+#include <map>
+#include <mutex>
 #include <openssl/sha.h>
 
 #include <neolib/core/vecarray.hpp>
 #include <neolib/core/string_utils.hpp>
 
 #include <neogfx/gfx/image.hpp>
+#include <neogfx/gfx/i_image_decoder.hpp>
+#include <neogfx/gfx/resampling.hpp>
 #include <neogfx/app/resource_manager.hpp>
 
 namespace neogfx
 {
+    struct image::mip_chain
+    {
+        std::mutex mutex;
+        std::map<resampling_filter, std::vector<std::unique_ptr<image>>> levels; // from level 1
+    };
+
     image::image(dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
         iDpiScaleFactor{ aDpiScaleFactor }, 
         iColorSpace{ aColorSpace },
@@ -51,6 +61,11 @@ namespace neogfx
     }
 
     image::image(std::string const& aUri, dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
+        image{ aUri, image_decoding::Synchronous, aDpiScaleFactor, aSampling, aColorSpace }
+    {
+    }
+
+    image::image(std::string const& aUri, image_decoding aDecoding, dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
         iResource{ service<i_resource_manager>().load_resource(aUri) },
         iUri{ aUri },
         iDpiScaleFactor{ aDpiScaleFactor },
@@ -59,7 +74,12 @@ namespace neogfx
         iSampling{ aSampling }
     {
         if (available())
-            load();
+        {
+            if (aDecoding == image_decoding::Asynchronous && recognize() != UnknownImage)
+                load_async();
+            else
+                load();
+        }
     }
 
     image::image(std::string const& aImagePattern, const std::unordered_map<std::string, color>& aColorMap, dimension aDpiScaleFactor, texture_sampling aSampling, neogfx::color_space aColorSpace) :
@@ -128,8 +148,12 @@ namespace neogfx
         iColorFormat{ aOther.iColorFormat },
         iData{ aOther.iData },
         iSampling{ aOther.iSampling },
-        iSize{ aOther.iSize }
+        iSize{ aOther.iSize },
+        iMipChain{ aOther.iMipChain },
+        iDecoding{ aOther.iDecoding }
     {
+        if (iDecoding)
+            follow_decoding();
     }
 
     image::image(image&& aOther) :
@@ -141,19 +165,29 @@ namespace neogfx
         iColorFormat{ std::move(aOther.iColorFormat) },
         iData{ std::move(aOther.iData) },
         iSampling{ std::move(aOther.iSampling) },
-        iSize{ std::move(aOther.iSize) }
+        iSize{ std::move(aOther.iSize) },
+        iMipChain{ std::move(aOther.iMipChain) },
+        iDecoding{ std::move(aOther.iDecoding) }
     {
+        aOther.iSink = sink{};
+        if (iDecoding)
+            follow_decoding();
     }
 
     image::image(image const& aOther, texture_sampling aSampling) :
         image{ aOther }
     {
+        // cached levels are created with the sampling of the image they were resampled for
+        if (iSampling != aSampling)
+            iMipChain = nullptr;
         iSampling = aSampling;
     }
 
     image::image(image&& aOther, texture_sampling aSampling) :
         image{ std::move(aOther) }
     {
+        if (iSampling != aSampling)
+            iMipChain = nullptr;
         iSampling = aSampling;
     }
 
@@ -210,14 +244,14 @@ namespace neogfx
 
     bool image::is_empty() const
     {
-        return iData.empty();
+        return pixel_data().empty();
     }
 
     const void* image::cdata() const
     {
-        if (iData.empty())
+        if (pixel_data().empty())
             throw no_data();
-        return &iData[0];
+        return &pixel_data()[0];
     }
 
     const void* image::data() const
@@ -227,12 +261,15 @@ namespace neogfx
 
     void* image::data()
     {
-        return const_cast<void*>(to_const(*this).data());
+        iMipChain = nullptr;
+        if (unshared_pixel_data().empty())
+            throw no_data();
+        return &unshared_pixel_data()[0];
     }
 
     std::size_t image::size() const
     {
-        return iData.size();
+        return pixel_data().size();
     }
 
     image::hash_digest_type const& image::hash() const
@@ -279,8 +316,9 @@ namespace neogfx
 
     void image::resize(const neogfx::size& aNewSize)
     {
+        iMipChain = nullptr;
         iSize = aNewSize;
-        iData.resize(static_cast<std::size_t>(iSize.cx * iSize.cy * 4));
+        unshared_pixel_data().resize(static_cast<std::size_t>(iSize.cx * iSize.cy * 4));
     }
 
     const void* image::cpixels() const
@@ -304,7 +342,7 @@ namespace neogfx
         {
         case neogfx::color_format::RGBA8:
             {
-                const std::uint8_t* pixel = &iData[static_cast<std::size_t>(aPoint.y * extents().cx * 4 + aPoint.x * 4)];
+                const std::uint8_t* pixel = &pixel_data()[static_cast<std::size_t>(aPoint.y * extents().cx * 4 + aPoint.x * 4)];
                 return color{pixel[0], pixel[1], pixel[2], pixel[3]};
             }
         default:
@@ -314,11 +352,12 @@ namespace neogfx
 
     void image::set_pixel(const point& aPoint, const color& aColor)
     {
+        iMipChain = nullptr;
         switch (iColorFormat)
         {
         case neogfx::color_format::RGBA8:
             {
-                std::uint8_t* pixel = &iData[static_cast<std::size_t>(aPoint.y * extents().cx * 4 + aPoint.x * 4)];
+                std::uint8_t* pixel = &unshared_pixel_data()[static_cast<std::size_t>(aPoint.y * extents().cx * 4 + aPoint.x * 4)];
                 pixel[0] = aColor.red();
                 pixel[1] = aColor.green();
                 pixel[2] = aColor.blue();
@@ -330,6 +369,66 @@ namespace neogfx
         }
     }
 
+    std::shared_ptr<decoded_image> image::decoding() const
+    {
+        return iDecoding;
+    }
+
+    std::uint32_t image::mip_level_count() const
+    {
+        auto const largest = static_cast<std::uint32_t>(std::max(extents().cx, extents().cy));
+        std::uint32_t result = 1u;
+        while ((largest >> result) != 0u)
+            ++result;
+        return result;
+    }
+
+    size image::mip_level_extents(std::uint32_t aLevel) const
+    {
+        if (aLevel >= mip_level_count())
+            throw bad_mip_level();
+        return size{
+            static_cast<dimension>(std::max(static_cast<std::uint32_t>(extents().cx) >> aLevel, 1u)),
+            static_cast<dimension>(std::max(static_cast<std::uint32_t>(extents().cy) >> aLevel, 1u)) };
+    }
+
+    std::uint32_t image::mip_level_for(const neogfx::size& aExtents) const
+    {
+        std::uint32_t result = 0u;
+        while (result + 1u < mip_level_count())
+        {
+            auto const next = mip_level_extents(result + 1u);
+            if (next.cx < std::ceil(aExtents.cx) || next.cy < std::ceil(aExtents.cy))
+                break;
+            ++result;
+        }
+        return result;
+    }
+
+    const image& image::mip_level(std::uint32_t aLevel, resampling_filter aFilter) const
+    {
+        if (aLevel >= mip_level_count())
+            throw bad_mip_level();
+        if (aLevel == 0u)
+            return *this;
+        if (iMipChain == nullptr)
+            iMipChain = std::make_shared<mip_chain>();
+        std::scoped_lock<std::mutex> lock{ iMipChain->mutex };
+        auto& levels = iMipChain->levels[aFilter];
+        while (levels.size() < aLevel)
+        {
+            image const& previous = levels.empty() ? *this : *levels.back();
+            auto next = std::make_unique<image>(iDpiScaleFactor, iSampling, iColorSpace);
+            next->resize(mip_level_extents(static_cast<std::uint32_t>(levels.size()) + 1u));
+            resample(
+                std::span<std::uint8_t const>{ static_cast<std::uint8_t const*>(previous.cpixels()), previous.size() }, size_u32{ previous.extents() },
+                std::span<std::uint8_t>{ static_cast<std::uint8_t*>(next->pixels()), next->size() }, size_u32{ next->extents() },
+                aFilter, iColorSpace);
+            levels.push_back(std::move(next));
+        }
+        return *levels[aLevel - 1u];
+    }
+
     bool image::has_resource() const
     {
         return iResource != nullptr;
@@ -353,6 +452,8 @@ namespace neogfx
                     const std::uint8_t* magic = static_cast<const std::uint8_t*>(resource().data());
                     if (magic[0] == 0x89 && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G')
                         return PngImage;
+                    if (magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF)
+                        return JpegImage;
                 }
             }
         }
@@ -366,39 +467,70 @@ namespace neogfx
         switch (recognize())
         {
         case PngImage:
-            return load_png();
+        case JpegImage:
+            return load_decoded();
         default:
             throw unknown_image_format();
         }
     }
 
-    bool image::load_png()
+    bool image::load_decoded()
     {
-        png_image image;
-        std::memset(&image, 0, (sizeof image));
-        image.version = PNG_IMAGE_VERSION;
-        if (png_image_begin_read_from_memory(&image, resource().data(), resource().size()) != 0)
+        auto const decoded = service<i_image_decoder>().decode(resource());
+        if (decoded->status() != decode_status::Decoded)
         {
-            image.format = PNG_FORMAT_RGBA;
-            iData.resize(PNG_IMAGE_SIZE(image));
-            if (png_image_finish_read(&image, NULL, data(), 0, NULL) != 0)
-            {
-                iSize = neogfx::size(image.width, image.height);
-                png_image_free(&image);
-                return true;
-            }
-            else
-            {
-                png_image_free(&image);
-                iError = image.message;
-                return false;
-            }
-        }
-        else
-        {
-            iError = image.message;
+            iError = decoded->error();
             return false;
         }
+        auto& pixels = unshared_pixel_data();
+        pixels.resize(decoded->size());
+        std::copy(decoded->pixels(), decoded->pixels() + decoded->size(), pixels.begin());
+        iSize = neogfx::size{ decoded->extents().cx, decoded->extents().cy };
+        return true;
+    }
+
+    image::data_type const& image::pixel_data() const
+    {
+        static const data_type sNoData;
+        return iData != nullptr ? *iData : sNoData;
+    }
+
+    image::data_type& image::unshared_pixel_data()
+    {
+        if (iData == nullptr)
+            iData = std::make_shared<data_type>();
+        else if (iData.use_count() > 1)
+            iData = std::make_shared<data_type>(*iData);
+        return *iData;
+    }
+
+    void image::load_async()
+    {
+        iDecoding = service<i_image_decoder>().decode_async(*iResource);
+        resize(neogfx::size{ iDecoding->extents().cx, iDecoding->extents().cy });
+        follow_decoding();
+    }
+
+    void image::follow_decoding()
+    {
+        iSink += iDecoding->RowsDecoded([this](std::uint32_t aFirstRow, std::uint32_t aRowCount)
+        {
+            size_u32 const decodedExtents = iDecoding->extents();
+            if (size_u32{ extents() } != decodedExtents)
+                resize(neogfx::size{ decodedExtents.cx, decodedExtents.cy });
+            std::uint8_t const* const rows = iDecoding->pixels() + static_cast<std::size_t>(aFirstRow) * iDecoding->stride();
+            std::copy(rows, rows + static_cast<std::size_t>(aRowCount) * iDecoding->stride(), unshared_pixel_data().begin() + static_cast<std::ptrdiff_t>(aFirstRow) * iDecoding->stride());
+            iMipChain = nullptr;
+        });
+        iSink += iDecoding->Decoded([this]()
+        {
+            iDecoding = nullptr;
+        });
+        iSink += iDecoding->DecodeFailed([this](std::string const& aError)
+        {
+            iError = aError;
+            iDecoding = nullptr;
+        });
     }
 
 }
\ No newline at end of file
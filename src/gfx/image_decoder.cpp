@@ -0,0 +1,525 @@
+// image_decoder.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <libpng/png.h>
+#include <jpeglib.h>
+
+#include <neogfx/gfx/color.hpp>
+#include <neogfx/gfx/image_decoder.hpp>
+
+std::unique_ptr<neogfx::i_image_decoder> sImageDecoder;
+
+template <> neogfx::i_image_decoder& services::start_service<neogfx::i_image_decoder>()
+{
+    static bool created = (sImageDecoder = std::make_unique<neogfx::image_decoder>(), true);
+    return *sImageDecoder;
+}
+
+template<> void services::teardown_service<neogfx::i_image_decoder>()
+{
+    sImageDecoder.reset();
+}
+
+namespace neogfx
+{
+    namespace
+    {
+        // libpng and libjpeg report errors by long jumping back to the decode function so nothing with a
+        // non-trivial destructor may be alive in those functions between setjmp and the library calls.
+        struct png_source
+        {
+            std::uint8_t const* data;
+            std::size_t size;
+            std::size_t position;
+            char error[256];
+        };
+
+        void png_read_source(png_structp aPng, png_bytep aData, png_size_t aLength)
+        {
+            auto& source = *static_cast<png_source*>(png_get_io_ptr(aPng));
+            if (aLength > source.size - source.position)
+                png_error(aPng, "unexpected end of data");
+            std::memcpy(aData, source.data + source.position, aLength);
+            source.position += aLength;
+        }
+
+        void png_error_handler(png_structp aPng, png_const_charp aMessage)
+        {
+            auto& source = *static_cast<png_source*>(png_get_error_ptr(aPng));
+            std::snprintf(source.error, sizeof(source.error), "%s", aMessage);
+            png_longjmp(aPng, 1);
+        }
+
+        void png_warning_handler(png_structp, png_const_charp)
+        {
+        }
+
+        struct jpeg_error_handler
+        {
+            jpeg_error_mgr manager;
+            std::jmp_buf jump;
+            char error[JMSG_LENGTH_MAX];
+        };
+
+        void jpeg_error_exit(j_common_ptr aInfo)
+        {
+            auto& handler = *reinterpret_cast<jpeg_error_handler*>(aInfo->err);
+            handler.manager.format_message(aInfo, handler.error);
+            std::longjmp(handler.jump, 1);
+        }
+
+        void jpeg_output_message(j_common_ptr)
+        {
+        }
+
+        bool is_png(std::uint8_t const* aData, std::size_t aSize)
+        {
+            return aSize >= 8u && png_sig_cmp(aData, 0u, 8u) == 0;
+        }
+
+        bool is_jpeg(std::uint8_t const* aData, std::size_t aSize)
+        {
+            return aSize >= 3u && aData[0] == 0xFFu && aData[1] == 0xD8u && aData[2] == 0xFFu;
+        }
+
+        std::uint32_t read_be16(std::uint8_t const* aData)
+        {
+            return (static_cast<std::uint32_t>(aData[0]) << 8u) | aData[1];
+        }
+
+        std::uint32_t read_be32(std::uint8_t const* aData)
+        {
+            return (read_be16(aData) << 16u) | read_be16(aData + 2u);
+        }
+
+        // Reads the extents from the image header without decoding so that they are known before the
+        // first row arrives; returns empty extents if the header is not where it is expected.
+        size_u32 read_extents(std::uint8_t const* aData, std::size_t aSize)
+        {
+            if (is_png(aData, aSize))
+            {
+                if (aSize >= 24u && std::memcmp(aData + 12u, "IHDR", 4u) == 0)
+                    return size_u32{ read_be32(aData + 16u), read_be32(aData + 20u) };
+            }
+            else if (is_jpeg(aData, aSize))
+            {
+                std::size_t position = 2u;
+                while (position + 4u <= aSize)
+                {
+                    if (aData[position] != 0xFFu)
+                        break;
+                    std::uint8_t const marker = aData[position + 1u];
+                    if (marker == 0xFFu)
+                    {
+                        ++position;
+                        continue;
+                    }
+                    if (marker == 0x01u || (marker >= 0xD0u && marker <= 0xD8u))
+                    {
+                        position += 2u;
+                        continue;
+                    }
+                    if (marker >= 0xC0u && marker <= 0xCFu && marker != 0xC4u && marker != 0xC8u && marker != 0xCCu)
+                    {
+                        if (position + 9u > aSize)
+                            break;
+                        return size_u32{ read_be16(aData + position + 7u), read_be16(aData + position + 5u) };
+                    }
+                    position += 2u + read_be16(aData + position + 2u);
+                }
+            }
+            return size_u32{};
+        }
+    }
+
+    decoded_image::decoded_image(texture_data_format aFormat, bool aPremultiplied) :
+        iFormat{ aFormat },
+        iPremultiplied{ aPremultiplied },
+        iSourceData{ nullptr },
+        iSourceSize{ 0u },
+        iExtents{},
+        iStatus{ decode_status::Queued },
+        iDecodedRows{ 0u },
+        iCancelled{ false },
+        iNotifiedRows{ 0u }
+    {
+        if (iFormat != texture_data_format::RGBA && iFormat != texture_data_format::BGRA)
+            throw i_image_decoder::unsupported_data_format();
+    }
+
+    decode_status decoded_image::status() const
+    {
+        return iStatus.load(std::memory_order_acquire);
+    }
+
+    bool decoded_image::finished() const
+    {
+        auto const currentStatus = status();
+        return currentStatus != decode_status::Queued && currentStatus != decode_status::Decoding;
+    }
+
+    std::string const& decoded_image::error() const
+    {
+        return iError;
+    }
+
+    texture_data_format decoded_image::format() const
+    {
+        return iFormat;
+    }
+
+    bool decoded_image::premultiplied() const
+    {
+        return iPremultiplied;
+    }
+
+    size_u32 decoded_image::extents() const
+    {
+        std::scoped_lock lock{ iExtentsMutex };
+        return iExtents;
+    }
+
+    std::uint32_t decoded_image::stride() const
+    {
+        return extents().cx * 4u;
+    }
+
+    std::uint32_t decoded_image::decoded_row_count() const
+    {
+        return iDecodedRows.load(std::memory_order_acquire);
+    }
+
+    std::uint8_t const* decoded_image::pixels() const
+    {
+        return iPixels.data();
+    }
+
+    std::size_t decoded_image::size() const
+    {
+        return iPixels.size();
+    }
+
+    void decoded_image::cancel()
+    {
+        iCancelled.store(true, std::memory_order_relaxed);
+    }
+
+    image_decoder::image_decoder() :
+        iStopping{ false },
+        iTimer{ service<i_async_task>(), [this](neolib::callback_timer& aTimer)
+        {
+            notify();
+            std::lock_guard<std::mutex> lock{ iMutex };
+            if (!iActive.empty())
+                aTimer.again();
+        }, std::chrono::milliseconds{ 10 }, false }
+    {
+    }
+
+    image_decoder::~image_decoder()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ iMutex };
+            iStopping = true;
+        }
+        iWorkAvailable.notify_all();
+        for (auto& worker : iWorkers)
+            worker.join();
+    }
+
+    std::shared_ptr<decoded_image> image_decoder::decode(i_resource const& aSource, texture_data_format aFormat, bool aPremultiplied)
+    {
+        auto result = create(aSource, aFormat, aPremultiplied);
+        decode(*result);
+        return result;
+    }
+
+    std::shared_ptr<decoded_image> image_decoder::decode_async(i_resource& aSource, texture_data_format aFormat, bool aPremultiplied)
+    {
+        auto result = create(aSource, aFormat, aPremultiplied);
+        result->iSource = ref_ptr<i_resource>{ aSource };
+        result->iExtents = read_extents(result->iSourceData, result->iSourceSize);
+        {
+            std::lock_guard<std::mutex> lock{ iMutex };
+            if (iWorkers.empty())
+            {
+                std::uint32_t const workers = std::max(std::thread::hardware_concurrency(), 2u) - 1u;
+                for (std::uint32_t worker = 0u; worker < workers; ++worker)
+                    iWorkers.emplace_back([this]() { work(); });
+            }
+            iActive.push_back(result);
+            iQueue.push_back(&*result);
+        }
+        iWorkAvailable.notify_one();
+        iTimer.again_if();
+        return result;
+    }
+
+    void image_decoder::work()
+    {
+        for (;;)
+        {
+            decoded_image* next = nullptr;
+            {
+                std::unique_lock<std::mutex> lock{ iMutex };
+                iWorkAvailable.wait(lock, [this]() { return iStopping || !iQueue.empty(); });
+                if (iStopping)
+                    return;
+                next = iQueue.front();
+                iQueue.pop_front();
+            }
+            // the image is kept alive by iActive until notify() has seen it finish
+            decode(*next);
+        }
+    }
+
+    void image_decoder::notify()
+    {
+        std::vector<std::shared_ptr<decoded_image>> active;
+        {
+            std::lock_guard<std::mutex> lock{ iMutex };
+            active = iActive;
+        }
+        for (auto& image : active)
+        {
+            auto const status = image->status();
+            auto const rows = image->decoded_row_count();
+            if (rows > image->iNotifiedRows)
+            {
+                auto const firstRow = image->iNotifiedRows;
+                image->iNotifiedRows = rows;
+                image->RowsDecoded(firstRow, rows - firstRow);
+            }
+            if (status == decode_status::Decoded)
+                image->Decoded();
+            else if (status == decode_status::Failed)
+                image->DecodeFailed(image->error());
+            if (image->finished())
+            {
+                image->iSource.reset();
+                std::lock_guard<std::mutex> lock{ iMutex };
+                iActive.erase(std::find(iActive.begin(), iActive.end(), image));
+            }
+        }
+    }
+
+    std::shared_ptr<decoded_image> image_decoder::create(i_resource const& aSource, texture_data_format aFormat, bool aPremultiplied)
+    {
+        if (!aSource.available())
+            throw i_resource::not_available();
+        auto result = std::make_shared<decoded_image>(aFormat, aPremultiplied);
+        result->iSourceData = static_cast<std::uint8_t const*>(aSource.cdata());
+        result->iSourceSize = aSource.size();
+        return result;
+    }
+
+    void image_decoder::decode(decoded_image& aImage)
+    {
+        bool decoded = false;
+        try
+        {
+            if (is_png(aImage.iSourceData, aImage.iSourceSize))
+                decoded = decode_png(aImage);
+            else if (is_jpeg(aImage.iSourceData, aImage.iSourceSize))
+                decoded = decode_jpeg(aImage);
+            else
+                aImage.iError = "unknown image format";
+        }
+        catch (std::exception const& e)
+        {
+            aImage.iError = e.what();
+        }
+        if (aImage.iCancelled.load(std::memory_order_relaxed))
+            aImage.iStatus.store(decode_status::Cancelled, std::memory_order_release);
+        else
+            aImage.iStatus.store(decoded ? decode_status::Decoded : decode_status::Failed, std::memory_order_release);
+    }
+
+    bool image_decoder::decode_png(decoded_image& aImage)
+    {
+        png_source source = { aImage.iSourceData, aImage.iSourceSize, 0u, "" };
+        png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &source, &png_error_handler, &png_warning_handler);
+        if (png == nullptr)
+            throw std::bad_alloc();
+        png_infop info = png_create_info_struct(png);
+        if (info == nullptr)
+        {
+            png_destroy_read_struct(&png, nullptr, nullptr);
+            throw std::bad_alloc();
+        }
+        if (setjmp(png_jmpbuf(png)))
+        {
+            png_destroy_read_struct(&png, &info, nullptr);
+            aImage.iError = source.error;
+            return false;
+        }
+        png_set_read_fn(png, &source, &png_read_source);
+        png_read_info(png, info);
+        auto const colorType = png_get_color_type(png, info);
+        auto const bitDepth = png_get_bit_depth(png, info);
+        bool const hasTransparency = png_get_valid(png, info, PNG_INFO_tRNS) != 0;
+        if (colorType == PNG_COLOR_TYPE_PALETTE)
+            png_set_palette_to_rgb(png);
+        if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+            png_set_expand_gray_1_2_4_to_8(png);
+        if (hasTransparency)
+            png_set_tRNS_to_alpha(png);
+        if (bitDepth == 16)
+            png_set_strip_16(png);
+        if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+            png_set_gray_to_rgb(png);
+        if ((colorType & PNG_COLOR_MASK_ALPHA) == 0 && !hasTransparency)
+            png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
+        png_set_gamma(png, PNG_DEFAULT_sRGB, PNG_DEFAULT_sRGB); // images with a gAMA chunk are corrected to sRGB
+        int const passes = png_set_interlace_handling(png);
+        png_read_update_info(png, info);
+        std::uint32_t const width = png_get_image_width(png, info);
+        std::uint32_t const height = png_get_image_height(png, info);
+        std::uint8_t* pixels = nullptr;
+        try
+        {
+            pixels = begin_rows(aImage, width, height);
+        }
+        catch (...)
+        {
+            png_destroy_read_struct(&png, &info, nullptr);
+            throw;
+        }
+        std::size_t const stride = width * 4u;
+        bool cancelled = false;
+        if (passes == 1)
+        {
+            // rows are converted and published as they are decoded
+            for (std::uint32_t row = 0u; row < height && !cancelled;)
+            {
+                std::uint32_t const batchEnd = std::min(row + RowBatch, height);
+                for (; row < batchEnd; ++row)
+                    png_read_row(png, pixels + row * stride, nullptr);
+                cancelled = !publish_rows(aImage, batchEnd);
+            }
+        }
+        else
+        {
+            // an interlaced image is not complete until the last pass
+            for (int pass = 0; pass < passes && !cancelled; ++pass)
+            {
+                for (std::uint32_t row = 0u; row < height; ++row)
+                    png_read_row(png, pixels + row * stride, nullptr);
+                cancelled = aImage.iCancelled.load(std::memory_order_relaxed);
+            }
+            if (!cancelled)
+                publish_rows(aImage, height);
+        }
+        if (!cancelled)
+            png_read_end(png, nullptr);
+        png_destroy_read_struct(&png, &info, nullptr);
+        return !cancelled;
+    }
+
+    bool image_decoder::decode_jpeg(decoded_image& aImage)
+    {
+        jpeg_decompress_struct info;
+        jpeg_error_handler error;
+        info.err = jpeg_std_error(&error.manager);
+        error.manager.error_exit = &jpeg_error_exit;
+        error.manager.output_message = &jpeg_output_message;
+        error.error[0] = '\0';
+        if (setjmp(error.jump))
+        {
+            jpeg_destroy_decompress(&info);
+            aImage.iError = error.error;
+            return false;
+        }
+        jpeg_create_decompress(&info);
+        jpeg_mem_src(&info, aImage.iSourceData, aImage.iSourceSize);
+        jpeg_read_header(&info, TRUE);
+        info.out_color_space = JCS_RGB;
+        jpeg_start_decompress(&info);
+        std::uint32_t const width = info.output_width;
+        std::uint32_t const height = info.output_height;
+        std::uint8_t* pixels = nullptr;
+        try
+        {
+            pixels = begin_rows(aImage, width, height);
+        }
+        catch (...)
+        {
+            jpeg_destroy_decompress(&info);
+            throw;
+        }
+        std::size_t const stride = width * 4u;
+        bool cancelled = false;
+        while (info.output_scanline < height && !cancelled)
+        {
+            std::uint32_t const batchEnd = std::min<std::uint32_t>(info.output_scanline + RowBatch, height);
+            while (info.output_scanline < batchEnd)
+            {
+                // scanlines are RGB; decode each to the start of its row then widen it to RGBA from the end
+                std::uint8_t* const row = pixels + info.output_scanline * stride;
+                JSAMPROW scanline = row;
+                jpeg_read_scanlines(&info, &scanline, 1);
+                for (std::uint32_t x = width; x-- > 0u;)
+                {
+                    row[x * 4u + 3u] = 0xFFu;
+                    row[x * 4u + 2u] = row[x * 3u + 2u];
+                    row[x * 4u + 1u] = row[x * 3u + 1u];
+                    row[x * 4u] = row[x * 3u];
+                }
+            }
+            cancelled = !publish_rows(aImage, batchEnd);
+        }
+        if (cancelled)
+            jpeg_abort_decompress(&info);
+        else
+            jpeg_finish_decompress(&info);
+        jpeg_destroy_decompress(&info);
+        return !cancelled;
+    }
+
+    std::uint8_t* image_decoder::begin_rows(decoded_image& aImage, std::uint32_t aWidth, std::uint32_t aHeight)
+    {
+        {
+            // the header peek may already have published the extents to readers on other threads
+            std::scoped_lock lock{ aImage.iExtentsMutex };
+            aImage.iExtents = size_u32{ aWidth, aHeight };
+        }
+        aImage.iPixels.resize(static_cast<std::size_t>(aWidth) * aHeight * 4u);
+        aImage.iStatus.store(decode_status::Decoding, std::memory_order_release);
+        return aImage.iPixels.data();
+    }
+
+    bool image_decoder::publish_rows(decoded_image& aImage, std::uint32_t aRowCount)
+    {
+        std::uint32_t const firstRow = aImage.iDecodedRows.load(std::memory_order_relaxed);
+        std::span<std::uint8_t> const rows{ aImage.iPixels.data() + static_cast<std::size_t>(firstRow) * aImage.stride(), static_cast<std::size_t>(aRowCount - firstRow) * aImage.stride() };
+        if (aImage.iFormat == texture_data_format::BGRA)
+            swap_red_blue(rows);
+        if (aImage.iPremultiplied)
+            premultiply(rows);
+        aImage.iDecodedRows.store(aRowCount, std::memory_order_release);
+        return !aImage.iCancelled.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,57 @@
+// frame_counter.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2023 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+
+#include <neogfx/gui/widget/i_widget.hpp>
+#include "frame_counter.hpp"
+
+namespace neogfx
+{
+    frame_counter::frame_counter(std::uint32_t aDuration) : iTimer{ service<i_async_task>(), [this](neolib::callback_timer& aTimer)
+        {
+            aTimer.again();
+            ++iCounter;
+            for (auto w : iWidgets)
+                w->update();
+        }, std::chrono::milliseconds{ aDuration } }, iCounter{ 0 }
+    {
+    }
+
+    std::uint32_t frame_counter::counter() const
+    {
+        return iCounter;
+    }
+
+    void frame_counter::add(i_widget& aWidget)
+    {
+        auto iterWidget = std::find(iWidgets.begin(), iWidgets.end(), &aWidget);
+        if (iterWidget == iWidgets.end())
+            iWidgets.push_back(&aWidget);
+    }
+
+    void frame_counter::remove(i_widget& aWidget)
+    {
+        auto iterWidget = std::find(iWidgets.begin(), iWidgets.end(), &aWidget);
+        if (iterWidget != iWidgets.end())
+            iWidgets.erase(iterWidget);
+    }
+}
@@ -0,0 +1,46 @@
+// frame_counter.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2023 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <vector>
+
+#include <neolib/task/timer.hpp>
+
+namespace neogfx
+{
+    class i_widget;
+
+    class frame_counter
+    {
+    public:
+        frame_counter(std::uint32_t aDuration);
+    public:
+        std::uint32_t counter() const;
+    public:
+        void add(i_widget& aWidget);
+        void remove(i_widget& aWidget);
+    private:
+        neolib::callback_timer iTimer;
+        std::uint32_t iCounter;
+        std::vector<i_widget*> iWidgets;
+    };
+}
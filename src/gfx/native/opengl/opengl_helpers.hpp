@@ -22,6 +22,7 @@
 #include <neogfx/neogfx.hpp>
 
 #include <vector>
+#include <deque>
 
 #include <neogfx/gfx/color.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
@@ -186,6 +187,12 @@ namespace neogfx
         {
             --iSize;
         }
+        void resize(size_type aSize)
+        {
+            if (aSize > size())
+                need(aSize - size());
+            iSize = aSize;
+        }
         void clear()
         {
             iSize = 0;
@@ -319,6 +326,13 @@ namespace neogfx
             if (previousBindingHandle != gl_handle_cast<GLint>(aBuffer.handle()))
                 glCheck(glBindBuffer(GL_ARRAY_BUFFER, previousBindingHandle));
         }
+        void set_divisor(GLuint aDivisor)
+        {
+            GLuint index;
+            glCheck(index = glGetAttribLocation(to_gl_handle<GLuint>(iShaderProgram.handle()), iVariableName.c_str()));
+            if (index != -1)
+                glCheck(glVertexAttribDivisor(index, aDivisor));
+        }
     private:
         bool const iNormalized;
         std::size_t const iStride;
@@ -367,6 +381,17 @@ namespace neogfx
         };
     };
 
+    // Draw calls made through a vertex buffer that has a capture set are handed to the capture instead of
+    // being issued; used to compile recorded graphics operations.
+    class i_opengl_draw_capture
+    {
+    public:
+        virtual ~i_opengl_draw_capture() = default;
+    public:
+        virtual void capture(GLenum aMode, standard_vertex const* aVertices, std::size_t aCount, optional_mat44 const& aTransformation, bool aWithTextures,
+            std::optional<std::size_t> const& aInstanceVertexCount, bool aUseBarrier, std::size_t aSkipCount) = 0;
+    };
+
     template <typename V = standard_vertex>
     class opengl_vertex_buffer : public vertex_buffer, private opengl_buffer_owner
     {
@@ -374,6 +399,24 @@ namespace neogfx
         typedef V vertex_type;
     public:
         typedef opengl_buffer<vertex_type> vertex_array;
+    public:
+        static constexpr std::size_t StreamingRegionCount = 3u;
+    private:
+        struct region
+        {
+            vertex_array buffer;
+            GLsync fence = nullptr;
+            region(opengl_buffer_owner& aOwner) :
+                buffer{ aOwner }
+            {
+            }
+        };
+        struct retired_vertices
+        {
+            GLsync fence = nullptr;
+            std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        };
+    public:
         class use
         {
         public:
@@ -386,11 +429,11 @@ namespace neogfx
         public:
             const vertex_array& vertices() const
             {
-                return iParent.iBuffer;
+                return iParent.vertices();
             }
             vertex_array& vertices()
             {
-                return iParent.iBuffer;
+                return iParent.vertices();
             }
             const optional_mat44& transformation() const
             {
@@ -404,13 +447,47 @@ namespace neogfx
             {
                 iParent.execute();
             }
+            void cycle()
+            {
+                iParent.cycle();
+            }
+            void acquire()
+            {
+                iParent.acquire();
+            }
+            void set_instance_divisor(GLuint aDivisor)
+            {
+                iParent.set_instance_divisor(aDivisor);
+            }
+            i_opengl_draw_capture* capture() const
+            {
+                return iParent.capture();
+            }
         private:
             opengl_vertex_buffer<vertex_type>& iParent;
         };
     public:
         opengl_vertex_buffer(i_vertex_provider& aProvider, vertex_buffer_type aType) :
-            vertex_buffer{ aProvider, aType }, iBuffer{ *this }
+            vertex_buffer{ aProvider, aType }
         {
+            // Persisted vertices are referenced by index from a render cache so they must stay put; anything
+            // else is streamed through a ring of regions so the CPU can fill one while the GPU reads another.
+            auto const regionCount = (aType & vertex_buffer_type::Persist) == vertex_buffer_type::Persist ? 1u : StreamingRegionCount;
+            for (std::size_t r = 0; r < regionCount; ++r)
+                iRegions.emplace_back(*this);
+        }
+        ~opengl_vertex_buffer()
+        {
+            for (auto& region : iRegions)
+                if (region.fence != nullptr)
+                {
+                    glCheck(glDeleteSync(region.fence));
+                }
+            for (auto& retired : iRetired)
+                if (retired.fence != nullptr)
+                {
+                    glCheck(glDeleteSync(retired.fence));
+                }
         }
     public:
         void attach_shader(i_rendering_context& aContext, i_shader_program& aShaderProgram) override
@@ -497,9 +574,32 @@ namespace neogfx
             vertex_buffer::detach_shader();
         }
     public:
+        // The GPU may still be reading the vertices being given up so they are only retired here; they are
+        // returned to the free list by recycle() once the fence placed by the next cycle() has signalled.
         void reclaim(std::size_t aStartIndex, std::size_t aEndIndex)
         {
-            vertices().reclaim(aStartIndex, aEndIndex);
+            if (aEndIndex == aStartIndex)
+                return;
+            if (iRetired.empty() || iRetired.back().fence != nullptr)
+                iRetired.emplace_back();
+            iRetired.back().ranges.emplace_back(aStartIndex, aEndIndex);
+        }
+        // Frees retired vertices the GPU has finished with; never blocks.
+        void recycle()
+        {
+            while (!iRetired.empty() && iRetired.front().fence != nullptr)
+            {
+                auto& retired = iRetired.front();
+                GLenum status;
+                glCheck(status = glClientWaitSync(retired.fence, 0, 0));
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                    break;
+                glCheck(glDeleteSync(retired.fence));
+                for (auto const& range : retired.ranges)
+                    if (range.second <= vertices().size())
+                        vertices().reclaim(range.first, range.second);
+                iRetired.pop_front();
+            }
         }
     public:
         void execute()
@@ -509,21 +609,94 @@ namespace neogfx
             glCheck(glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, ~0ull));
             glCheck(glDeleteSync(sync));
         }
+        // Fences the vertices submitted so far without waiting for them. A streaming buffer then moves on to
+        // the next (emptied) region of its ring, only blocking if the GPU is still reading that region; a
+        // persistent buffer keeps its region and writes new vertices to ranges the GPU is not reading, the
+        // fence only deciding when retired ranges can be reused (see reclaim).
+        void cycle()
+        {
+            auto& region = iRegions[iCurrentRegion];
+            if (region.fence != nullptr)
+            {
+                glCheck(glDeleteSync(region.fence));
+            }
+            glCheck(region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+            if (!iRetired.empty() && iRetired.back().fence == nullptr)
+            {
+                glCheck(iRetired.back().fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+            }
+            if (iRegions.size() > 1u)
+            {
+                iCurrentRegion = (iCurrentRegion + 1u) % iRegions.size();
+                acquire();
+                vertices().clear();
+                update_attrib_arrays();
+            }
+        }
+        // Waits until the GPU has finished reading the current region so that it can be overwritten.
+        void acquire()
+        {
+            auto& region = iRegions[iCurrentRegion];
+            if (region.fence != nullptr)
+            {
+                glCheck(glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~0ull));
+                glCheck(glDeleteSync(region.fence));
+                region.fence = nullptr;
+            }
+        }
         void flush()
         {
             flush(vertices().size());
         }
         void flush(std::size_t aElements)
         {
-            iBuffer.flush(aElements);
+            vertices().flush(aElements);
+        }
+        const vertex_array& vertices() const
+        {
+            return iRegions[iCurrentRegion].buffer;
         }
         vertex_array& vertices()
         {
-            return iBuffer;
+            return iRegions[iCurrentRegion].buffer;
         }
         std::size_t capacity() const
         {
-            return iBuffer.capacity();
+            return vertices().capacity();
+        }
+        i_opengl_draw_capture* capture() const
+        {
+            return iCapture;
+        }
+        void set_capture(i_opengl_draw_capture* aCapture)
+        {
+            iCapture = aCapture;
+        }
+        // A divisor of 1 makes every attribute advance once per instance rather than once per vertex.
+        void set_instance_divisor(GLuint aDivisor)
+        {
+            if (iVao)
+                iVao->bind();
+            if (iVertexPositionAttribArray)
+                iVertexPositionAttribArray->set_divisor(aDivisor);
+            if (iVertexColorAttribArray)
+                iVertexColorAttribArray->set_divisor(aDivisor);
+            if (iVertexTextureCoordAttribArray)
+                iVertexTextureCoordAttribArray->set_divisor(aDivisor);
+            if (iVertexFunction0AttribArray)
+                iVertexFunction0AttribArray->set_divisor(aDivisor);
+            if (iVertexFunction1AttribArray)
+                iVertexFunction1AttribArray->set_divisor(aDivisor);
+            if (iVertexFunction2AttribArray)
+                iVertexFunction2AttribArray->set_divisor(aDivisor);
+            if (iVertexFunction3AttribArray)
+                iVertexFunction3AttribArray->set_divisor(aDivisor);
+            if (iVertexFunction4AttribArray)
+                iVertexFunction4AttribArray->set_divisor(aDivisor);
+            if (iVertexFunction5AttribArray)
+                iVertexFunction5AttribArray->set_divisor(aDivisor);
+            if (iVertexFunction6AttribArray)
+                iVertexFunction6AttribArray->set_divisor(aDivisor);
         }
     private:
         void buffer_grown() override
@@ -535,28 +708,31 @@ namespace neogfx
             if (iVao)
                 iVao->bind();
             if (iVertexPositionAttribArray)
-                iVertexPositionAttribArray->update(iBuffer);
+                iVertexPositionAttribArray->update(vertices());
             if (iVertexColorAttribArray)
-                iVertexColorAttribArray->update(iBuffer);
+                iVertexColorAttribArray->update(vertices());
             if (iVertexTextureCoordAttribArray)
-                iVertexTextureCoordAttribArray->update(iBuffer);
+                iVertexTextureCoordAttribArray->update(vertices());
             if (iVertexFunction0AttribArray)
-                iVertexFunction0AttribArray->update(iBuffer);
+                iVertexFunction0AttribArray->update(vertices());
             if (iVertexFunction1AttribArray)
-                iVertexFunction1AttribArray->update(iBuffer);
+                iVertexFunction1AttribArray->update(vertices());
             if (iVertexFunction2AttribArray)
-                iVertexFunction2AttribArray->update(iBuffer);
+                iVertexFunction2AttribArray->update(vertices());
             if (iVertexFunction3AttribArray)
-                iVertexFunction3AttribArray->update(iBuffer);
+                iVertexFunction3AttribArray->update(vertices());
             if (iVertexFunction4AttribArray)
-                iVertexFunction4AttribArray->update(iBuffer);
+                iVertexFunction4AttribArray->update(vertices());
             if (iVertexFunction5AttribArray)
-                iVertexFunction5AttribArray->update(iBuffer);
+                iVertexFunction5AttribArray->update(vertices());
             if (iVertexFunction6AttribArray)
-                iVertexFunction6AttribArray->update(iBuffer);
+                iVertexFunction6AttribArray->update(vertices());
         }
     private:
-        opengl_buffer<vertex_type> iBuffer;
+        std::deque<region> iRegions;
+        std::size_t iCurrentRegion = 0;
+        std::deque<retired_vertices> iRetired;
+        i_opengl_draw_capture* iCapture = nullptr;
         optional_mat44 iTransformation;
         std::optional<opengl_vertex_array> iVao;
         std::optional<opengl_vertex_attrib_array<vertex_type, decltype(vertex_type::xyz)>> iVertexPositionAttribArray;
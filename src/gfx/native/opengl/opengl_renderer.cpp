@@ -45,40 +45,15 @@
 
 namespace neogfx
 {
-    frame_counter::frame_counter(std::uint32_t aDuration) : iTimer{ service<i_async_task>(), [this](neolib::callback_timer& aTimer)
-        {
-            aTimer.again();
-            ++iCounter;
-            for (auto w : iWidgets)
-                w->update();
-        }, std::chrono::milliseconds{ aDuration } }, iCounter{ 0 }
-    {
-    }
-
-    std::uint32_t frame_counter::counter() const
-    {
-        return iCounter;
-    }
-
-    void frame_counter::add(i_widget& aWidget)
-    {
-        auto iterWidget = std::find(iWidgets.begin(), iWidgets.end(), &aWidget);
-        if (iterWidget == iWidgets.end())
-            iWidgets.push_back(&aWidget);
-    }
-
-    void frame_counter::remove(i_widget& aWidget)
-    {
-        auto iterWidget = std::find(iWidgets.begin(), iWidgets.end(), &aWidget);
-        if (iterWidget != iWidgets.end())
-            iWidgets.erase(iterWidget);
-    }
-
     opengl_renderer::opengl_renderer(neogfx::renderer aRenderer) :
         iRenderer{ aRenderer },
         iLimitFrameRate{ true },
         iFrameRateLimit{ 60u },
-        iSubpixelRendering{ false }
+        iSubpixelRendering{ false },
+        iOperationReordering{ false },
+        iInstancedShapes{ false },
+        iParallelMeshGeneration{ false },
+        iTextureUploadBudget{ 16ull * 1024ull * 1024ull }
     {
 #ifdef _WIN32
         ::SetProcessDpiAwareness(PROCESS_PER_MONITOR_DPI_AWARE);
@@ -117,6 +92,7 @@ namespace neogfx
         iPingPongBuffer1s = std::nullopt;
         iPingPongBuffer2s = std::nullopt;
         iTextureManager = std::nullopt;
+        iTextureUploadQueue = std::nullopt;
         iShaderPrograms.clear();
         iDefaultShaderProgram.reset();
     }
@@ -269,12 +245,10 @@ namespace neogfx
         auto existing = iVertexBuffers.find(&aProvider);
         if (existing != iVertexBuffers.end())
         {
+            // Vertices in use by the GPU are never overwritten without first waiting on a fence (see opengl_vertex_buffer::cycle)
+            // so switching buffers need not wait.
             if (iLastVertexBufferUsed && iLastVertexBufferUsed != existing)
-            {
-                auto& currentBuffer = (**iLastVertexBufferUsed).second;
-                currentBuffer.flush();
-                currentBuffer.execute();
-            }
+                (**iLastVertexBufferUsed).second.flush();
             iLastVertexBufferUsed = existing;
             return existing->second;
         }
@@ -292,7 +266,7 @@ namespace neogfx
         {
             auto& buffer = vb.second;
             buffer.flush();
-            buffer.execute();
+            buffer.cycle();
         }
     }
 
@@ -335,6 +309,86 @@ namespace neogfx
         }
     }
 
+    bool opengl_renderer::operation_reordering_enabled() const
+    {
+        return iOperationReordering;
+    }
+
+    void opengl_renderer::enable_operation_reordering(bool aEnable)
+    {
+        iOperationReordering = aEnable;
+    }
+
+    bool opengl_renderer::instanced_shapes_enabled() const
+    {
+        return iInstancedShapes;
+    }
+
+    void opengl_renderer::enable_instanced_shapes(bool aEnable)
+    {
+        iInstancedShapes = aEnable;
+    }
+
+    bool opengl_renderer::parallel_mesh_generation_enabled() const
+    {
+        return iParallelMeshGeneration;
+    }
+
+    void opengl_renderer::enable_parallel_mesh_generation(bool aEnable)
+    {
+        iParallelMeshGeneration = aEnable;
+    }
+
+    std::uint64_t opengl_renderer::texture_upload_budget() const
+    {
+        return iTextureUploadBudget;
+    }
+
+    void opengl_renderer::set_texture_upload_budget(std::uint64_t aBytesPerFrame)
+    {
+        iTextureUploadBudget = aBytesPerFrame;
+    }
+
+    rendering_statistics const& opengl_renderer::statistics() const
+    {
+        return iStatistics;
+    }
+
+    rendering_statistics& opengl_renderer::frame_statistics()
+    {
+        return iFrameStatistics;
+    }
+
+    std::uint32_t opengl_renderer::draw_calls_saved() const
+    {
+        return iStatistics.drawCallsSaved;
+    }
+
+    void opengl_renderer::add_draw_calls_saved(std::uint32_t aDrawCalls)
+    {
+        iFrameStatistics.drawCallsSaved += aDrawCalls;
+    }
+
+    opengl_texture_upload_queue& opengl_renderer::texture_upload_queue()
+    {
+        if (iTextureUploadQueue == std::nullopt)
+            iTextureUploadQueue.emplace();
+        return *iTextureUploadQueue;
+    }
+
+    void opengl_renderer::upload_textures()
+    {
+        if (iTextureUploadQueue != std::nullopt)
+            iTextureUploadQueue->upload(texture_upload_budget());
+    }
+
+    void opengl_renderer::end_frame()
+    {
+        iStatistics = iFrameStatistics;
+        iFrameStatistics = {};
+        iFrameStatistics.frame = iStatistics.frame + 1ull;
+    }
+
     bool opengl_renderer::frame_rate_limited() const
     {
         return iLimitFrameRate && neolib::service<neolib::i_power>().green_mode_active(); 
@@ -30,25 +30,12 @@
 #include <neogfx/gfx/i_standard_shader_program.hpp>
 #include "opengl.hpp"
 #include "opengl_texture_manager.hpp"
+#include "opengl_texture_upload_queue.hpp"
 #include "opengl_helpers.hpp"
+#include "../frame_counter.hpp"
 
 namespace neogfx
 {
-    class frame_counter
-    {
-    public:
-        frame_counter(std::uint32_t aDuration);
-    public:
-        std::uint32_t counter() const;
-    public:
-        void add(i_widget& aWidget);
-        void remove(i_widget& aWidget);
-    private:
-        neolib::callback_timer iTimer;
-        std::uint32_t iCounter;
-        std::vector<i_widget*> iWidgets;
-    };
-
     class opengl_renderer : public i_rendering_engine
     {
         // events
@@ -111,10 +98,23 @@ namespace neogfx
         bool is_subpixel_rendering_on() const override;
         void subpixel_rendering_on() override;
         void subpixel_rendering_off() override;
+        bool operation_reordering_enabled() const override;
+        void enable_operation_reordering(bool aEnable) override;
+        bool instanced_shapes_enabled() const override;
+        std::uint32_t draw_calls_saved() const override;
+        void add_draw_calls_saved(std::uint32_t aDrawCalls) override;
+        void enable_instanced_shapes(bool aEnable) override;
+        bool parallel_mesh_generation_enabled() const override;
+        void enable_parallel_mesh_generation(bool aEnable) override;
+        std::uint64_t texture_upload_budget() const override;
+        void set_texture_upload_budget(std::uint64_t aBytesPerFrame) override;
         bool frame_rate_limited() const override;
         void enable_frame_rate_limiter(bool aEnable) override;
         std::uint32_t frame_rate_limit() const override;
         void set_frame_rate_limit(std::uint32_t aFps) override;
+    public:
+        rendering_statistics const& statistics() const override;
+        rendering_statistics& frame_statistics() override;
     public:
         bool process_events() override;
     public:
@@ -122,14 +122,26 @@ namespace neogfx
         void unregister_frame_counter(i_widget& aWidget, std::uint32_t aDuration) override;
         std::uint32_t frame_counter(std::uint32_t aDuration) const override;
         i_texture& create_ping_pong_buffer(ping_pong_buffers_t& aBufferList, const size& aExtents, size& aPreviousExtents, texture_sampling aSampling);
+    public:
+        opengl_texture_upload_queue& texture_upload_queue();
+    protected:
+        void upload_textures();
+        void end_frame();
     private:
         neogfx::renderer iRenderer;
+        std::optional<opengl_texture_upload_queue> iTextureUploadQueue;
         mutable std::optional<opengl_texture_manager> iTextureManager;
         mutable std::optional<neogfx::font_manager> iFontManager;
         mutable shader_program_list iShaderPrograms;
         bool iLimitFrameRate;
         std::uint32_t iFrameRateLimit;
         bool iSubpixelRendering;
+        bool iOperationReordering;
+        bool iInstancedShapes;
+        bool iParallelMeshGeneration;
+        std::uint64_t iTextureUploadBudget;
+        rendering_statistics iStatistics;
+        rendering_statistics iFrameStatistics;
         typedef std::unordered_map<i_vertex_provider*, opengl_vertex_buffer<>> vertex_buffers_map;
         mutable vertex_buffers_map iVertexBuffers;
         mutable std::optional<vertex_buffers_map::iterator> iLastVertexBufferUsed;
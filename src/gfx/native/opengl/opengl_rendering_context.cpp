@@ -19,7 +19,10 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <future>
+#include <thread>
 #include <neolib/core/thread_local.hpp>
+#include <neolib/task/thread_pool.hpp>
 #include <neolib/app/i_power.hpp>
 
 #include <neogfx/app/i_basic_services.hpp>
@@ -33,6 +36,7 @@
 #include <neogfx/game/rectangle.hpp>
 #include <neogfx/game/text_mesh.hpp>
 #include <neogfx/game/ecs_helpers.hpp>
+#include <neogfx/game/collision_detector.hpp>
 #include <neogfx/hid/i_native_surface.hpp>
 #include "../i_native_texture.hpp"
 #include "../../text/native/i_native_font_face.hpp"
@@ -259,6 +263,150 @@ namespace neogfx
             }
             return aValue.as<float>().to_vec4();
         }
+
+        inline bool aabb_in_viewport(vec3f const& aMin, vec3f const& aMax, mat44f const& aTransformation, aabb_2df const& aViewport)
+        {
+            vec2f min{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+            vec2f max{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+            for (std::uint32_t corner = 0u; corner < 8u; ++corner)
+            {
+                auto const xyz = aTransformation * vec3f{
+                    (corner & 1u) ? aMax.x : aMin.x,
+                    (corner & 2u) ? aMax.y : aMin.y,
+                    (corner & 4u) ? aMax.z : aMin.z };
+                min.x = std::min(min.x, xyz.x);
+                min.y = std::min(min.y, xyz.y);
+                max.x = std::max(max.x, xyz.x);
+                max.y = std::max(max.y, xyz.y);
+            }
+            return max.x >= aViewport.min.x && min.x <= aViewport.max.x &&
+                max.y >= aViewport.min.y && min.y <= aViewport.max.y;
+        }
+
+        // Operations that only change rendering context state are executed when a recording is compiled, so that
+        // the draw calls captured after them see that state, and again when it is replayed.
+        inline bool changes_state_only(std::size_t aOperationType)
+        {
+            switch (aOperationType)
+            {
+            case graphics_operation::operation_type::SetLogicalCoordinateSystem:
+            case graphics_operation::operation_type::SetLogicalCoordinates:
+            case graphics_operation::operation_type::SetOrigin:
+            case graphics_operation::operation_type::SetViewTransformation:
+            case graphics_operation::operation_type::ScissorOn:
+            case graphics_operation::operation_type::ScissorOff:
+            case graphics_operation::operation_type::SnapToPixelOn:
+            case graphics_operation::operation_type::SnapToPixelOff:
+            case graphics_operation::operation_type::SetOpacity:
+            case graphics_operation::operation_type::SetBlendingMode:
+            case graphics_operation::operation_type::SetSmoothingMode:
+            case graphics_operation::operation_type::PushLogicalOperation:
+            case graphics_operation::operation_type::PopLogicalOperation:
+            case graphics_operation::operation_type::LineStippleOn:
+            case graphics_operation::operation_type::LineStippleOff:
+            case graphics_operation::operation_type::SubpixelRenderingOn:
+            case graphics_operation::operation_type::SubpixelRenderingOff:
+            case graphics_operation::operation_type::ClearGradient:
+            case graphics_operation::operation_type::SetGradient:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Operations whose output is drawn entirely through the standard vertex arrays and so can be captured.
+        inline bool capturable(std::size_t aOperationType)
+        {
+            switch (aOperationType)
+            {
+            case graphics_operation::operation_type::SetPixel:
+            case graphics_operation::operation_type::DrawPixel:
+            case graphics_operation::operation_type::DrawLine:
+            case graphics_operation::operation_type::DrawTriangle:
+            case graphics_operation::operation_type::DrawRect:
+            case graphics_operation::operation_type::DrawRoundedRect:
+            case graphics_operation::operation_type::DrawEllipseRect:
+            case graphics_operation::operation_type::DrawCheckerboard:
+            case graphics_operation::operation_type::DrawCircle:
+            case graphics_operation::operation_type::DrawEllipse:
+            case graphics_operation::operation_type::DrawPie:
+            case graphics_operation::operation_type::DrawArc:
+            case graphics_operation::operation_type::DrawCubicBezier:
+            case graphics_operation::operation_type::DrawPath:
+            case graphics_operation::operation_type::DrawShape:
+            case graphics_operation::operation_type::DrawGlyph:
+            case graphics_operation::operation_type::DrawMesh:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // The texture units the standard shaders sample: 1 and 2 the texture being drawn, 3 and 4 the gradient,
+        // 5 the filter kernel and 7 the render target (subpixel glyphs).
+        inline GLenum texture_unit_target(std::size_t aUnit)
+        {
+            switch (aUnit)
+            {
+            case 1:
+                return GL_TEXTURE_2D;
+            case 2:
+            case 7:
+                return GL_TEXTURE_2D_MULTISAMPLE;
+            case 3:
+            case 4:
+            case 5:
+                return GL_TEXTURE_RECTANGLE;
+            default:
+                return GL_NONE;
+            }
+        }
+
+        inline GLenum texture_unit_binding(std::size_t aUnit)
+        {
+            switch (texture_unit_target(aUnit))
+            {
+            case GL_TEXTURE_2D:
+                return GL_TEXTURE_BINDING_2D;
+            case GL_TEXTURE_2D_MULTISAMPLE:
+                return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+            case GL_TEXTURE_RECTANGLE:
+                return GL_TEXTURE_BINDING_RECTANGLE;
+            default:
+                return GL_NONE;
+            }
+        }
+
+        // Replaying captured draw calls binds textures directly; textures remember the unit they were bound to so
+        // the previous bindings are put back afterwards.
+        class scoped_texture_units
+        {
+        public:
+            scoped_texture_units()
+            {
+                glCheck(glGetIntegerv(GL_ACTIVE_TEXTURE, &iActiveTexture));
+                for (std::size_t unit = 0u; unit < iBindings.size(); ++unit)
+                    if (texture_unit_binding(unit) != GL_NONE)
+                    {
+                        glCheck(glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit)));
+                        glCheck(glGetIntegerv(texture_unit_binding(unit), &iBindings[unit]));
+                    }
+                glCheck(glActiveTexture(static_cast<GLenum>(iActiveTexture)));
+            }
+            ~scoped_texture_units()
+            {
+                for (std::size_t unit = 0u; unit < iBindings.size(); ++unit)
+                    if (texture_unit_target(unit) != GL_NONE)
+                    {
+                        glCheck(glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit)));
+                        glCheck(glBindTexture(texture_unit_target(unit), static_cast<GLuint>(iBindings[unit])));
+                    }
+                glCheck(glActiveTexture(static_cast<GLenum>(iActiveTexture)));
+            }
+        private:
+            GLint iActiveTexture = 0;
+            std::array<GLint, opengl_rendering_context::compiled_recording::TextureUnitCount> iBindings = {};
+        };
     }
 
     opengl_rendering_context::opengl_rendering_context(const i_render_target& aTarget, neogfx::blending_mode aBlendingMode) :
@@ -266,8 +414,11 @@ namespace neogfx
         iTarget{ aTarget }, 
         iWidget{ nullptr },
         iInFlush{ false },
+        iRecording{ nullptr },
+        iCapture{ nullptr },
         iMultisample{ true },
         iOpacity{ 1.0 },
+        iReplayOpacity{ 1.0 },
         iSubpixelRendering{ rendering_engine().is_subpixel_rendering_on() },
         iSnapToPixel{ false },
         iSnapToPixelUsesOffset{ true },
@@ -291,9 +442,12 @@ namespace neogfx
         iTarget{ aTarget },
         iWidget{ &aWidget },
         iInFlush{ false },
+        iRecording{ nullptr },
+        iCapture{ nullptr },
         iLogicalCoordinateSystem{ aWidget.logical_coordinate_system() },
         iMultisample{ true },
         iOpacity{ 1.0 },
+        iReplayOpacity{ 1.0 },
         iSubpixelRendering{ rendering_engine().is_subpixel_rendering_on() },
         iSnapToPixel{ false },
         iSnapToPixelUsesOffset{ true },
@@ -317,10 +471,13 @@ namespace neogfx
         iTarget{ aOther.iTarget },
         iWidget{ aOther.iWidget },
         iInFlush{ false },
+        iRecording{ nullptr },
+        iCapture{ nullptr },
         iLogicalCoordinateSystem{ aOther.iLogicalCoordinateSystem },
         iLogicalCoordinates{ aOther.iLogicalCoordinates },
         iMultisample{ true },
         iOpacity{ 1.0 },
+        iReplayOpacity{ 1.0 },
         iSubpixelRendering{ aOther.iSubpixelRendering },
         iSnapToPixel{ false },
         iSnapToPixelUsesOffset{ true },
@@ -453,7 +610,10 @@ namespace neogfx
 
     void opengl_rendering_context::enqueue(const graphics_operation::operation& aOperation)
     {
-        queue().push_back(aOperation);
+        if (iRecording)
+            iRecording->push_back(aOperation);
+        else
+            queue().push_back(aOperation);
     }
 
     void opengl_rendering_context::flush()
@@ -466,10 +626,18 @@ namespace neogfx
         if (queue().empty())
             return;
 
+        auto const flushStart = std::chrono::steady_clock::now();
+        auto& statistics = rendering_engine().frame_statistics();
+        ++statistics.flushes;
+        statistics.queueLength += queue().size();
+
         scoped_render_target srt{ render_target() };
         set_blending_mode(blending_mode());
         apply_scissor();
 
+        if (rendering_engine().operation_reordering_enabled())
+            rendering_engine().add_draw_calls_saved(graphics_operation::reorder(queue()));
+
         for (auto batchStart = queue().begin(); batchStart != queue().end();)
         {
             auto batchEnd = std::next(batchStart);
@@ -477,174 +645,523 @@ namespace neogfx
                 ++batchEnd;
             graphics_operation::batch const opBatch{ &*batchStart, &*batchStart + (batchEnd - batchStart) };
             batchStart = batchEnd;
-            switch (opBatch.cbegin()->index())
+            execute(opBatch);
+        }
+        queue().clear();
+
+        statistics.flushTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - flushStart);
+    }
+
+    void opengl_rendering_context::begin_recording(graphics_operation::recording& aRecording)
+    {
+        iRecording = &aRecording;
+    }
+
+    void opengl_rendering_context::end_recording()
+    {
+        if (iRecording == nullptr)
+            return;
+        auto& recording = *iRecording;
+        iRecording = nullptr;
+        rendering_engine().add_draw_calls_saved(recording.compile(rendering_engine().operation_reordering_enabled()));
+        recording.set_compiled(compile(recording));
+    }
+
+    void opengl_rendering_context::replay(const graphics_operation::recording& aRecording, const vec2& aOffset, double aOpacity)
+    {
+        if (aRecording.empty())
+            return;
+
+        flush();
+
+        neolib::scoped_flag sf{ iInFlush };
+
+        auto const replayStart = std::chrono::steady_clock::now();
+        auto& statistics = rendering_engine().frame_statistics();
+        ++statistics.flushes;
+        statistics.queueLength += aRecording.operations().size();
+
+        scoped_render_target srt{ render_target() };
+        set_blending_mode(blending_mode());
+        apply_scissor();
+
+        // the recorded vertices are in device units relative to the origin at the time of recording so
+        // translation is left to the vertex shader by way of the offset uniform
+        auto const previousOffset = iOffset;
+        auto const previousOpacity = iOpacity;
+        iOffset = iOffset.value_or(vec2{}) + aOffset;
+        iReplayOffset = aOffset;
+        iReplayOpacity = aOpacity;
+        iOpacity *= aOpacity;
+
+        if (auto const compiled = dynamic_cast<compiled_recording const*>(aRecording.compiled()))
+        {
+            // replay only reads the compiled vertices; the provider is needed to find their buffer
+            auto& provider = const_cast<compiled_recording&>(*compiled);
+            for (auto const& step : compiled->iSteps)
             {
-            case graphics_operation::operation_type::SetLogicalCoordinateSystem:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    set_logical_coordinate_system(static_variant_cast<const graphics_operation::set_logical_coordinate_system&>(*op).system);
-                break;
-            case graphics_operation::operation_type::SetLogicalCoordinates:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    set_logical_coordinates(static_variant_cast<const graphics_operation::set_logical_coordinates&>(*op).coordinates);
-                break;
-            case graphics_operation::operation_type::SetOrigin:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    set_origin(static_variant_cast<const graphics_operation::set_origin&>(*op).origin);
-                break;
-            case graphics_operation::operation_type::SetViewport:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                {
-                    auto const& setViewport = static_variant_cast<const graphics_operation::set_viewport&>(*op);
-                    if (setViewport.viewport)
-                        render_target().set_viewport(setViewport.viewport.value().as<std::int32_t>());
-                    else
-                        render_target().set_viewport(rect{ render_target().target_origin(), render_target().extents() }.as<std::int32_t>());
-                }
-                break;
-            case graphics_operation::operation_type::ScissorOn:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    scissor_on(static_variant_cast<const graphics_operation::scissor_on&>(*op).rect);
-                break;
-            case graphics_operation::operation_type::ScissorOff:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                {
-                    (void)op;
-                    scissor_off();
-                }
-                break;
-            case graphics_operation::operation_type::SnapToPixelOn:
-                set_snap_to_pixel(true);
-                break;
-            case graphics_operation::operation_type::SnapToPixelOff:
-                set_snap_to_pixel(false);
-                break;
-            case graphics_operation::operation_type::SetOpacity:
-                set_opacity(static_variant_cast<const graphics_operation::set_opacity&>(*(std::prev(opBatch.cend()))).opacity);
-                break;
-            case graphics_operation::operation_type::SetBlendingMode:
-                set_blending_mode(static_variant_cast<const graphics_operation::set_blending_mode&>(*(std::prev(opBatch.cend()))).blendingMode);
-                break;
-            case graphics_operation::operation_type::SetSmoothingMode:
-                set_smoothing_mode(static_variant_cast<const graphics_operation::set_smoothing_mode&>(*(std::prev(opBatch.cend()))).smoothingMode);
-                break;
-            case graphics_operation::operation_type::PushLogicalOperation:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    push_logical_operation(static_variant_cast<const graphics_operation::push_logical_operation&>(*op).logicalOperation);
-                break;
-            case graphics_operation::operation_type::PopLogicalOperation:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                {
-                    (void)op;
-                    pop_logical_operation();
-                }
-                break;
-            case graphics_operation::operation_type::LineStippleOn:
+                auto const batch = aRecording.batch_at(step.batch);
+                if (step.draws == std::nullopt)
                 {
-                    auto const& lso = static_variant_cast<const graphics_operation::line_stipple_on&>(*(std::prev(opBatch.cend())));
-                    line_stipple_on(lso.stipple);
-                }
-                break;
-            case graphics_operation::operation_type::LineStippleOff:
-                line_stipple_off();
-                break;
-            case graphics_operation::operation_type::SubpixelRenderingOn:
-                subpixel_rendering_on();
-                break;
-            case graphics_operation::operation_type::SubpixelRenderingOff:
-                subpixel_rendering_off();
-                break;
-            case graphics_operation::operation_type::Clear:
-                clear(static_variant_cast<const graphics_operation::clear&>(*(std::prev(opBatch.cend()))).color);
-                break;
-            case graphics_operation::operation_type::ClearDepthBuffer:
-                clear_depth_buffer();
-                break;
-            case graphics_operation::operation_type::ClearStencilBuffer:
-                clear_stencil_buffer();
-                break;
-            case graphics_operation::operation_type::SetGradient:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    set_gradient(static_variant_cast<const graphics_operation::set_gradient&>(*op).gradient);
-                break;
-            case graphics_operation::operation_type::ClearGradient:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    clear_gradient();
-                break;
-            case graphics_operation::operation_type::SetPixel:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                    set_pixel(static_variant_cast<const graphics_operation::set_pixel&>(*op).point, static_variant_cast<const graphics_operation::set_pixel&>(*op).color);
-                break;
-            case graphics_operation::operation_type::DrawPixel:
-                draw_pixels(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawLine:
-                draw_lines(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawTriangle:
-                draw_triangles(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawRect:
-                draw_rects(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawRoundedRect:
-                draw_rounded_rects(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawEllipseRect:
-                draw_ellipse_rects(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawCheckerboard:
-                draw_checkerboards(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawCircle:
-                draw_circles(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawEllipse:
-                draw_ellipses(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawPie:
-                draw_pies(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawArc:
-                draw_arcs(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawCubicBezier:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                {
-                    auto const& args = static_variant_cast<const graphics_operation::draw_cubic_bezier&>(*op);
-                    draw_cubic_bezier(args.p0, args.p1, args.p2, args.p3, args.pen);
-                }
-                break;
-            case graphics_operation::operation_type::DrawPath:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
-                {
-                    auto const& args = static_variant_cast<const graphics_operation::draw_path&>(*op);
-                    draw_path(args.path, args.shape, args.boundingRect, args.pen, args.fill);
+                    execute(batch);
+                    continue;
                 }
-                break;
-            case graphics_operation::operation_type::DrawShape:
-                draw_shapes(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawEntities:
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
+                ++statistics.batches;
+                ++statistics.batchesByOperation[batch.cbegin()->index()];
+                scoped_texture_units stu;
+                for (auto drawCall = step.draws->first; drawCall != step.draws->second; ++drawCall)
+                    replay(provider, compiled->iDraws[drawCall]);
+            }
+        }
+        else
+            for (std::size_t batchIndex = 0u; batchIndex < aRecording.batch_count(); ++batchIndex)
+                execute(aRecording.batch_at(batchIndex));
+
+        iOffset = previousOffset;
+        iReplayOffset = vec2{};
+        iReplayOpacity = 1.0;
+        iOpacity = previousOpacity;
+
+        statistics.flushTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - replayStart);
+    }
+
+    void opengl_rendering_context::execute(const graphics_operation::batch& aBatch)
+    {
+        auto& statistics = rendering_engine().frame_statistics();
+        ++statistics.batches;
+        ++statistics.batchesByOperation[aBatch.cbegin()->index()];
+        dispatch(aBatch);
+    }
+
+    void opengl_rendering_context::dispatch(const graphics_operation::batch& aBatch)
+    {
+        switch (aBatch.cbegin()->index())
+        {
+        case graphics_operation::operation_type::SetLogicalCoordinateSystem:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                set_logical_coordinate_system(static_variant_cast<const graphics_operation::set_logical_coordinate_system&>(*op).system);
+            break;
+        case graphics_operation::operation_type::SetLogicalCoordinates:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                set_logical_coordinates(static_variant_cast<const graphics_operation::set_logical_coordinates&>(*op).coordinates);
+            break;
+        case graphics_operation::operation_type::SetOrigin:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                set_origin(static_variant_cast<const graphics_operation::set_origin&>(*op).origin);
+            break;
+        case graphics_operation::operation_type::SetViewport:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+            {
+                auto const& setViewport = static_variant_cast<const graphics_operation::set_viewport&>(*op);
+                if (setViewport.viewport)
+                    render_target().set_viewport(setViewport.viewport.value().as<std::int32_t>());
+                else
+                    render_target().set_viewport(rect{ render_target().target_origin(), render_target().extents() }.as<std::int32_t>());
+            }
+            break;
+        case graphics_operation::operation_type::ScissorOn:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                scissor_on(static_variant_cast<const graphics_operation::scissor_on&>(*op).rect.translated(point{ iReplayOffset }));
+            break;
+        case graphics_operation::operation_type::ScissorOff:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+            {
+                (void)op;
+                scissor_off();
+            }
+            break;
+        case graphics_operation::operation_type::SnapToPixelOn:
+            set_snap_to_pixel(true);
+            break;
+        case graphics_operation::operation_type::SnapToPixelOff:
+            set_snap_to_pixel(false);
+            break;
+        case graphics_operation::operation_type::SetOpacity:
+            set_opacity(static_variant_cast<const graphics_operation::set_opacity&>(*(std::prev(aBatch.cend()))).opacity * iReplayOpacity);
+            break;
+        case graphics_operation::operation_type::SetBlendingMode:
+            set_blending_mode(static_variant_cast<const graphics_operation::set_blending_mode&>(*(std::prev(aBatch.cend()))).blendingMode);
+            break;
+        case graphics_operation::operation_type::SetSmoothingMode:
+            set_smoothing_mode(static_variant_cast<const graphics_operation::set_smoothing_mode&>(*(std::prev(aBatch.cend()))).smoothingMode);
+            break;
+        case graphics_operation::operation_type::PushLogicalOperation:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                push_logical_operation(static_variant_cast<const graphics_operation::push_logical_operation&>(*op).logicalOperation);
+            break;
+        case graphics_operation::operation_type::PopLogicalOperation:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+            {
+                (void)op;
+                pop_logical_operation();
+            }
+            break;
+        case graphics_operation::operation_type::LineStippleOn:
+            {
+                auto const& lso = static_variant_cast<const graphics_operation::line_stipple_on&>(*(std::prev(aBatch.cend())));
+                line_stipple_on(lso.stipple);
+            }
+            break;
+        case graphics_operation::operation_type::LineStippleOff:
+            line_stipple_off();
+            break;
+        case graphics_operation::operation_type::SubpixelRenderingOn:
+            subpixel_rendering_on();
+            break;
+        case graphics_operation::operation_type::SubpixelRenderingOff:
+            subpixel_rendering_off();
+            break;
+        case graphics_operation::operation_type::Clear:
+            clear(static_variant_cast<const graphics_operation::clear&>(*(std::prev(aBatch.cend()))).color);
+            break;
+        case graphics_operation::operation_type::ClearDepthBuffer:
+            clear_depth_buffer();
+            break;
+        case graphics_operation::operation_type::ClearStencilBuffer:
+            clear_stencil_buffer();
+            break;
+        case graphics_operation::operation_type::SetGradient:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                set_gradient(static_variant_cast<const graphics_operation::set_gradient&>(*op).gradient);
+            break;
+        case graphics_operation::operation_type::ClearGradient:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                clear_gradient();
+            break;
+        case graphics_operation::operation_type::SetPixel:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+                set_pixel(static_variant_cast<const graphics_operation::set_pixel&>(*op).point, static_variant_cast<const graphics_operation::set_pixel&>(*op).color);
+            break;
+        case graphics_operation::operation_type::DrawPixel:
+            draw_pixels(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawLine:
+            draw_lines(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawTriangle:
+            draw_triangles(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawRect:
+            draw_rects(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawRoundedRect:
+            draw_rounded_rects(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawEllipseRect:
+            draw_ellipse_rects(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawCheckerboard:
+            draw_checkerboards(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawCircle:
+            draw_circles(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawEllipse:
+            draw_ellipses(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawPie:
+            draw_pies(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawArc:
+            draw_arcs(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawCubicBezier:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_cubic_bezier&>(*op);
+                draw_cubic_bezier(args.p0, args.p1, args.p2, args.p3, args.pen);
+            }
+            break;
+        case graphics_operation::operation_type::DrawPath:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_path&>(*op);
+                draw_path(args.path, args.shape, args.boundingRect, args.pen, args.fill);
+            }
+            break;
+        case graphics_operation::operation_type::DrawShape:
+            draw_shapes(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawEntities:
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_entities&>(*op);
+                draw_entities(args.ecs, args.layer, args.transformation);
+            }
+            break;
+        case graphics_operation::operation_type::DrawGlyph:
+            draw_glyphs(aBatch);
+            break;
+        case graphics_operation::operation_type::DrawMesh:
+            // todo: use draw_meshes
+            for (auto op = aBatch.cbegin(); op != aBatch.cend(); ++op)
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_mesh&>(*op);
+                draw_mesh(args.mesh, args.material, args.transformation, args.filter);
+            }
+            break;
+        }
+    }
+
+    opengl_rendering_context::compiled_recording::compiled_recording() :
+        iContext{ nullptr },
+        iFailed{ false }
+    {
+        service<i_rendering_engine>().allocate_vertex_buffer(*this, vertex_buffer_type::Default | vertex_buffer_type::Persist);
+    }
+
+    opengl_rendering_context::compiled_recording::~compiled_recording()
+    {
+        service<i_rendering_engine>().deallocate_vertex_buffer(*this);
+    }
+
+    bool opengl_rendering_context::compiled_recording::cacheable() const
+    {
+        return false;
+    }
+
+    const game::component<game::mesh_render_cache>& opengl_rendering_context::compiled_recording::cache() const
+    {
+        throw not_cacheable();
+    }
+
+    game::component<game::mesh_render_cache>& opengl_rendering_context::compiled_recording::cache()
+    {
+        throw not_cacheable();
+    }
+
+    void opengl_rendering_context::compiled_recording::capture(GLenum aMode, standard_vertex const* aVertices, std::size_t aCount, optional_mat44 const& aTransformation, bool aWithTextures,
+        std::optional<std::size_t> const& aInstanceVertexCount, bool aUseBarrier, std::size_t aSkipCount)
+    {
+        auto& vertices = vertex_buffer().vertices();
+        auto const start = vertices.size();
+        vertices.resize(start + aCount);
+        std::copy(aVertices, aVertices + aCount, std::next(vertices.begin(), start));
+
+        auto& context = *iContext;
+        auto& program = context.rendering_engine().active_shader_program();
+
+        auto& drawCall = iDraws.emplace_back();
+        drawCall.mode = aMode;
+        drawCall.start = start;
+        drawCall.count = aCount;
+        drawCall.transformation = aTransformation;
+        drawCall.withTextures = aWithTextures;
+        drawCall.instanceVertexCount = aInstanceVertexCount;
+        drawCall.useBarrier = aUseBarrier;
+        drawCall.skipCount = aSkipCount;
+        drawCall.program = &program;
+        for (auto& stage : program.stages())
+            for (auto& shader : stage->shaders())
+            {
+                auto& shaderState = drawCall.shaders.emplace_back(shader_state{ &*shader, shader->enabled() });
+                for (auto const& uniform : shader->uniforms())
+                    if (!uniform.value().empty())
+                    {
+                        shaderState.uniforms.emplace_back(uniform.id(), shader_value_type{});
+                        shaderState.uniforms.back().second = uniform.value();
+                    }
+            }
+
+        GLint activeTexture = 0;
+        glCheck(glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture));
+        drawCall.textures = {};
+        for (std::size_t unit = 0u; unit < TextureUnitCount; ++unit)
+            if (texture_unit_binding(unit) != GL_NONE)
+            {
+                glCheck(glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit)));
+                glCheck(glGetIntegerv(texture_unit_binding(unit), &drawCall.textures[unit]));
+            }
+        drawCall.textureFilter = {};
+        if (drawCall.textures[1u] != 0)
+        {
+            glCheck(glActiveTexture(GL_TEXTURE1));
+            glCheck(glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &drawCall.textureFilter[0u]));
+            glCheck(glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &drawCall.textureFilter[1u]));
+        }
+        glCheck(glActiveTexture(static_cast<GLenum>(activeTexture)));
+
+        drawCall.smoothingMode = context.smoothing_mode();
+        drawCall.multisample = context.multisample();
+        drawCall.snapToPixel = context.iSnapToPixel;
+        drawCall.snapToPixelUsesOffset = context.iSnapToPixelUsesOffset;
+        drawCall.sampleShading = context.iSampleShadingRate != std::nullopt;
+    }
+
+    opengl_vertex_buffer<>& opengl_rendering_context::compiled_recording::vertex_buffer()
+    {
+        return static_cast<opengl_vertex_buffer<>&>(service<i_rendering_engine>().vertex_buffer(*this));
+    }
+
+    void opengl_rendering_context::compiled_recording::fail()
+    {
+        iFailed = true;
+    }
+
+    void opengl_rendering_context::compiled_recording::keep(ref_ptr<i_texture> const& aTexture)
+    {
+        if (iTextures.empty() || iTextures.back() != aTexture)
+            iTextures.push_back(aTexture);
+    }
+
+    std::unique_ptr<opengl_rendering_context::compiled_recording> opengl_rendering_context::compile(const graphics_operation::recording& aRecording)
+    {
+        auto result = std::make_unique<compiled_recording>();
+        auto& compiled = *result;
+
+        neolib::scoped_flag sf{ iInFlush };
+        scoped_render_target srt{ render_target() };
+
+        auto const savedLogicalCoordinateSystem = iLogicalCoordinateSystem;
+        auto const savedLogicalCoordinates = iLogicalCoordinates;
+        auto const savedOrigin = iOrigin;
+        auto const savedOpacity = iOpacity;
+        auto const savedBlendingMode = blending_mode();
+        auto const savedSmoothingMode = smoothing_mode();
+        auto const savedLogicalOperationStack = iLogicalOperationStack;
+        auto const savedScissorRects = iScissorRects;
+        auto const savedSnapToPixel = iSnapToPixel;
+        auto const savedSubpixelRendering = iSubpixelRendering;
+        auto const savedGradient = iGradient;
+
+        auto& streamingBuffer = static_cast<opengl_vertex_buffer<>&>(rendering_engine().vertex_buffer(as_vertex_provider()));
+        auto& compiledVertices = compiled.vertex_buffer().vertices();
+
+        auto finish = [&]()
+        {
+            streamingBuffer.set_capture(nullptr);
+            iCapture = nullptr;
+            compiled.iContext = nullptr;
+            iLogicalCoordinateSystem = savedLogicalCoordinateSystem;
+            iLogicalCoordinates = savedLogicalCoordinates;
+            iOrigin = savedOrigin;
+            iOpacity = savedOpacity;
+            iSnapToPixel = savedSnapToPixel;
+            iSubpixelRendering = savedSubpixelRendering;
+            iGradient = savedGradient;
+            line_stipple_off();
+            iSmoothingMode = std::nullopt;
+            set_smoothing_mode(savedSmoothingMode);
+            iBlendingMode = std::nullopt;
+            set_blending_mode(savedBlendingMode);
+            iLogicalOperationStack = savedLogicalOperationStack;
+            apply_logical_operation();
+            iScissorRects = savedScissorRects;
+            iScissorRect = std::nullopt;
+            apply_scissor();
+        };
+
+        iCapture = &compiled;
+        compiled.iContext = this;
+        streamingBuffer.set_capture(&compiled);
+
+        try
+        {
+            for (std::size_t batchIndex = 0u; batchIndex < aRecording.batch_count(); ++batchIndex)
+            {
+                auto const batch = aRecording.batch_at(batchIndex);
+                auto const operationType = batch.cbegin()->index();
+                if (changes_state_only(operationType))
                 {
-                    auto const& args = static_variant_cast<const graphics_operation::draw_entities&>(*op);
-                    draw_entities(args.ecs, args.layer, args.transformation);
+                    dispatch(batch);
+                    compiled.iSteps.push_back(compiled_recording::step{ batchIndex });
                 }
-                break;
-            case graphics_operation::operation_type::DrawGlyph:
-                draw_glyphs(opBatch);
-                break;
-            case graphics_operation::operation_type::DrawMesh:
-                // todo: use draw_meshes
-                for (auto op = opBatch.cbegin(); op != opBatch.cend(); ++op)
+                else if (capturable(operationType))
                 {
-                    auto const& args = static_variant_cast<const graphics_operation::draw_mesh&>(*op);
-                    draw_mesh(args.mesh, args.material, args.transformation, args.filter);
+                    auto const firstDrawCall = compiled.iDraws.size();
+                    auto const firstVertex = compiledVertices.size();
+                    auto const firstTexture = compiled.iTextures.size();
+                    compiled.iFailed = false;
+                    dispatch(batch);
+                    if (!compiled.iFailed)
+                        compiled.iSteps.push_back(compiled_recording::step{ batchIndex, std::make_pair(firstDrawCall, compiled.iDraws.size()) });
+                    else
+                    {
+                        // executed as normal when replayed
+                        compiled.iDraws.erase(std::next(compiled.iDraws.begin(), firstDrawCall), compiled.iDraws.end());
+                        compiledVertices.resize(firstVertex);
+                        compiled.iTextures.erase(std::next(compiled.iTextures.begin(), firstTexture), compiled.iTextures.end());
+                        compiled.iSteps.push_back(compiled_recording::step{ batchIndex });
+                    }
                 }
-                break;
+                else
+                    compiled.iSteps.push_back(compiled_recording::step{ batchIndex });
             }
         }
-        queue().clear();
+        catch (...)
+        {
+            finish();
+            throw;
+        }
+
+        finish();
+        compiled.vertex_buffer().flush();
+
+        return result;
+    }
+
+    void opengl_rendering_context::replay(compiled_recording& aCompiled, compiled_recording::draw_call const& aDrawCall)
+    {
+        use_shader_program usp{ *this, *aDrawCall.program, iOpacity };
+        scoped_anti_alias saa{ *this, aDrawCall.smoothingMode };
+        scoped_multisample sms{ *this, aDrawCall.multisample };
+        neolib::scoped_flag snap{ iSnapToPixel, aDrawCall.snapToPixel };
+        neolib::scoped_flag snapUsesOffset{ iSnapToPixelUsesOffset, aDrawCall.snapToPixelUsesOffset };
+
+        for (auto const& shaderState : aDrawCall.shaders)
+        {
+            if (shaderState.enabled)
+                shaderState.shader->enable();
+            else
+                shaderState.shader->disable();
+            for (auto const& uniform : shaderState.uniforms)
+                shaderState.shader->set_uniform(uniform.first, to_abstract(uniform.second));
+        }
+
+        for (std::size_t unit = 0u; unit < compiled_recording::TextureUnitCount; ++unit)
+        {
+            auto texture = static_cast<GLuint>(aDrawCall.textures[unit]);
+            if (texture == 0u || texture_unit_target(unit) == GL_NONE)
+                continue;
+            if (unit == 7u)
+            {
+                // subpixel glyphs sample what is under them so this is always the target being replayed to
+                texture = static_cast<GLuint>(render_target().target_texture().native_handle());
+                static_cast<i_shader&>(rendering_engine().default_shader_program().glyph_shader()).set_uniform(
+                    "uGlyphRenderTargetExtents"_s, render_target().extents().to_vec2().as<std::int32_t>());
+            }
+            else
+            {
+                // a texture the draw call did not sample may since have been deleted
+                GLboolean isTexture;
+                glCheck(isTexture = glIsTexture(texture));
+                if (isTexture == GL_FALSE)
+                    continue;
+            }
+            glCheck(glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit)));
+            glCheck(glBindTexture(texture_unit_target(unit), texture));
+            if (unit == 1u && aDrawCall.textureFilter[0u] != 0)
+            {
+                glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, aDrawCall.textureFilter[0u]));
+                glCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, aDrawCall.textureFilter[1u]));
+            }
+        }
+
+        if (aDrawCall.sampleShading)
+            enable_sample_shading(1.0);
+
+        {
+            std::optional<use_vertex_arrays> vertexArrays;
+            if (aDrawCall.instanceVertexCount != std::nullopt)
+                vertexArrays.emplace(aCompiled, *this, aDrawCall.mode, instanced, *aDrawCall.instanceVertexCount);
+            else if (aDrawCall.withTextures)
+                vertexArrays.emplace(aCompiled, *this, aDrawCall.mode, aDrawCall.transformation, with_textures, 0u, aDrawCall.useBarrier);
+            else
+                vertexArrays.emplace(aCompiled, *this, aDrawCall.mode, aDrawCall.transformation, 0u, aDrawCall.useBarrier);
+            vertexArrays->draw(aDrawCall.start, aDrawCall.count, { aDrawCall.skipCount });
+        }
+
+        disable_sample_shading();
     }
 
     void opengl_rendering_context::scissor_on(const rect& aRect)
@@ -1024,6 +1541,32 @@ namespace neogfx
 
     namespace
     {
+        // Rect, rounded rect and circle shapes are shaded by the shape shader's SDFs over their bounding rect
+        // so when instancing is enabled each shape is one vertex record that the vertex shader expands into
+        // the bounding rect's two triangles.
+        void emplace_shape_vertex_arrays(std::optional<use_vertex_arrays>& aVertexArrays, i_vertex_provider& aProvider, i_rendering_context& aContext, std::size_t aShapeCount)
+        {
+            if (aContext.rendering_engine().instanced_shapes_enabled())
+                aVertexArrays.emplace(aProvider, aContext, GL_TRIANGLES, instanced, 2u * 3u, aShapeCount);
+            else
+                aVertexArrays.emplace(aProvider, aContext, GL_TRIANGLES, 2u * 2u * 3u * aShapeCount);
+        }
+
+        void push_shape(use_vertex_arrays& aVertexArrays, rect const& aBoundingRect, use_vertex_arrays::value_type aVertex)
+        {
+            if (aVertexArrays.instanced())
+            {
+                aVertex.xyz = aBoundingRect.top_left().to_vec3().as<float>();
+                aVertex.st = aBoundingRect.extents().to_vec2().as<float>();
+                aVertexArrays.push_back(aVertex);
+            }
+            else
+                for (auto const& v : rect_vertices<vec3f>(aBoundingRect, mesh_type::Triangles))
+                {
+                    aVertex.xyz = v;
+                    aVertexArrays.push_back(aVertex);
+                }
+        }
     }
 
     void opengl_rendering_context::draw_rects(const graphics_operation::batch& aDrawRectOps)
@@ -1044,7 +1587,8 @@ namespace neogfx
                         std::holds_alternative<std::monostate>(drawOp.fill)))
                 {
                     bool optimise = false;
-                    if (!logical_operation_active())
+                    // a clear cannot be captured so compiled recordings draw the rect instead
+                    if (!logical_operation_active() && iCapture == nullptr)
                     {
                         auto const penWidth = drawOp.pen.width();
                         if (penWidth == 0.0)
@@ -1083,37 +1627,35 @@ namespace neogfx
 
                     rendering_engine().default_shader_program().shape_shader().set_shape(shader_shape::Rect);
 
-                    maybeVertexArrays.emplace(as_vertex_provider(), *this, GL_TRIANGLES, static_cast<std::size_t>(2u * 2u * 3u * (aDrawRectOps.cend() - aDrawRectOps.cbegin())));
+                    emplace_shape_vertex_arrays(maybeVertexArrays, as_vertex_provider(), *this, static_cast<std::size_t>(aDrawRectOps.cend() - aDrawRectOps.cbegin()));
                 }
 
                 auto& vertexArrays = maybeVertexArrays.value();
 
                 auto const sdfRect = snap_to_pixel() ? drawOp.rect.deflated(drawOp.pen.width() / 2.0) : drawOp.rect;
                 auto const boundingRect = drawOp.rect.inflated(drawOp.pen.width() / 2.0);
-                auto const vertices = rect_vertices<vec3f>(boundingRect, mesh_type::Triangles);
                 auto const function = to_function(drawOp.fill, boundingRect);
 
-                for (auto const& v : vertices)
-                    vertexArrays.push_back({ v,
-                        std::holds_alternative<color>(drawOp.fill) ?
-                            static_variant_cast<color>(drawOp.fill).as<float>() :
-                            vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.fill) ? 0.0f : 1.0f },
-                        {},
-                        function,
-                        vec4{ sdfRect.center().x, sdfRect.center().y, sdfRect.width(), sdfRect.height() }.as<float>(),
-                        vec4{},
-                        vec4{
-                            drawOp.pen.width() ? drawOp.pen.secondary_color().has_value() ? 2.0 : 1.0 : 0.0,
-                            !logical_operation_active() && !snap_to_pixel() ?
-                                drawOp.pen.anti_aliased() ? 
-                                    0.5 : 0.0 :
-                                0.0,
+                push_shape(vertexArrays, boundingRect, { {},
+                    std::holds_alternative<color>(drawOp.fill) ?
+                        static_variant_cast<color>(drawOp.fill).as<float>() :
+                        vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.fill) ? 0.0f : 1.0f },
+                    {},
+                    function,
+                    vec4{ sdfRect.center().x, sdfRect.center().y, sdfRect.width(), sdfRect.height() }.as<float>(),
+                    vec4{},
+                    vec4{
+                        drawOp.pen.width() ? drawOp.pen.secondary_color().has_value() ? 2.0 : 1.0 : 0.0,
+                        !logical_operation_active() && !snap_to_pixel() ?
+                            drawOp.pen.anti_aliased() ? 
+                                0.5 : 0.0 :
                             0.0,
-                            drawOp.pen.width() }.as<float>(),
-                        std::holds_alternative<color>(drawOp.pen.color()) ?
-                            static_variant_cast<color>(drawOp.pen.color()).as<float>() :
-                            vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.pen.color()) ? 0.0f : 1.0f },
-                        drawOp.pen.secondary_color().value_or(vec4{}).as<float>() });
+                        0.0,
+                        drawOp.pen.width() }.as<float>(),
+                    std::holds_alternative<color>(drawOp.pen.color()) ?
+                        static_variant_cast<color>(drawOp.pen.color()).as<float>() :
+                        vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.pen.color()) ? 0.0f : 1.0f },
+                    drawOp.pen.secondary_color().value_or(vec4{}).as<float>() });
             }
         }
     }
@@ -1134,37 +1676,37 @@ namespace neogfx
         rendering_engine().default_shader_program().shape_shader().set_shape(shader_shape::RoundedRect);
 
         {
-            use_vertex_arrays vertexArrays{ as_vertex_provider(), *this, GL_TRIANGLES, static_cast<std::size_t>(2u * 2u * 3u * (aDrawRoundedRectOps.cend() - aDrawRoundedRectOps.cbegin()))};
+            std::optional<use_vertex_arrays> maybeVertexArrays;
+            emplace_shape_vertex_arrays(maybeVertexArrays, as_vertex_provider(), *this, static_cast<std::size_t>(aDrawRoundedRectOps.cend() - aDrawRoundedRectOps.cbegin()));
+            auto& vertexArrays = maybeVertexArrays.value();
 
             for (auto op = aDrawRoundedRectOps.cbegin(); op != aDrawRoundedRectOps.cend(); ++op)
             {
                 auto& drawOp = static_variant_cast<const graphics_operation::draw_rounded_rect&>(*op);
                 auto const sdfRect = snap_to_pixel() ? drawOp.rect.deflated(drawOp.pen.width() / 2.0) : drawOp.rect;
                 auto const boundingRect = drawOp.rect.inflated(drawOp.pen.width() / 2.0);
-                auto const vertices = rect_vertices<vec3f>(boundingRect, mesh_type::Triangles);
                 auto const function = to_function(drawOp.fill, boundingRect);
 
-                for (auto const& v : vertices)
-                    vertexArrays.push_back({ v,
-                        std::holds_alternative<color>(drawOp.fill) ?
-                            static_variant_cast<color>(drawOp.fill).as<float>() :
-                            vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.fill) ? 0.0f : 1.0f },
-                        {},
-                        function,
-                        vec4{ sdfRect.center().x, sdfRect.center().y, sdfRect.width(), sdfRect.height() }.as<float>(),
-                        drawOp.radius.as<float>(),
-                        vec4{
-                            drawOp.pen.width() ? drawOp.pen.secondary_color().has_value() ? 2.0 : 1.0 : 0.0,
-                            !logical_operation_active() && !snap_to_pixel() ?
-                                drawOp.pen.anti_aliased() ? 
-                                    0.5 : 0.0 :
-                                0.0,
+                push_shape(vertexArrays, boundingRect, { {},
+                    std::holds_alternative<color>(drawOp.fill) ?
+                        static_variant_cast<color>(drawOp.fill).as<float>() :
+                        vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.fill) ? 0.0f : 1.0f },
+                    {},
+                    function,
+                    vec4{ sdfRect.center().x, sdfRect.center().y, sdfRect.width(), sdfRect.height() }.as<float>(),
+                    drawOp.radius.as<float>(),
+                    vec4{
+                        drawOp.pen.width() ? drawOp.pen.secondary_color().has_value() ? 2.0 : 1.0 : 0.0,
+                        !logical_operation_active() && !snap_to_pixel() ?
+                            drawOp.pen.anti_aliased() ? 
+                                0.5 : 0.0 :
                             0.0,
-                            drawOp.pen.width() }.as<float>(),
-                        std::holds_alternative<color>(drawOp.pen.color()) ?
-                            static_variant_cast<color>(drawOp.pen.color()).as<float>() :
-                            vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.pen.color()) ? 0.0f : 1.0f },
-                        drawOp.pen.secondary_color().value_or(vec4{}).as<float>() });
+                        0.0,
+                        drawOp.pen.width() }.as<float>(),
+                    std::holds_alternative<color>(drawOp.pen.color()) ?
+                        static_variant_cast<color>(drawOp.pen.color()).as<float>() :
+                        vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.pen.color()) ? 0.0f : 1.0f },
+                    drawOp.pen.secondary_color().value_or(vec4{}).as<float>() });
             }
         }
     }
@@ -1350,36 +1892,36 @@ namespace neogfx
         rendering_engine().default_shader_program().shape_shader().set_shape(shader_shape::Circle);
 
         {
-            use_vertex_arrays vertexArrays{ as_vertex_provider(), *this, GL_TRIANGLES, static_cast<std::size_t>(2u * 2u * 3u * (aDrawCircleOps.cend() - aDrawCircleOps.cbegin()))};
+            std::optional<use_vertex_arrays> maybeVertexArrays;
+            emplace_shape_vertex_arrays(maybeVertexArrays, as_vertex_provider(), *this, static_cast<std::size_t>(aDrawCircleOps.cend() - aDrawCircleOps.cbegin()));
+            auto& vertexArrays = maybeVertexArrays.value();
 
             for (auto op = aDrawCircleOps.cbegin(); op != aDrawCircleOps.cend(); ++op)
             {
                 auto& drawOp = static_variant_cast<const graphics_operation::draw_circle&>(*op);
                 auto boundingRect = rect{ drawOp.center - point{ drawOp.radius, drawOp.radius }, size{ drawOp.radius * 2.0 } }.inflated(drawOp.pen.width() / 2.0);
-                auto vertices = rect_vertices<vec3f>(boundingRect, mesh_type::Triangles);
                 auto const function = to_function(drawOp.pen.color(), boundingRect);
 
-                for (auto const& v : vertices)
-                    vertexArrays.push_back({ v,
-                        std::holds_alternative<color>(drawOp.fill) ?
-                            static_variant_cast<color>(drawOp.fill).as<float>() :
-                            vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.fill) ? 0.0f : 1.0f },
-                        {},
-                        function,
-                        vec4{ drawOp.center.x, drawOp.center.y, drawOp.radius }.as<float>(),
-                        {},
-                        vec4{
-                            drawOp.pen.width() ? drawOp.pen.secondary_color().has_value() ? 2.0 : 1.0 : 0.0,
-                            !logical_operation_active() ?
-                                drawOp.pen.anti_aliased() ? 
-                                    0.5 : 0.0 :
-                                0.0,
+                push_shape(vertexArrays, boundingRect, { {},
+                    std::holds_alternative<color>(drawOp.fill) ?
+                        static_variant_cast<color>(drawOp.fill).as<float>() :
+                        vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.fill) ? 0.0f : 1.0f },
+                    {},
+                    function,
+                    vec4{ drawOp.center.x, drawOp.center.y, drawOp.radius }.as<float>(),
+                    {},
+                    vec4{
+                        drawOp.pen.width() ? drawOp.pen.secondary_color().has_value() ? 2.0 : 1.0 : 0.0,
+                        !logical_operation_active() ?
+                            drawOp.pen.anti_aliased() ? 
+                                0.5 : 0.0 :
                             0.0,
-                            drawOp.pen.width() }.as<float>(),
-                        std::holds_alternative<color>(drawOp.pen.color()) ?
-                            static_variant_cast<color>(drawOp.pen.color()).as<float>() :
-                            vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.pen.color()) ? 0.0f : 1.0f },
-                        drawOp.pen.secondary_color().value_or(vec4{}).as<float>() });
+                        0.0,
+                        drawOp.pen.width() }.as<float>(),
+                    std::holds_alternative<color>(drawOp.pen.color()) ?
+                        static_variant_cast<color>(drawOp.pen.color()).as<float>() :
+                        vec4f{ 0.0f, 0.0f, 0.0f, std::holds_alternative<std::monostate>(drawOp.pen.color()) ? 0.0f : 1.0f },
+                    drawOp.pen.secondary_color().value_or(vec4{}).as<float>() });
             }
         }
     }
@@ -1637,7 +2179,66 @@ namespace neogfx
             auto const& infos = aEcs.component<game::entity_info>();
             auto const& meshRenderers = aEcs.component<game::mesh_renderer>();
             auto const& meshFilters = aEcs.component<game::mesh_filter>();
-            auto const& cache = aEcs.component<game::mesh_render_cache>();
+            auto& cache = aEcs.component<game::mesh_render_cache>();
+            auto entity_transformation = [&](game::entity_id aEntity, game::mesh_filter const& aMeshFilter)
+            {
+                auto const& rigidBodyTransformation = (rigidBodies.has_entity_record_no_lock(aEntity) ?
+                    to_transformation_matrix(rigidBodies.entity_record_no_lock(aEntity)) : mat44f::identity());
+                auto const& meshFilterTransformation = (aMeshFilter.transformation ?
+                    *aMeshFilter.transformation : mat44f::identity());
+                auto const& animationMeshFilterTransformation = (animatedMeshFilters.has_entity_record_no_lock(aEntity) ?
+                    to_transformation_matrix(animatedMeshFilters.entity_record_no_lock(aEntity)) : mat44f::identity());
+                return rigidBodyTransformation * meshFilterTransformation * animationMeshFilterTransformation;
+            };
+            // Cull against the logical coordinates; the vertex shader adds the offset after aTransformation.
+            auto const logicalCoordinates = logical_coordinates();
+            auto const viewportOffset = offset().as<float>();
+            aabb_2df const viewport{
+                vec2f{
+                    static_cast<float>(std::min(logicalCoordinates.bottomLeft.x, logicalCoordinates.topRight.x)) - viewportOffset.x,
+                    static_cast<float>(std::min(logicalCoordinates.bottomLeft.y, logicalCoordinates.topRight.y)) - viewportOffset.y },
+                vec2f{
+                    static_cast<float>(std::max(logicalCoordinates.bottomLeft.x, logicalCoordinates.topRight.x)) - viewportOffset.x,
+                    static_cast<float>(std::max(logicalCoordinates.bottomLeft.y, logicalCoordinates.topRight.y)) - viewportOffset.y } };
+            auto const viewTransformation = aTransformation.as<float>();
+            bool const useColliders = aEcs.system_instantiated<game::collision_detector>();
+            std::optional<game::scoped_component_lock<game::box_collider>> boxColliderLock;
+            std::optional<game::scoped_component_lock<game::box_collider_2d>> boxCollider2dLock;
+            if (useColliders && aEcs.component_instantiated<game::box_collider>())
+                boxColliderLock.emplace(aEcs);
+            if (useColliders && aEcs.component_instantiated<game::box_collider_2d>())
+                boxCollider2dLock.emplace(aEcs);
+            auto in_viewport = [&](game::entity_id aEntity, game::mesh_filter const& aMeshFilter)
+            {
+                if (boxColliderLock)
+                {
+                    auto const& colliders = aEcs.component<game::box_collider>();
+                    if (colliders.has_entity_record_no_lock(aEntity) && colliders.entity_record_no_lock(aEntity).currentAabb)
+                    {
+                        auto const& aabb = *colliders.entity_record_no_lock(aEntity).currentAabb;
+                        return aabb_in_viewport(aabb.min, aabb.max, viewTransformation, viewport);
+                    }
+                }
+                if (boxCollider2dLock)
+                {
+                    auto const& colliders = aEcs.component<game::box_collider_2d>();
+                    if (colliders.has_entity_record_no_lock(aEntity) && colliders.entity_record_no_lock(aEntity).currentAabb)
+                    {
+                        auto const& aabb = *colliders.entity_record_no_lock(aEntity).currentAabb;
+                        return aabb_in_viewport(vec3f{ aabb.min.x, aabb.min.y, 0.0f }, vec3f{ aabb.max.x, aabb.max.y, 0.0f }, viewTransformation, viewport);
+                    }
+                }
+                auto const& mesh = (aMeshFilter.mesh != std::nullopt ? *aMeshFilter.mesh : *aMeshFilter.sharedMesh.ptr);
+                if (mesh.vertices.empty())
+                    return true;
+                // Mesh bounds are recalculated whenever the render cache is not clean as an animation frame change may change the mesh.
+                auto const& meshRenderCache = cache.entity_record_no_lock(aEntity, true);
+                if (meshRenderCache.state != game::cache_state::Clean || meshRenderCache.untransformedAabb == std::nullopt)
+                    meshRenderCache.untransformedAabb = to_aabb(mesh.vertices);
+                return aabb_in_viewport(meshRenderCache.untransformedAabb->min, meshRenderCache.untransformedAabb->max, 
+                    viewTransformation * entity_transformation(aEntity, aMeshFilter), viewport);
+            };
+            auto& statistics = rendering_engine().frame_statistics();
             for (auto entity : meshRenderers.entities())
             {
 #if defined(NEOGFX_DEBUG) && !defined(NDEBUG)
@@ -1654,22 +2255,19 @@ namespace neogfx
                 auto const& meshFilter = meshFilters.has_entity_record_no_lock(entity) ?
                     meshFilters.entity_record_no_lock(entity) :
                     game::current_animation_frame(animatedMeshFilters.entity_record_no_lock(entity));
+                if (!in_viewport(entity, meshFilter))
+                {
+                    ++statistics.entitiesCulled;
+                    continue;
+                }
+                ++statistics.entitiesDrawn;
                 drawables[meshRenderer.layer].emplace_back(
                     meshFilter,
                     meshRenderer,
                     optional_mat44f{},
                     entity);
                 if (!game::is_render_cache_clean_no_lock(cache, entity))
-                {
-                    auto const& rigidBodyTransformation = (rigidBodies.has_entity_record_no_lock(entity) ?
-                        to_transformation_matrix(rigidBodies.entity_record_no_lock(entity)) : mat44f::identity());
-                    auto const& meshFilterTransformation = (meshFilter.transformation ?
-                        *meshFilter.transformation : mat44f::identity());
-                    auto const& animationMeshFilterTransformation = (animatedMeshFilters.has_entity_record_no_lock(entity) ?
-                        to_transformation_matrix(animatedMeshFilters.entity_record_no_lock(entity)) : mat44f::identity());
-                    auto const& transformation = rigidBodyTransformation * meshFilterTransformation * animationMeshFilterTransformation;
-                    drawables[meshRenderer.layer].back().transformation = transformation;
-                }
+                    drawables[meshRenderer.layer].back().transformation = entity_transformation(entity, meshFilter);
             }
         }
         if (!drawables[aLayer].empty())
@@ -1932,7 +2530,15 @@ namespace neogfx
                             continue;
 
                         if (!filter)
+                        {
+                            // the filter draws to buffers of its own so these glyphs cannot be captured
+                            if (iCapture != nullptr)
+                            {
+                                iCapture->fail();
+                                return;
+                            }
                             filter.emplace(*this, blur_filter{ *filterRegion, drawOp.appearance->effect()->width() });
+                        }
 
                         filter->front_buffer().draw_glyph(
                             drawOp.point.as<scalar>() + drawOp.appearance->effect()->offset(),
@@ -2193,18 +2799,13 @@ namespace neogfx
         }
 
         auto& vertexBuffer = static_cast<opengl_vertex_buffer<>&>(service<i_rendering_engine>().vertex_buffer(aVertexProvider));
+        if (cache != nullptr)
+            vertexBuffer.recycle();
+        // A cacheable provider's buffer simply grows (preserving the cached vertices) when it runs out of room;
+        // a streaming buffer moves on to the next region of its ring instead.
+        if (cache == nullptr && !vertexBuffer.vertices().room_for(vertexCount - cachedVertexCount))
+            vertexBuffer.cycle();
         auto& vertices = vertexBuffer.vertices();
-        if (!vertices.room_for(vertexCount - cachedVertexCount))
-        {
-            vertexBuffer.execute();
-            vertices.clear();
-            for (auto md = aFirst; md != aLast; ++md)
-            {
-                auto& meshDrawable = *md;
-                if (meshDrawable.entity != null_entity)
-                    game::set_render_cache_invalid_no_lock(*cache, meshDrawable.entity);
-            }
-        }
 
         std::optional<neolib::cookie> textureId;
         std::optional<float> uvGui;
@@ -2212,6 +2813,27 @@ namespace neogfx
         vec2f uvFixupCoefficient;
         vec2f uvFixupOffset;
 
+        // Vertex output ranges are allocated here in drawable order so the buffer layout does not depend on
+        // whether the vertices are then generated on this thread or on workers.
+        struct vertex_job
+        {
+            game::mesh const* mesh;
+            game::faces const* faces;
+            optional_mat44f const* transformation;
+            vec4f rgba;
+            vec4f function;
+            bool textured;
+            vec2f textureStorageExtents;
+            vec2f uvFixupCoefficient;
+            vec2f uvFixupOffset;
+            std::optional<float> uvGui;
+            std::size_t vertexStartIndex;
+        };
+        thread_local std::vector<vertex_job> vertexJobs;
+        vertexJobs.clear();
+        std::size_t vertexJobsVertexCount = 0;
+        auto appendIndex = vertices.size();
+
         for (auto md = aFirst; md != aLast; ++md)
         {
             auto& meshDrawable = *md;
@@ -2238,7 +2860,8 @@ namespace neogfx
                         vec4f{};
                 if (meshRenderCache.state != game::cache_state::Clean)
                 {
-                    if (patch_drawable::has_texture(meshRenderer, material))
+                    bool const textured = patch_drawable::has_texture(meshRenderer, material);
+                    if (textured)
                     {
                         auto const& materialTexture = patch_drawable::texture(meshRenderer, material);
                         auto nextTextureId = materialTexture.id.cookie();
@@ -2258,35 +2881,23 @@ namespace neogfx
                                 uvGui = static_cast<float>(texture.extents().to_vec2().as<float>().y / textureStorageExtents.y);
                         }
                     }
-                    // todo: check vertex count is same as in cache
-                    auto const vertexStartIndex = (meshRenderCache.state != game::cache_state::Invalid ? cacheIndices[0] : vertices.find_space_for(faces.size() * 3));
-                    auto nextIndex = vertexStartIndex;
-                    for (auto const& face : faces)
+                    // Dirty vertices are written to a fresh range rather than over the old one, which the GPU may
+                    // still be reading; the old range is retired and reused once the GPU is done with it.
+                    auto const faceVertexCount = faces.size() * 3;
+                    auto vertexStartIndex = vertices.find_space_for(faceVertexCount);
+                    if (meshRenderCache.state != game::cache_state::Invalid)
+                        vertexBuffer.reclaim(cacheIndices[0], cacheIndices[1]);
+                    if (vertexStartIndex == vertices.size())
                     {
-                        for (auto faceVertexIndex : face)
-                        {
-                            auto const& xyz = (transformation? *transformation * mesh.vertices[faceVertexIndex] : mesh.vertices[faceVertexIndex]);
-                            auto const& rgba = (material.color != std::nullopt ? material.color->rgba : defaultColor);
-                            auto const& uv = (patch_drawable::has_texture(meshRenderer, material) ?
-                                (mesh.uv[faceVertexIndex].scale(uvFixupCoefficient) + uvFixupOffset).scale(1.0f / textureStorageExtents) : vec2f{});
-                            auto const& xyzw = function;
-                            if (nextIndex == vertices.size())
-                                vertices.emplace_back(xyz, rgba, uv, xyzw);
-                            else
-                            {
-                                auto& vertex = vertices[nextIndex];
-                                vertex.xyz = xyz;
-                                vertex.rgba = rgba;
-                                vertex.st = uv;
-                                vertex.xyzw = xyzw;
-                            }
-                            if (uvGui)
-                                vertices[nextIndex].st.y = *uvGui - vertices[nextIndex].st.y;
-                            ++nextIndex;
-                        }
+                        vertexStartIndex = appendIndex;
+                        appendIndex += faceVertexCount;
                     }
+                    vertexJobs.push_back(vertex_job{ &mesh, &faces, &transformation,
+                        material.color != std::nullopt ? material.color->rgba : defaultColor, function,
+                        textured, textureStorageExtents, uvFixupCoefficient, uvFixupOffset, uvGui, vertexStartIndex });
+                    vertexJobsVertexCount += faceVertexCount;
                     cacheIndices[0] = static_cast<std::uint32_t>(vertexStartIndex);
-                    cacheIndices[1] = static_cast<std::uint32_t>(nextIndex);
+                    cacheIndices[1] = static_cast<std::uint32_t>(vertexStartIndex + faceVertexCount);
                 }
                 patchDrawable.items.emplace_back(meshDrawable, cacheIndices[0], cacheIndices[1], material, faces);
             };
@@ -2307,6 +2918,61 @@ namespace neogfx
             meshRenderCache.state = game::cache_state::Clean;
         }
 
+        if (appendIndex > vertices.size())
+            vertices.resize(appendIndex);
+
+        // Map the buffer here as workers must not make GL calls. No vertex job targets a range the GPU may still
+        // be reading so there is nothing to wait for.
+        auto const vertexData = vertexJobs.empty() ? nullptr : vertices.begin();
+        auto generate_vertices = [vertexData](vertex_job const* aFirstJob, vertex_job const* aLastJob)
+        {
+            for (auto job = aFirstJob; job != aLastJob; ++job)
+            {
+                auto& mesh = *job->mesh;
+                auto const& transformation = *job->transformation;
+                auto nextIndex = job->vertexStartIndex;
+                for (auto const& face : *job->faces)
+                {
+                    for (auto faceVertexIndex : face)
+                    {
+                        auto const& xyz = (transformation ? *transformation * mesh.vertices[faceVertexIndex] : mesh.vertices[faceVertexIndex]);
+                        auto uv = (job->textured ?
+                            (mesh.uv[faceVertexIndex].scale(job->uvFixupCoefficient) + job->uvFixupOffset).scale(1.0f / job->textureStorageExtents) : vec2f{});
+                        if (job->uvGui)
+                            uv.y = *job->uvGui - uv.y;
+                        vertexData[nextIndex++] = { xyz, job->rgba, uv, job->function };
+                    }
+                }
+            }
+        };
+
+        std::size_t const meshWorkers = rendering_engine().parallel_mesh_generation_enabled() ?
+            std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), vertexJobsVertexCount / ParallelMeshVerticesPerWorker) : 0u;
+        if (meshWorkers > 1u)
+        {
+            // Partition the jobs into contiguous runs of roughly equal vertex count.
+            std::vector<vertex_job const*> partitions{ vertexJobs.data() };
+            std::size_t runningVertexCount = 0;
+            for (auto const& job : vertexJobs)
+            {
+                runningVertexCount += job.faces->size() * 3;
+                if (runningVertexCount >= vertexJobsVertexCount * partitions.size() / meshWorkers && partitions.size() < meshWorkers)
+                    partitions.push_back(&job + 1);
+            }
+            partitions.push_back(vertexJobs.data() + vertexJobs.size());
+            // partitions are handed to the shared thread pool rather than a thread per partition per call
+            std::vector<std::future<void>> workers;
+            for (std::size_t p = 1u; p < partitions.size() - 1u; ++p)
+                workers.push_back(neolib::thread_pool::default_thread_pool().run(
+                    [&generate_vertices, first = partitions[p], last = partitions[p + 1u]]() { generate_vertices(first, last); }).first);
+            generate_vertices(partitions[0], partitions[1]);
+            for (auto& w : workers)
+                w.get();
+        }
+        else
+            generate_vertices(vertexJobs.data(), vertexJobs.data() + vertexJobs.size());
+        rendering_engine().frame_statistics().verticesUploaded += vertexJobsVertexCount;
+
         draw_patch(patchDrawable, aTransformation);
     }
 
@@ -2386,6 +3052,9 @@ namespace neogfx
             {
                 auto const& texture = *service<i_texture_manager>().find_texture(item->texture().id.cookie());
 
+                if (iCapture != nullptr)
+                    iCapture->keep(service<i_texture_manager>().find_texture(item->texture().id.cookie()));
+
                 glCheck(glActiveTexture(sampling != texture_sampling::Multisample ? GL_TEXTURE1 : GL_TEXTURE2));
 
                 previousTexture.emplace(0);
@@ -21,6 +21,7 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <array>
 #include <neogfx/gfx/i_graphics_context.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
 #include <neogfx/game/i_ecs.hpp>
@@ -41,6 +42,8 @@ namespace neogfx
 
     class opengl_rendering_context : public i_rendering_context
     {
+    public:
+        static constexpr std::size_t ParallelMeshVerticesPerWorker = 4096u;
     public:
         class standard_batching : public i_vertex_provider
         {
@@ -167,6 +170,68 @@ namespace neogfx
             ping_pong_buffers iBuffers;
             std::optional<scoped_render_target> iRenderTarget;
         };
+        // A recording compiled for direct replay: the operations are executed once at compile time with draw calls
+        // captured rather than issued, keeping the tessellated vertices and the shader uniforms and textures each
+        // draw call was made with. Operations that only change context state are kept so replay can re-apply them
+        // and operations whose output cannot be captured are kept to be executed as normal.
+        class compiled_recording : public graphics_operation::i_compiled_recording, public i_vertex_provider, public i_opengl_draw_capture
+        {
+            friend class opengl_rendering_context;
+        public:
+            static constexpr std::size_t TextureUnitCount = 8u;
+        private:
+            struct shader_state
+            {
+                i_shader* shader;
+                bool enabled;
+                std::vector<std::pair<shader_uniform_id, shader_value_type>> uniforms;
+            };
+            struct draw_call
+            {
+                GLenum mode;
+                std::size_t start;
+                std::size_t count;
+                optional_mat44 transformation;
+                bool withTextures;
+                std::optional<std::size_t> instanceVertexCount;
+                bool useBarrier;
+                std::size_t skipCount;
+                i_shader_program* program;
+                std::vector<shader_state> shaders;
+                std::array<GLint, TextureUnitCount> textures;
+                std::array<GLint, 2> textureFilter;
+                neogfx::smoothing_mode smoothingMode;
+                bool multisample;
+                bool snapToPixel;
+                bool snapToPixelUsesOffset;
+                bool sampleShading;
+            };
+            struct step
+            {
+                std::size_t batch;
+                std::optional<std::pair<std::size_t, std::size_t>> draws;
+            };
+        public:
+            compiled_recording();
+            ~compiled_recording();
+        public:
+            bool cacheable() const override;
+            const game::component<game::mesh_render_cache>& cache() const override;
+            game::component<game::mesh_render_cache>& cache() override;
+        public:
+            void capture(GLenum aMode, standard_vertex const* aVertices, std::size_t aCount, optional_mat44 const& aTransformation, bool aWithTextures,
+                std::optional<std::size_t> const& aInstanceVertexCount, bool aUseBarrier, std::size_t aSkipCount) override;
+        private:
+            opengl_vertex_buffer<>& vertex_buffer();
+            void fail();
+            void keep(ref_ptr<i_texture> const& aTexture);
+        private:
+            opengl_rendering_context* iContext;
+            std::vector<step> iSteps;
+            std::vector<draw_call> iDraws;
+            std::vector<ref_ptr<i_texture>> iTextures;
+            bool iFailed;
+        };
         struct draw_glyph
         {
             vec3f point;
@@ -267,6 +332,14 @@ namespace neogfx
         graphics_operation::queue& queue() const override;
         void enqueue(const graphics_operation::operation& aOperation) override;
         void flush() override;
+        void begin_recording(graphics_operation::recording& aRecording) override;
+        void end_recording() override;
+        void replay(const graphics_operation::recording& aRecording, const vec2& aOffset, double aOpacity) override;
+    private:
+        void execute(const graphics_operation::batch& aBatch);
+        void dispatch(const graphics_operation::batch& aBatch);
+        std::unique_ptr<compiled_recording> compile(const graphics_operation::recording& aRecording);
+        void replay(compiled_recording& aCompiled, compiled_recording::draw_call const& aDrawCall);
     public:
         neogfx::logical_coordinate_system logical_coordinate_system() const override;
         void set_logical_coordinate_system(neogfx::logical_coordinate_system aSystem);
@@ -342,12 +415,15 @@ namespace neogfx
         const i_render_target& iTarget;
         const i_widget* iWidget;
         bool iInFlush;
+        graphics_operation::recording* iRecording;
+        compiled_recording* iCapture;
         mutable std::optional<neogfx::logical_coordinate_system> iLogicalCoordinateSystem;
         mutable std::optional<neogfx::logical_coordinates> iLogicalCoordinates;
         point iOrigin;
         bool iMultisample;
         std::optional<double> iSampleShadingRate;
         double iOpacity;
+        double iReplayOpacity;
         std::optional<neogfx::blending_mode> iBlendingMode;
         std::optional<neogfx::smoothing_mode> iSmoothingMode;
         bool iSubpixelRendering;
@@ -360,6 +436,7 @@ namespace neogfx
         std::optional<std::uint8_t> iLastDrawGlyphFallbackFontIndex;
         sink iSink;
         optional_vec2 iOffset;
+        vec2 iReplayOffset;
         bool iSnapToPixel;
         bool iSnapToPixelUsesOffset;
         std::optional<gradient> iGradient;
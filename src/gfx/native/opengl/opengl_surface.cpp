@@ -29,6 +29,7 @@
 #include <neogfx/hid/i_surface_manager.hpp>
 #include <neogfx/hid/i_surface_window.hpp>
 #include <neogfx/gfx/i_rendering_context.hpp>
+#include <neogfx/gfx/i_image.hpp>
 #include "opengl_surface.hpp"
 #include "opengl_helpers.hpp"
 #include "opengl_texture.hpp"
@@ -160,13 +161,70 @@ namespace neogfx
         GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0 };
         glCheck(glDrawBuffers(sizeof(drawBuffers) / sizeof(drawBuffers[0]), drawBuffers));
 
-        glCheck(surface_window().native_window_render(invalidated_area()));
+        for (auto const& region : rendering_regions())
+        {
+            set_rendering_region(region);
+            glCheck(surface_window().native_window_render(region));
+        }
+        set_rendering_region({});
 
         rendering_engine().execute_vertex_buffers();
 
         glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
         glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, iFrameBuffer));
-        glCheck(glBlitFramebuffer(0, 0, static_cast<GLint>(extents().cx), static_cast<GLint>(extents().cy), 0, 0, static_cast<GLint>(extents().cx), static_cast<GLint>(extents().cy), GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        if (iPreservesBackBuffer == std::nullopt)
+            iPreservesBackBuffer = rendering_engine().preserves_back_buffer(*this);
+        if (*iPreservesBackBuffer && iPresentedExtents == extents())
+        {
+            // back buffer still holds the previous frame so only present the damaged regions
+            for (auto const& region : rendering_regions())
+            {
+                auto const r = region.intersection(rect{ extents() }).as<GLint>();
+                auto const y = static_cast<GLint>(extents().cy) - r.bottom();
+                glCheck(glBlitFramebuffer(r.left(), y, r.right(), y + r.cy, r.left(), y, r.right(), y + r.cy, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+            }
+        }
+        else
+            glCheck(glBlitFramebuffer(0, 0, static_cast<GLint>(extents().cx), static_cast<GLint>(extents().cy), 0, 0, static_cast<GLint>(extents().cx), static_cast<GLint>(extents().cy), GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        iPresentedExtents = extents();
+    }
+
+    void opengl_surface::snapshot(i_image& aImage) const
+    {
+        if (iPresentedExtents == size{})
+            throw nothing_rendered();
+
+        scoped_render_target srt{ *this };
+
+        auto const width = static_cast<GLint>(iPresentedExtents.cx);
+        auto const height = static_cast<GLint>(iPresentedExtents.cy);
+
+        // the frame buffer is multisampled so resolve it into a single sampled one before reading it back
+        GLuint resolveFrameBuffer;
+        GLuint resolveColorBuffer;
+        glCheck(glGenFramebuffers(1, &resolveFrameBuffer));
+        glCheck(glGenRenderbuffers(1, &resolveColorBuffer));
+        glCheck(glBindRenderbuffer(GL_RENDERBUFFER, resolveColorBuffer));
+        glCheck(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+        glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFrameBuffer));
+        glCheck(glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveColorBuffer));
+        glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, iFrameBuffer));
+        glCheck(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+
+        aImage.resize(iPresentedExtents);
+        auto const pixels = static_cast<std::uint8_t*>(aImage.pixels());
+        auto const stride = static_cast<std::size_t>(width) * 4u;
+        glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFrameBuffer));
+        glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        glCheck(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+        // OpenGL returns the bottom row first
+        for (GLint y = 0; y < height / 2; ++y)
+            std::swap_ranges(pixels + y * stride, pixels + (y + 1) * stride, pixels + (height - 1 - y) * stride);
+
+        glCheck(glBindFramebuffer(GL_FRAMEBUFFER, iFrameBuffer));
+        glCheck(glDeleteRenderbuffers(1, &resolveColorBuffer));
+        glCheck(glDeleteFramebuffers(1, &resolveFrameBuffer));
+        glCheck(glBindRenderbuffer(GL_RENDERBUFFER, iDepthStencilBuffer));
     }
 
     std::unique_ptr<i_rendering_context> opengl_surface::create_graphics_context(blending_mode aBlendingMode) const
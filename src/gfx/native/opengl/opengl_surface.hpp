@@ -54,6 +54,7 @@ namespace neogfx
     public:
         color read_pixel(const point& aPosition) const override;
         void do_render() override;
+        void snapshot(i_image& aImage) const override;
     public:
         std::unique_ptr<i_rendering_context> create_graphics_context(blending_mode aBlendingMode) const override;
         std::unique_ptr<i_rendering_context> create_graphics_context(const i_widget& aWidget, blending_mode aBlendingMode) const override;
@@ -66,6 +67,8 @@ namespace neogfx
         mutable optional_texture iFrameBufferTexture;
         GLuint iDepthStencilBuffer;
         size iFrameBufferExtents;
+        std::optional<bool> iPreservesBackBuffer;
+        size iPresentedExtents;
         mutable std::unique_ptr<graphics_operation::i_queue> iQueue;
     };
 }
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include "opengl_error.hpp"
 #include "opengl_helpers.hpp"
 #include "opengl_rendering_context.hpp"
+#include "opengl_renderer.hpp"
 #include "opengl_texture.hpp"
 
 namespace neogfx
@@ -61,6 +62,24 @@ namespace neogfx
             }
         }
 
+        inline std::size_t bytes_per_pixel(texture_data_format aDataFormat, texture_data_type aDataType)
+        {
+            std::size_t const channels = (aDataFormat == texture_data_format::Red ? 1u : 4u);
+            return channels * (aDataType == texture_data_type::Float ? sizeof(float) : sizeof(std::uint8_t));
+        }
+
+        inline void record_texture_upload(texture_data_format aDataFormat, texture_data_type aDataType, std::size_t aWidth, std::size_t aHeight)
+        {
+            auto& statistics = service<i_rendering_engine>().frame_statistics();
+            ++statistics.textureUploads;
+            statistics.textureUploadBytes += aWidth * aHeight * bytes_per_pixel(aDataFormat, aDataType);
+        }
+
+        inline opengl_texture_upload_queue& texture_upload_queue()
+        {
+            return static_cast<opengl_renderer&>(service<i_rendering_engine>()).texture_upload_queue();
+        }
+
         inline GLenum to_gl_enum(texture_sampling aSampling)
         {
             switch (aSampling)
@@ -163,6 +182,8 @@ namespace neogfx
                                     };
                 }
                 glCheck(glTexImage2D(to_gl_enum(sampling()), 0, internalformat, static_cast<GLsizei>(iStorageSize.cx), static_cast<GLsizei>(iStorageSize.cy), 0, format, type, data.empty() ? nullptr : &data[0]));
+                if (!data.empty())
+                    record_texture_upload(iDataFormat, kDataType, iStorageSize.cx, iStorageSize.cy);
                 if (sampling() == texture_sampling::NormalMipmap)
                 {
                     glCheck(glGenerateMipmap(GL_TEXTURE_2D));
@@ -256,11 +277,12 @@ namespace neogfx
                                 for (std::size_t c = 0; c < 4; ++c)
                                     data[(iSize.cy + 1 - y) * iStorageSize.cx + x][c] = imageData[(y + imagePartOrigin.y - 1) * imageExtents.cx * 4 + (imagePartOrigin.x + x - 1) * 4 + c] / 255.0f;
                     }
-                    glCheck(glTexImage2D(GL_TEXTURE_2D, 0, internalformat, static_cast<GLsizei>(iStorageSize.cx), static_cast<GLsizei>(iStorageSize.cy), 0, format, type, &data[0]));
-                    if (sampling() == texture_sampling::NormalMipmap)
-                    {
-                        glCheck(glGenerateMipmap(GL_TEXTURE_2D));
-                    }
+                    // Image data is uploaded via the upload queue so that loading large images does not stall the frame.
+                    glCheck(glTexImage2D(GL_TEXTURE_2D, 0, internalformat, static_cast<GLsizei>(iStorageSize.cx), static_cast<GLsizei>(iStorageSize.cy), 0, format, type, nullptr));
+                    // Transparent until the upload lands.
+                    glCheck(glClearTexImage(iHandle, 0, format, type, nullptr));
+                    texture_upload_queue().stage(iHandle, point_i32{}, iStorageSize, format, type, sizeof(value_type), &data[0], 0u, 1u, 
+                        sampling() == texture_sampling::NormalMipmap, {});
                 }
                 break;
             default:
@@ -284,6 +306,7 @@ namespace neogfx
             glCheck(glDeleteRenderbuffers(1, &iDepthStencilBuffer));
             glCheck(glDeleteFramebuffers(1, &iFrameBuffer));
         }
+        texture_upload_queue().cancel(iHandle);
         glCheck(glDeleteTextures(1, &iHandle));
     }
 
@@ -417,6 +440,7 @@ namespace neogfx
         auto const adjustedRect = aRect + (sampling() != texture_sampling::Data ? point{ 1.0, 1.0 } : point{ 0.0, 0.0 });
         if (sampling() != texture_sampling::Multisample)
         {
+            complete_uploads();
             bind(1);
             GLint previousPackAlignment;
             GLint previousPackRowLength;
@@ -429,6 +453,7 @@ namespace neogfx
                 static_cast<GLint>(adjustedRect.x), static_cast<GLint>(adjustedRect.y),
                 static_cast<GLsizei>(adjustedRect.cx), static_cast<GLsizei>(adjustedRect.cy),
                 format, type, aPixelData));
+            record_texture_upload(aDataFormat, kDataType, static_cast<std::size_t>(adjustedRect.cx), static_cast<std::size_t>(adjustedRect.cy));
             if (sampling() == texture_sampling::NormalMipmap)
             {
                 glCheck(glGenerateMipmap(to_gl_enum(sampling())));
@@ -472,6 +497,21 @@ namespace neogfx
         }
     }
 
+    template <typename T>
+    void opengl_texture<T>::set_pixels_async(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded, std::uint32_t aStride, std::uint32_t aPackAlignment)
+    {
+        auto const adjustedRect = aRect + (sampling() != texture_sampling::Data ? point{ 1.0, 1.0 } : point{ 0.0, 0.0 });
+        if (sampling() != texture_sampling::Multisample)
+        {
+            auto const [internalformat, format, type] = to_gl_enums(aDataFormat, kDataType);
+            texture_upload_queue().stage(iHandle, adjustedRect.position().as<std::int32_t>(), adjustedRect.extents().as<std::uint32_t>(), format, type, bytes_per_pixel(aDataFormat, kDataType), 
+                aPixelData, aStride, aPackAlignment, sampling() == texture_sampling::NormalMipmap, aUploaded);
+            iPixelData.clear();
+        }
+        else
+            throw unsupported_sampling_type_for_function();
+    }
+
     template <typename T>
     void opengl_texture<T>::set_pixel(const point& aPosition, const color& aColor)
     {
@@ -564,6 +604,7 @@ namespace neogfx
         GLint previousTexture = 0;
         glCheck(glGetIntegerv(to_gl_binding_enum(sampling()), &previousTexture));
         glCheck(glBindTexture(to_gl_enum(sampling()), static_cast<GLuint>(reinterpret_cast<std::intptr_t>(handle()))));
+        texture_upload_queue().sampled(iHandle);
         iBoundTextureUnit = aTextureUnit;
         iPreviouslyBoundTexture = previousTexture;
     }
@@ -699,6 +740,7 @@ namespace neogfx
             TargetActivating();
             service<i_rendering_engine>().activate_context(*this);
         }
+        complete_uploads();
         bind(10);
         if (iFrameBuffer == 0)
         {
@@ -803,6 +845,7 @@ namespace neogfx
                 if (iPixelData.empty())
                 {
                     iPixelData.resize(static_cast<std::size_t>(storage_extents().cx) * static_cast<std::size_t>(storage_extents().cy));
+                    complete_uploads();
                     bind(1);
                     glCheck(glGetTexImage(to_gl_enum(sampling()), 0, format, type, iPixelData.data()));
                 }
@@ -817,6 +860,14 @@ namespace neogfx
             throw std::logic_error("neogfx::opengl_texture::read_pixel: not yet implemented for multisample render targets");
     }
 
+    // Merely sampling a texture leaves its staged uploads to the frame budget (ahead of the rest of the queue);
+    // callers here are about to write or read the texture's contents so the staged data must land first.
+    template <typename T>
+    void opengl_texture<T>::complete_uploads() const
+    {
+        texture_upload_queue().flush(iHandle);
+    }
+
     template class opengl_texture<std::uint8_t>;
     template class opengl_texture<float>;
     template class opengl_texture<avec4u8>;
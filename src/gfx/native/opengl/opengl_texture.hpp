@@ -71,6 +71,7 @@ namespace neogfx
         void set_pixels(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::uint32_t aStride = 0u, std::uint32_t aPackAlignment = 4u) final;
         void set_pixels(const i_image& aImage) final;
         void set_pixels(const i_image& aImage, const rect& aImagePart) final;
+        void set_pixels_async(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded = {}, std::uint32_t aStride = 0u, std::uint32_t aPackAlignment = 4u) final;
         void set_pixel(const point& aPosition, const color& aColor) final;
         color get_pixel(const point& aPosition) const final;
     public:
@@ -114,6 +115,8 @@ namespace neogfx
     public:
         neogfx::color_space color_space() const final;
         color read_pixel(const point& aPosition) const final;
+    private:
+        void complete_uploads() const;
     private:
         i_texture_manager& iManager;
         texture_id iId;
@@ -0,0 +1,269 @@
+// opengl_texture_upload_queue.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <neogfx/gfx/i_rendering_engine.hpp>
+#include <neogfx/hid/i_surface_manager.hpp>
+#include "opengl_error.hpp"
+#include "opengl_texture_upload_queue.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        // Staged rows are tightly packed so the client unpack state is overridden while uploads are issued.
+        class scoped_unpack_state
+        {
+        public:
+            scoped_unpack_state(GLuint aPixelBuffer)
+            {
+                glCheck(glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &iPreviousPixelBuffer));
+                glCheck(glGetIntegerv(GL_UNPACK_ALIGNMENT, &iPreviousAlignment));
+                glCheck(glGetIntegerv(GL_UNPACK_ROW_LENGTH, &iPreviousRowLength));
+                glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+                glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+                glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, aPixelBuffer));
+            }
+            ~scoped_unpack_state()
+            {
+                glCheck(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, static_cast<GLuint>(iPreviousPixelBuffer)));
+                glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, iPreviousAlignment));
+                glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, iPreviousRowLength));
+            }
+        private:
+            GLint iPreviousPixelBuffer;
+            GLint iPreviousAlignment;
+            GLint iPreviousRowLength;
+        };
+    }
+
+    opengl_texture_upload_queue::opengl_texture_upload_queue() :
+        iIssuing{ nullptr, {}, {}, {}, false }
+    {
+    }
+
+    opengl_texture_upload_queue::~opengl_texture_upload_queue()
+    {
+        for (auto& staged : iPending)
+            free_staging_buffer(staged.buffer);
+        for (auto& staging : iIssuing.buffers)
+            free_staging_buffer(staging);
+        for (auto& inFlight : iInFlight)
+        {
+            glCheck(glDeleteSync(inFlight.fence));
+            for (auto& staging : inFlight.buffers)
+                free_staging_buffer(staging);
+        }
+        for (auto& staging : iFreeStagingBuffers)
+            glCheck(glDeleteBuffers(1, &staging.handle));
+    }
+
+    bool opengl_texture_upload_queue::empty() const
+    {
+        return iPending.empty();
+    }
+
+    std::size_t opengl_texture_upload_queue::pending() const
+    {
+        return iPending.size();
+    }
+
+    void opengl_texture_upload_queue::stage(GLuint aTexture, point_i32 const& aPosition, size_u32 const& aExtents, GLenum aFormat, GLenum aType, std::size_t aBytesPerPixel,
+        void const* aPixelData, std::uint32_t aStride, std::uint32_t aPackAlignment, bool aGenerateMipmap, completion_callback const& aUploaded)
+    {
+        if (aExtents.cx == 0u || aExtents.cy == 0u)
+        {
+            if (aUploaded)
+                aUploaded();
+            return;
+        }
+        std::size_t const rowBytes = aExtents.cx * aBytesPerPixel;
+        std::size_t const sourceRowBytes = (aStride != 0u ? aStride : aExtents.cx) * aBytesPerPixel;
+        std::size_t const alignment = std::max<std::size_t>(aPackAlignment, 1u);
+        std::size_t const sourcePitch = (sourceRowBytes + alignment - 1u) / alignment * alignment;
+        std::size_t const bytes = rowBytes * aExtents.cy;
+        auto const staging = allocate_staging_buffer(bytes);
+        void* mapped = nullptr;
+        glCheck(mapped = glMapNamedBufferRange(staging.handle, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        auto const source = static_cast<std::uint8_t const*>(aPixelData);
+        auto const destination = static_cast<std::uint8_t*>(mapped);
+        if (sourcePitch == rowBytes)
+            std::memcpy(destination, source, bytes);
+        else
+            for (std::size_t y = 0u; y < aExtents.cy; ++y)
+                std::memcpy(destination + y * rowBytes, source + y * sourcePitch, rowBytes);
+        glCheck(glUnmapNamedBuffer(staging.handle));
+        iPending.push_back(staged_upload{ aTexture, aPosition, aExtents, aFormat, aType, aGenerateMipmap, staging, bytes, aUploaded, false });
+    }
+
+    void opengl_texture_upload_queue::upload(std::uint64_t aBudget)
+    {
+        std::uint64_t issuedBytes = 0ull;
+        // Always make progress, even if the next upload alone exceeds the budget.
+        while (!iPending.empty() && (issuedBytes == 0ull || issuedBytes + iPending.front().bytes <= aBudget))
+        {
+            issuedBytes += iPending.front().bytes;
+            issue(iPending.front());
+            iPending.pop_front();
+        }
+        end_batch();
+        retire();
+        service<i_rendering_engine>().frame_statistics().textureUploadsPending = static_cast<std::uint32_t>(iPending.size());
+    }
+
+    void opengl_texture_upload_queue::flush(GLuint aTexture)
+    {
+        if (iPending.empty())
+            return;
+        for (auto staged = iPending.begin(); staged != iPending.end();)
+        {
+            if (staged->texture == aTexture)
+            {
+                issue(*staged);
+                staged = iPending.erase(staged);
+            }
+            else
+                ++staged;
+        }
+        end_batch();
+    }
+
+    void opengl_texture_upload_queue::cancel(GLuint aTexture)
+    {
+        for (auto staged = iPending.begin(); staged != iPending.end();)
+        {
+            if (staged->texture == aTexture)
+            {
+                free_staging_buffer(staged->buffer);
+                staged = iPending.erase(staged);
+            }
+            else
+                ++staged;
+        }
+        for (auto& inFlight : iInFlight)
+            inFlight.callbacks.erase(std::remove_if(inFlight.callbacks.begin(), inFlight.callbacks.end(), 
+                [aTexture](auto const& aCallback) { return aCallback.first == aTexture; }), inFlight.callbacks.end());
+    }
+
+    void opengl_texture_upload_queue::sampled(GLuint aTexture)
+    {
+        // Uploads of a texture that has been drawn with are issued ahead of the rest of the queue and
+        // their retirement repaints the surfaces that drew the texture before its contents had landed.
+        if (iPending.empty() && iIssuing.textures.empty() && iInFlight.empty())
+            return;
+        bool found = false;
+        for (auto& staged : iPending)
+            if (staged.texture == aTexture)
+                found = staged.sampled = true;
+        if (found)
+            std::stable_partition(iPending.begin(), iPending.end(), [](staged_upload const& aUpload) { return aUpload.sampled; });
+        if (std::find(iIssuing.textures.begin(), iIssuing.textures.end(), aTexture) != iIssuing.textures.end())
+            iIssuing.sampled = true;
+        for (auto& inFlight : iInFlight)
+            if (std::find(inFlight.textures.begin(), inFlight.textures.end(), aTexture) != inFlight.textures.end())
+                inFlight.sampled = true;
+    }
+
+    void opengl_texture_upload_queue::issue(staged_upload& aUpload)
+    {
+        {
+            scoped_unpack_state unpackState{ aUpload.buffer.handle };
+            glCheck(glTextureSubImage2D(aUpload.texture, 0,
+                aUpload.position.x, aUpload.position.y,
+                static_cast<GLsizei>(aUpload.extents.cx), static_cast<GLsizei>(aUpload.extents.cy),
+                aUpload.format, aUpload.type, nullptr));
+        }
+        if (aUpload.generateMipmap)
+        {
+            glCheck(glGenerateTextureMipmap(aUpload.texture));
+        }
+        auto& statistics = service<i_rendering_engine>().frame_statistics();
+        ++statistics.textureUploads;
+        statistics.textureUploadBytes += aUpload.bytes;
+        iIssuing.buffers.push_back(aUpload.buffer);
+        iIssuing.textures.push_back(aUpload.texture);
+        iIssuing.sampled = iIssuing.sampled || aUpload.sampled;
+        if (aUpload.uploaded)
+            iIssuing.callbacks.emplace_back(aUpload.texture, std::move(aUpload.uploaded));
+    }
+
+    void opengl_texture_upload_queue::end_batch()
+    {
+        if (iIssuing.buffers.empty())
+            return;
+        glCheck(iIssuing.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        iInFlight.push_back(std::move(iIssuing));
+        iIssuing = batch{ nullptr, {}, {}, {}, false };
+    }
+
+    void opengl_texture_upload_queue::retire()
+    {
+        bool repaint = false;
+        while (!iInFlight.empty())
+        {
+            auto& oldest = iInFlight.front();
+            GLenum status;
+            glCheck(status = glClientWaitSync(oldest.fence, 0, 0));
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+            glCheck(glDeleteSync(oldest.fence));
+            for (auto& staging : oldest.buffers)
+                free_staging_buffer(staging);
+            auto callbacks = std::move(oldest.callbacks);
+            repaint = repaint || oldest.sampled;
+            iInFlight.pop_front();
+            for (auto& callback : callbacks)
+                callback.second();
+        }
+        if (repaint)
+            service<i_surface_manager>().invalidate_surfaces();
+    }
+
+    opengl_texture_upload_queue::staging_buffer opengl_texture_upload_queue::allocate_staging_buffer(std::size_t aSize)
+    {
+        auto best = iFreeStagingBuffers.end();
+        for (auto existing = iFreeStagingBuffers.begin(); existing != iFreeStagingBuffers.end(); ++existing)
+            if (existing->capacity >= aSize && (best == iFreeStagingBuffers.end() || existing->capacity < best->capacity))
+                best = existing;
+        if (best != iFreeStagingBuffers.end())
+        {
+            auto const result = *best;
+            iFreeStagingBuffers.erase(best);
+            return result;
+        }
+        staging_buffer result{ 0u, aSize };
+        glCheck(glCreateBuffers(1, &result.handle));
+        glCheck(glNamedBufferStorage(result.handle, static_cast<GLsizeiptr>(aSize), nullptr, GL_MAP_WRITE_BIT));
+        return result;
+    }
+
+    void opengl_texture_upload_queue::free_staging_buffer(staging_buffer const& aBuffer)
+    {
+        if (iFreeStagingBuffers.size() < MaxFreeStagingBuffers)
+            iFreeStagingBuffers.push_back(aBuffer);
+        else
+        {
+            glCheck(glDeleteBuffers(1, &aBuffer.handle));
+        }
+    }
+}
@@ -0,0 +1,96 @@
+// opengl_texture_upload_queue.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <neogfx/core/geometrical.hpp>
+#include "opengl.hpp"
+
+namespace neogfx
+{
+    // Texture uploads are copied into pixel buffer objects when queued and the copies into the textures are
+    // issued later, a frame's upload budget at a time, so the GPU does the transfer asynchronously. Drawing
+    // with a texture does not flush its uploads (it shows the texture's transparent initial contents until
+    // they land) but moves them to the front of the queue, and the surfaces are repainted once uploads of a
+    // texture that was drawn with have retired. Anything that would otherwise race with the uploads
+    // (rendering to the texture, reading it back or a synchronous set_pixels) flushes them first.
+    class opengl_texture_upload_queue
+    {
+    public:
+        typedef std::function<void()> completion_callback;
+    private:
+        struct staging_buffer
+        {
+            GLuint handle;
+            std::size_t capacity;
+        };
+        struct staged_upload
+        {
+            GLuint texture;
+            point_i32 position;
+            size_u32 extents;
+            GLenum format;
+            GLenum type;
+            bool generateMipmap;
+            staging_buffer buffer;
+            std::size_t bytes;
+            completion_callback uploaded;
+            bool sampled;
+        };
+        struct batch
+        {
+            GLsync fence;
+            std::vector<staging_buffer> buffers;
+            std::vector<std::pair<GLuint, completion_callback>> callbacks;
+            std::vector<GLuint> textures;
+            bool sampled;
+        };
+    public:
+        static constexpr std::size_t MaxFreeStagingBuffers = 4u;
+    public:
+        opengl_texture_upload_queue();
+        ~opengl_texture_upload_queue();
+    public:
+        bool empty() const;
+        std::size_t pending() const;
+        void stage(GLuint aTexture, point_i32 const& aPosition, size_u32 const& aExtents, GLenum aFormat, GLenum aType, std::size_t aBytesPerPixel, 
+            void const* aPixelData, std::uint32_t aStride, std::uint32_t aPackAlignment, bool aGenerateMipmap, completion_callback const& aUploaded);
+        void upload(std::uint64_t aBudget);
+        void flush(GLuint aTexture);
+        void cancel(GLuint aTexture);
+        void sampled(GLuint aTexture);
+    private:
+        void issue(staged_upload& aUpload);
+        void end_batch();
+        void retire();
+        staging_buffer allocate_staging_buffer(std::size_t aSize);
+        void free_staging_buffer(staging_buffer const& aBuffer);
+    private:
+        std::deque<staged_upload> iPending;
+        batch iIssuing;
+        std::deque<batch> iInFlight;
+        std::vector<staging_buffer> iFreeStagingBuffers;
+    };
+}
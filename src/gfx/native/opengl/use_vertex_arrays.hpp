@@ -28,6 +28,7 @@ namespace neogfx
     namespace
     {
         struct with_textures_t {} with_textures;
+        struct instanced_t {} instanced;
 
         class use_vertex_arrays
         {
@@ -58,6 +59,25 @@ namespace neogfx
                 if (!room_for(aNeed) && !need(aNeed))
                     throw not_enough_room();
             }
+            // Each vertex pushed is one instance of a primitive made of aInstanceVertexCount vertices; the
+            // vertex shader generates the primitive's vertices from the instance's attributes.
+            use_vertex_arrays(i_vertex_provider& aProvider, i_rendering_context& aParent, GLenum aMode, instanced_t, std::size_t aInstanceVertexCount, std::size_t aNeed = 0u) :
+                iProvider{ aProvider },
+                iParent{ aParent },
+                iUse{ static_cast<opengl_vertex_buffer<>&>(aParent.rendering_engine().vertex_buffer(aProvider)) },
+                iMode{ aMode },
+                iWithTextures{ false },
+                iInstanceVertexCount{ aInstanceVertexCount },
+                iStart{ static_cast<GLint>(vertices().size()) },
+                iUseBarrier{ false },
+                iDrawOnExit{ true }
+            {
+                if (!room_for(aNeed))
+                    draw_and_execute();
+                set_transformation(optional_mat44{});
+                if (!room_for(aNeed) && !need(aNeed))
+                    throw not_enough_room();
+            }
             use_vertex_arrays(i_vertex_provider& aProvider, i_rendering_context& aParent, GLenum aMode, const optional_mat44& aTransformation, std::size_t aNeed = 0u, bool aUseBarrier = false) :
                 iProvider{ aProvider },
                 iParent{ aParent },
@@ -116,6 +136,7 @@ namespace neogfx
             {
                 if (iDrawOnExit)
                     draw();
+                count_written();
             }
         public:
             i_rendering_context& parent()
@@ -146,6 +167,10 @@ namespace neogfx
             {
                 return iWithTextures;
             }
+            bool instanced() const
+            {
+                return iInstanceVertexCount != std::nullopt;
+            }
         public:
             const_iterator begin() const
             {
@@ -185,6 +210,7 @@ namespace neogfx
                 if (!room_for(1))
                     draw_and_execute();
                 vertices().push_back(aVertex);
+                ++iWritten;
             }
             template <typename... Args>
             void emplace_back(Args&&... args)
@@ -192,10 +218,12 @@ namespace neogfx
                 if (!room_for(1))
                     draw_and_execute();
                 vertices().emplace_back(std::forward<Args>(args)...);
+                ++iWritten;
             }
             template <typename Iter>
             iterator insert(const_iterator aPos, Iter aFirst, Iter aLast)
             {
+                iWritten += static_cast<std::size_t>(std::distance(aFirst, aLast));
                 if (room_for(std::distance(aFirst, aLast)))
                     return vertices().insert(aPos, aFirst, aLast);
                 else
@@ -230,7 +258,8 @@ namespace neogfx
             void draw_and_execute()
             {
                 draw();
-                execute();
+                iUse.cycle();
+                iUse.acquire();
                 vertices().clear();
 				iStart = 0;
             }
@@ -261,10 +290,24 @@ namespace neogfx
                     throw invalid_draw_count();
                 if (static_cast<std::size_t>(iStart) == vertices().size())
                     return;
+                if (auto const capture = iUse.capture())
+                {
+                    capture->capture(mode(), &*begin(), aCount, transformation(), iWithTextures, iInstanceVertexCount, iUseBarrier, skipCount);
+                    iStart += static_cast<GLint>(aCount);
+                    return;
+                }
+                if (instanced())
+                {
+                    draw_instances(aCount);
+                    return;
+                }
                 iParent.rendering_engine().vertex_buffer(iProvider).attach_shader(iParent, iParent.rendering_engine().active_shader_program());
+                count_written();
+                auto& statistics = iParent.rendering_engine().frame_statistics();
                 if (!iUseBarrier && mode() == translated_mode())
                 {
                     glCheck(glDrawArrays(translated_mode(), iStart, static_cast<GLsizei>(aCount)));
+                    ++statistics.drawCalls;
                     iStart += static_cast<GLint>(aCount);
                 }
                 else
@@ -279,6 +322,7 @@ namespace neogfx
                     {
                         auto amount = std::min(chunk, aCount);
                         glCheck(glDrawArrays(translated_mode(), iStart, static_cast<GLsizei>(amount)));
+                        ++statistics.drawCalls;
                         iStart += static_cast<GLint>(amount);
                         aCount -= amount;
                         if (iUseBarrier)
@@ -289,6 +333,30 @@ namespace neogfx
                 }
             }
         private:
+            void draw_instances(std::size_t aCount)
+            {
+                auto& shaderProgram = iParent.rendering_engine().active_shader_program();
+                if (shaderProgram.type() == shader_program_type::Standard)
+                    static_cast<i_standard_vertex_shader&>(shaderProgram.vertex_shader()).set_instanced(true);
+                iParent.rendering_engine().vertex_buffer(iProvider).attach_shader(iParent, shaderProgram);
+                iUse.set_instance_divisor(1u);
+                glCheck(glDrawArraysInstancedBaseInstance(translated_mode(), 0, static_cast<GLsizei>(*iInstanceVertexCount), static_cast<GLsizei>(aCount), static_cast<GLuint>(iStart)));
+                iUse.set_instance_divisor(0u);
+                if (shaderProgram.type() == shader_program_type::Standard)
+                    static_cast<i_standard_vertex_shader&>(shaderProgram.vertex_shader()).set_instanced(false);
+                count_written();
+                auto& statistics = iParent.rendering_engine().frame_statistics();
+                statistics.instancesDrawn += aCount;
+                ++statistics.drawCalls;
+                iStart += static_cast<GLint>(aCount);
+            }
+            // vertices (and instances, which are pushed as one vertex each) are counted when written rather than 
+            // when drawn as draw_patch() redraws cached vertices without writing them again
+            void count_written()
+            {
+                if (iWritten != 0u)
+                    iParent.rendering_engine().frame_statistics().verticesUploaded += std::exchange(iWritten, 0u);
+            }
             bool is_new_transformation(const optional_mat44& aTransformation) const
             {
                 return iUse.transformation() != aTransformation;
@@ -329,9 +397,11 @@ namespace neogfx
             opengl_vertex_buffer<>::use iUse;
             GLenum iMode;
             bool iWithTextures;
+            std::optional<std::size_t> iInstanceVertexCount;
             GLint iStart;
             bool iUseBarrier;
             bool iDrawOnExit;
+            std::size_t iWritten = 0u;
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,878 @@
+// software_rasterizer.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <thread>
+
+#include <neolib/task/thread_pool.hpp>
+
+#include "../../../core/cpu_features.hpp"
+#include "software_rasterizer.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        // Compositing is source-over of a premultiplied source scaled by 8-bit coverage; every code path
+        // uses the same exact division by 255 so results are identical whichever path is taken.
+        inline std::uint32_t div255(std::uint32_t aValue)
+        {
+            aValue += 128u;
+            return (aValue + (aValue >> 8u)) >> 8u;
+        }
+
+        inline std::uint32_t blend_pixel(std::uint32_t aDestination, std::uint32_t aSource, std::uint32_t aCoverage)
+        {
+            std::uint32_t const sourceAlpha = div255((aSource >> 24u) * aCoverage);
+            std::uint32_t result = 0u;
+            for (std::uint32_t shift = 0u; shift < 32u; shift += 8u)
+            {
+                std::uint32_t const source = div255(((aSource >> shift) & 0xFFu) * aCoverage);
+                std::uint32_t const destination = div255(((aDestination >> shift) & 0xFFu) * (255u - sourceAlpha));
+                result |= std::min(source + destination, 255u) << shift;
+            }
+            return result;
+        }
+
+        template <bool Masked, bool Varying>
+        void composite_scalar(std::uint32_t* aDestination, std::uint8_t const* aCoverage, std::uint32_t const* aColors, std::uint32_t aColor, std::int32_t aCount)
+        {
+            for (std::int32_t i = 0; i < aCount; ++i)
+            {
+                std::uint32_t const coverage = Masked ? aCoverage[i] : 255u;
+                if (coverage != 0u)
+                    aDestination[i] = blend_pixel(aDestination[i], Varying ? aColors[i] : aColor, coverage);
+            }
+        }
+
+#ifdef NEOGFX_X86
+        inline __m128i div255_epi16(__m128i aValue)
+        {
+            __m128i const biased = _mm_add_epi16(aValue, _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_add_epi16(biased, _mm_srli_epi16(biased, 8)), 8);
+        }
+
+        inline __m128i source_over_epi16(__m128i aSource, __m128i aDestination)
+        {
+            __m128i const sourceAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(aSource, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            return _mm_add_epi16(aSource, div255_epi16(_mm_mullo_epi16(aDestination, _mm_sub_epi16(_mm_set1_epi16(255), sourceAlpha))));
+        }
+
+        template <bool Masked, bool Varying>
+        void composite_sse2(std::uint32_t* aDestination, std::uint8_t const* aCoverage, std::uint32_t const* aColors, std::uint32_t aColor, std::int32_t aCount)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const solid = _mm_set1_epi32(static_cast<int>(aColor));
+            std::int32_t i = 0;
+            for (; i + 4 <= aCount; i += 4)
+            {
+                __m128i const source = Varying ? _mm_loadu_si128(reinterpret_cast<__m128i const*>(aColors + i)) : solid;
+                __m128i const destination = _mm_loadu_si128(reinterpret_cast<__m128i const*>(aDestination + i));
+                __m128i sourceLo = _mm_unpacklo_epi8(source, zero);
+                __m128i sourceHi = _mm_unpackhi_epi8(source, zero);
+                if constexpr (Masked)
+                {
+                    std::int32_t coverage;
+                    std::memcpy(&coverage, aCoverage + i, sizeof(coverage));
+                    if (coverage == 0)
+                        continue;
+                    __m128i mask = _mm_cvtsi32_si128(coverage);
+                    mask = _mm_unpacklo_epi8(mask, mask);
+                    mask = _mm_unpacklo_epi16(mask, mask);
+                    sourceLo = div255_epi16(_mm_mullo_epi16(sourceLo, _mm_unpacklo_epi8(mask, zero)));
+                    sourceHi = div255_epi16(_mm_mullo_epi16(sourceHi, _mm_unpackhi_epi8(mask, zero)));
+                }
+                __m128i const resultLo = source_over_epi16(sourceLo, _mm_unpacklo_epi8(destination, zero));
+                __m128i const resultHi = source_over_epi16(sourceHi, _mm_unpackhi_epi8(destination, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(aDestination + i), _mm_packus_epi16(resultLo, resultHi));
+            }
+            composite_scalar<Masked, Varying>(aDestination + i, aCoverage + (Masked ? i : 0), aColors + (Varying ? i : 0), aColor, aCount - i);
+        }
+
+        NEOGFX_TARGET_AVX2 inline __m256i div255_epi16(__m256i aValue)
+        {
+            __m256i const biased = _mm256_add_epi16(aValue, _mm256_set1_epi16(128));
+            return _mm256_srli_epi16(_mm256_add_epi16(biased, _mm256_srli_epi16(biased, 8)), 8);
+        }
+
+        NEOGFX_TARGET_AVX2 inline __m256i source_over_epi16(__m256i aSource, __m256i aDestination)
+        {
+            __m256i const sourceAlpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(aSource, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            return _mm256_add_epi16(aSource, div255_epi16(_mm256_mullo_epi16(aDestination, _mm256_sub_epi16(_mm256_set1_epi16(255), sourceAlpha))));
+        }
+
+        template <bool Masked, bool Varying>
+        NEOGFX_TARGET_AVX2 void composite_avx2(std::uint32_t* aDestination, std::uint8_t const* aCoverage, std::uint32_t const* aColors, std::uint32_t aColor, std::int32_t aCount)
+        {
+            __m256i const zero = _mm256_setzero_si256();
+            __m256i const solid = _mm256_set1_epi32(static_cast<int>(aColor));
+            std::int32_t i = 0;
+            for (; i + 8 <= aCount; i += 8)
+            {
+                __m256i const source = Varying ? _mm256_loadu_si256(reinterpret_cast<__m256i const*>(aColors + i)) : solid;
+                __m256i const destination = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(aDestination + i));
+                __m256i sourceLo = _mm256_unpacklo_epi8(source, zero);
+                __m256i sourceHi = _mm256_unpackhi_epi8(source, zero);
+                if constexpr (Masked)
+                {
+                    __m128i const coverage = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(aCoverage + i));
+                    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(coverage, _mm_setzero_si128())) & 0xFF) == 0xFF)
+                        continue;
+                    __m256i const mask = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(coverage), _mm256_set1_epi32(0x01010101));
+                    sourceLo = div255_epi16(_mm256_mullo_epi16(sourceLo, _mm256_unpacklo_epi8(mask, zero)));
+                    sourceHi = div255_epi16(_mm256_mullo_epi16(sourceHi, _mm256_unpackhi_epi8(mask, zero)));
+                }
+                __m256i const resultLo = source_over_epi16(sourceLo, _mm256_unpacklo_epi8(destination, zero));
+                __m256i const resultHi = source_over_epi16(sourceHi, _mm256_unpackhi_epi8(destination, zero));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDestination + i), _mm256_packus_epi16(resultLo, resultHi));
+            }
+            composite_sse2<Masked, Varying>(aDestination + i, aCoverage + (Masked ? i : 0), aColors + (Varying ? i : 0), aColor, aCount - i);
+        }
+#endif
+
+        using composite_function = void(*)(std::uint32_t*, std::uint8_t const*, std::uint32_t const*, std::uint32_t, std::int32_t);
+
+        struct compositor
+        {
+            composite_function solid;
+            composite_function masked;
+            composite_function varying;
+            composite_function maskedVarying;
+        };
+
+        compositor const& select_compositor()
+        {
+            static compositor const sCompositor = []()
+            {
+#ifdef NEOGFX_X86
+                if (host_cpu_features().avx2)
+                    return compositor{ &composite_avx2<false, false>, &composite_avx2<true, false>, &composite_avx2<false, true>, &composite_avx2<true, true> };
+                if (host_cpu_features().sse2)
+                    return compositor{ &composite_sse2<false, false>, &composite_sse2<true, false>, &composite_sse2<false, true>, &composite_sse2<true, true> };
+#endif
+                return compositor{ &composite_scalar<false, false>, &composite_scalar<true, false>, &composite_scalar<false, true>, &composite_scalar<true, true> };
+            }();
+            return sCompositor;
+        }
+
+        inline void composite(std::uint32_t* aDestination, std::uint8_t const* aCoverage, std::uint32_t const* aColors, std::uint32_t aColor, std::int32_t aCount)
+        {
+            if (aCount <= 0)
+                return;
+            auto const& compositor = select_compositor();
+            if (aColors != nullptr)
+                (aCoverage != nullptr ? compositor.maskedVarying : compositor.varying)(aDestination, aCoverage, aColors, aColor, aCount);
+            else if (aCoverage != nullptr)
+                compositor.masked(aDestination, aCoverage, aColors, aColor, aCount);
+            else if ((aColor >> 24u) == 0xFFu)
+                std::fill_n(aDestination, aCount, aColor);
+            else if ((aColor >> 24u) != 0u)
+                compositor.solid(aDestination, aCoverage, aColors, aColor, aCount);
+        }
+
+        inline std::uint8_t to_coverage(float aCoverage)
+        {
+            return static_cast<std::uint8_t>(std::clamp(aCoverage, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+
+        inline float span_coverage(float aPixel, float aStart, float aEnd)
+        {
+            return std::clamp(std::min(aPixel + 1.0f, aEnd) - std::max(aPixel, aStart), 0.0f, 1.0f);
+        }
+
+        inline float rounded_box_distance(float aX, float aY, float aHalfWidth, float aHalfHeight, std::array<float, 10> const& aParams)
+        {
+            // radii are top-left, top-right, bottom-right, bottom-left
+            float radius = aX > 0.0f ? (aY > 0.0f ? aParams[6] : aParams[5]) : (aY > 0.0f ? aParams[7] : aParams[4]);
+            radius = std::min(radius, std::min(aHalfWidth, aHalfHeight));
+            float const qx = std::abs(aX) - aHalfWidth + radius;
+            float const qy = std::abs(aY) - aHalfHeight + radius;
+            return std::min(std::max(qx, qy), 0.0f) + std::hypot(std::max(qx, 0.0f), std::max(qy, 0.0f)) - radius;
+        }
+
+        inline float ellipse_distance(float aX, float aY, float aRadiusX, float aRadiusY)
+        {
+            float const k0 = std::hypot(aX / aRadiusX, aY / aRadiusY);
+            float const k1 = std::hypot(aX / (aRadiusX * aRadiusX), aY / (aRadiusY * aRadiusY));
+            return k1 > 0.0f ? k0 * (k0 - 1.0f) / k1 : -std::min(aRadiusX, aRadiusY);
+        }
+
+        inline bool edge_includes(float aEdge, float aDx, float aDy)
+        {
+            // ties go to exactly one of two triangles sharing an edge
+            return aEdge > 0.0f || (aEdge == 0.0f && (aDy > 0.0f || (aDy == 0.0f && aDx > 0.0f)));
+        }
+
+        inline float segment_distance(float aX, float aY, software_rasterizer::vertex const& aStart, software_rasterizer::vertex const& aEnd)
+        {
+            float const dx = aEnd.x - aStart.x;
+            float const dy = aEnd.y - aStart.y;
+            float const length = std::hypot(dx, dy);
+            float const px = aX - aStart.x;
+            float const py = aY - aStart.y;
+            if (length == 0.0f)
+                return std::max(std::abs(px), std::abs(py));
+            float const along = (px * dx + py * dy) / length;
+            float const across = std::abs(px * dy - py * dx) / length;
+            return std::max(across, std::max(-along, along - length));
+        }
+
+        inline std::uint32_t texel(software_rasterizer::texture_source const& aTexture, std::int32_t aX, std::int32_t aY)
+        {
+            return aTexture.pixels[static_cast<std::size_t>(std::clamp(aY, 0, aTexture.height - 1)) * aTexture.width + std::clamp(aX, 0, aTexture.width - 1)];
+        }
+
+        inline std::uint32_t sample(software_rasterizer::texture_source const& aTexture, float aU, float aV, bool aSmooth)
+        {
+            if (!aSmooth)
+                return texel(aTexture, static_cast<std::int32_t>(std::floor(aU)), static_cast<std::int32_t>(std::floor(aV)));
+            float const u = aU - 0.5f;
+            float const v = aV - 0.5f;
+            auto const x = static_cast<std::int32_t>(std::floor(u));
+            auto const y = static_cast<std::int32_t>(std::floor(v));
+            auto const fx = static_cast<std::uint32_t>((u - x) * 256.0f);
+            auto const fy = static_cast<std::uint32_t>((v - y) * 256.0f);
+            std::uint32_t const t00 = texel(aTexture, x, y);
+            std::uint32_t const t10 = texel(aTexture, x + 1, y);
+            std::uint32_t const t01 = texel(aTexture, x, y + 1);
+            std::uint32_t const t11 = texel(aTexture, x + 1, y + 1);
+            std::uint32_t result = 0u;
+            for (std::uint32_t shift = 0u; shift < 32u; shift += 8u)
+            {
+                std::uint32_t const top = ((t00 >> shift) & 0xFFu) * (256u - fx) + ((t10 >> shift) & 0xFFu) * fx;
+                std::uint32_t const bottom = ((t01 >> shift) & 0xFFu) * (256u - fx) + ((t11 >> shift) & 0xFFu) * fx;
+                result |= (((top * (256u - fy) + bottom * fy) + 32768u) >> 16u) << shift;
+            }
+            return result;
+        }
+
+        inline std::uint32_t apply_texture_effect(software_rasterizer::texture_effect aEffect, std::uint32_t aTexel, std::uint32_t aColor)
+        {
+            // texel and colour are premultiplied so the shader's unpremultiplied formulae reduce to these
+            std::uint32_t const r = aTexel & 0xFFu;
+            std::uint32_t const g = (aTexel >> 8u) & 0xFFu;
+            std::uint32_t const b = (aTexel >> 16u) & 0xFFu;
+            std::uint32_t const a = aTexel >> 24u;
+            std::uint32_t source;
+            switch (aEffect)
+            {
+            case software_rasterizer::texture_effect::Modulate:
+            case software_rasterizer::texture_effect::Monochrome:
+            default:
+                source = aTexel;
+                break;
+            case software_rasterizer::texture_effect::Colorize:
+                {
+                    std::uint32_t const average = (r + g + b + 1u) / 3u;
+                    source = average | (average << 8u) | (average << 16u) | (a << 24u);
+                }
+                break;
+            case software_rasterizer::texture_effect::ColorizeMaximum:
+                {
+                    std::uint32_t const maximum = std::max({ r, g, b });
+                    source = maximum | (maximum << 8u) | (maximum << 16u) | (a << 24u);
+                }
+                break;
+            case software_rasterizer::texture_effect::ColorizeSpot:
+                source = a * 0x01010101u;
+                break;
+            case software_rasterizer::texture_effect::ColorizeAlpha:
+                source = ((r + g + b + 1u) / 3u) * 0x01010101u;
+                break;
+            }
+            std::uint32_t result = 0u;
+            for (std::uint32_t shift = 0u; shift < 32u; shift += 8u)
+                result |= div255(((source >> shift) & 0xFFu) * ((aColor >> shift) & 0xFFu)) << shift;
+            if (aEffect == software_rasterizer::texture_effect::Monochrome)
+            {
+                auto const gray = static_cast<std::uint32_t>(
+                    (result & 0xFFu) * 0.299f + ((result >> 8u) & 0xFFu) * 0.587f + ((result >> 16u) & 0xFFu) * 0.114f + 0.5f);
+                result = gray | (gray << 8u) | (gray << 16u) | (result & 0xFF000000u);
+            }
+            return result;
+        }
+    }
+
+    software_bitmap::software_bitmap() :
+        iWidth{ 0 }, iHeight{ 0 }
+    {
+    }
+
+    software_bitmap::software_bitmap(std::int32_t aWidth, std::int32_t aHeight) :
+        iWidth{ 0 }, iHeight{ 0 }
+    {
+        resize(aWidth, aHeight);
+    }
+
+    std::int32_t software_bitmap::width() const
+    {
+        return iWidth;
+    }
+
+    std::int32_t software_bitmap::height() const
+    {
+        return iHeight;
+    }
+
+    void software_bitmap::resize(std::int32_t aWidth, std::int32_t aHeight)
+    {
+        iWidth = std::max(aWidth, 0);
+        iHeight = std::max(aHeight, 0);
+        iPixels.assign(static_cast<std::size_t>(iWidth) * iHeight, 0u);
+    }
+
+    std::uint32_t const* software_bitmap::data() const
+    {
+        return iPixels.data();
+    }
+
+    std::uint32_t* software_bitmap::data()
+    {
+        return iPixels.data();
+    }
+
+    std::uint32_t const* software_bitmap::row(std::int32_t aY) const
+    {
+        return iPixels.data() + static_cast<std::size_t>(aY) * iWidth;
+    }
+
+    std::uint32_t* software_bitmap::row(std::int32_t aY)
+    {
+        return iPixels.data() + static_cast<std::size_t>(aY) * iWidth;
+    }
+
+    software_rasterizer::software_rasterizer()
+    {
+    }
+
+    std::optional<software_rasterizer::clip_rect> const& software_rasterizer::clip() const
+    {
+        return iClip;
+    }
+
+    void software_rasterizer::set_clip(std::optional<clip_rect> const& aClip)
+    {
+        iClip = aClip;
+    }
+
+    std::uint32_t software_rasterizer::add_ramp(ramp const& aRamp)
+    {
+        iRamps.push_back(aRamp);
+        return static_cast<std::uint32_t>(iRamps.size() - 1u);
+    }
+
+    std::uint32_t software_rasterizer::add_texture(texture_source const& aTexture)
+    {
+        iTextures.push_back(aTexture);
+        return static_cast<std::uint32_t>(iTextures.size() - 1u);
+    }
+
+    std::size_t software_rasterizer::primitive_count() const
+    {
+        return iPrimitives.size();
+    }
+
+    void software_rasterizer::clear(std::uint32_t aColor)
+    {
+        auto const limit = static_cast<float>(std::numeric_limits<std::int32_t>::max() / 2);
+        add(shape::Clear, -limit, -limit, limit, limit, {}, paint{ aColor }, {});
+    }
+
+    void software_rasterizer::fill_rect(float aX0, float aY0, float aX1, float aY1, paint const& aPaint)
+    {
+        add(shape::Rect, aX0, aY0, aX1, aY1, { aX0, aY0, aX1, aY1 }, aPaint, {});
+    }
+
+    void software_rasterizer::fill_rounded_rect(float aX0, float aY0, float aX1, float aY1, std::array<float, 4> const& aRadii, paint const& aPaint)
+    {
+        add(shape::RoundedRect, aX0 - 1.0f, aY0 - 1.0f, aX1 + 1.0f, aY1 + 1.0f,
+            { (aX0 + aX1) / 2.0f, (aY0 + aY1) / 2.0f, (aX1 - aX0) / 2.0f, (aY1 - aY0) / 2.0f, aRadii[0], aRadii[1], aRadii[2], aRadii[3] }, aPaint, {});
+    }
+
+    void software_rasterizer::stroke_rounded_rect(float aX0, float aY0, float aX1, float aY1, std::array<float, 4> const& aRadii, float aWidth, paint const& aPaint)
+    {
+        float const margin = aWidth / 2.0f + 1.0f;
+        add(shape::RoundedRectOutline, aX0 - margin, aY0 - margin, aX1 + margin, aY1 + margin,
+            { (aX0 + aX1) / 2.0f, (aY0 + aY1) / 2.0f, (aX1 - aX0) / 2.0f, (aY1 - aY0) / 2.0f, aRadii[0], aRadii[1], aRadii[2], aRadii[3], aWidth / 2.0f }, aPaint, {});
+    }
+
+    void software_rasterizer::fill_ellipse(float aCenterX, float aCenterY, float aRadiusX, float aRadiusY, paint const& aPaint)
+    {
+        if (aRadiusX <= 0.0f || aRadiusY <= 0.0f)
+            return;
+        add(shape::Ellipse, aCenterX - aRadiusX - 1.0f, aCenterY - aRadiusY - 1.0f, aCenterX + aRadiusX + 1.0f, aCenterY + aRadiusY + 1.0f,
+            { aCenterX, aCenterY, aRadiusX, aRadiusY }, aPaint, {});
+    }
+
+    void software_rasterizer::stroke_ellipse(float aCenterX, float aCenterY, float aRadiusX, float aRadiusY, float aWidth, paint const& aPaint)
+    {
+        if (aRadiusX <= 0.0f || aRadiusY <= 0.0f)
+            return;
+        float const margin = aWidth / 2.0f + 1.0f;
+        add(shape::EllipseOutline, aCenterX - aRadiusX - margin, aCenterY - aRadiusY - margin, aCenterX + aRadiusX + margin, aCenterY + aRadiusY + margin,
+            { aCenterX, aCenterY, aRadiusX, aRadiusY, aWidth / 2.0f }, aPaint, {});
+    }
+
+    void software_rasterizer::draw_line(float aX0, float aY0, float aX1, float aY1, float aWidth, paint const& aPaint)
+    {
+        float const margin = aWidth / 2.0f + 1.0f;
+        add(shape::Line, std::min(aX0, aX1) - margin, std::min(aY0, aY1) - margin, std::max(aX0, aX1) + margin, std::max(aY0, aY1) + margin,
+            { aX0, aY0, aX1, aY1, aWidth / 2.0f }, aPaint, {});
+    }
+
+    void software_rasterizer::fill_triangle(float aX0, float aY0, float aX1, float aY1, float aX2, float aY2, paint const& aPaint)
+    {
+        float const area = (aX1 - aX0) * (aY2 - aY0) - (aY1 - aY0) * (aX2 - aX0);
+        if (area == 0.0f)
+            return;
+        if (area < 0.0f)
+        {
+            std::swap(aX1, aX2);
+            std::swap(aY1, aY2);
+        }
+        add(shape::Triangle, std::min({ aX0, aX1, aX2 }), std::min({ aY0, aY1, aY2 }), std::max({ aX0, aX1, aX2 }), std::max({ aY0, aY1, aY2 }),
+            { aX0, aY0, aX1, aY1, aX2, aY2 }, aPaint, {});
+    }
+
+    void software_rasterizer::fill_polygon(std::vector<vertex> const& aVertices, paint const& aPaint)
+    {
+        if (aVertices.size() < 3u)
+            return;
+        float minX = aVertices[0].x, minY = aVertices[0].y, maxX = minX, maxY = minY;
+        for (auto const& v : aVertices)
+        {
+            minX = std::min(minX, v.x);
+            minY = std::min(minY, v.y);
+            maxX = std::max(maxX, v.x);
+            maxY = std::max(maxY, v.y);
+        }
+        auto const first = static_cast<std::uint32_t>(iVertices.size());
+        auto const before = iPrimitives.size();
+        add(shape::Polygon, minX, minY, maxX, maxY, { static_cast<float>(aVertices.size()) }, aPaint, {}, first);
+        if (iPrimitives.size() != before)
+            iVertices.insert(iVertices.end(), aVertices.begin(), aVertices.end());
+    }
+
+    void software_rasterizer::draw_polyline(std::vector<vertex> const& aVertices, bool aClosed, float aWidth, paint const& aPaint)
+    {
+        if (aVertices.size() < 2u)
+            return;
+        float minX = aVertices[0].x, minY = aVertices[0].y, maxX = minX, maxY = minY;
+        for (auto const& v : aVertices)
+        {
+            minX = std::min(minX, v.x);
+            minY = std::min(minY, v.y);
+            maxX = std::max(maxX, v.x);
+            maxY = std::max(maxY, v.y);
+        }
+        float const margin = aWidth / 2.0f + 1.0f;
+        auto const first = static_cast<std::uint32_t>(iVertices.size());
+        auto const before = iPrimitives.size();
+        add(shape::Polyline, minX - margin, minY - margin, maxX + margin, maxY + margin,
+            { static_cast<float>(aVertices.size()), aWidth / 2.0f, aClosed ? 1.0f : 0.0f }, aPaint, {}, first);
+        if (iPrimitives.size() != before)
+            iVertices.insert(iVertices.end(), aVertices.begin(), aVertices.end());
+    }
+
+    void software_rasterizer::fill_checkerboard(float aX0, float aY0, float aX1, float aY1, float aSquareSize, paint const& aPaint1, paint const& aPaint2)
+    {
+        if (aSquareSize <= 0.0f)
+            return;
+        add(shape::Checkerboard, aX0, aY0, aX1, aY1, { aX0, aY0, aX1, aY1, aSquareSize }, aPaint1, aPaint2);
+    }
+
+    void software_rasterizer::execute(software_bitmap& aTarget)
+    {
+        if (iPrimitives.empty() || aTarget.width() == 0 || aTarget.height() == 0)
+        {
+            discard();
+            return;
+        }
+
+        std::int32_t const tilesX = (aTarget.width() + TileSize - 1) / TileSize;
+        std::int32_t const tilesY = (aTarget.height() + TileSize - 1) / TileSize;
+        std::size_t const tileCount = static_cast<std::size_t>(tilesX) * tilesY;
+        std::size_t const threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        bins tileBins(tileCount);
+        if (iPrimitives.size() >= ParallelBinningThreshold && threads > 1u)
+        {
+            // each worker bins a contiguous run of primitives; concatenating the per-worker bins in
+            // worker order preserves submission order within every tile; chunks after the first are
+            // handed to the shared thread pool and the calling thread bins the first
+            std::size_t const chunks = std::min(threads, iPrimitives.size() / (ParallelBinningThreshold / 2u));
+            std::size_t const chunkSize = (iPrimitives.size() + chunks - 1u) / chunks;
+            std::vector<bins> chunkBins(chunks, bins(tileCount));
+            std::vector<std::future<void>> workers;
+            for (std::size_t chunk = 1u; chunk < chunks; ++chunk)
+            {
+                auto const first = chunk * chunkSize;
+                auto const last = std::min(first + chunkSize, iPrimitives.size());
+                workers.push_back(neolib::thread_pool::default_thread_pool().run(
+                    [&, chunk, first, last]() { bin(first, last, tilesX, tilesY, chunkBins[chunk]); }).first);
+            }
+            bin(0u, std::min(chunkSize, iPrimitives.size()), tilesX, tilesY, chunkBins[0]);
+            for (auto& worker : workers)
+                worker.get();
+            for (std::size_t tile = 0u; tile < tileCount; ++tile)
+                for (auto const& chunk : chunkBins)
+                    tileBins[tile].insert(tileBins[tile].end(), chunk[tile].begin(), chunk[tile].end());
+        }
+        else
+            bin(0u, iPrimitives.size(), tilesX, tilesY, tileBins);
+
+        std::vector<std::size_t> busyTiles;
+        for (std::size_t tile = 0u; tile < tileCount; ++tile)
+            if (!tileBins[tile].empty())
+                busyTiles.push_back(tile);
+
+        auto rasterize = [&](std::size_t aTile)
+        {
+            rasterize_tile(aTarget, static_cast<std::int32_t>(aTile % tilesX), static_cast<std::int32_t>(aTile / tilesX), tileBins[aTile]);
+        };
+
+        if (busyTiles.size() > 1u && threads > 1u)
+        {
+            std::atomic<std::size_t> nextTile = 0u;
+            auto work = [&]()
+            {
+                for (std::size_t next; (next = nextTile++) < busyTiles.size();)
+                    rasterize(busyTiles[next]);
+            };
+            std::vector<std::future<void>> workers;
+            for (std::size_t worker = 1u; worker < std::min(threads, busyTiles.size()); ++worker)
+                workers.push_back(neolib::thread_pool::default_thread_pool().run(work).first);
+            work();
+            for (auto& worker : workers)
+                worker.get();
+        }
+        else
+            for (auto tile : busyTiles)
+                rasterize(tile);
+
+        discard();
+    }
+
+    void software_rasterizer::discard()
+    {
+        iPrimitives.clear();
+        iRamps.clear();
+        iTextures.clear();
+        iVertices.clear();
+    }
+
+    void software_rasterizer::add(shape aType, float aX0, float aY0, float aX1, float aY1, std::array<float, 10> const& aParams, paint const& aPaint, paint const& aPaint2, std::uint32_t aVertices)
+    {
+        auto const limit = static_cast<float>(std::numeric_limits<std::int32_t>::max() / 2);
+        clip_rect bounds{
+            static_cast<std::int32_t>(std::floor(std::clamp(aX0, -limit, limit))),
+            static_cast<std::int32_t>(std::floor(std::clamp(aY0, -limit, limit))),
+            static_cast<std::int32_t>(std::ceil(std::clamp(aX1, -limit, limit))),
+            static_cast<std::int32_t>(std::ceil(std::clamp(aY1, -limit, limit))) };
+        if (iClip)
+        {
+            bounds.x0 = std::max(bounds.x0, iClip->x0);
+            bounds.y0 = std::max(bounds.y0, iClip->y0);
+            bounds.x1 = std::min(bounds.x1, iClip->x1);
+            bounds.y1 = std::min(bounds.y1, iClip->y1);
+        }
+        if (bounds.x0 >= bounds.x1 || bounds.y0 >= bounds.y1)
+            return;
+        if (aType != shape::Clear && (aPaint.color >> 24u) == 0u && aPaint.ramp == NoRamp && (aType != shape::Checkerboard || (aPaint2.color >> 24u) == 0u))
+            return;
+        iPrimitives.push_back(primitive{ aType, bounds, aParams, aPaint, aPaint2, aVertices });
+    }
+
+    void software_rasterizer::bin(std::size_t aFirst, std::size_t aLast, std::int32_t aTilesX, std::int32_t aTilesY, bins& aBins) const
+    {
+        for (auto index = aFirst; index < aLast; ++index)
+        {
+            auto const& bounds = iPrimitives[index].bounds;
+            if (bounds.x1 <= 0 || bounds.y1 <= 0)
+                continue;
+            std::int32_t const tileX0 = std::max(bounds.x0, 0) / TileSize;
+            std::int32_t const tileY0 = std::max(bounds.y0, 0) / TileSize;
+            std::int32_t const tileX1 = std::min((bounds.x1 - 1) / TileSize, aTilesX - 1);
+            std::int32_t const tileY1 = std::min((bounds.y1 - 1) / TileSize, aTilesY - 1);
+            for (std::int32_t tileY = tileY0; tileY <= tileY1; ++tileY)
+                for (std::int32_t tileX = tileX0; tileX <= tileX1; ++tileX)
+                    aBins[static_cast<std::size_t>(tileY) * aTilesX + tileX].push_back(static_cast<std::uint32_t>(index));
+        }
+    }
+
+    void software_rasterizer::rasterize_tile(software_bitmap& aTarget, std::int32_t aTileX, std::int32_t aTileY, std::vector<std::uint32_t> const& aPrimitives) const
+    {
+        thread_local std::array<std::uint8_t, TileSize> coverage;
+        thread_local std::array<std::uint32_t, TileSize> colors;
+        thread_local std::array<std::uint32_t, TileSize> colors2;
+        thread_local std::array<float, TileSize> accumulated;
+        thread_local std::vector<std::pair<float, std::int32_t>> crossings;
+        thread_local std::vector<std::uint32_t> segments;
+
+        std::int32_t const tileX0 = aTileX * TileSize;
+        std::int32_t const tileY0 = aTileY * TileSize;
+        std::int32_t const tileX1 = std::min(tileX0 + TileSize, aTarget.width());
+        std::int32_t const tileY1 = std::min(tileY0 + TileSize, aTarget.height());
+
+        for (auto index : aPrimitives)
+        {
+            auto const& primitive = iPrimitives[index];
+            auto const& p = primitive.params;
+            std::int32_t const x0 = std::max(primitive.bounds.x0, tileX0);
+            std::int32_t const y0 = std::max(primitive.bounds.y0, tileY0);
+            std::int32_t const x1 = std::min(primitive.bounds.x1, tileX1);
+            std::int32_t const y1 = std::min(primitive.bounds.y1, tileY1);
+            if (x0 >= x1 || y0 >= y1)
+                continue;
+            std::int32_t const count = x1 - x0;
+            bool const varying = primitive.fill.ramp != NoRamp || primitive.fill.texture != NoTexture;
+            for (std::int32_t y = y0; y < y1; ++y)
+            {
+                auto* const destination = aTarget.row(y) + x0;
+                float const sampleY = y + 0.5f;
+                if (varying)
+                    shade(primitive.fill, x0, y, count, colors.data());
+                std::uint32_t const* const shaded = varying ? colors.data() : nullptr;
+                switch (primitive.type)
+                {
+                case shape::Clear:
+                    std::fill_n(destination, count, primitive.fill.color);
+                    break;
+                case shape::Rect:
+                    {
+                        float const coverageY = span_coverage(static_cast<float>(y), p[1], p[3]);
+                        if (coverageY == 1.0f)
+                        {
+                            // only the partially covered columns at either end need a coverage mask
+                            std::int32_t const inner0 = std::clamp(static_cast<std::int32_t>(std::ceil(p[0])), x0, x1);
+                            std::int32_t const inner1 = std::clamp(static_cast<std::int32_t>(std::floor(p[2])), inner0, x1);
+                            for (std::int32_t x = x0; x < inner0; ++x)
+                                coverage[x - x0] = to_coverage(span_coverage(static_cast<float>(x), p[0], p[2]));
+                            for (std::int32_t x = inner1; x < x1; ++x)
+                                coverage[x - x0] = to_coverage(span_coverage(static_cast<float>(x), p[0], p[2]));
+                            composite(destination, coverage.data(), shaded, primitive.fill.color, inner0 - x0);
+                            composite(destination + (inner0 - x0), nullptr, varying ? shaded + (inner0 - x0) : nullptr, primitive.fill.color, inner1 - inner0);
+                            composite(destination + (inner1 - x0), coverage.data() + (inner1 - x0), varying ? shaded + (inner1 - x0) : nullptr, primitive.fill.color, x1 - inner1);
+                        }
+                        else
+                        {
+                            for (std::int32_t x = x0; x < x1; ++x)
+                                coverage[x - x0] = to_coverage(coverageY * span_coverage(static_cast<float>(x), p[0], p[2]));
+                            composite(destination, coverage.data(), shaded, primitive.fill.color, count);
+                        }
+                    }
+                    break;
+                case shape::RoundedRect:
+                case shape::RoundedRectOutline:
+                    for (std::int32_t x = x0; x < x1; ++x)
+                    {
+                        float const distance = rounded_box_distance(x + 0.5f - p[0], sampleY - p[1], p[2], p[3], p);
+                        coverage[x - x0] = to_coverage(primitive.type == shape::RoundedRect ? 0.5f - distance : p[8] + 0.5f - std::abs(distance));
+                    }
+                    composite(destination, coverage.data(), shaded, primitive.fill.color, count);
+                    break;
+                case shape::Ellipse:
+                case shape::EllipseOutline:
+                    for (std::int32_t x = x0; x < x1; ++x)
+                    {
+                        float const distance = ellipse_distance(x + 0.5f - p[0], sampleY - p[1], p[2], p[3]);
+                        coverage[x - x0] = to_coverage(primitive.type == shape::Ellipse ? 0.5f - distance : p[4] + 0.5f - std::abs(distance));
+                    }
+                    composite(destination, coverage.data(), shaded, primitive.fill.color, count);
+                    break;
+                case shape::Line:
+                    {
+                        float const dx = p[2] - p[0];
+                        float const dy = p[3] - p[1];
+                        float const length = std::hypot(dx, dy);
+                        for (std::int32_t x = x0; x < x1; ++x)
+                        {
+                            float const px = x + 0.5f - p[0];
+                            float const py = sampleY - p[1];
+                            float distance;
+                            if (length > 0.0f)
+                            {
+                                float const along = (px * dx + py * dy) / length;
+                                float const across = std::abs(px * dy - py * dx) / length;
+                                distance = std::max(across - p[4], std::max(-along, along - length));
+                            }
+                            else
+                                distance = std::max(std::abs(px), std::abs(py)) - p[4];
+                            coverage[x - x0] = to_coverage(0.5f - distance);
+                        }
+                        composite(destination, coverage.data(), shaded, primitive.fill.color, count);
+                    }
+                    break;
+                case shape::Triangle:
+                    {
+                        float const edges[3][4] = {
+                            { p[0], p[1], p[2] - p[0], p[3] - p[1] },
+                            { p[2], p[3], p[4] - p[2], p[5] - p[3] },
+                            { p[4], p[5], p[0] - p[4], p[1] - p[5] } };
+                        for (std::int32_t x = x0; x < x1; ++x)
+                        {
+                            float const sampleX = x + 0.5f;
+                            bool inside = true;
+                            for (auto const& edge : edges)
+                                inside = inside && edge_includes(edge[2] * (sampleY - edge[1]) - edge[3] * (sampleX - edge[0]), edge[2], edge[3]);
+                            coverage[x - x0] = inside ? 255u : 0u;
+                        }
+                        composite(destination, coverage.data(), shaded, primitive.fill.color, count);
+                    }
+                    break;
+                case shape::Polygon:
+                    {
+                        // non-zero winding, four sub-scanlines per row, exact horizontal coverage per span
+                        constexpr std::int32_t SubScanlines = 4;
+                        auto const* const vertices = iVertices.data() + primitive.vertices;
+                        auto const vertexCount = static_cast<std::uint32_t>(p[0]);
+                        std::fill_n(accumulated.begin(), count, 0.0f);
+                        for (std::int32_t subScanline = 0; subScanline < SubScanlines; ++subScanline)
+                        {
+                            float const scanY = y + (subScanline + 0.5f) / SubScanlines;
+                            crossings.clear();
+                            for (std::uint32_t v = 0u; v < vertexCount; ++v)
+                            {
+                                auto const& a = vertices[v];
+                                auto const& b = vertices[(v + 1u) % vertexCount];
+                                if ((a.y <= scanY) == (b.y <= scanY))
+                                    continue;
+                                float const crossingX = a.x + (scanY - a.y) * (b.x - a.x) / (b.y - a.y);
+                                crossings.emplace_back(crossingX, a.y < b.y ? 1 : -1);
+                            }
+                            std::sort(crossings.begin(), crossings.end());
+                            std::int32_t winding = 0;
+                            for (std::size_t crossing = 0u; crossing + 1u < crossings.size(); ++crossing)
+                            {
+                                winding += crossings[crossing].second;
+                                if (winding == 0)
+                                    continue;
+                                float const spanStart = std::max(crossings[crossing].first, static_cast<float>(x0));
+                                float const spanEnd = std::min(crossings[crossing + 1u].first, static_cast<float>(x1));
+                                if (spanStart >= spanEnd)
+                                    continue;
+                                std::int32_t const first = static_cast<std::int32_t>(std::floor(spanStart));
+                                std::int32_t const last = std::min(static_cast<std::int32_t>(std::ceil(spanEnd)), x1);
+                                for (std::int32_t x = first; x < last; ++x)
+                                    accumulated[x - x0] += span_coverage(static_cast<float>(x), spanStart, spanEnd) / SubScanlines;
+                            }
+                        }
+                        for (std::int32_t x = x0; x < x1; ++x)
+                            coverage[x - x0] = to_coverage(accumulated[x - x0]);
+                        composite(destination, coverage.data(), shaded, primitive.fill.color, count);
+                    }
+                    break;
+                case shape::Polyline:
+                    {
+                        // coverage is taken from the nearest segment (or round join) so overlapping segments
+                        // are composited once
+                        auto const* const vertices = iVertices.data() + primitive.vertices;
+                        auto const vertexCount = static_cast<std::uint32_t>(p[0]);
+                        float const halfWidth = p[1];
+                        bool const closed = p[2] != 0.0f;
+                        std::uint32_t const segmentCount = closed ? vertexCount : vertexCount - 1u;
+                        float const reach = halfWidth + 1.0f;
+                        segments.clear();
+                        for (std::uint32_t s = 0u; s < segmentCount; ++s)
+                        {
+                            auto const& a = vertices[s];
+                            auto const& b = vertices[(s + 1u) % vertexCount];
+                            if (std::min(a.y, b.y) - reach <= y + 1.0f && std::max(a.y, b.y) + reach >= static_cast<float>(y))
+                                segments.push_back(s);
+                        }
+                        for (std::int32_t x = x0; x < x1; ++x)
+                        {
+                            float const sampleX = x + 0.5f;
+                            float distance = std::numeric_limits<float>::max();
+                            for (auto s : segments)
+                            {
+                                auto const& a = vertices[s];
+                                auto const& b = vertices[(s + 1u) % vertexCount];
+                                distance = std::min(distance, segment_distance(sampleX, sampleY, a, b));
+                                if (closed || s + 1u < segmentCount)
+                                    distance = std::min(distance, std::hypot(sampleX - b.x, sampleY - b.y));
+                            }
+                            coverage[x - x0] = to_coverage(halfWidth + 0.5f - distance);
+                        }
+                        composite(destination, coverage.data(), shaded, primitive.fill.color, count);
+                    }
+                    break;
+                case shape::Checkerboard:
+                    {
+                        float const coverageY = span_coverage(static_cast<float>(y), p[1], p[3]);
+                        auto const row = static_cast<std::int32_t>(std::floor((sampleY - p[1]) / p[4]));
+                        if (!varying)
+                            std::fill_n(colors.begin(), count, primitive.fill.color);
+                        bool const varying2 = primitive.fill2.ramp != NoRamp || primitive.fill2.texture != NoTexture;
+                        if (varying2)
+                            shade(primitive.fill2, x0, y, count, colors2.data());
+                        for (std::int32_t x = x0; x < x1; ++x)
+                        {
+                            coverage[x - x0] = to_coverage(coverageY * span_coverage(static_cast<float>(x), p[0], p[2]));
+                            auto const column = static_cast<std::int32_t>(std::floor((x + 0.5f - p[0]) / p[4]));
+                            if (((row + column) & 1) != 0)
+                                colors[x - x0] = varying2 ? colors2[x - x0] : primitive.fill2.color;
+                        }
+                        composite(destination, coverage.data(), colors.data(), primitive.fill.color, count);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    void software_rasterizer::shade(paint const& aPaint, std::int32_t aX, std::int32_t aY, std::int32_t aCount, std::uint32_t* aColors) const
+    {
+        if (aPaint.ramp != NoRamp)
+        {
+            auto const& colorRamp = iRamps[aPaint.ramp];
+            float const sampleY = aY + 0.5f - aPaint.originY;
+            for (std::int32_t i = 0; i < aCount; ++i)
+            {
+                float const sampleX = aX + i + 0.5f - aPaint.originX;
+                float const t = aPaint.radial ?
+                    (aPaint.axisX > 0.0f ? std::hypot(sampleX, sampleY) / aPaint.axisX : 0.0f) :
+                    sampleX * aPaint.axisX + sampleY * aPaint.axisY;
+                aColors[i] = colorRamp[static_cast<std::size_t>(std::clamp(t, 0.0f, 1.0f) * 255.0f + 0.5f)];
+            }
+        }
+        else
+            std::fill_n(aColors, aCount, aPaint.color);
+        if (aPaint.texture != NoTexture)
+        {
+            auto const& source = iTextures[aPaint.texture];
+            auto const& m = aPaint.uv;
+            float const sampleY = aY + 0.5f;
+            for (std::int32_t i = 0; i < aCount; ++i)
+            {
+                float const sampleX = aX + i + 0.5f;
+                float const u = m[0] * sampleX + m[1] * sampleY + m[2];
+                float const v = m[3] * sampleX + m[4] * sampleY + m[5];
+                aColors[i] = apply_texture_effect(aPaint.effect, sample(source, u, v, aPaint.smooth), aColors[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,170 @@
+// software_rasterizer.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <optional>
+
+namespace neogfx
+{
+    // Pixels are premultiplied RGBA8 stored in memory in the byte order R, G, B, A.
+    class software_bitmap
+    {
+    public:
+        software_bitmap();
+        software_bitmap(std::int32_t aWidth, std::int32_t aHeight);
+    public:
+        std::int32_t width() const;
+        std::int32_t height() const;
+        void resize(std::int32_t aWidth, std::int32_t aHeight);
+        std::uint32_t const* data() const;
+        std::uint32_t* data();
+        std::uint32_t const* row(std::int32_t aY) const;
+        std::uint32_t* row(std::int32_t aY);
+    private:
+        std::int32_t iWidth;
+        std::int32_t iHeight;
+        std::vector<std::uint32_t> iPixels;
+    };
+
+    // Records primitives in device coordinates and rasterizes them into a bitmap: primitives are binned
+    // into tiles and tiles are rasterized concurrently, each in submission order, so the result does not
+    // depend on the number of threads or the instruction set used to composite spans.
+    class software_rasterizer
+    {
+    public:
+        static constexpr std::int32_t TileSize = 64;
+        static constexpr std::uint32_t NoRamp = ~0u;
+        static constexpr std::uint32_t NoTexture = ~0u;
+        static constexpr std::size_t ParallelBinningThreshold = 512u;
+    public:
+        using ramp = std::array<std::uint32_t, 256>;
+        struct vertex
+        {
+            float x;
+            float y;
+        };
+        // Premultiplied pixels in the same layout as software_bitmap; the pixels must outlive execute().
+        struct texture_source
+        {
+            std::uint32_t const* pixels;
+            std::int32_t width;
+            std::int32_t height;
+        };
+        // How a texel is combined with the paint colour; mirrors the standard texture shader effects.
+        enum class texture_effect : std::uint8_t
+        {
+            Modulate,
+            Colorize,
+            ColorizeMaximum,
+            ColorizeSpot,
+            ColorizeAlpha,
+            Monochrome
+        };
+        struct clip_rect
+        {
+            std::int32_t x0;
+            std::int32_t y0;
+            std::int32_t x1;
+            std::int32_t y1;
+        };
+        // A solid premultiplied colour or, if ramp is not NoRamp, a colour ramp indexed by
+        // t = (x - origin.x) * axis.x + (y - origin.y) * axis.y or, if radial, by the distance
+        // from origin divided by axis.x. If texture is not NoTexture the texel at u = uv[0] * x + uv[1] * y + uv[2],
+        // v = uv[3] * x + uv[4] * y + uv[5] (in texels) is combined with that colour according to effect.
+        struct paint
+        {
+            std::uint32_t color = 0u;
+            std::uint32_t ramp = NoRamp;
+            bool radial = false;
+            float originX = 0.0f;
+            float originY = 0.0f;
+            float axisX = 0.0f;
+            float axisY = 0.0f;
+            std::uint32_t texture = NoTexture;
+            texture_effect effect = texture_effect::Modulate;
+            bool smooth = false;
+            std::array<float, 6> uv = {};
+        };
+    private:
+        enum class shape : std::uint8_t
+        {
+            Clear,
+            Rect,
+            RoundedRect,
+            RoundedRectOutline,
+            Ellipse,
+            EllipseOutline,
+            Line,
+            Triangle,
+            Polygon,
+            Polyline,
+            Checkerboard
+        };
+        struct primitive
+        {
+            shape type;
+            clip_rect bounds;
+            std::array<float, 10> params;
+            paint fill;
+            paint fill2;
+            std::uint32_t vertices;
+        };
+        using bins = std::vector<std::vector<std::uint32_t>>;
+    public:
+        software_rasterizer();
+    public:
+        std::optional<clip_rect> const& clip() const;
+        void set_clip(std::optional<clip_rect> const& aClip);
+        std::uint32_t add_ramp(ramp const& aRamp);
+        std::uint32_t add_texture(texture_source const& aTexture);
+        std::size_t primitive_count() const;
+    public:
+        void clear(std::uint32_t aColor);
+        void fill_rect(float aX0, float aY0, float aX1, float aY1, paint const& aPaint);
+        void fill_rounded_rect(float aX0, float aY0, float aX1, float aY1, std::array<float, 4> const& aRadii, paint const& aPaint);
+        void stroke_rounded_rect(float aX0, float aY0, float aX1, float aY1, std::array<float, 4> const& aRadii, float aWidth, paint const& aPaint);
+        void fill_ellipse(float aCenterX, float aCenterY, float aRadiusX, float aRadiusY, paint const& aPaint);
+        void stroke_ellipse(float aCenterX, float aCenterY, float aRadiusX, float aRadiusY, float aWidth, paint const& aPaint);
+        void draw_line(float aX0, float aY0, float aX1, float aY1, float aWidth, paint const& aPaint);
+        void fill_triangle(float aX0, float aY0, float aX1, float aY1, float aX2, float aY2, paint const& aPaint);
+        void fill_polygon(std::vector<vertex> const& aVertices, paint const& aPaint);
+        void draw_polyline(std::vector<vertex> const& aVertices, bool aClosed, float aWidth, paint const& aPaint);
+        void fill_checkerboard(float aX0, float aY0, float aX1, float aY1, float aSquareSize, paint const& aPaint1, paint const& aPaint2);
+    public:
+        void execute(software_bitmap& aTarget);
+        void discard();
+    private:
+        void add(shape aType, float aX0, float aY0, float aX1, float aY1, std::array<float, 10> const& aParams, paint const& aPaint, paint const& aPaint2, std::uint32_t aVertices = 0u);
+        void bin(std::size_t aFirst, std::size_t aLast, std::int32_t aTilesX, std::int32_t aTilesY, bins& aBins) const;
+        void rasterize_tile(software_bitmap& aTarget, std::int32_t aTileX, std::int32_t aTileY, std::vector<std::uint32_t> const& aPrimitives) const;
+        void shade(paint const& aPaint, std::int32_t aX, std::int32_t aY, std::int32_t aCount, std::uint32_t* aColors) const;
+    private:
+        std::optional<clip_rect> iClip;
+        std::vector<primitive> iPrimitives;
+        std::vector<ramp> iRamps;
+        std::vector<texture_source> iTextures;
+        std::vector<vertex> iVertices;
+    };
+}
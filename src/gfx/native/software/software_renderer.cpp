@@ -0,0 +1,530 @@
+// software_renderer.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2023 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <neolib/core/scoped.hpp>
+#include <neolib/task/thread.hpp>
+#include <neolib/app/i_power.hpp>
+
+#include <neogfx/hid/i_display.hpp>
+#include <neogfx/hid/i_surface_manager.hpp>
+#include <neogfx/app/i_basic_services.hpp>
+#include <neogfx/gui/widget/i_widget.hpp>
+#include "../../../gui/window/native/headless_window.hpp"
+#include "../../../gui/window/native/headless_surface.hpp"
+#include "../../../gui/window/native/virtual_window.hpp"
+#include "../../../gui/window/native/virtual_surface.hpp"
+#include "software_shader_program.hpp"
+#include "software_renderer.hpp"
+
+namespace neogfx
+{
+    software_renderer::software_renderer(neogfx::renderer aRenderer) :
+        iRenderer{ aRenderer },
+        iInitialized{ false },
+        iVsyncEnabled{ false },
+        iCreatingWindow{ 0 },
+        iNextObjectHandle{ 0 },
+        iLimitFrameRate{ true },
+        iFrameRateLimit{ 60u },
+        iSubpixelRendering{ false },
+        iOperationReordering{ false },
+        iInstancedShapes{ false },
+        iParallelMeshGeneration{ false },
+        iTextureUploadBudget{ 16ull * 1024ull * 1024ull }
+    {
+    }
+
+    software_renderer::~software_renderer()
+    {
+    }
+
+    const i_device_metrics& software_renderer::default_screen_metrics() const
+    {
+        return service<i_basic_services>().display().metrics();
+    }
+
+    renderer software_renderer::renderer() const
+    {
+        return iRenderer;
+    }
+
+    bool software_renderer::vsync_enabled() const
+    {
+        return iVsyncEnabled;
+    }
+
+    void software_renderer::enable_vsync()
+    {
+        iVsyncEnabled = true;
+    }
+
+    void software_renderer::disable_vsync()
+    {
+        iVsyncEnabled = false;
+    }
+
+    void software_renderer::initialize()
+    {
+        iInitialized = true;
+        iDefaultShaderProgram = add_shader_program(neolib::make_ref<software_standard_shader_program>().as<i_shader_program>()).as<i_standard_shader_program>();
+    }
+
+    void software_renderer::cleanup()
+    {
+        iFontManager = std::nullopt;
+        iPingPongBuffer1s = std::nullopt;
+        iPingPongBuffer2s = std::nullopt;
+        iTextureManager = std::nullopt;
+        iShaderPrograms.clear();
+        iDefaultShaderProgram.reset();
+        iInitialized = false;
+    }
+
+    pixel_format_t software_renderer::set_pixel_format(const i_render_target&)
+    {
+        return 0;
+    }
+
+    bool software_renderer::preserves_back_buffer(const i_render_target&) const
+    {
+        return true;
+    }
+
+    const i_render_target* software_renderer::active_target() const
+    {
+        if (iTargetStack.empty())
+            return nullptr;
+        return iTargetStack.back();
+    }
+
+    void software_renderer::activate_context(const i_render_target& aTarget)
+    {
+        iTargetStack.push_back(&aTarget);
+        if (!iInitialized)
+            initialize();
+    }
+
+    void software_renderer::deactivate_context()
+    {
+        if (iTargetStack.empty())
+            throw no_target_active();
+        iTargetStack.pop_back();
+        auto activeTarget = active_target();
+        if (activeTarget != nullptr)
+        {
+            iTargetStack.pop_back();
+            activeTarget->activate_target();
+        }
+    }
+
+    software_renderer::handle software_renderer::create_context(const i_render_target&)
+    {
+        // There is no device context to create; hand out a unique non-null token
+        return reinterpret_cast<handle>(++iNextObjectHandle);
+    }
+
+    void software_renderer::destroy_context(handle)
+    {
+    }
+
+    const software_renderer::shader_program_list& software_renderer::shader_programs() const
+    {
+        return iShaderPrograms;
+    }
+
+    const i_shader_program& software_renderer::shader_program(const neolib::i_string& aName) const
+    {
+        for (auto const& s : shader_programs())
+            if (s->name() == aName)
+                return *s;
+        throw shader_program_not_found();
+    }
+
+    i_shader_program& software_renderer::shader_program(const neolib::i_string& aName)
+    {
+        return const_cast<i_shader_program&>(to_const(*this).shader_program(aName));
+    }
+
+    i_shader_program& software_renderer::add_shader_program(const neolib::i_ref_ptr<i_shader_program>& aShaderProgram)
+    {
+        iShaderPrograms.push_back(aShaderProgram);
+        return *aShaderProgram;
+    }
+
+    bool software_renderer::is_shader_program_active() const
+    {
+        for (auto const& shaderProgram : shader_programs())
+            if (shaderProgram->active())
+                return true;
+        return false;
+    }
+
+    i_shader_program& software_renderer::active_shader_program()
+    {
+        for (auto const& shaderProgram : shader_programs())
+            if (shaderProgram->active())
+                return *shaderProgram;
+        throw no_shader_program_active();
+    }
+
+    const i_standard_shader_program& software_renderer::default_shader_program() const
+    {
+        return *iDefaultShaderProgram;
+    }
+
+    i_standard_shader_program& software_renderer::default_shader_program()
+    {
+        return *iDefaultShaderProgram;
+    }
+
+    software_renderer::handle software_renderer::create_shader_program_object()
+    {
+        return reinterpret_cast<handle>(++iNextObjectHandle);
+    }
+
+    void software_renderer::destroy_shader_program_object(handle)
+    {
+    }
+
+    software_renderer::handle software_renderer::create_shader_object(shader_type)
+    {
+        return reinterpret_cast<handle>(++iNextObjectHandle);
+    }
+
+    void software_renderer::destroy_shader_object(handle)
+    {
+    }
+
+    void software_renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const video_mode& aVideoMode, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
+    {
+        neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
+        if ((aWindow.style() & window_style::Nested) == window_style::Nested)
+            throw virtual_surface_must_have_parent();
+        aResult = make_ref<headless_window>(*this, aSurfaceManager, aWindow, basic_size<int>{ static_cast<int>(aVideoMode.resolution().cx), static_cast<int>(aVideoMode.resolution().cy) }, aWindowTitle, aStyle);
+        auto newSurface = make_ref<headless_surface>(*this, aWindow);
+        aResult->attach(*newSurface);
+    }
+
+    void software_renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
+    {
+        neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
+        if ((aWindow.style() & window_style::Nested) == window_style::Nested)
+            throw virtual_surface_must_have_parent();
+        aResult = make_ref<headless_window>(*this, aSurfaceManager, aWindow, aDimensions, aWindowTitle, aStyle);
+        auto newSurface = make_ref<headless_surface>(*this, aWindow);
+        aResult->attach(*newSurface);
+    }
+
+    void software_renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const point& aPosition, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
+    {
+        neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
+        if ((aWindow.style() & window_style::Nested) == window_style::Nested)
+            throw virtual_surface_must_have_parent();
+        aResult = make_ref<headless_window>(*this, aSurfaceManager, aWindow, aPosition, aDimensions, aWindowTitle, aStyle);
+        auto newSurface = make_ref<headless_surface>(*this, aWindow);
+        aResult->attach(*newSurface);
+    }
+
+    void software_renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, i_native_window& aParent, const video_mode& aVideoMode, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
+    {
+        if ((aWindow.style() & window_style::Nested) == window_style::Nested)
+            throw virtual_surface_cannot_be_fullscreen();
+        create_window(aSurfaceManager, aWindow, aVideoMode, aWindowTitle, aStyle, aResult);
+    }
+
+    void software_renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, i_native_window& aParent, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
+    {
+        if ((aWindow.style() & window_style::Nested) == window_style::Nested)
+        {
+            neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
+            aResult = make_ref<virtual_window>(*this, aSurfaceManager, aWindow, aParent, aDimensions, aWindowTitle, aStyle);
+            auto newSurface = make_ref<virtual_surface>(*this, aWindow);
+            aResult->attach(*newSurface);
+        }
+        else
+            create_window(aSurfaceManager, aWindow, aDimensions, aWindowTitle, aStyle, aResult);
+    }
+
+    void software_renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, i_native_window& aParent, const point& aPosition, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
+    {
+        if ((aWindow.style() & window_style::Nested) == window_style::Nested)
+        {
+            neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
+            aResult = make_ref<virtual_window>(*this, aSurfaceManager, aWindow, aParent, aPosition, aDimensions, aWindowTitle, aStyle);
+            auto newSurface = make_ref<virtual_surface>(*this, aWindow);
+            aResult->attach(*newSurface);
+        }
+        else
+            create_window(aSurfaceManager, aWindow, aPosition, aDimensions, aWindowTitle, aStyle, aResult);
+    }
+
+    bool software_renderer::creating_window() const
+    {
+        return iCreatingWindow != 0;
+    }
+
+    i_font_manager& software_renderer::font_manager()
+    {
+        if (iFontManager == std::nullopt)
+            iFontManager.emplace();
+        return *iFontManager;
+    }
+
+    i_texture_manager& software_renderer::texture_manager()
+    {
+        if (iTextureManager == std::nullopt)
+            iTextureManager.emplace();
+        return *iTextureManager;
+    }
+
+    bool software_renderer::vertex_buffer_allocated(i_vertex_provider&) const
+    {
+        return false;
+    }
+
+    i_vertex_buffer& software_renderer::allocate_vertex_buffer(i_vertex_provider&, vertex_buffer_type)
+    {
+        // Software rendering contexts rasterize meshes directly from the operation queue
+        throw no_vertex_buffers();
+    }
+
+    void software_renderer::deallocate_vertex_buffer(i_vertex_provider&)
+    {
+        throw consumer_not_found();
+    }
+
+    const i_vertex_buffer& software_renderer::vertex_buffer(i_vertex_provider&) const
+    {
+        throw consumer_not_found();
+    }
+
+    i_vertex_buffer& software_renderer::vertex_buffer(i_vertex_provider&)
+    {
+        throw consumer_not_found();
+    }
+
+    void software_renderer::execute_vertex_buffers()
+    {
+    }
+
+    i_texture& software_renderer::ping_pong_buffer1(const size& aExtents, size& aPreviousExtents, texture_sampling aSampling)
+    {
+        if (!iPingPongBuffer1s)
+            iPingPongBuffer1s.emplace();
+        return create_ping_pong_buffer(*iPingPongBuffer1s, aExtents, aPreviousExtents, aSampling);
+    }
+
+    i_texture& software_renderer::ping_pong_buffer2(const size& aExtents, size& aPreviousExtents, texture_sampling aSampling)
+    {
+        if (!iPingPongBuffer2s)
+            iPingPongBuffer2s.emplace();
+        return create_ping_pong_buffer(*iPingPongBuffer2s, aExtents, aPreviousExtents, aSampling);
+    }
+
+    bool software_renderer::is_subpixel_rendering_on() const
+    {
+        return iSubpixelRendering;
+    }
+
+    void software_renderer::subpixel_rendering_on()
+    {
+        if (!iSubpixelRendering)
+        {
+            iSubpixelRendering = true;
+            SubpixelRenderingChanged();
+        }
+    }
+
+    void software_renderer::subpixel_rendering_off()
+    {
+        if (iSubpixelRendering)
+        {
+            iSubpixelRendering = false;
+            SubpixelRenderingChanged();
+        }
+    }
+
+    bool software_renderer::operation_reordering_enabled() const
+    {
+        return iOperationReordering;
+    }
+
+    void software_renderer::enable_operation_reordering(bool aEnable)
+    {
+        iOperationReordering = aEnable;
+    }
+
+    bool software_renderer::instanced_shapes_enabled() const
+    {
+        return iInstancedShapes;
+    }
+
+    std::uint32_t software_renderer::draw_calls_saved() const
+    {
+        return iStatistics.drawCallsSaved;
+    }
+
+    void software_renderer::add_draw_calls_saved(std::uint32_t aDrawCalls)
+    {
+        iFrameStatistics.drawCallsSaved += aDrawCalls;
+    }
+
+    void software_renderer::enable_instanced_shapes(bool aEnable)
+    {
+        iInstancedShapes = aEnable;
+    }
+
+    bool software_renderer::parallel_mesh_generation_enabled() const
+    {
+        return iParallelMeshGeneration;
+    }
+
+    void software_renderer::enable_parallel_mesh_generation(bool aEnable)
+    {
+        iParallelMeshGeneration = aEnable;
+    }
+
+    std::uint64_t software_renderer::texture_upload_budget() const
+    {
+        return iTextureUploadBudget;
+    }
+
+    void software_renderer::set_texture_upload_budget(std::uint64_t aBytesPerFrame)
+    {
+        iTextureUploadBudget = aBytesPerFrame;
+    }
+
+    rendering_statistics const& software_renderer::statistics() const
+    {
+        return iStatistics;
+    }
+
+    rendering_statistics& software_renderer::frame_statistics()
+    {
+        return iFrameStatistics;
+    }
+
+    void software_renderer::render_now()
+    {
+        service<i_font_manager>().upload_prefetched_glyphs();
+        service<i_surface_manager>().render_surfaces();
+        end_frame();
+    }
+
+    bool software_renderer::frame_rate_limited() const
+    {
+        return iLimitFrameRate && neolib::service<neolib::i_power>().green_mode_active();
+    }
+
+    void software_renderer::enable_frame_rate_limiter(bool aEnable)
+    {
+        iLimitFrameRate = aEnable;
+    }
+
+    std::uint32_t software_renderer::frame_rate_limit() const
+    {
+        return iFrameRateLimit;
+    }
+
+    void software_renderer::set_frame_rate_limit(std::uint32_t aFps)
+    {
+        iFrameRateLimit = aFps;
+    }
+
+    bool software_renderer::use_rendering_priority() const
+    {
+        return false;
+    }
+
+    bool software_renderer::process_events()
+    {
+        bool didSome = false;
+        auto lastRenderTime = neolib::this_process::elapsed_ms();
+        bool finished = false;
+        while (!finished)
+        {
+            finished = true;
+            for (std::size_t s = 0; s < service<i_surface_manager>().surface_count(); ++s)
+            {
+                auto& surface = service<i_surface_manager>().surface(s);
+                scoped_units su{ surface, units::Pixels };
+                if (surface.has_native_surface() && surface.as_surface_window().native_window().pump_event())
+                {
+                    didSome = true;
+                    finished = false;
+                }
+            }
+            if (neolib::this_process::elapsed_ms() - lastRenderTime > 10)
+            {
+                lastRenderTime = neolib::this_process::elapsed_ms();
+                render_now();
+            }
+        }
+        return didSome;
+    }
+
+    void software_renderer::register_frame_counter(i_widget& aWidget, std::uint32_t aDuration)
+    {
+        auto iterFrameCounter = iFrameCounters.find(aDuration);
+        if (iterFrameCounter == iFrameCounters.end())
+            iterFrameCounter = iFrameCounters.emplace(aDuration, aDuration).first;
+        iterFrameCounter->second.add(aWidget);
+    }
+
+    void software_renderer::unregister_frame_counter(i_widget& aWidget, std::uint32_t aDuration)
+    {
+        auto iterFrameCounter = iFrameCounters.find(aDuration);
+        if (iterFrameCounter != iFrameCounters.end())
+            iterFrameCounter->second.remove(aWidget);
+    }
+
+    std::uint32_t software_renderer::frame_counter(std::uint32_t aDuration) const
+    {
+        auto iterFrameCounter = iFrameCounters.find(aDuration);
+        if (iterFrameCounter != iFrameCounters.end())
+            return iterFrameCounter->second.counter();
+        return 0;
+    }
+
+    i_texture& software_renderer::create_ping_pong_buffer(ping_pong_buffers_t& aBufferList, const size& aExtents, size& aPreviousExtents, texture_sampling aSampling)
+    {
+        auto existing = aBufferList.lower_bound(std::make_pair(aSampling, aExtents));
+        if (existing != aBufferList.end() && existing->first.first == aSampling && existing->first.second.greater_than_or_equal(aExtents))
+        {
+            aPreviousExtents = existing->second.second;
+            existing->second.second = aExtents;
+            return existing->second.first;
+        }
+        auto const sizeMultiple = 1024;
+        basic_size<std::int32_t> idealSize{ (((static_cast<std::int32_t>(aExtents.cx) - 1) / sizeMultiple) + 1) * sizeMultiple, (((static_cast<std::int32_t>(aExtents.cy) - 1) / sizeMultiple) + 1) * sizeMultiple };
+        auto newBuffer = aBufferList.emplace(std::make_pair(aSampling, idealSize), std::make_pair(texture{ idealSize, 1.0, aSampling }, aExtents)).first;
+        newBuffer->second.second = aExtents;
+        aPreviousExtents = idealSize;
+        return newBuffer->second.first;
+    }
+
+    void software_renderer::end_frame()
+    {
+        iStatistics = iFrameStatistics;
+        iFrameStatistics = {};
+        iFrameStatistics.frame = iStatistics.frame + 1ull;
+    }
+}
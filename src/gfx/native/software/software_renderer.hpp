@@ -0,0 +1,165 @@
+// software_renderer.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2023 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <map>
+
+#include <neogfx/gfx/i_rendering_engine.hpp>
+#include <neogfx/gfx/text/font_manager.hpp>
+#include <neogfx/gfx/i_standard_shader_program.hpp>
+#include "software_texture_manager.hpp"
+#include "../frame_counter.hpp"
+
+namespace neogfx
+{
+    // A platform neutral rendering engine that needs no GPU: textures live in system memory, rendering
+    // contexts rasterize on the CPU and every top level window is a headless window whose frames can be
+    // read back with snapshot(). Nothing is presented to a display.
+    class software_renderer : public i_rendering_engine
+    {
+        // events
+    public:
+        define_declared_event(SubpixelRenderingChanged, subpixel_rendering_changed)
+        // exceptions
+    public:
+        struct virtual_surface_must_have_parent : std::logic_error { virtual_surface_must_have_parent() : std::logic_error("neogfx::software_renderer::virtual_surface_must_have_parent") {} };
+        struct virtual_surface_cannot_be_fullscreen : std::logic_error { virtual_surface_cannot_be_fullscreen() : std::logic_error("neogfx::software_renderer::virtual_surface_cannot_be_fullscreen") {} };
+        struct no_target_active : std::logic_error { no_target_active() : std::logic_error("neogfx::software_renderer::no_target_active") {} };
+        struct no_vertex_buffers : std::logic_error { no_vertex_buffers() : std::logic_error("neogfx::software_renderer::no_vertex_buffers") {} };
+        // types
+    public:
+        typedef neolib::vector<neolib::ref_ptr<i_shader_program>> shader_program_list;
+        typedef std::map<std::pair<texture_sampling, size>, std::pair<texture, size>> ping_pong_buffers_t;
+        // construction
+    public:
+        software_renderer(neogfx::renderer aRenderer);
+        ~software_renderer();
+    public:
+        const i_device_metrics& default_screen_metrics() const override;
+    public:
+        neogfx::renderer renderer() const override;
+        bool vsync_enabled() const override;
+        void enable_vsync() override;
+        void disable_vsync() override;
+        void initialize() override;
+        void cleanup() override;
+        pixel_format_t set_pixel_format(const i_render_target& aTarget) override;
+        bool preserves_back_buffer(const i_render_target& aTarget) const override;
+        const i_render_target* active_target() const override;
+        void activate_context(const i_render_target& aTarget) override;
+        void deactivate_context() override;
+        handle create_context(const i_render_target& aTarget) override;
+        void destroy_context(handle aContext) override;
+    public:
+        const shader_program_list& shader_programs() const override;
+        const i_shader_program& shader_program(const neolib::i_string& aName) const override;
+        i_shader_program& shader_program(const neolib::i_string& aName) override;
+        i_shader_program& add_shader_program(const neolib::i_ref_ptr<i_shader_program>& aShaderProgram) override;
+        bool is_shader_program_active() const override;
+        i_shader_program& active_shader_program() override;
+    public:
+        const i_standard_shader_program& default_shader_program() const override;
+        i_standard_shader_program& default_shader_program() override;
+    public:
+        handle create_shader_program_object() override;
+        void destroy_shader_program_object(handle aShaderProgramObject) override;
+        handle create_shader_object(shader_type aShaderType) override;
+        void destroy_shader_object(handle aShaderObject) override;
+    public:
+        void create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const video_mode& aVideoMode, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult) override;
+        void create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult) override;
+        void create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const point& aPosition, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult) override;
+        void create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, i_native_window& aParent, const video_mode& aVideoMode, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult) override;
+        void create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, i_native_window& aParent, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult) override;
+        void create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, i_native_window& aParent, const point& aPosition, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult) override;
+        bool creating_window() const override;
+    public:
+        i_font_manager& font_manager() override;
+        i_texture_manager& texture_manager() override;
+    public:
+        bool vertex_buffer_allocated(i_vertex_provider& aProvider) const override;
+        i_vertex_buffer& allocate_vertex_buffer(i_vertex_provider& aProvider, vertex_buffer_type aType = vertex_buffer_type::Default) override;
+        void deallocate_vertex_buffer(i_vertex_provider& aProvider) override;
+        const i_vertex_buffer& vertex_buffer(i_vertex_provider& aProvider) const override;
+        i_vertex_buffer& vertex_buffer(i_vertex_provider& aProvider) override;
+        void execute_vertex_buffers() override;
+    public:
+        i_texture& ping_pong_buffer1(const size& aExtents, size& aPreviousExtents, texture_sampling aSampling = texture_sampling::Multisample) override;
+        i_texture& ping_pong_buffer2(const size& aExtents, size& aPreviousExtents, texture_sampling aSampling = texture_sampling::Multisample) override;
+    public:
+        bool is_subpixel_rendering_on() const override;
+        void subpixel_rendering_on() override;
+        void subpixel_rendering_off() override;
+        bool operation_reordering_enabled() const override;
+        void enable_operation_reordering(bool aEnable) override;
+        bool instanced_shapes_enabled() const override;
+        std::uint32_t draw_calls_saved() const override;
+        void add_draw_calls_saved(std::uint32_t aDrawCalls) override;
+        void enable_instanced_shapes(bool aEnable) override;
+        bool parallel_mesh_generation_enabled() const override;
+        void enable_parallel_mesh_generation(bool aEnable) override;
+        std::uint64_t texture_upload_budget() const override;
+        void set_texture_upload_budget(std::uint64_t aBytesPerFrame) override;
+    public:
+        rendering_statistics const& statistics() const override;
+        rendering_statistics& frame_statistics() override;
+    public:
+        void render_now() override;
+        bool frame_rate_limited() const override;
+        void enable_frame_rate_limiter(bool aEnable) override;
+        std::uint32_t frame_rate_limit() const override;
+        void set_frame_rate_limit(std::uint32_t aFps) override;
+        bool use_rendering_priority() const override;
+    public:
+        bool process_events() override;
+    public:
+        void register_frame_counter(i_widget& aWidget, std::uint32_t aDuration) override;
+        void unregister_frame_counter(i_widget& aWidget, std::uint32_t aDuration) override;
+        std::uint32_t frame_counter(std::uint32_t aDuration) const override;
+    private:
+        i_texture& create_ping_pong_buffer(ping_pong_buffers_t& aBufferList, const size& aExtents, size& aPreviousExtents, texture_sampling aSampling);
+        void end_frame();
+    private:
+        neogfx::renderer iRenderer;
+        bool iInitialized;
+        bool iVsyncEnabled;
+        std::uint32_t iCreatingWindow;
+        std::vector<const i_render_target*> iTargetStack;
+        std::uintptr_t iNextObjectHandle;
+        mutable std::optional<software_texture_manager> iTextureManager;
+        mutable std::optional<neogfx::font_manager> iFontManager;
+        mutable shader_program_list iShaderPrograms;
+        bool iLimitFrameRate;
+        std::uint32_t iFrameRateLimit;
+        bool iSubpixelRendering;
+        bool iOperationReordering;
+        bool iInstancedShapes;
+        bool iParallelMeshGeneration;
+        std::uint64_t iTextureUploadBudget;
+        rendering_statistics iStatistics;
+        rendering_statistics iFrameStatistics;
+        std::map<std::uint32_t, neogfx::frame_counter> iFrameCounters;
+        mutable std::optional<ping_pong_buffers_t> iPingPongBuffer1s;
+        mutable std::optional<ping_pong_buffers_t> iPingPongBuffer2s;
+        ref_ptr<i_standard_shader_program> iDefaultShaderProgram;
+    };
+}
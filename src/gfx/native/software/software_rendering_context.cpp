@@ -0,0 +1,1046 @@
+// software_rendering_context.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <chrono>
+#include <cmath>
+
+#include <neogfx/gfx/gradient.hpp>
+#include <neogfx/gfx/i_render_target.hpp>
+#include <neogfx/gfx/i_texture_manager.hpp>
+#include <neogfx/gfx/i_sub_texture.hpp>
+#include <neogfx/gfx/text/glyph_text.hpp>
+#include <neogfx/gfx/text/i_glyph.hpp>
+#include <neogfx/gfx/text/i_font_manager.hpp>
+#include <neogfx/gfx/text/i_emoji_atlas.hpp>
+#include <neogfx/gui/widget/i_widget.hpp>
+#include <neogfx/game/ecs_helpers.hpp>
+#include "../../text/native/i_native_font_face.hpp"
+#include "software_texture.hpp"
+#include "software_rendering_context.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        // number of line segments used to approximate curves (arcs and bezier curves)
+        std::uint32_t constexpr CurveSegments = 64u;
+
+        std::uint32_t premultiplied(const color& aColor, double aOpacity)
+        {
+            auto const rgba = aColor.as<float>();
+            float const alpha = std::clamp(rgba[3] * static_cast<float>(aOpacity), 0.0f, 1.0f);
+            auto channel = [&](float aValue)
+            {
+                return static_cast<std::uint32_t>(std::clamp(aValue, 0.0f, 1.0f) * 255.0f + 0.5f);
+            };
+            return channel(rgba[0] * alpha) | (channel(rgba[1] * alpha) << 8u) | (channel(rgba[2] * alpha) << 16u) | (channel(alpha) << 24u);
+        }
+
+        rect bounding_rect(const std::vector<vec2f>& aPoints)
+        {
+            if (aPoints.empty())
+                return rect{};
+            vec2f minimum = aPoints[0];
+            vec2f maximum = aPoints[0];
+            for (auto const& p : aPoints)
+            {
+                minimum.x = std::min(minimum.x, p.x);
+                minimum.y = std::min(minimum.y, p.y);
+                maximum.x = std::max(maximum.x, p.x);
+                maximum.y = std::max(maximum.y, p.y);
+            }
+            return rect{ point{ minimum.x, minimum.y }, point{ maximum.x, maximum.y } };
+        }
+
+        std::vector<software_rasterizer::vertex> to_vertices(const std::vector<vec2f>& aPoints)
+        {
+            std::vector<software_rasterizer::vertex> result;
+            result.reserve(aPoints.size());
+            for (auto const& p : aPoints)
+                result.push_back(software_rasterizer::vertex{ p.x, p.y });
+            return result;
+        }
+
+        software_rasterizer::texture_effect to_texture_effect(shader_effect aEffect)
+        {
+            switch (aEffect)
+            {
+            case shader_effect::None:
+            case shader_effect::Filter:
+            default:
+                return software_rasterizer::texture_effect::Modulate;
+            case shader_effect::Colorize:
+                return software_rasterizer::texture_effect::Colorize;
+            case shader_effect::ColorizeMaximum:
+                return software_rasterizer::texture_effect::ColorizeMaximum;
+            case shader_effect::ColorizeSpot:
+            case shader_effect::Ignore: // the glyph shader takes coverage from the texture and colour from the vertex
+                return software_rasterizer::texture_effect::ColorizeSpot;
+            case shader_effect::ColorizeAlpha:
+                return software_rasterizer::texture_effect::ColorizeAlpha;
+            case shader_effect::Monochrome:
+                return software_rasterizer::texture_effect::Monochrome;
+            }
+        }
+
+        // Solves for the affine map from device position to texel position that passes through the three
+        // vertices of a triangle.
+        std::optional<std::array<float, 6>> uv_transformation(const std::array<vec2f, 3>& aPositions, const std::array<vec2f, 3>& aTexels)
+        {
+            float const x10 = aPositions[1].x - aPositions[0].x;
+            float const y10 = aPositions[1].y - aPositions[0].y;
+            float const x20 = aPositions[2].x - aPositions[0].x;
+            float const y20 = aPositions[2].y - aPositions[0].y;
+            float const determinant = x10 * y20 - x20 * y10;
+            if (determinant == 0.0f)
+                return {};
+            std::array<float, 6> result;
+            for (std::size_t component = 0u; component < 2u; ++component)
+            {
+                float const t0 = aTexels[0][component];
+                float const t10 = aTexels[1][component] - t0;
+                float const t20 = aTexels[2][component] - t0;
+                float const a = (t10 * y20 - t20 * y10) / determinant;
+                float const b = (t20 * x10 - t10 * x20) / determinant;
+                result[component * 3u + 0u] = a;
+                result[component * 3u + 1u] = b;
+                result[component * 3u + 2u] = t0 - a * aPositions[0].x - b * aPositions[0].y;
+            }
+            return result;
+        }
+    }
+
+    software_rendering_context::software_rendering_context(const i_render_target& aTarget, software_bitmap& aBitmap) :
+        iRenderingEngine{ service<i_rendering_engine>() },
+        iTarget{ aTarget },
+        iBitmap{ aBitmap },
+        iInFlush{ false },
+        iRecording{ nullptr },
+        iOpacity{ 1.0 },
+        iReplayOpacity{ 1.0 },
+        iSnapToPixel{ false }
+    {
+        iSink += render_target().target_deactivating([&]()
+        {
+            flush();
+        });
+    }
+
+    software_rendering_context::software_rendering_context(const i_render_target& aTarget, const i_widget& aWidget, software_bitmap& aBitmap) :
+        iRenderingEngine{ service<i_rendering_engine>() },
+        iTarget{ aTarget },
+        iBitmap{ aBitmap },
+        iInFlush{ false },
+        iRecording{ nullptr },
+        iLogicalCoordinateSystem{ aWidget.logical_coordinate_system() },
+        iOpacity{ 1.0 },
+        iReplayOpacity{ 1.0 },
+        iSnapToPixel{ false }
+    {
+        iSink += render_target().target_deactivating([&]()
+        {
+            flush();
+        });
+    }
+
+    software_rendering_context::software_rendering_context(const software_rendering_context& aOther) :
+        iRenderingEngine{ aOther.iRenderingEngine },
+        iTarget{ aOther.iTarget },
+        iBitmap{ aOther.iBitmap },
+        iInFlush{ false },
+        iRecording{ nullptr },
+        iLogicalCoordinateSystem{ aOther.iLogicalCoordinateSystem },
+        iLogicalCoordinates{ aOther.iLogicalCoordinates },
+        iOpacity{ 1.0 },
+        iReplayOpacity{ 1.0 },
+        iSnapToPixel{ false }
+    {
+        iSink += render_target().target_deactivating([&]()
+        {
+            flush();
+        });
+    }
+
+    software_rendering_context::~software_rendering_context()
+    {
+    }
+
+    std::unique_ptr<i_rendering_context> software_rendering_context::clone() const
+    {
+        return std::unique_ptr<i_rendering_context>(new software_rendering_context(*this));
+    }
+
+    i_rendering_engine& software_rendering_context::rendering_engine() const
+    {
+        return iRenderingEngine;
+    }
+
+    const i_render_target& software_rendering_context::render_target() const
+    {
+        return iTarget;
+    }
+
+    rect software_rendering_context::rendering_area(bool aConsiderScissor) const
+    {
+        rect result{ render_target().target_origin(), render_target().target_extents() };
+        if (aConsiderScissor)
+            for (auto const& scissorRect : iScissorRects)
+                result = result.intersection(scissorRect);
+        return result;
+    }
+
+    graphics_operation::queue& software_rendering_context::queue() const
+    {
+        return static_cast<graphics_operation::queue&>(iTarget.graphics_operation_queue());
+    }
+
+    void software_rendering_context::enqueue(const graphics_operation::operation& aOperation)
+    {
+        if (iRecording)
+            iRecording->push_back(aOperation);
+        else
+            queue().push_back(aOperation);
+    }
+
+    void software_rendering_context::flush()
+    {
+        if (iInFlush)
+            return;
+
+        neolib::scoped_flag sf{ iInFlush };
+
+        if (queue().empty())
+            return;
+
+        auto const flushStart = std::chrono::steady_clock::now();
+        auto& statistics = rendering_engine().frame_statistics();
+        ++statistics.flushes;
+        statistics.queueLength += queue().size();
+
+        apply_scissor();
+        for (auto const& op : queue())
+            execute(op);
+        queue().clear();
+        execute_primitives();
+
+        statistics.flushTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - flushStart);
+    }
+
+    void software_rendering_context::begin_recording(graphics_operation::recording& aRecording)
+    {
+        iRecording = &aRecording;
+    }
+
+    void software_rendering_context::end_recording()
+    {
+        if (iRecording == nullptr)
+            return;
+        // batching has no effect on the software rasterizer so there is nothing to gain by reordering
+        iRecording->compile(false);
+        iRecording = nullptr;
+    }
+
+    void software_rendering_context::replay(const graphics_operation::recording& aRecording, const vec2& aOffset, double aOpacity)
+    {
+        if (aRecording.empty())
+            return;
+
+        flush();
+
+        neolib::scoped_flag sf{ iInFlush };
+
+        auto const replayStart = std::chrono::steady_clock::now();
+        auto& statistics = rendering_engine().frame_statistics();
+        ++statistics.flushes;
+        statistics.queueLength += aRecording.operations().size();
+
+        auto const previousOffset = iOffset;
+        auto const previousOpacity = iOpacity;
+        iOffset = iOffset.value_or(vec2{}) + aOffset;
+        iReplayOffset = aOffset;
+        iReplayOpacity = aOpacity;
+        iOpacity *= aOpacity;
+
+        apply_scissor();
+        for (auto const& op : aRecording.operations())
+            execute(op);
+        execute_primitives();
+
+        iOffset = previousOffset;
+        iReplayOffset = vec2{};
+        iReplayOpacity = 1.0;
+        iOpacity = previousOpacity;
+
+        statistics.flushTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - replayStart);
+    }
+
+    neogfx::logical_coordinate_system software_rendering_context::logical_coordinate_system() const
+    {
+        if (iLogicalCoordinateSystem != std::nullopt)
+            return *iLogicalCoordinateSystem;
+        return render_target().logical_coordinate_system();
+    }
+
+    neogfx::logical_coordinates software_rendering_context::logical_coordinates() const
+    {
+        if (iLogicalCoordinates != std::nullopt)
+            return *iLogicalCoordinates;
+        auto result = render_target().logical_coordinates();
+        if (logical_coordinate_system() != render_target().logical_coordinate_system())
+        {
+            switch (logical_coordinate_system())
+            {
+            case neogfx::logical_coordinate_system::Specified:
+                break;
+            case neogfx::logical_coordinate_system::AutomaticGame:
+                if (render_target().logical_coordinate_system() == neogfx::logical_coordinate_system::AutomaticGui)
+                    std::swap(result.bottomLeft.y, result.topRight.y);
+                break;
+            case neogfx::logical_coordinate_system::AutomaticGui:
+                std::swap(result.bottomLeft.y, result.topRight.y);
+                break;
+            }
+        }
+        return result;
+    }
+
+    vec2 software_rendering_context::offset() const
+    {
+        return iOffset.value_or(vec2{}) + (iSnapToPixel ? 0.5 : 0.0);
+    }
+
+    void software_rendering_context::set_offset(const optional_vec2& aOffset)
+    {
+        iOffset = aOffset;
+    }
+
+    bool software_rendering_context::gradient_set() const
+    {
+        return false;
+    }
+
+    void software_rendering_context::apply_gradient(i_gradient_shader&)
+    {
+        // gradients are evaluated by the rasterizer, not by shaders
+    }
+
+    neogfx::subpixel_format software_rendering_context::subpixel_format() const
+    {
+        return neogfx::subpixel_format::None;
+    }
+
+    void software_rendering_context::execute(const graphics_operation::operation& aOperation)
+    {
+        switch (aOperation.index())
+        {
+        case graphics_operation::operation_type::SetLogicalCoordinateSystem:
+            iLogicalCoordinateSystem = static_variant_cast<const graphics_operation::set_logical_coordinate_system&>(aOperation).system;
+            break;
+        case graphics_operation::operation_type::SetLogicalCoordinates:
+            iLogicalCoordinates = static_variant_cast<const graphics_operation::set_logical_coordinates&>(aOperation).coordinates;
+            break;
+        case graphics_operation::operation_type::ScissorOn:
+            scissor_on(static_variant_cast<const graphics_operation::scissor_on&>(aOperation).rect.translated(point{ iReplayOffset }));
+            break;
+        case graphics_operation::operation_type::ScissorOff:
+            scissor_off();
+            break;
+        case graphics_operation::operation_type::SnapToPixelOn:
+            iSnapToPixel = true;
+            break;
+        case graphics_operation::operation_type::SnapToPixelOff:
+            iSnapToPixel = false;
+            break;
+        case graphics_operation::operation_type::SetOpacity:
+            iOpacity = static_variant_cast<const graphics_operation::set_opacity&>(aOperation).opacity * iReplayOpacity;
+            break;
+        case graphics_operation::operation_type::Clear:
+            iRasterizer.clear(premultiplied(static_variant_cast<const graphics_operation::clear&>(aOperation).color, 1.0));
+            break;
+        case graphics_operation::operation_type::SetPixel:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::set_pixel&>(aOperation);
+                auto const p = to_device(args.point);
+                iRasterizer.fill_rect(std::floor(p.x), std::floor(p.y), std::floor(p.x) + 1.0f, std::floor(p.y) + 1.0f, to_paint(args.color));
+            }
+            break;
+        case graphics_operation::operation_type::DrawPixel:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_pixel&>(aOperation);
+                auto const p = to_device(args.point);
+                iRasterizer.fill_rect(std::floor(p.x), std::floor(p.y), std::floor(p.x) + 1.0f, std::floor(p.y) + 1.0f, to_paint(args.color));
+            }
+            break;
+        case graphics_operation::operation_type::DrawLine:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_line&>(aOperation);
+                draw_polyline({ to_device(args.from), to_device(args.to) }, false, args.pen);
+            }
+            break;
+        case graphics_operation::operation_type::DrawTriangle:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_triangle&>(aOperation);
+                std::vector<vec2f> const points{ to_device(args.p0), to_device(args.p1), to_device(args.p2) };
+                fill_polygon(points, args.fill);
+                draw_polyline(points, true, args.pen);
+            }
+            break;
+        case graphics_operation::operation_type::DrawRect:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_rect&>(aOperation);
+                auto const r = to_device(args.rect);
+                iRasterizer.fill_rect(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()), to_paint(args.fill, r));
+                if (has_outline(args.pen))
+                    iRasterizer.stroke_rounded_rect(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()),
+                        {}, static_cast<float>(args.pen.width()), to_paint(args.pen.color(), r));
+            }
+            break;
+        case graphics_operation::operation_type::DrawRoundedRect:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_rounded_rect&>(aOperation);
+                auto const r = to_device(args.rect);
+                std::array<float, 4> const radii{ static_cast<float>(args.radius[0]), static_cast<float>(args.radius[1]), static_cast<float>(args.radius[2]), static_cast<float>(args.radius[3]) };
+                iRasterizer.fill_rounded_rect(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()), radii, to_paint(args.fill, r));
+                if (has_outline(args.pen))
+                    iRasterizer.stroke_rounded_rect(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()),
+                        radii, static_cast<float>(args.pen.width()), to_paint(args.pen.color(), r));
+            }
+            break;
+        case graphics_operation::operation_type::DrawEllipseRect:
+            {
+                // elliptical corners are approximated by circular ones
+                auto const& args = static_variant_cast<const graphics_operation::draw_ellipse_rect&>(aOperation);
+                auto const r = to_device(args.rect);
+                std::array<float, 4> radii;
+                for (std::size_t corner = 0u; corner < radii.size(); ++corner)
+                    radii[corner] = static_cast<float>(std::min(args.radiusX[corner], args.radiusY[corner]));
+                iRasterizer.fill_rounded_rect(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()), radii, to_paint(args.fill, r));
+                if (has_outline(args.pen))
+                    iRasterizer.stroke_rounded_rect(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()),
+                        radii, static_cast<float>(args.pen.width()), to_paint(args.pen.color(), r));
+            }
+            break;
+        case graphics_operation::operation_type::DrawCheckerboard:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_checkerboard&>(aOperation);
+                auto const r = to_device(args.rect);
+                iRasterizer.fill_checkerboard(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()),
+                    static_cast<float>(args.squareSize.cx), to_paint(args.fill1, r), to_paint(args.fill2, r));
+                if (has_outline(args.pen))
+                    iRasterizer.stroke_rounded_rect(static_cast<float>(r.left()), static_cast<float>(r.top()), static_cast<float>(r.right()), static_cast<float>(r.bottom()),
+                        {}, static_cast<float>(args.pen.width()), to_paint(args.pen.color(), r));
+            }
+            break;
+        case graphics_operation::operation_type::DrawCircle:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_circle&>(aOperation);
+                auto const c = to_device(args.center);
+                auto const radius = static_cast<float>(args.radius);
+                rect const r{ point{ c.x - radius, c.y - radius }, point{ c.x + radius, c.y + radius } };
+                iRasterizer.fill_ellipse(c.x, c.y, radius, radius, to_paint(args.fill, r));
+                if (has_outline(args.pen))
+                    iRasterizer.stroke_ellipse(c.x, c.y, radius, radius, static_cast<float>(args.pen.width()), to_paint(args.pen.color(), r));
+            }
+            break;
+        case graphics_operation::operation_type::DrawEllipse:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_ellipse&>(aOperation);
+                auto const c = to_device(args.center);
+                auto const radiusA = static_cast<float>(args.radiusA);
+                auto const radiusB = static_cast<float>(args.radiusB);
+                rect const r{ point{ c.x - radiusA, c.y - radiusB }, point{ c.x + radiusA, c.y + radiusB } };
+                iRasterizer.fill_ellipse(c.x, c.y, radiusA, radiusB, to_paint(args.fill, r));
+                if (has_outline(args.pen))
+                    iRasterizer.stroke_ellipse(c.x, c.y, radiusA, radiusB, static_cast<float>(args.pen.width()), to_paint(args.pen.color(), r));
+            }
+            break;
+        case graphics_operation::operation_type::DrawPie:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_pie&>(aOperation);
+                draw_arc(args.center, args.radius, args.startAngle, args.endAngle, args.pen, args.fill, true);
+            }
+            break;
+        case graphics_operation::operation_type::DrawArc:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_arc&>(aOperation);
+                draw_arc(args.center, args.radius, args.startAngle, args.endAngle, args.pen, args.fill, false);
+            }
+            break;
+        case graphics_operation::operation_type::DrawCubicBezier:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_cubic_bezier&>(aOperation);
+                auto const p0 = to_device(args.p0);
+                auto const p1 = to_device(args.p1);
+                auto const p2 = to_device(args.p2);
+                auto const p3 = to_device(args.p3);
+                std::vector<vec2f> points;
+                for (std::uint32_t segment = 0u; segment <= CurveSegments; ++segment)
+                {
+                    float const t = static_cast<float>(segment) / CurveSegments;
+                    float const u = 1.0f - t;
+                    points.push_back(p0 * (u * u * u) + p1 * (3.0f * u * u * t) + p2 * (3.0f * u * t * t) + p3 * (t * t * t));
+                }
+                draw_polyline(points, false, args.pen);
+            }
+            break;
+        case graphics_operation::operation_type::DrawShape:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_shape&>(aOperation);
+                mat44 const translation{ { 1.0, 0.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0, 0.0 }, { 0.0, 0.0, 1.0, 0.0 }, { args.position.x, args.position.y, args.position.z, 1.0 } };
+                draw_mesh(args.mesh, translation, args.fill, args.pen);
+            }
+            break;
+        case graphics_operation::operation_type::DrawPath:
+            draw_path(static_variant_cast<const graphics_operation::draw_path&>(aOperation));
+            break;
+        case graphics_operation::operation_type::DrawGlyph:
+            draw_glyphs(static_variant_cast<const graphics_operation::draw_glyphs&>(aOperation));
+            break;
+        case graphics_operation::operation_type::DrawMesh:
+            {
+                auto const& args = static_variant_cast<const graphics_operation::draw_mesh&>(aOperation);
+                draw_mesh(args.mesh, args.material, args.transformation);
+            }
+            break;
+        default:
+            // pipeline state (viewports, blending, smoothing, logical operations, stipples, subpixel
+            // rendering and depth/stencil buffers) has no software equivalent and entities are rendered
+            // through vertex buffers
+            break;
+        }
+    }
+
+    void software_rendering_context::scissor_on(const rect& aRect)
+    {
+        iScissorRects.push_back(aRect);
+        apply_scissor();
+    }
+
+    void software_rendering_context::scissor_off()
+    {
+        if (!iScissorRects.empty())
+            iScissorRects.pop_back();
+        apply_scissor();
+    }
+
+    void software_rendering_context::apply_scissor()
+    {
+        // the clip always includes the target area as a texture target only covers part of its bitmap
+        auto clip = rendering_area();
+        if (!logical_coordinates().is_gui_orientation())
+            clip = rect{ point{ clip.left(), render_target().target_extents().cy - clip.bottom() }, clip.extents() };
+        auto const origin = device_origin();
+        iRasterizer.set_clip(software_rasterizer::clip_rect{
+            static_cast<std::int32_t>(std::ceil(origin.x + clip.left())),
+            static_cast<std::int32_t>(std::ceil(origin.y + clip.top())),
+            static_cast<std::int32_t>(std::ceil(origin.x + clip.right())),
+            static_cast<std::int32_t>(std::ceil(origin.y + clip.bottom())) });
+    }
+
+    void software_rendering_context::execute_primitives()
+    {
+        iRasterizer.execute(iBitmap);
+        iTextureSources.clear();
+        iTextureCopies.clear();
+    }
+
+    vec2f software_rendering_context::device_origin() const
+    {
+        // a texture's extents occupy the top of its storage, inside the border (see software_texture)
+        if (render_target().target_type() != render_target_type::Texture)
+            return vec2f{};
+        auto const targetTexture = dynamic_cast<const software_texture*>(&render_target().target_texture().native_texture());
+        if (targetTexture == nullptr)
+            return vec2f{};
+        auto const border = targetTexture->border();
+        return vec2f{
+            static_cast<float>(border.x),
+            static_cast<float>(targetTexture->storage_extents().cy - border.y - targetTexture->extents().cy) };
+    }
+
+    vec2f software_rendering_context::to_device(const point& aPoint) const
+    {
+        auto const translated = aPoint.to_vec2() + offset();
+        auto const origin = device_origin();
+        if (logical_coordinates().is_gui_orientation())
+            return origin + vec2f{ static_cast<float>(translated.x), static_cast<float>(translated.y) };
+        return origin + vec2f{ static_cast<float>(translated.x), static_cast<float>(render_target().target_extents().cy - translated.y) };
+    }
+
+    rect software_rendering_context::to_device(const rect& aRect) const
+    {
+        return bounding_rect({ to_device(aRect.top_left()), to_device(aRect.bottom_right()) });
+    }
+
+    software_rasterizer::paint software_rendering_context::to_paint(const color& aColor) const
+    {
+        return software_rasterizer::paint{ premultiplied(aColor, iOpacity) };
+    }
+
+    software_rasterizer::paint software_rendering_context::to_paint(const color_or_gradient& aColor, const rect& aBoundingRect)
+    {
+        if (std::holds_alternative<color>(aColor))
+            return to_paint(static_variant_cast<const color&>(aColor));
+        if (!std::holds_alternative<gradient>(aColor))
+            return software_rasterizer::paint{};
+        auto const& colorGradient = static_variant_cast<const gradient&>(aColor);
+        software_rasterizer::ramp colorRamp;
+        for (std::size_t i = 0u; i < colorRamp.size(); ++i)
+            colorRamp[i] = premultiplied(colorGradient.at(static_cast<scalar>(i) / (colorRamp.size() - 1u)), iOpacity);
+        software_rasterizer::paint result;
+        result.ramp = iRasterizer.add_ramp(colorRamp);
+        result.originX = static_cast<float>(aBoundingRect.left());
+        result.originY = static_cast<float>(aBoundingRect.top());
+        float const width = std::max(static_cast<float>(aBoundingRect.cx), 1.0f);
+        float const height = std::max(static_cast<float>(aBoundingRect.cy), 1.0f);
+        switch (colorGradient.direction())
+        {
+        case gradient_direction::Vertical:
+        default:
+            result.axisY = 1.0f / height;
+            break;
+        case gradient_direction::Horizontal:
+            result.axisX = 1.0f / width;
+            break;
+        case gradient_direction::Diagonal:
+            result.axisX = width / (width * width + height * height);
+            result.axisY = height / (width * width + height * height);
+            break;
+        case gradient_direction::Rectangular:
+        case gradient_direction::Radial:
+            result.radial = true;
+            result.originX += width / 2.0f;
+            result.originY += height / 2.0f;
+            result.axisX = colorGradient.direction() == gradient_direction::Radial ? std::hypot(width, height) / 2.0f : std::max(width, height) / 2.0f;
+            break;
+        }
+        return result;
+    }
+
+    software_rasterizer::paint software_rendering_context::to_paint(const brush& aFill, const rect& aBoundingRect)
+    {
+        if (std::holds_alternative<color>(aFill))
+            return to_paint(static_variant_cast<const color&>(aFill));
+        if (std::holds_alternative<gradient>(aFill))
+            return to_paint(color_or_gradient{ static_variant_cast<const gradient&>(aFill) }, aBoundingRect);
+        // texture brushes are stretched over the bounding rect
+        if (std::holds_alternative<texture>(aFill))
+            return to_paint(static_variant_cast<const texture&>(aFill), {}, aBoundingRect);
+        if (std::holds_alternative<std::pair<texture, rect>>(aFill))
+        {
+            auto const& textureAndRect = static_variant_cast<const std::pair<texture, rect>&>(aFill);
+            return to_paint(textureAndRect.first, textureAndRect.second, aBoundingRect);
+        }
+        if (std::holds_alternative<sub_texture>(aFill))
+            return to_paint(static_variant_cast<const sub_texture&>(aFill), {}, aBoundingRect);
+        if (std::holds_alternative<std::pair<sub_texture, rect>>(aFill))
+        {
+            auto const& subTextureAndRect = static_variant_cast<const std::pair<sub_texture, rect>&>(aFill);
+            return to_paint(subTextureAndRect.first, subTextureAndRect.second, aBoundingRect);
+        }
+        return software_rasterizer::paint{};
+    }
+
+    software_rasterizer::paint software_rendering_context::to_paint(const i_texture& aTexture, const optional_rect& aTextureRect, const rect& aBoundingRect)
+    {
+        auto const source = texture_source(aTexture);
+        if (source == std::nullopt || aBoundingRect.cx <= 0.0 || aBoundingRect.cy <= 0.0)
+            return software_rasterizer::paint{};
+        // region of storage (GL texel coordinates, as the uv fixup in draw_mesh) covered by the brush
+        auto const& nativeTexture = aTexture.native_texture();
+        vec2f regionOrigin = aTexture.type() == texture_type::Texture ?
+            vec2f{ 1.0f, 1.0f } : aTexture.as_sub_texture().atlas_location().top_left().to_vec2().as<float>() + vec2f{ 1.0f, 1.0f };
+        vec2f regionExtents = aTexture.extents().to_vec2().as<float>();
+        if (aTextureRect != std::nullopt)
+        {
+            regionOrigin += aTextureRect->top_left().to_vec2().as<float>();
+            regionExtents = aTextureRect->extents().to_vec2().as<float>();
+        }
+        auto const storageHeight = static_cast<float>(nativeTexture.storage_extents().cy);
+        float const scaleX = regionExtents.x / static_cast<float>(aBoundingRect.cx);
+        float const scaleY = regionExtents.y / static_cast<float>(aBoundingRect.cy);
+        software_rasterizer::paint result{ premultiplied(color::White, iOpacity) };
+        result.texture = *source;
+        result.smooth = aTexture.sampling() != texture_sampling::Nearest && aTexture.sampling() != texture_sampling::Data;
+        // the top of the brush samples the top of the region, which is the bottom of the storage rows
+        result.uv = {
+            scaleX, 0.0f, regionOrigin.x - static_cast<float>(aBoundingRect.left()) * scaleX,
+            0.0f, scaleY, storageHeight - regionOrigin.y - regionExtents.y - static_cast<float>(aBoundingRect.top()) * scaleY };
+        return result;
+    }
+
+    std::optional<std::uint32_t> software_rendering_context::texture_source(const i_texture& aTexture)
+    {
+        auto const& nativeTexture = aTexture.native_texture();
+        auto existing = iTextureSources.find(&nativeTexture);
+        if (existing != iTextureSources.end())
+            return existing->second;
+        software_rasterizer::texture_source source;
+        if (auto const softwareTexture = dynamic_cast<const software_texture*>(&nativeTexture))
+        {
+            // a target cannot be sampled while it is being rendered to
+            if (&softwareTexture->bitmap() == &iBitmap)
+                return {};
+            source = { softwareTexture->bitmap().data(), softwareTexture->bitmap().width(), softwareTexture->bitmap().height() };
+        }
+        else
+        {
+            // a texture of another rendering engine: copy its texels into storage laid out as a
+            // software_texture's (rows top-down, one texel border unless sampling data)
+            auto const storageExtents = nativeTexture.storage_extents().as<std::int32_t>();
+            auto const extents = nativeTexture.extents().as<std::int32_t>();
+            std::int32_t const border = nativeTexture.sampling() != texture_sampling::Data ? 1 : 0;
+            if (storageExtents.cx <= 0 || storageExtents.cy <= 0)
+                return {};
+            auto& copy = iTextureCopies.emplace_back(storageExtents.cx, storageExtents.cy);
+            bool const red = nativeTexture.data_format() == texture_data_format::Red;
+            for (std::int32_t y = 0; y < extents.cy && y + border < storageExtents.cy; ++y)
+            {
+                auto const row = copy.row(storageExtents.cy - 1 - (y + border));
+                for (std::int32_t x = 0; x < extents.cx && x + border < storageExtents.cx; ++x)
+                {
+                    auto const texel = nativeTexture.read_pixel(point{ static_cast<scalar>(x), static_cast<scalar>(y) });
+                    row[x + border] = red ? texel.red() * 0x01010101u : premultiplied(texel, 1.0);
+                }
+            }
+            source = { copy.data(), copy.width(), copy.height() };
+        }
+        auto const result = iRasterizer.add_texture(source);
+        iTextureSources.emplace(&nativeTexture, result);
+        return result;
+    }
+
+    bool software_rendering_context::has_outline(const pen& aPen) const
+    {
+        return aPen.width() > 0.0 && aPen.style() != line_style::None && !std::holds_alternative<std::monostate>(aPen.color());
+    }
+
+    void software_rendering_context::draw_polyline(const std::vector<vec2f>& aPoints, bool aClosed, const pen& aPen)
+    {
+        if (!has_outline(aPen) || aPoints.size() < 2u)
+            return;
+        // one primitive for the whole polyline so translucent segments are not blended twice where they join
+        iRasterizer.draw_polyline(to_vertices(aPoints), aClosed && aPoints.size() > 2u, static_cast<float>(aPen.width()), to_paint(aPen.color(), bounding_rect(aPoints)));
+    }
+
+    void software_rendering_context::fill_polygon(const std::vector<vec2f>& aPoints, const brush& aFill)
+    {
+        if (aPoints.size() < 3u || std::holds_alternative<std::monostate>(aFill))
+            return;
+        // filled with the non-zero winding rule so concave outlines are correct
+        iRasterizer.fill_polygon(to_vertices(aPoints), to_paint(aFill, bounding_rect(aPoints)));
+    }
+
+    void software_rendering_context::draw_arc(const point& aCenter, dimension aRadius, angle aStartAngle, angle aEndAngle, const pen& aPen, const brush& aFill, bool aPie)
+    {
+        auto const center = to_device(aCenter);
+        auto const radius = static_cast<float>(aRadius);
+        std::vector<vec2f> points;
+        for (std::uint32_t segment = 0u; segment <= CurveSegments; ++segment)
+        {
+            auto const theta = aStartAngle + (aEndAngle - aStartAngle) * segment / CurveSegments;
+            points.push_back(vec2f{ center.x + radius * static_cast<float>(std::cos(theta)), center.y + radius * static_cast<float>(std::sin(theta)) });
+        }
+        if (aPie)
+            points.insert(points.begin(), center);
+        fill_polygon(points, aFill);
+        draw_polyline(points, aPie, aPen);
+    }
+
+    void software_rendering_context::draw_mesh(const game::mesh& aMesh, const mat44& aTransformation, const brush& aFill, const pen& aPen)
+    {
+        auto const transformation = aTransformation.as<float>();
+        std::vector<vec2f> points;
+        points.reserve(aMesh.vertices.size());
+        for (auto const& v : aMesh.vertices)
+        {
+            auto const xyz = transformation * v;
+            points.push_back(to_device(point{ xyz.x, xyz.y }));
+        }
+        if (!std::holds_alternative<std::monostate>(aFill))
+        {
+            if (aMesh.faces.empty())
+                fill_polygon(points, aFill);
+            else
+            {
+                auto const paint = to_paint(aFill, bounding_rect(points));
+                for (auto const& face : aMesh.faces)
+                    iRasterizer.fill_triangle(points[face[0]].x, points[face[0]].y, points[face[1]].x, points[face[1]].y, points[face[2]].x, points[face[2]].y, paint);
+            }
+        }
+        draw_polyline(points, true, aPen);
+    }
+
+    void software_rendering_context::draw_mesh(const game::mesh& aMesh, const game::material& aMaterial, const mat44& aTransformation)
+    {
+        brush fill;
+        if (aMaterial.gradient)
+            fill = *aMaterial.gradient;
+        else if (aMaterial.color)
+            fill = *aMaterial.color;
+        if (!aMaterial.texture && !aMaterial.sharedTexture)
+        {
+            draw_mesh(aMesh, aTransformation, fill, pen{});
+            return;
+        }
+        if (aMesh.faces.empty() || aMesh.uv.size() < aMesh.vertices.size())
+            return;
+
+        auto const& materialTexture = aMaterial.texture ? *aMaterial.texture : *aMaterial.sharedTexture->ptr;
+        auto const texture = service<i_texture_manager>().find_texture(materialTexture.id.cookie());
+        auto const source = texture_source(*texture);
+        if (source == std::nullopt)
+            return;
+
+        // the uv fixup of opengl_rendering_context::draw_meshes, in texels, then flipped as storage rows are held top-down
+        auto const textureStorageExtents = texture->storage_extents().to_vec2().as<float>();
+        auto const& uvFixupCoefficient = materialTexture.extents;
+        vec2f uvFixupOffset;
+        if (materialTexture.type == texture_type::Texture)
+            uvFixupOffset = vec2f{ 1.0f, 1.0f };
+        else if (materialTexture.subTexture == std::nullopt)
+            uvFixupOffset = texture->as_sub_texture().atlas_location().top_left().to_vec2().as<float>() + vec2f{ 1.0f, 1.0f };
+        else
+            uvFixupOffset = materialTexture.subTexture->min + vec2f{ 1.0f, 1.0f };
+        std::optional<float> uvGui;
+        if (texture->is_render_target() && texture->as_render_target().logical_coordinate_system() == neogfx::logical_coordinate_system::AutomaticGui)
+            uvGui = static_cast<float>(texture->extents().cy) / textureStorageExtents.y;
+
+        auto const transformation = aTransformation.as<float>();
+        std::vector<vec2f> points;
+        std::vector<vec2f> texels;
+        points.reserve(aMesh.vertices.size());
+        texels.reserve(aMesh.vertices.size());
+        for (std::size_t v = 0u; v < aMesh.vertices.size(); ++v)
+        {
+            auto const xyz = transformation * aMesh.vertices[v];
+            points.push_back(to_device(point{ xyz.x, xyz.y }));
+            auto uv = aMesh.uv[v].scale(uvFixupCoefficient) + uvFixupOffset;
+            if (uvGui)
+                uv.y = *uvGui * textureStorageExtents.y - uv.y;
+            texels.push_back(vec2f{ uv.x, textureStorageExtents.y - uv.y });
+        }
+
+        auto const boundingRect = bounding_rect(points);
+        auto sampling = materialTexture.sampling != std::nullopt ? *materialTexture.sampling : texture->sampling();
+        if (sampling == texture_sampling::Scaled)
+        {
+            auto const extents = size_u32{ texture->extents() };
+            if (extents / 2u * 2u == extents && (boundingRect.cx > extents.cx || boundingRect.cy > extents.cy))
+                sampling = texture_sampling::Nearest;
+            else
+                sampling = texture_sampling::Normal;
+        }
+
+        auto texturePaint = std::holds_alternative<std::monostate>(fill) ? to_paint(color::White) : to_paint(fill, boundingRect);
+        texturePaint.texture = *source;
+        texturePaint.effect = to_texture_effect(aMaterial.shaderEffect != std::nullopt ? *aMaterial.shaderEffect : shader_effect::None);
+        texturePaint.smooth = sampling != texture_sampling::Nearest && sampling != texture_sampling::Data;
+        for (auto const& face : aMesh.faces)
+        {
+            auto const uv = uv_transformation(
+                { points[face[0]], points[face[1]], points[face[2]] },
+                { texels[face[0]], texels[face[1]], texels[face[2]] });
+            if (uv == std::nullopt)
+                continue;
+            texturePaint.uv = *uv;
+            iRasterizer.fill_triangle(points[face[0]].x, points[face[0]].y, points[face[1]].x, points[face[1]].y, points[face[2]].x, points[face[2]].y, texturePaint);
+        }
+    }
+
+    void software_rendering_context::draw_path(const graphics_operation::draw_path& aDrawPath)
+    {
+        std::vector<vec2f> points;
+        {
+            auto& ssbo = rendering_engine().default_shader_program().shape_shader().shape_vertices();
+            scoped_lock_ssbo<vec4f> vertices{ ssbo, aDrawPath.path };
+            points.reserve(aDrawPath.path.last - aDrawPath.path.first);
+            for (auto v = vertices.data(); v != vertices.data() + (aDrawPath.path.last - aDrawPath.path.first); ++v)
+                points.push_back(to_device(point{ v->x, v->y }));
+        }
+        switch (aDrawPath.shape)
+        {
+        case path_shape::ConvexPolygon:
+            fill_polygon(points, aDrawPath.fill);
+            draw_polyline(points, true, aDrawPath.pen);
+            break;
+        case path_shape::LineLoop:
+            draw_polyline(points, true, aDrawPath.pen);
+            break;
+        case path_shape::LineStrip:
+            draw_polyline(points, false, aDrawPath.pen);
+            break;
+        case path_shape::Lines:
+            for (std::size_t i = 0u; i + 1u < points.size(); i += 2u)
+                draw_polyline({ points[i], points[i + 1u] }, false, aDrawPath.pen);
+            break;
+        default:
+            // not implemented by the OpenGL renderer either
+            break;
+        }
+    }
+
+    void software_rendering_context::draw_glyphs(const graphics_operation::draw_glyphs& aDrawGlyphs)
+    {
+        // The stages of opengl_rendering_context::draw_glyphs; glow and shadow effects are drawn unblurred.
+        auto& glyphText = aDrawGlyphs.glyphText.content();
+        vec3f const glyphPoint = aDrawGlyphs.point.as<float>();
+
+        thread_local std::vector<std::pair<glyph_char const*, text_format const*>> glyphs;
+        glyphs.clear();
+        auto a = aDrawGlyphs.attributes.begin();
+        for (auto g = aDrawGlyphs.begin; g != aDrawGlyphs.end; ++g)
+        {
+            while (a != aDrawGlyphs.attributes.end() && (g - aDrawGlyphs.begin) >= a->end)
+                ++a;
+            if (a != aDrawGlyphs.attributes.end() && (g - aDrawGlyphs.begin) >= a->start)
+                glyphs.emplace_back(&*g, &a->attributes);
+        }
+
+        auto shape_quad = [&](font const& glyphFont, glyph_char const& glyphChar, bool outline = false)
+        {
+            static optional_mat44f const italicTransformGui = mat44f{
+                    { 1.0f, 0.0f, 0.0f, 0.0f },
+                    { -0.25f, 1.0f, 0.0f, 0.0f },
+                    { 0.0f, 0.0f, 1.0f, 0.0f },
+                    { 0.0f, 0.0f, 0.0f, 1.0f } };
+            static optional_mat44f const italicTransformGame = mat44f{
+                    { 1.0f, 0.0f, 0.0f, 0.0f },
+                    { 0.25f, 1.0f, 0.0f, 0.0f },
+                    { 0.0f, 0.0f, 1.0f, 0.0f },
+                    { 0.0f, 0.0f, 0.0f, 1.0f } };
+            auto const& italicTransform = ((glyphFont.style() & font_style::EmulatedItalic) != font_style::EmulatedItalic) ?
+                optional_mat44f{} :
+                logical_coordinate_system() == neogfx::logical_coordinate_system::AutomaticGui ?
+                italicTransformGui : italicTransformGame;
+
+            if (!italicTransform)
+                return !outline ? glyphChar.shape : glyphChar.outlineShape.value();
+
+            quadf_2d transformedQuad;
+            vec2f centeringTranslation;
+            transformedQuad = center_quad(!outline ? glyphChar.shape : glyphChar.outlineShape.value(), centeringTranslation);
+            for (auto& v : transformedQuad)
+                v = (*italicTransform * vec3f{ v } + -vec3f{ centeringTranslation }).xy;
+
+            return transformedQuad;
+        };
+
+        auto draw_glyph_texture = [&](vec3f const& aPoint, glyph_char const& aGlyphChar, quadf_2d const& aShapeQuad, i_texture const& aTexture, text_color const& aInk, shader_effect aEffect)
+        {
+            auto const& glyphQuad = quadf_2d{
+                (aGlyphChar.cell[0] + aShapeQuad[0]).round(),
+                (aGlyphChar.cell[0] + aShapeQuad[1]).round(),
+                (aGlyphChar.cell[0] + aShapeQuad[2]).round(),
+                (aGlyphChar.cell[0] + aShapeQuad[3]).round() } + ~aPoint.xy;
+            auto const& mesh = to_ecs_component(glyphQuad, mesh_type::Triangles);
+            draw_mesh(mesh,
+                game::material{
+                    std::holds_alternative<color>(aInk) ? to_ecs_component(static_variant_cast<const color&>(aInk)) : std::optional<game::color>{},
+                    std::holds_alternative<gradient>(aInk) ? to_ecs_component(static_variant_cast<const gradient&>(aInk).with_bounding_box_if_none(rect{ to_aabb_2d(glyphQuad.begin(), glyphQuad.end()) })) : std::optional<game::gradient>{},
+                    {},
+                    to_ecs_component(aTexture),
+                    aEffect },
+                mat44::identity());
+        };
+
+        // Paper
+        for (auto const& [glyphChar, appearance] : glyphs)
+        {
+            if (appearance->paper() == std::nullopt || appearance->being_filtered())
+                continue;
+            auto const& mesh = to_ecs_component(glyphPoint + quadf{ glyphChar->cell[0], glyphChar->cell[1], glyphChar->cell[2], glyphChar->cell[3] }, mesh_type::Triangles);
+            auto const& paper = *appearance->paper();
+            draw_mesh(mesh,
+                game::material{
+                    std::holds_alternative<color>(paper) ? to_ecs_component(std::get<color>(paper)) : std::optional<game::color>{},
+                    std::holds_alternative<gradient>(paper) ? to_ecs_component(std::get<gradient>(paper)) : std::optional<game::gradient>{} },
+                mat44::identity());
+        }
+
+        // SpecialEffects
+        for (auto const& [glyphChar, appearance] : glyphs)
+        {
+            if (is_whitespace(*glyphChar) || is_emoji(*glyphChar) || appearance->being_filtered() || appearance->only_calculate_effect() || !appearance->effect())
+                continue;
+            auto const& effect = *appearance->effect();
+            if (effect.type() != text_effect_type::Glow && effect.type() != text_effect_type::Shadow)
+                continue;
+            draw_glyph_texture(glyphPoint + effect.offset().as<float>(), *glyphChar, shape_quad(glyphText.glyph_font(*glyphChar), *glyphChar),
+                glyphText.glyph(*glyphChar).texture(), effect.color(), shader_effect::Ignore);
+        }
+
+        // EmojiFinal
+        for (auto const& [glyphChar, appearance] : glyphs)
+        {
+            if (is_whitespace(*glyphChar) || !is_emoji(*glyphChar))
+                continue;
+            auto const& emojiTexture = rendering_engine().font_manager().emoji_atlas().emoji_texture(glyphChar->value).as_sub_texture();
+            auto const& ink = !appearance->effect() || !appearance->being_filtered() ?
+                (appearance->ignore_emoji() ? neolib::none : appearance->ink()) :
+                (appearance->effect()->ignore_emoji() ? neolib::none : appearance->effect()->color());
+            draw_glyph_texture(glyphPoint, *glyphChar, glyphChar->shape, emojiTexture, ink,
+                !appearance->being_filtered() ?
+                    appearance->ignore_emoji() ?
+                        shader_effect::None : shader_effect::Colorize :
+                    !appearance->effect() || appearance->effect()->ignore_emoji() ?
+                        shader_effect::None : to_ecs_component(appearance->effect()->type()));
+        }
+
+        // GlyphOutline
+        for (auto const& [glyphChar, appearance] : glyphs)
+        {
+            if (is_whitespace(*glyphChar) || is_emoji(*glyphChar))
+                continue;
+            auto const& theGlyph = glyphText.glyph(*glyphChar);
+            if (theGlyph.has_outline_texture() && appearance->effect() && appearance->effect()->type() == text_effect_type::Outline)
+                draw_glyph_texture(glyphPoint, *glyphChar, shape_quad(glyphText.glyph_font(*glyphChar), *glyphChar, true),
+                    theGlyph.outline_texture(), appearance->effect()->color(), shader_effect::Ignore);
+        }
+
+        // GlyphFinal
+        for (auto const& [glyphChar, appearance] : glyphs)
+        {
+            if (is_whitespace(*glyphChar) || is_emoji(*glyphChar))
+                continue;
+            auto const& ink = !appearance->effect() || !appearance->being_filtered() ?
+                appearance->ink() : appearance->effect()->color();
+            draw_glyph_texture(glyphPoint, *glyphChar, shape_quad(glyphText.glyph_font(*glyphChar), *glyphChar),
+                glyphText.glyph(*glyphChar).texture(), ink, shader_effect::Ignore);
+        }
+
+        // Adornments
+        auto const baseline = static_cast<float>(glyphText.baseline());
+        for (auto const& [glyphChar, appearance] : glyphs)
+        {
+            if (!underline(*glyphChar) && !(aDrawGlyphs.showMnemonics && neogfx::mnemonic(*glyphChar)))
+                continue;
+            auto const& ink = !appearance->effect() || !appearance->being_filtered() ?
+                appearance->ink() : appearance->effect()->color();
+            auto const& majorFont = glyphText.major_font();
+            auto const yUnderline = static_cast<float>(std::round(majorFont.native_font_face().underline_position()));
+            auto const cyUnderline = static_cast<float>(std::ceil(majorFont.native_font_face().underline_thickness()));
+            auto const from = glyphPoint + vec3f{ glyphChar->cell[0].x, glyphChar->cell[0].y + baseline - yUnderline };
+            auto const to = glyphPoint + vec3f{ glyphChar->cell[1].x, glyphChar->cell[1].y + baseline - yUnderline };
+            draw_polyline({ to_device(point{ from.x, from.y }), to_device(point{ to.x, to.y }) }, false, pen{ ink, cyUnderline });
+        }
+    }
+}
@@ -0,0 +1,108 @@
+// software_rendering_context.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <deque>
+#include <unordered_map>
+
+#include <neogfx/gfx/i_rendering_context.hpp>
+#include <neogfx/gfx/i_rendering_engine.hpp>
+#include <neogfx/gfx/pen.hpp>
+#include "software_rasterizer.hpp"
+
+namespace neogfx
+{
+    // Executes graphics operations on the CPU, rasterizing them into a software_bitmap owned by the
+    // render target. Glyphs, textured meshes and texture brushes are sampled from software_texture bitmaps
+    // (texels of other textures are read back once per flush). Entities, blur filters and GPU pipeline
+    // state (blending modes, logical operations, stipples) are not supported.
+    class software_rendering_context : public i_rendering_context
+    {
+    public:
+        software_rendering_context(const i_render_target& aTarget, software_bitmap& aBitmap);
+        software_rendering_context(const i_render_target& aTarget, const i_widget& aWidget, software_bitmap& aBitmap);
+        software_rendering_context(const software_rendering_context& aOther);
+        ~software_rendering_context();
+    public:
+        std::unique_ptr<i_rendering_context> clone() const override;
+    public:
+        i_rendering_engine& rendering_engine() const override;
+        const i_render_target& render_target() const override;
+        rect rendering_area(bool aConsiderScissor = true) const override;
+    public:
+        graphics_operation::queue& queue() const override;
+        void enqueue(const graphics_operation::operation& aOperation) override;
+        void flush() override;
+        void begin_recording(graphics_operation::recording& aRecording) override;
+        void end_recording() override;
+        void replay(const graphics_operation::recording& aRecording, const vec2& aOffset, double aOpacity) override;
+    public:
+        neogfx::logical_coordinate_system logical_coordinate_system() const override;
+        neogfx::logical_coordinates logical_coordinates() const override;
+        vec2 offset() const override;
+        void set_offset(const optional_vec2& aOffset) override;
+        bool gradient_set() const override;
+        void apply_gradient(i_gradient_shader& aShader) override;
+    public:
+        neogfx::subpixel_format subpixel_format() const override;
+    private:
+        void execute(const graphics_operation::operation& aOperation);
+        void scissor_on(const rect& aRect);
+        void scissor_off();
+        void apply_scissor();
+        void execute_primitives();
+        vec2f device_origin() const;
+        vec2f to_device(const point& aPoint) const;
+        rect to_device(const rect& aRect) const;
+        software_rasterizer::paint to_paint(const color& aColor) const;
+        software_rasterizer::paint to_paint(const color_or_gradient& aColor, const rect& aBoundingRect);
+        software_rasterizer::paint to_paint(const brush& aFill, const rect& aBoundingRect);
+        software_rasterizer::paint to_paint(const i_texture& aTexture, const optional_rect& aTextureRect, const rect& aBoundingRect);
+        std::optional<std::uint32_t> texture_source(const i_texture& aTexture);
+        bool has_outline(const pen& aPen) const;
+        void draw_polyline(const std::vector<vec2f>& aPoints, bool aClosed, const pen& aPen);
+        void fill_polygon(const std::vector<vec2f>& aPoints, const brush& aFill);
+        void draw_arc(const point& aCenter, dimension aRadius, angle aStartAngle, angle aEndAngle, const pen& aPen, const brush& aFill, bool aPie);
+        void draw_mesh(const game::mesh& aMesh, const mat44& aTransformation, const brush& aFill, const pen& aPen);
+        void draw_mesh(const game::mesh& aMesh, const game::material& aMaterial, const mat44& aTransformation);
+        void draw_path(const graphics_operation::draw_path& aDrawPath);
+        void draw_glyphs(const graphics_operation::draw_glyphs& aDrawGlyphs);
+    private:
+        i_rendering_engine& iRenderingEngine;
+        const i_render_target& iTarget;
+        software_bitmap& iBitmap;
+        bool iInFlush;
+        graphics_operation::recording* iRecording;
+        std::optional<neogfx::logical_coordinate_system> iLogicalCoordinateSystem;
+        std::optional<neogfx::logical_coordinates> iLogicalCoordinates;
+        double iOpacity;
+        double iReplayOpacity;
+        optional_vec2 iOffset;
+        vec2 iReplayOffset;
+        bool iSnapToPixel;
+        std::vector<rect> iScissorRects;
+        software_rasterizer iRasterizer;
+        std::unordered_map<const i_texture*, std::uint32_t> iTextureSources;
+        std::deque<software_bitmap> iTextureCopies;
+        sink iSink;
+    };
+}
@@ -0,0 +1,207 @@
+// software_shader_program.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2023 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include "software_shader_program.hpp"
+
+namespace neogfx
+{
+    template <typename T>
+    software_ssbo<T>::software_ssbo(i_string const& aName, ssbo_id aId) :
+        ssbo<T>{ aName, aId }
+    {
+    }
+
+    template <typename T>
+    void software_ssbo<T>::reserve(std::size_t aCapacity)
+    {
+        if (iLockCount)
+            throw ssbo_locked();
+
+        if (aCapacity <= this->capacity())
+            return;
+
+        auto existingData = std::move(iData);
+        ssbo<T>::reserve(aCapacity);
+        iData = std::make_unique<value_type[]>(this->capacity());
+        if (existingData)
+            std::copy(existingData.get(), existingData.get() + this->size(), iData.get());
+    }
+
+    template <typename T>
+    void* software_ssbo<T>::lock(ssbo_range aRange)
+    {
+        ++iLockCount;
+        return iData.get() + aRange.first;
+    }
+
+    template <typename T>
+    void software_ssbo<T>::unlock(ssbo_range aRange)
+    {
+        --iLockCount;
+    }
+
+    template class software_ssbo<bool>;
+    template class software_ssbo<float>;
+    template class software_ssbo<double>;
+    template class software_ssbo<std::int32_t>;
+    template class software_ssbo<std::uint32_t>;
+    template class software_ssbo<vec2f>;
+    template class software_ssbo<vec2>;
+    template class software_ssbo<vec2i32>;
+    template class software_ssbo<vec2u32>;
+    template class software_ssbo<vec3f>;
+    template class software_ssbo<vec3>;
+    template class software_ssbo<vec3i32>;
+    template class software_ssbo<vec3u32>;
+    template class software_ssbo<vec4f>;
+    template class software_ssbo<vec4>;
+    template class software_ssbo<vec4i32>;
+    template class software_ssbo<vec4u32>;
+    template class software_ssbo<mat4f>;
+    template class software_ssbo<mat4>;
+
+    software_standard_shader_program::software_standard_shader_program() :
+        base_type{ "standard_shader_program" }
+    {
+        create_standard_shaders();
+    }
+
+    software_standard_shader_program::~software_standard_shader_program()
+    {
+        stages().clear();
+    }
+
+    void software_standard_shader_program::compile()
+    {
+        // nothing to compile
+    }
+
+    void software_standard_shader_program::link()
+    {
+        // nothing to link
+    }
+
+    void software_standard_shader_program::use()
+    {
+        set_active();
+    }
+
+    void software_standard_shader_program::update_uniform_storage()
+    {
+        // uniforms are read from the shaders directly
+    }
+
+    void software_standard_shader_program::update_uniform_locations()
+    {
+    }
+
+    void software_standard_shader_program::update_uniforms(const i_rendering_context&)
+    {
+    }
+
+    std::size_t software_standard_shader_program::ssbo_count() const
+    {
+        return iSsbos.size();
+    }
+
+    i_ssbo const& software_standard_shader_program::ssbo(std::size_t aIndex) const
+    {
+        return *iSsbos.at_index(aIndex);
+    }
+
+    void software_standard_shader_program::create_ssbo(i_string const& aName, shader_data_type aDataType, i_ref_ptr<i_ssbo>& aSsbo)
+    {
+        ssbo_id const ssboId = iSsbos.next_cookie();
+        switch(aDataType)
+        {
+        case shader_data_type::Boolean:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<bool>>(aName, ssboId));
+            break;
+        case shader_data_type::Float:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<float>>(aName, ssboId));
+            break;
+        case shader_data_type::Double:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<double>>(aName, ssboId));
+            break;
+        case shader_data_type::Int:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<std::int32_t>>(aName, ssboId));
+            break;
+        case shader_data_type::Uint:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<std::uint32_t>>(aName, ssboId));
+            break;
+        case shader_data_type::Vec2:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec2f>>(aName, ssboId));
+            break;
+        case shader_data_type::DVec2:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec2>>(aName, ssboId));
+            break;
+        case shader_data_type::IVec2:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec2i32>>(aName, ssboId));
+            break;
+        case shader_data_type::UVec2:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec2u32>>(aName, ssboId));
+            break;
+        case shader_data_type::Vec3:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec3f>>(aName, ssboId));
+            break;
+        case shader_data_type::DVec3:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec3>>(aName, ssboId));
+            break;
+        case shader_data_type::IVec3:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec3i32>>(aName, ssboId));
+            break;
+        case shader_data_type::UVec3:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec3u32>>(aName, ssboId));
+            break;
+        case shader_data_type::Vec4:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec4f>>(aName, ssboId));
+            break;
+        case shader_data_type::DVec4:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec4>>(aName, ssboId));
+            break;
+        case shader_data_type::IVec4:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec4i32>>(aName, ssboId));
+            break;
+        case shader_data_type::UVec4:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<vec4u32>>(aName, ssboId));
+            break;
+        case shader_data_type::Mat4:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<mat4f>>(aName, ssboId));
+            break;
+        case shader_data_type::DMat4:
+            iSsbos.add(ssboId, aSsbo = make_ref<software_ssbo<mat4>>(aName, ssboId));
+            break;
+        case shader_data_type::FloatArray:
+        case shader_data_type::DoubleArray:
+        case shader_data_type::Sampler2D:
+        case shader_data_type::Sampler2DMS:
+        case shader_data_type::Sampler2DRect:
+        default:
+            throw std::logic_error("not supported");
+        }
+    }
+
+    void software_standard_shader_program::deactivate()
+    {
+        if (active())
+            set_inactive();
+    }
+}
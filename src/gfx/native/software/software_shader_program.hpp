@@ -0,0 +1,70 @@
+// software_shader_program.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2023 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/gfx/shader_program.hpp>
+#include <neogfx/gfx/standard_shader_program.hpp>
+
+namespace neogfx
+{
+    template <typename T>
+    class software_ssbo : public ssbo<T>
+    {
+        using base_type = ssbo<T>;
+    public:
+        using typename base_type::value_type;
+    public:
+        software_ssbo(i_string const& aName, ssbo_id aId);
+    public:
+        void reserve(std::size_t aCapacity) final;
+    public:
+        void* lock(ssbo_range aRange) final;
+        void unlock(ssbo_range aRange) final;
+    private:
+        std::unique_ptr<value_type[]> iData;
+        std::uint32_t iLockCount = 0u;
+    };
+
+    // The standard shaders are never compiled by the software renderer: the software rendering context
+    // evaluates their effects itself. The program exists so that code written against the standard shaders
+    // (uniform setters, the shape vertex SSBO) works unchanged; SSBOs are held in system memory.
+    class software_standard_shader_program : public standard_shader_program
+    {
+        using base_type = standard_shader_program;
+    public:
+        software_standard_shader_program();
+        ~software_standard_shader_program();
+    public:
+        void compile() final;
+        void link() final;
+        void use() final;
+        void update_uniform_storage() final;
+        void update_uniform_locations() final;
+        void update_uniforms(const i_rendering_context& aContext) final;
+        std::size_t ssbo_count() const final;
+        i_ssbo const& ssbo(std::size_t aIndex) const final;
+        void create_ssbo(i_string const& aName, shader_data_type aDataType, i_ref_ptr<i_ssbo>& aSsbo) final;
+        void deactivate() final;
+    private:
+        neolib::std_vector_jar<weak_ref_ptr<i_ssbo>> iSsbos;
+    };
+}
@@ -0,0 +1,573 @@
+// software_texture.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2023 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#include <neogfx/gfx/i_texture_manager.hpp>
+#include <neogfx/gfx/i_rendering_engine.hpp>
+#include <neogfx/gfx/graphics_operations.hpp>
+#include "software_rendering_context.hpp"
+#include "software_texture.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        inline size_u32 storage_extents_for(size_u32 const& aExtents, texture_sampling aSampling)
+        {
+            if (aSampling == texture_sampling::Data)
+                return aExtents;
+            if (aSampling != texture_sampling::NormalMipmap)
+                return size_u32{ ((aExtents.cx + 2 - 1) / 16 + 1) * 16, ((aExtents.cy + 2 - 1) / 16 + 1) * 16 };
+            return size_u32{ size{ std::max(std::pow(2.0, std::ceil(std::log2(aExtents.cx + 2))), 16.0), std::max(std::pow(2.0, std::ceil(std::log2(aExtents.cy + 2))), 16.0) } };
+        }
+
+        inline std::size_t channels(texture_data_format aDataFormat)
+        {
+            return aDataFormat == texture_data_format::Red ? 1u : 4u;
+        }
+
+        inline std::size_t bytes_per_pixel(texture_data_format aDataFormat, texture_data_type aDataType)
+        {
+            return channels(aDataFormat) * (aDataType == texture_data_type::Float ? sizeof(float) : sizeof(std::uint8_t));
+        }
+
+        inline void record_texture_upload(texture_data_format aDataFormat, texture_data_type aDataType, std::size_t aWidth, std::size_t aHeight)
+        {
+            auto& statistics = service<i_rendering_engine>().frame_statistics();
+            ++statistics.textureUploads;
+            statistics.textureUploadBytes += aWidth * aHeight * bytes_per_pixel(aDataFormat, aDataType);
+        }
+
+        // Decodes one source pixel to unpremultiplied RGBA8 the way GL unpacks it: a single channel source
+        // supplies red only.
+        inline std::array<std::uint8_t, 4> decode(texture_data_format aDataFormat, texture_data_type aDataType, std::uint8_t const* aPixel)
+        {
+            std::array<std::uint8_t, 4> result{ 0u, 0u, 0u, 0xFFu };
+            for (std::size_t c = 0; c < channels(aDataFormat); ++c)
+            {
+                if (aDataType == texture_data_type::Float)
+                {
+                    float value;
+                    std::memcpy(&value, aPixel + c * sizeof(float), sizeof(float));
+                    result[c] = static_cast<std::uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+                }
+                else
+                    result[c] = aPixel[c];
+            }
+            if (aDataFormat == texture_data_format::BGRA)
+                std::swap(result[0], result[2]);
+            return result;
+        }
+
+        // The texel the standard texture shader would see, premultiplied.
+        inline std::uint32_t to_texel(texture_data_format aDataFormat, std::array<std::uint8_t, 4> const& aRgba)
+        {
+            switch (aDataFormat)
+            {
+            case texture_data_format::Red:
+                return aRgba[0] * 0x01010101u;
+            case texture_data_format::SubPixel:
+                return ((aRgba[0] + aRgba[1] + aRgba[2] + 1u) / 3u) * 0x01010101u;
+            default:
+                {
+                    std::uint32_t const alpha = aRgba[3];
+                    auto channel = [&](std::uint32_t aValue) { return (aValue * alpha + 127u) / 255u; };
+                    return channel(aRgba[0]) | (channel(aRgba[1]) << 8u) | (channel(aRgba[2]) << 16u) | (alpha << 24u);
+                }
+            }
+        }
+
+        inline std::array<std::uint8_t, 4> from_texel(std::uint32_t aTexel)
+        {
+            std::uint32_t const alpha = aTexel >> 24u;
+            if (alpha == 0u)
+                return {};
+            auto channel = [&](std::uint32_t aShift)
+            {
+                return static_cast<std::uint8_t>(std::min<std::uint32_t>(((aTexel >> aShift) & 0xFFu) * 255u + alpha / 2u, 255u * alpha) / alpha);
+            };
+            return { channel(0u), channel(8u), channel(16u), static_cast<std::uint8_t>(alpha) };
+        }
+    }
+
+    software_texture::software_texture(i_texture_manager& aManager, texture_id aId, const neogfx::size& aExtents, dimension aDpiScaleFactor, texture_sampling aSampling, texture_data_format aDataFormat, texture_data_type aDataType, neogfx::color_space aColorSpace, const optional_color& aColor) :
+        iManager{ aManager },
+        iId{ aId },
+        iUri{ "neogfx::software_texture::internal" },
+        iPart{ aExtents },
+        iDpiScaleFactor{ aDpiScaleFactor },
+        iColorSpace{ aColorSpace },
+        iSampling{ aSampling },
+        iDataFormat{ aDataFormat },
+        iDataType{ aDataType },
+        iSize{ aExtents },
+        iStorageSize{ storage_extents_for(iSize, aSampling) },
+        iLogicalCoordinateSystem{ neogfx::logical_coordinate_system::AutomaticGame },
+        iBitmap{ static_cast<std::int32_t>(iStorageSize.cx), static_cast<std::int32_t>(iStorageSize.cy) },
+        iRenderTarget{ false }
+    {
+        if (aColor.has_value())
+        {
+            auto const texel = to_texel(iDataFormat, { aColor->red(), aColor->green(), aColor->blue(), aColor->alpha() });
+            for (std::int32_t y = 0; y < static_cast<std::int32_t>(iSize.cy); ++y)
+                for (std::int32_t x = 0; x < static_cast<std::int32_t>(iSize.cx); ++x)
+                    storage_texel(x + border().x, y + border().y) = texel;
+            record_texture_upload(iDataFormat, iDataType, iStorageSize.cx, iStorageSize.cy);
+        }
+    }
+
+    software_texture::software_texture(i_texture_manager& aManager, texture_id aId, const i_image& aImage, const rect& aImagePart, texture_data_format aDataFormat, texture_data_type aDataType) :
+        iManager{ aManager },
+        iId{ aId },
+        iUri{ aImage.uri() },
+        iPart{ aImagePart },
+        iDpiScaleFactor{ aImage.dpi_scale_factor() },
+        iColorSpace{ aImage.color_space() },
+        iSampling{ aImage.sampling() },
+        iDataFormat{ aDataFormat },
+        iDataType{ aDataType },
+        iSize{ aImagePart.extents() },
+        iStorageSize{ storage_extents_for(iSize, aImage.sampling()) },
+        iLogicalCoordinateSystem{ neogfx::logical_coordinate_system::AutomaticGame },
+        iBitmap{ static_cast<std::int32_t>(iStorageSize.cx), static_cast<std::int32_t>(iStorageSize.cy) },
+        iRenderTarget{ false }
+    {
+        switch (aImage.color_format())
+        {
+        case color_format::RGBA8:
+            {
+                size_u32 const imageExtents = aImage.extents();
+                point_u32 const imagePartOrigin = aImagePart.position();
+                auto const imageData = static_cast<const std::uint8_t*>(aImage.cpixels());
+                // as opengl_texture: the first image row is the last storage row of the part
+                for (std::uint32_t y = 0; y < iSize.cy; ++y)
+                    for (std::uint32_t x = 0; x < iSize.cx; ++x)
+                    {
+                        auto const pixel = &imageData[(y + imagePartOrigin.y) * imageExtents.cx * 4 + (x + imagePartOrigin.x) * 4];
+                        storage_texel(static_cast<std::int32_t>(x) + border().x, static_cast<std::int32_t>(iSize.cy - 1 - y) + border().y) =
+                            to_texel(iDataFormat, { pixel[0], pixel[1], pixel[2], pixel[3] });
+                    }
+                record_texture_upload(iDataFormat, iDataType, iStorageSize.cx, iStorageSize.cy);
+            }
+            break;
+        default:
+            throw unsupported_color_format();
+            break;
+        }
+    }
+
+    software_texture::~software_texture()
+    {
+    }
+
+    texture_id software_texture::id() const
+    {
+        return iId;
+    }
+
+    string const& software_texture::uri() const
+    {
+        return iUri;
+    }
+
+    rect const& software_texture::part() const
+    {
+        return iPart;
+    }
+
+    texture_type software_texture::type() const
+    {
+        return texture_type::Texture;
+    }
+
+    bool software_texture::is_render_target() const
+    {
+        return iRenderTarget;
+    }
+
+    const i_render_target& software_texture::as_render_target() const
+    {
+        return *this;
+    }
+
+    i_render_target& software_texture::as_render_target()
+    {
+        return *this;
+    }
+
+    const i_sub_texture& software_texture::as_sub_texture() const
+    {
+        throw not_sub_texture();
+    }
+
+    dimension software_texture::dpi_scale_factor() const
+    {
+        return iDpiScaleFactor;
+    }
+
+    texture_sampling software_texture::sampling() const
+    {
+        switch (iSampling)
+        {
+        case texture_sampling::Multisample4x:
+        case texture_sampling::Multisample8x:
+        case texture_sampling::Multisample16x:
+        case texture_sampling::Multisample32x:
+            return texture_sampling::Multisample;
+        default:
+            return iSampling;
+        }
+    }
+
+    std::uint32_t software_texture::samples() const
+    {
+        // multisample textures are rasterized (with coverage anti-aliasing) at one sample per texel
+        return 1u;
+    }
+
+    texture_data_format software_texture::data_format() const
+    {
+        return iDataFormat;
+    }
+
+    texture_data_type software_texture::data_type() const
+    {
+        return iDataType;
+    }
+
+    bool software_texture::is_empty() const
+    {
+        return false;
+    }
+
+    size software_texture::extents() const
+    {
+        return iSize;
+    }
+
+    size software_texture::storage_extents() const
+    {
+        return iStorageSize;
+    }
+
+    void software_texture::set_pixels(const rect& aRect, void const* aPixelData, std::uint32_t aStride, std::uint32_t aPackAlignment)
+    {
+        set_pixels(aRect, aPixelData, iDataFormat, aStride, aPackAlignment);
+    }
+
+    void software_texture::set_pixels(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::uint32_t aStride, std::uint32_t aPackAlignment)
+    {
+        rect_i32 const adjustedRect = aRect + point{ border() };
+        auto const pixelBytes = bytes_per_pixel(aDataFormat, iDataType);
+        auto const rowPixels = aStride != 0u ? aStride : static_cast<std::uint32_t>(adjustedRect.cx);
+        auto const alignment = std::max<std::uint32_t>(aPackAlignment, 1u);
+        auto const rowBytes = (rowPixels * pixelBytes + alignment - 1u) / alignment * alignment;
+        auto const data = static_cast<std::uint8_t const*>(aPixelData);
+        for (std::int32_t y = 0; y < adjustedRect.cy; ++y)
+        {
+            auto const glY = adjustedRect.y + y;
+            if (glY < 0 || glY >= static_cast<std::int32_t>(iStorageSize.cy))
+                continue;
+            auto const row = data + y * rowBytes;
+            for (std::int32_t x = 0; x < adjustedRect.cx; ++x)
+            {
+                auto const glX = adjustedRect.x + x;
+                if (glX < 0 || glX >= static_cast<std::int32_t>(iStorageSize.cx))
+                    continue;
+                storage_texel(glX, glY) = to_texel(iDataFormat, decode(aDataFormat, iDataType, row + x * pixelBytes));
+            }
+        }
+        record_texture_upload(aDataFormat, iDataType, static_cast<std::size_t>(adjustedRect.cx), static_cast<std::size_t>(adjustedRect.cy));
+    }
+
+    void software_texture::set_pixels(const i_image& aImage)
+    {
+        set_pixels(rect{ point{}, aImage.extents() }, aImage.cpixels());
+    }
+
+    void software_texture::set_pixels(const i_image& aImage, const rect& aImagePart)
+    {
+        size_u32 const imageExtents = aImage.extents();
+        point_u32 const imagePartOrigin = aImagePart.position();
+        size_u32 const imagePartExtents = aImagePart.extents();
+        switch (aImage.color_format())
+        {
+        case color_format::RGBA8:
+            {
+                const std::uint8_t* imageData = static_cast<const std::uint8_t*>(aImage.cpixels());
+                thread_local std::vector<std::uint8_t> data;
+                data.clear();
+                data.resize(imagePartExtents.cx * 4 * imagePartExtents.cy);
+                for (std::size_t y = 0; y < imagePartExtents.cy; ++y)
+                    for (std::size_t x = 0; x < imagePartExtents.cx; ++x)
+                        for (std::size_t c = 0; c < 4; ++c)
+                            data[(imagePartExtents.cy - 1 - y) * imagePartExtents.cx * 4 + x * 4 + c] = imageData[(y + imagePartOrigin.y) * imageExtents.cx * 4 + (x + imagePartOrigin.x) * 4 + c];
+                set_pixels(rect{ point{}, imagePartExtents }, &data[0]);
+            }
+            break;
+        }
+    }
+
+    void software_texture::set_pixels_async(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded, std::uint32_t aStride, std::uint32_t aPackAlignment)
+    {
+        // there is no device to stage an upload for so the pixels land straight away
+        set_pixels(aRect, aPixelData, aDataFormat, aStride, aPackAlignment);
+        if (aUploaded)
+            aUploaded();
+    }
+
+    void software_texture::set_pixel(const point& aPosition, const color& aColor)
+    {
+        avec4u8 pixel{ aColor.red(), aColor.green(), aColor.blue(), aColor.alpha() };
+        set_pixels(rect{ aPosition, size{1.0, 1.0} }, &pixel, texture_data_format::RGBA);
+    }
+
+    color software_texture::get_pixel(const point& aPosition) const
+    {
+        switch (sampling())
+        {
+        case texture_sampling::Normal:
+        case texture_sampling::Nearest:
+        case texture_sampling::Data:
+            return read_pixel(aPosition);
+        default:
+            throw unsupported_sampling_type_for_function();
+        }
+    }
+
+    void* software_texture::handle() const
+    {
+        return iBitmap.data();
+    }
+
+    bool software_texture::is_resident() const
+    {
+        return true;
+    }
+
+    dimension software_texture::horizontal_dpi() const
+    {
+        return dpi_scale_factor() * STANDARD_DPI_PPI;
+    }
+
+    dimension software_texture::vertical_dpi() const
+    {
+        return dpi_scale_factor() * STANDARD_DPI_PPI;
+    }
+
+    dimension software_texture::ppi() const
+    {
+        return size{ horizontal_dpi(), vertical_dpi() }.magnitude() / std::sqrt(2.0);
+    }
+
+    bool software_texture::metrics_available() const
+    {
+        return true;
+    }
+
+    dimension software_texture::em_size() const
+    {
+        return 0.0;
+    }
+
+    std::unique_ptr<i_rendering_context> software_texture::create_graphics_context(blending_mode) const
+    {
+        return std::unique_ptr<i_rendering_context>(new software_rendering_context{ *this, iBitmap });
+    }
+
+    graphics_operation::i_queue& software_texture::graphics_operation_queue() const
+    {
+        if (iQueue == nullptr)
+            iQueue = std::make_unique<graphics_operation::queue>();
+        return *iQueue;
+    }
+
+    void software_texture::bind(std::uint32_t) const
+    {
+        // texels are sampled directly from the bitmap
+    }
+
+    void software_texture::unbind() const
+    {
+    }
+
+    intptr_t software_texture::native_handle() const
+    {
+        return reinterpret_cast<intptr_t>(handle());
+    }
+
+    i_texture& software_texture::native_texture() const
+    {
+        return const_cast<software_texture&>(*this);
+    }
+
+    render_target_type software_texture::target_type() const
+    {
+        return render_target_type::Texture;
+    }
+
+    void* software_texture::target_handle() const
+    {
+        return handle();
+    }
+
+    void* software_texture::target_device_handle() const
+    {
+        return nullptr;
+    }
+
+    pixel_format_t software_texture::pixel_format() const
+    {
+        return 0;
+    }
+
+    const i_texture& software_texture::target_texture() const
+    {
+        return *this;
+    }
+
+    point software_texture::target_origin() const
+    {
+        return {};
+    }
+
+    size software_texture::target_extents() const
+    {
+        return extents();
+    }
+
+    neogfx::logical_coordinate_system software_texture::logical_coordinate_system() const
+    {
+        return iLogicalCoordinateSystem;
+    }
+
+    void software_texture::set_logical_coordinate_system(neogfx::logical_coordinate_system aSystem)
+    {
+        iLogicalCoordinateSystem = aSystem;
+    }
+
+    logical_coordinates software_texture::logical_coordinates() const
+    {
+        if (iLogicalCoordinates.has_value())
+            return iLogicalCoordinates.value();
+        neogfx::logical_coordinates result;
+        switch (iLogicalCoordinateSystem)
+        {
+        case neogfx::logical_coordinate_system::Specified:
+            throw logical_coordinates_not_specified();
+            break;
+        case neogfx::logical_coordinate_system::AutomaticGui:
+            result.bottomLeft = vec2{ 0.0, extents().cy };
+            result.topRight = vec2{ extents().cx, 0.0 };
+            break;
+        case neogfx::logical_coordinate_system::AutomaticGame:
+            result.bottomLeft = vec2{ 0.0, 0.0 };
+            result.topRight = vec2{ extents().cx, extents().cy };
+            break;
+        }
+        return result;
+    }
+
+    void software_texture::set_logical_coordinates(const neogfx::logical_coordinates& aCoordinates)
+    {
+        iLogicalCoordinates = aCoordinates;
+    }
+
+    rect_i32 software_texture::viewport() const
+    {
+        return iViewport;
+    }
+
+    rect_i32 software_texture::set_viewport(const rect_i32& aViewport) const
+    {
+        auto const oldViewport = iViewport;
+        iViewport = aViewport;
+        return oldViewport;
+    }
+
+    void software_texture::activate_target() const
+    {
+        bool alreadyActive = target_active();
+        if (!alreadyActive)
+        {
+            TargetActivating();
+            service<i_rendering_engine>().activate_context(*this);
+        }
+        iRenderTarget = true;
+        set_viewport(rect_i32{ border(), extents().as<std::int32_t>() });
+        if (!alreadyActive)
+            TargetActivated();
+    }
+
+    bool software_texture::target_active() const
+    {
+        return service<i_rendering_engine>().active_target() == this;
+    }
+
+    void software_texture::deactivate_target() const
+    {
+        if (target_active())
+        {
+            TargetDeactivating();
+            service<i_rendering_engine>().deactivate_context();
+            TargetDeactivated();
+            return;
+        }
+        throw not_active();
+    }
+
+    color_space software_texture::color_space() const
+    {
+        return iColorSpace;
+    }
+
+    color software_texture::read_pixel(const point& aPosition) const
+    {
+        if (aPosition.x < 0.0 || aPosition.y < 0.0 || aPosition.x >= extents().cx || aPosition.y >= extents().cy)
+            return color{};
+        point_i32 const pos = point_i32{ aPosition } + border();
+        auto const texel = storage_texel(pos.x, pos.y);
+        if (iDataFormat == texture_data_format::Red)
+        {
+            auto const value = static_cast<std::uint8_t>(texel >> 24u);
+            return color{ value, value, value, value };
+        }
+        auto const pixel = from_texel(texel);
+        return color{ pixel[0], pixel[1], pixel[2], pixel[3] };
+    }
+
+    software_bitmap const& software_texture::bitmap() const
+    {
+        return iBitmap;
+    }
+
+    point_i32 software_texture::border() const
+    {
+        return sampling() != texture_sampling::Data ? point_i32{ 1, 1 } : point_i32{ 0, 0 };
+    }
+
+    std::uint32_t& software_texture::storage_texel(std::int32_t aX, std::int32_t aY) const
+    {
+        return iBitmap.row(static_cast<std::int32_t>(iStorageSize.cy) - 1 - aY)[aX];
+    }
+}
@@ -1,4 +1,11 @@
 void standard_texture_vertex_shader(inout vec3 coord, inout vec4 color, inout vec2 texCoord, inout vec4 function0, inout vec4 function1, inout vec4 function2, inout vec4 function3, inout vec4 function4, inout vec4 function5, inout vec4 function6)
 {
+    if (uInstanced)
+    {
+        // One vertex record per shape: coord is the top left of its bounding rect and texCoord its extents.
+        const vec2 corners[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+        coord.xy += corners[gl_VertexID % 6] * texCoord;
+        texCoord = vec2(0.0, 0.0);
+    }
     standard_vertex_shader(coord, color);
 }
@@ -422,6 +422,14 @@ namespace neogfx
         }
     }
 
+    template <typename T>
+    void vulkan_texture<T>::set_pixels_async(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded, std::uint32_t aStride, std::uint32_t aPackAlignment)
+    {
+        set_pixels(aRect, aPixelData, aDataFormat, aStride, aPackAlignment);
+        if (aUploaded)
+            aUploaded();
+    }
+
     template <typename T>
     void vulkan_texture<T>::set_pixel(const point& aPosition, const color& aColor)
     {
@@ -32,6 +32,8 @@
 #include "../../gui/window/native/windows_window.hpp"
 #include "../../gui/window/native/virtual_window.hpp"
 #include "../../gui/window/native/virtual_surface.hpp"
+#include "../../gui/window/native/headless_window.hpp"
+#include "../../gui/window/native/headless_surface.hpp"
 #include "opengl/opengl_surface.hpp"
 #include "windows_renderer.hpp"
 
@@ -283,6 +285,19 @@ namespace neogfx
             return set_pixel_format(aTarget.target_device_handle());
         }
 
+        bool renderer::preserves_back_buffer(const i_render_target& aTarget) const
+        {
+            auto const hdc = static_cast<HDC>(aTarget.target_device_handle());
+            int const pixelFormat = ::GetPixelFormat(hdc);
+            if (pixelFormat == 0)
+                return false;
+            int const attribute = WGL_SWAP_METHOD_ARB;
+            int swapMethod = 0;
+            if (!wglGetPixelFormatAttribivARB(hdc, pixelFormat, 0, 1, &attribute, &swapMethod))
+                return false;
+            return swapMethod == WGL_SWAP_COPY_ARB;
+        }
+
         const i_render_target* renderer::active_target() const
         {
             if (iTargetStack.empty())
@@ -338,7 +353,7 @@ namespace neogfx
 
         renderer::opengl_context renderer::create_context(const i_render_target& aTarget)
         {
-            if (aTarget.target_type() == render_target_type::Surface)
+            if (aTarget.target_type() == render_target_type::Surface && aTarget.target_device_handle() != nullptr)
             {
                 aTarget.pixel_format();
                 return create_opengl_context(static_cast<HDC>(aTarget.target_device_handle()));
@@ -358,7 +373,13 @@ namespace neogfx
         void renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const video_mode& aVideoMode, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
         {
             neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
-            if ((aWindow.style() & window_style::Nested) != window_style::Nested)
+            if ((aWindow.style() & window_style::Offscreen) == window_style::Offscreen)
+            {
+                aResult = make_ref<headless_window>(*this, aSurfaceManager, aWindow, basic_size<int>{ static_cast<int>(aVideoMode.resolution().cx), static_cast<int>(aVideoMode.resolution().cy) }, aWindowTitle, aStyle);
+                auto newSurface = make_ref<headless_surface>(*this, aWindow);
+                aResult->attach(*newSurface);
+            }
+            else if ((aWindow.style() & window_style::Nested) != window_style::Nested)
             {
                 aResult = make_ref<window>(*this, aSurfaceManager, aWindow, aVideoMode, aWindowTitle, aStyle);
                 auto newSurface = make_ref<opengl_surface>(*this, aWindow);
@@ -371,7 +392,13 @@ namespace neogfx
         void renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
         {
             neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
-            if ((aWindow.style() & window_style::Nested) != window_style::Nested)
+            if ((aWindow.style() & window_style::Offscreen) == window_style::Offscreen)
+            {
+                aResult = make_ref<headless_window>(*this, aSurfaceManager, aWindow, aDimensions, aWindowTitle, aStyle);
+                auto newSurface = make_ref<headless_surface>(*this, aWindow);
+                aResult->attach(*newSurface);
+            }
+            else if ((aWindow.style() & window_style::Nested) != window_style::Nested)
             {
                 aResult = make_ref<window>(*this, aSurfaceManager, aWindow, aDimensions, aWindowTitle, aStyle);
                 auto newSurface = make_ref<opengl_surface>(*this, aWindow);
@@ -384,7 +411,13 @@ namespace neogfx
         void renderer::create_window(i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const point& aPosition, const size& aDimensions, std::string const& aWindowTitle, window_style aStyle, i_ref_ptr<i_native_window>& aResult)
         {
             neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
-            if ((aWindow.style() & window_style::Nested) != window_style::Nested)
+            if ((aWindow.style() & window_style::Offscreen) == window_style::Offscreen)
+            {
+                aResult = make_ref<headless_window>(*this, aSurfaceManager, aWindow, aPosition, aDimensions, aWindowTitle, aStyle);
+                auto newSurface = make_ref<headless_surface>(*this, aWindow);
+                aResult->attach(*newSurface);
+            }
+            else if ((aWindow.style() & window_style::Nested) != window_style::Nested)
             {
                 aResult = make_ref<window>(*this, aSurfaceManager, aWindow, aPosition, aDimensions, aWindowTitle, aStyle);
                 auto newSurface = make_ref<opengl_surface>(*this, aWindow);
@@ -398,7 +431,7 @@ namespace neogfx
         {
             neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
             window* parent = dynamic_cast<window*>(&aParent);
-            if (parent != nullptr)
+            if (parent != nullptr && (aWindow.style() & window_style::Offscreen) != window_style::Offscreen)
             {
                 if ((aWindow.style() & window_style::Nested) != window_style::Nested)
                 {
@@ -417,7 +450,7 @@ namespace neogfx
         {
             neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
             window* parent = dynamic_cast<window*>(&aParent);
-            if (parent != nullptr)
+            if (parent != nullptr && (aWindow.style() & window_style::Offscreen) != window_style::Offscreen)
             {
                 if ((aWindow.style() & window_style::Nested) != window_style::Nested)
                 {
@@ -440,7 +473,7 @@ namespace neogfx
         {
             neolib::scoped_counter<std::uint32_t> sc(iCreatingWindow);
             window* parent = dynamic_cast<window*>(&aParent);
-            if (parent != nullptr)
+            if (parent != nullptr && (aWindow.style() & window_style::Offscreen) != window_style::Offscreen)
             {
                 if ((aWindow.style() & window_style::Nested) != window_style::Nested)
                 {
@@ -466,7 +499,10 @@ namespace neogfx
 
         void renderer::render_now()
         {
+            upload_textures();
+            service<i_font_manager>().upload_prefetched_glyphs();
             service<i_surface_manager>().render_surfaces();
+            end_frame();
         }
 
         bool renderer::use_rendering_priority() const
@@ -494,8 +530,10 @@ namespace neogfx
 
         pixel_format_t renderer::set_pixel_format(void* aNativeSurfaceDevinceHandle)
         {
+            // prefer a copy swap method so that the back buffer survives presentation allowing partial updates
             int attributes[] =
             {
+                WGL_SWAP_METHOD_ARB, WGL_SWAP_COPY_ARB,
                 WGL_DRAW_TO_WINDOW_ARB, GL_TRUE,
                 WGL_SUPPORT_OPENGL_ARB, GL_TRUE,
                 WGL_DOUBLE_BUFFER_ARB, GL_TRUE,
@@ -511,8 +549,11 @@ namespace neogfx
 
             pixel_format_t pixelFormat = 0;
             unsigned int matching;
-            if (!wglChoosePixelFormatARB(static_cast<HDC>(aNativeSurfaceDevinceHandle), attributes, NULL, 1, &pixelFormat, &matching))
-                throw failed_to_set_pixel_format(GetLastErrorText());
+            if (!wglChoosePixelFormatARB(static_cast<HDC>(aNativeSurfaceDevinceHandle), attributes, NULL, 1, &pixelFormat, &matching) || matching == 0)
+            {
+                if (!wglChoosePixelFormatARB(static_cast<HDC>(aNativeSurfaceDevinceHandle), &attributes[2], NULL, 1, &pixelFormat, &matching))
+                    throw failed_to_set_pixel_format(GetLastErrorText());
+            }
 
             PIXELFORMATDESCRIPTOR pfd = {};
             ::DescribePixelFormat(static_cast<HDC>(aNativeSurfaceDevinceHandle), pixelFormat, sizeof(pfd), &pfd);
@@ -551,7 +592,7 @@ namespace neogfx
         void renderer::activate_current_target()
         {
             BOOL result = FALSE;
-            if (active_target() != nullptr && active_target()->target_type() == render_target_type::Surface)
+            if (active_target() != nullptr && active_target()->target_type() == render_target_type::Surface && active_target()->target_device_handle() != nullptr)
                 result = ::wglMakeCurrent(static_cast<HDC>(active_target()->target_device_handle()), static_cast<HGLRC>(iContext));
             else
                 result = ::wglMakeCurrent(static_cast<HDC>(allocate_offscreen_window(active_target())->device_handle()), static_cast<HGLRC>(iContext));
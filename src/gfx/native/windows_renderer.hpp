@@ -67,6 +67,7 @@ namespace neogfx
             void enable_vsync() override;
             void disable_vsync() override;
             pixel_format_t set_pixel_format(const i_render_target& aTarget) override;
+            bool preserves_back_buffer(const i_render_target& aTarget) const override;
             const i_render_target* active_target() const override;
             void activate_context(const i_render_target& aTarget) override;
             void deactivate_context() override;
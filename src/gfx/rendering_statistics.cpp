@@ -0,0 +1,103 @@
+// rendering_statistics.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <sstream>
+
+#include <neogfx/gfx/rendering_statistics.hpp>
+
+namespace neogfx
+{
+    namespace
+    {
+        double flush_time_ms(rendering_statistics const& aStatistics)
+        {
+            return std::chrono::duration<double, std::milli>{ aStatistics.flushTime }.count();
+        }
+    }
+
+    std::string rendering_statistics_csv_header()
+    {
+        std::ostringstream result;
+        result << "frame,flushes,queue_length,batches,draw_calls,draw_calls_saved,vertices_uploaded,instances_drawn,texture_uploads,texture_upload_bytes,texture_uploads_pending,flush_time_ms,damage_regions,pixels_repainted,entities_drawn,entities_culled";
+        for (std::size_t opType = 0u; opType < RenderingStatisticsOperationTypeCount; ++opType)
+            result << ",batches_" << graphics_operation::to_string(static_cast<graphics_operation::operation_type>(opType));
+        return result.str();
+    }
+
+    std::string to_csv(rendering_statistics const& aStatistics)
+    {
+        std::ostringstream result;
+        result << aStatistics.frame << ','
+            << aStatistics.flushes << ','
+            << aStatistics.queueLength << ','
+            << aStatistics.batches << ','
+            << aStatistics.drawCalls << ','
+            << aStatistics.drawCallsSaved << ','
+            << aStatistics.verticesUploaded << ','
+            << aStatistics.instancesDrawn << ','
+            << aStatistics.textureUploads << ','
+            << aStatistics.textureUploadBytes << ','
+            << aStatistics.textureUploadsPending << ','
+            << flush_time_ms(aStatistics) << ','
+            << aStatistics.damageRegions << ','
+            << aStatistics.pixelsRepainted << ','
+            << aStatistics.entitiesDrawn << ','
+            << aStatistics.entitiesCulled;
+        for (auto const batches : aStatistics.batchesByOperation)
+            result << ',' << batches;
+        return result.str();
+    }
+
+    std::string to_json(rendering_statistics const& aStatistics)
+    {
+        std::ostringstream result;
+        result << "{"
+            << "\"frame\":" << aStatistics.frame << ','
+            << "\"flushes\":" << aStatistics.flushes << ','
+            << "\"queue_length\":" << aStatistics.queueLength << ','
+            << "\"batches\":" << aStatistics.batches << ','
+            << "\"draw_calls\":" << aStatistics.drawCalls << ','
+            << "\"draw_calls_saved\":" << aStatistics.drawCallsSaved << ','
+            << "\"vertices_uploaded\":" << aStatistics.verticesUploaded << ','
+            << "\"instances_drawn\":" << aStatistics.instancesDrawn << ','
+            << "\"texture_uploads\":" << aStatistics.textureUploads << ','
+            << "\"texture_upload_bytes\":" << aStatistics.textureUploadBytes << ','
+            << "\"texture_uploads_pending\":" << aStatistics.textureUploadsPending << ','
+            << "\"flush_time_ms\":" << flush_time_ms(aStatistics) << ','
+            << "\"damage_regions\":" << aStatistics.damageRegions << ','
+            << "\"pixels_repainted\":" << aStatistics.pixelsRepainted << ','
+            << "\"entities_drawn\":" << aStatistics.entitiesDrawn << ','
+            << "\"entities_culled\":" << aStatistics.entitiesCulled << ','
+            << "\"batches_by_operation\":{";
+        bool first = true;
+        for (std::size_t opType = 0u; opType < RenderingStatisticsOperationTypeCount; ++opType)
+        {
+            if (aStatistics.batchesByOperation[opType] == 0u)
+                continue;
+            if (!first)
+                result << ',';
+            first = false;
+            result << '"' << graphics_operation::to_string(static_cast<graphics_operation::operation_type>(opType)) << "\":" << aStatistics.batchesByOperation[opType];
+        }
+        result << "}}";
+        return result.str();
+    }
+}
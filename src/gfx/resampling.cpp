@@ -0,0 +1,313 @@
+// resampling.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <neogfx/core/numerical.hpp>
+#include <neogfx/gfx/color.hpp>
+#include <neogfx/gfx/resampling.hpp>
+#include "color_conversion.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        // Destination rows resampled by a worker at a time; bounds the intermediate buffer.
+        std::uint32_t constexpr BandRows = 64u;
+        // Smaller sources are resampled on the calling thread only.
+        std::size_t constexpr ParallelThreshold = 256u * 256u;
+
+        // The source pixels contributing to each destination pixel along one axis and their weights.
+        struct filter_weights
+        {
+            std::vector<std::uint32_t> first;
+            std::vector<std::uint32_t> count;
+            std::vector<std::size_t> offset;
+            std::vector<float> weights;
+        };
+
+        double lanczos3(double aX)
+        {
+            if (aX == 0.0)
+                return 1.0;
+            if (std::abs(aX) >= 3.0)
+                return 0.0;
+            double const pix = math::pi<double>() * aX;
+            return 3.0 * std::sin(pix) * std::sin(pix / 3.0) / (pix * pix);
+        }
+
+        filter_weights compute_weights(std::uint32_t aSourceSize, std::uint32_t aDestinationSize, resampling_filter aFilter)
+        {
+            filter_weights result;
+            double const scale = static_cast<double>(aSourceSize) / aDestinationSize;
+            double const filterScale = std::max(scale, 1.0);
+            double const support = (aFilter == resampling_filter::Lanczos3 ? 3.0 : 0.5) * filterScale;
+            std::vector<double> weights;
+            for (std::uint32_t i = 0u; i < aDestinationSize; ++i)
+            {
+                double const center = (i + 0.5) * scale;
+                std::uint32_t const nearest = std::min(static_cast<std::uint32_t>(center), aSourceSize - 1u);
+                auto first = static_cast<std::uint32_t>(std::max(std::floor(center - support), 0.0));
+                auto const last = static_cast<std::uint32_t>(std::min(std::ceil(center + support), static_cast<double>(aSourceSize)));
+                weights.clear();
+                double total = 0.0;
+                if (aFilter != resampling_filter::None)
+                    for (std::uint32_t j = first; j < last; ++j)
+                    {
+                        double weight;
+                        if (aFilter == resampling_filter::Box)
+                            weight = std::max(std::min(j + 1.0, center + support) - std::max(static_cast<double>(j), center - support), 0.0);
+                        else
+                            weight = lanczos3((j + 0.5 - center) / filterScale);
+                        weights.push_back(weight);
+                        total += weight;
+                    }
+                if (total == 0.0)
+                {
+                    first = nearest;
+                    weights.assign(1u, 1.0);
+                    total = 1.0;
+                }
+                while (weights.back() == 0.0)
+                    weights.pop_back();
+                auto const leadingZeros = std::find_if(weights.begin(), weights.end(), [](double w) { return w != 0.0; }) - weights.begin();
+                result.first.push_back(first + static_cast<std::uint32_t>(leadingZeros));
+                result.count.push_back(static_cast<std::uint32_t>(weights.size() - leadingZeros));
+                result.offset.push_back(result.weights.size());
+                for (auto w = weights.begin() + leadingZeros; w != weights.end(); ++w)
+                    result.weights.push_back(static_cast<float>(*w / total));
+            }
+            return result;
+        }
+
+        // Every kernel accumulates weighted pixels in tap order with a separate multiply and add so that
+        // all code paths produce the same result.
+
+        void filter_row_scalar(float const* aSource, float* aDestination, filter_weights const& aWeights)
+        {
+            for (std::size_t x = 0u; x < aWeights.first.size(); ++x)
+            {
+                float const* source = aSource + aWeights.first[x] * 4u;
+                float const* weight = &aWeights.weights[aWeights.offset[x]];
+                float sum[4] = {};
+                for (std::uint32_t tap = 0u; tap < aWeights.count[x]; ++tap)
+                    for (std::size_t component = 0u; component < 4u; ++component)
+                        sum[component] += source[tap * 4u + component] * weight[tap];
+                std::copy(sum, sum + 4, aDestination + x * 4u);
+            }
+        }
+
+        // Sums the weighted rows and clamps the result to a valid premultiplied pixel; ringing from
+        // negative filter lobes can otherwise leave a component outside [0, alpha].
+        void filter_column_scalar(float const* const* aRows, float const* aWeights, std::uint32_t aTaps, float* aDestination, std::size_t aCount)
+        {
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                float sum[4] = {};
+                for (std::uint32_t tap = 0u; tap < aTaps; ++tap)
+                    for (std::size_t component = 0u; component < 4u; ++component)
+                        sum[component] += aRows[tap][i + component] * aWeights[tap];
+                float const alpha = detail::saturate(sum[3]);
+                for (std::size_t component = 0u; component < 3u; ++component)
+                    aDestination[i + component] = std::min(detail::saturate(sum[component]), alpha);
+                aDestination[i + 3u] = alpha;
+            }
+        }
+
+#ifdef NEOGFX_X86
+        void filter_row_sse2(float const* aSource, float* aDestination, filter_weights const& aWeights)
+        {
+            for (std::size_t x = 0u; x < aWeights.first.size(); ++x)
+            {
+                float const* source = aSource + aWeights.first[x] * 4u;
+                float const* weight = &aWeights.weights[aWeights.offset[x]];
+                __m128 sum = _mm_setzero_ps();
+                for (std::uint32_t tap = 0u; tap < aWeights.count[x]; ++tap)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + tap * 4u), _mm_set1_ps(weight[tap])));
+                _mm_storeu_ps(aDestination + x * 4u, sum);
+            }
+        }
+
+        void filter_column_sse2(float const* const* aRows, float const* aWeights, std::uint32_t aTaps, float* aDestination, std::size_t aCount)
+        {
+            __m128 const zero = _mm_setzero_ps();
+            __m128 const one = _mm_set1_ps(1.0f);
+            for (std::size_t i = 0u; i < aCount; i += 4u)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (std::uint32_t tap = 0u; tap < aTaps; ++tap)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(aRows[tap] + i), _mm_set1_ps(aWeights[tap])));
+                sum = _mm_min_ps(_mm_max_ps(sum, zero), one);
+                _mm_storeu_ps(aDestination + i, _mm_min_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3))));
+            }
+        }
+
+        NEOGFX_TARGET_AVX2 void filter_column_avx2(float const* const* aRows, float const* aWeights, std::uint32_t aTaps, float* aDestination, std::size_t aCount)
+        {
+            __m256 const zero = _mm256_setzero_ps();
+            __m256 const one = _mm256_set1_ps(1.0f);
+            std::size_t i = 0u;
+            for (; i + 8u <= aCount; i += 8u)
+            {
+                __m256 sum = _mm256_setzero_ps();
+                for (std::uint32_t tap = 0u; tap < aTaps; ++tap)
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(aRows[tap] + i), _mm256_set1_ps(aWeights[tap])));
+                sum = _mm256_min_ps(_mm256_max_ps(sum, zero), one);
+                _mm256_storeu_ps(aDestination + i, _mm256_min_ps(sum, _mm256_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3))));
+            }
+            if (i < aCount)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (std::uint32_t tap = 0u; tap < aTaps; ++tap)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(aRows[tap] + i), _mm_set1_ps(aWeights[tap])));
+                sum = _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+                _mm_storeu_ps(aDestination + i, _mm_min_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3))));
+            }
+        }
+#endif
+
+        struct resampling_kernels
+        {
+            void(*filterRow)(float const*, float*, filter_weights const&);
+            void(*filterColumn)(float const* const*, float const*, std::uint32_t, float*, std::size_t);
+        };
+
+        resampling_kernels const& select_resampling_kernels()
+        {
+            static resampling_kernels const sKernels = []()
+            {
+                resampling_kernels kernels{ &filter_row_scalar, &filter_column_scalar };
+#ifdef NEOGFX_X86
+                if (host_cpu_features().sse2)
+                {
+                    kernels.filterRow = &filter_row_sse2;
+                    kernels.filterColumn = &filter_column_sse2;
+                }
+                if (host_cpu_features().avx2)
+                    kernels.filterColumn = &filter_column_avx2;
+#endif
+                return kernels;
+            }();
+            return sKernels;
+        }
+
+        void decode(std::uint8_t const* aSource, float* aDestination, std::size_t aCount, color_space aColorSpace)
+        {
+            if (aColorSpace == color_space::sRGB)
+                sRGB_to_linear(std::span<std::uint8_t const>{ aSource, aCount }, std::span<float>{ aDestination, aCount });
+            else
+                for (std::size_t i = 0u; i < aCount; ++i)
+                    aDestination[i] = aSource[i] / 255.0f;
+            premultiply(std::span<float>{ aDestination, aCount });
+        }
+
+        void encode(float* aSource, std::uint8_t* aDestination, std::size_t aCount, color_space aColorSpace)
+        {
+            unpremultiply(std::span<float>{ aSource, aCount });
+            if (aColorSpace == color_space::sRGB)
+                linear_to_sRGB(std::span<float const>{ aSource, aCount }, std::span<std::uint8_t>{ aDestination, aCount });
+            else
+                for (std::size_t i = 0u; i < aCount; ++i)
+                    aDestination[i] = detail::to_component(aSource[i]);
+        }
+    }
+
+    void resample(std::span<std::uint8_t const> aSource, size_u32 const& aSourceExtents, std::span<std::uint8_t> aDestination, size_u32 const& aDestinationExtents, resampling_filter aFilter, color_space aColorSpace)
+    {
+        std::size_t const sourceStride = aSourceExtents.cx * 4u;
+        std::size_t const destinationStride = aDestinationExtents.cx * 4u;
+        if (aSource.size() != sourceStride * aSourceExtents.cy || aDestination.size() != destinationStride * aDestinationExtents.cy)
+            throw bad_pixel_buffer();
+        if (aDestination.empty())
+            return;
+        if (aSource.empty())
+            throw bad_pixel_buffer();
+
+        auto const& kernels = select_resampling_kernels();
+        auto const columns = compute_weights(aSourceExtents.cx, aDestinationExtents.cx, aFilter);
+        auto const rows = compute_weights(aSourceExtents.cy, aDestinationExtents.cy, aFilter);
+        std::size_t const bands = (aDestinationExtents.cy + BandRows - 1u) / BandRows;
+
+        // each worker filters the source rows a band of destination rows needs horizontally, then
+        // filters the band's columns; bands share a few source rows which are filtered by both
+        struct buffers
+        {
+            std::vector<float> sourceRow;
+            std::vector<float> filteredRows;
+            std::vector<float> destinationRow;
+            std::vector<float const*> taps;
+        };
+        auto resample_band = [&](std::size_t aBand, buffers& aBuffers)
+        {
+            std::uint32_t const y0 = static_cast<std::uint32_t>(aBand * BandRows);
+            std::uint32_t const y1 = std::min(y0 + BandRows, aDestinationExtents.cy);
+            std::uint32_t sourceFirst = rows.first[y0];
+            std::uint32_t sourceLast = 0u;
+            for (std::uint32_t y = y0; y < y1; ++y)
+            {
+                sourceFirst = std::min(sourceFirst, rows.first[y]);
+                sourceLast = std::max(sourceLast, rows.first[y] + rows.count[y]);
+            }
+            aBuffers.sourceRow.resize(sourceStride);
+            aBuffers.filteredRows.resize((sourceLast - sourceFirst) * destinationStride);
+            aBuffers.destinationRow.resize(destinationStride);
+            for (std::uint32_t sourceY = sourceFirst; sourceY < sourceLast; ++sourceY)
+            {
+                decode(&aSource[sourceY * sourceStride], aBuffers.sourceRow.data(), sourceStride, aColorSpace);
+                kernels.filterRow(aBuffers.sourceRow.data(), &aBuffers.filteredRows[(sourceY - sourceFirst) * destinationStride], columns);
+            }
+            for (std::uint32_t y = y0; y < y1; ++y)
+            {
+                aBuffers.taps.clear();
+                for (std::uint32_t tap = 0u; tap < rows.count[y]; ++tap)
+                    aBuffers.taps.push_back(&aBuffers.filteredRows[(rows.first[y] + tap - sourceFirst) * destinationStride]);
+                kernels.filterColumn(aBuffers.taps.data(), &rows.weights[rows.offset[y]], rows.count[y], aBuffers.destinationRow.data(), destinationStride);
+                encode(aBuffers.destinationRow.data(), &aDestination[y * destinationStride], destinationStride, aColorSpace);
+            }
+        };
+
+        std::atomic<std::size_t> nextBand = 0u;
+        auto work = [&]()
+        {
+            buffers workerBuffers;
+            for (std::size_t next; (next = nextBand++) < bands;)
+                resample_band(next, workerBuffers);
+        };
+        std::size_t const threads = std::max(std::thread::hardware_concurrency(), 1u);
+        if (bands > 1u && threads > 1u && aSource.size() / 4u >= ParallelThreshold)
+        {
+            std::vector<std::future<void>> workers;
+            for (std::size_t worker = 1u; worker < std::min(threads, bands); ++worker)
+                workers.push_back(std::async(std::launch::async, work));
+            work();
+            for (auto& worker : workers)
+                worker.get();
+        }
+        else
+            work();
+    }
+}
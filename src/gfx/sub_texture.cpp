@@ -209,12 +209,22 @@ namespace neogfx
                     for (std::size_t x = 0; x < imagePartExtents.cx; ++x)
                         for (std::size_t c = 0; c < 4; ++c)
                             data[(imagePartExtents.cy - 1 - y) * imagePartExtents.cx * 4 + x * 4 + c] = imageData[(y + imagePartOrigin.y) * imageExtents.cx * 4 + (x + imagePartOrigin.x) * 4 + c];
-                set_pixels(rect{ point{}, imagePartExtents }, &data[0]);
+                set_pixels_async(rect{ point{}, imagePartExtents }, &data[0], data_format());
             }
             break;
         }
     }
 
+    void sub_texture::set_pixels_async(rect const& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded, std::uint32_t aStride, std::uint32_t aPackAlignment)
+    {
+        rect r = aRect;
+        r.position() += atlas_location().position();
+        r = r.intersection(atlas_location());
+        if (r.cx != aRect.cx || r.cy != aRect.cy)
+            throw bad_rectangle();
+        native_texture().set_pixels_async(r, aPixelData, aDataFormat, aUploaded, aStride, aPackAlignment);
+    }
+
     void sub_texture::set_pixel(point const& aPosition, color const& aColor)
     {
         native_texture().set_pixel(aPosition + atlas_location().position(), aColor);
@@ -85,13 +85,28 @@ namespace neogfx
         catch (...)
         {
         }
+        // page 0 is the empty page shared by all code point blocks containing no emoji
+        iSingleEmojiPages.emplace_back();
+        for (auto const& e : iEmojiMap)
+        {
+            if (e.first.size() != 1u || e.first[0] >= 0x110000u)
+                continue;
+            auto& pageIndex = iSingleEmojiPageIndex[e.first[0] >> 8];
+            if (pageIndex == 0u)
+            {
+                pageIndex = static_cast<std::uint16_t>(iSingleEmojiPages.size());
+                iSingleEmojiPages.emplace_back();
+            }
+            iSingleEmojiPages[pageIndex][(e.first[0] & 0xFFu) >> 6] |= (1ull << (e.first[0] & 0x3Fu));
+        }
     }
 
     bool emoji_atlas::is_emoji(char32_t aCodePoint) const
     {
-        thread_local std::u32string str;
-        str = aCodePoint;
-        return is_emoji(str);
+        if (aCodePoint >= 0x110000u)
+            return false;
+        auto const& page = iSingleEmojiPages[iSingleEmojiPageIndex[aCodePoint >> 8]];
+        return (page[(aCodePoint & 0xFFu) >> 6] >> (aCodePoint & 0x3Fu)) & 1u;
     }
 
     bool emoji_atlas::is_emoji(const std::u32string& aCodePoints) const
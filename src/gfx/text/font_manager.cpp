@@ -20,6 +20,11 @@
 #include <neogfx/neogfx.hpp>
 
 #include <filesystem>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <neolib/core/string_utils.hpp>
 #include <neolib/core/string_utf.hpp>
 #include <ft2build.h>
@@ -43,6 +48,7 @@
 #endif
 
 #include <neolib/file/file.hpp>
+#include <neolib/task/thread_pool.hpp>
 
 #include <neogfx/app/i_app.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
@@ -189,11 +195,49 @@ namespace neogfx
             hb_script_t script;
         };
         typedef std::vector<glyph_run> run_list;
+        struct preshaped_key
+        {
+            std::u32string text;
+            hb_font_t* font;
+            bool kerning;
+            text_direction direction;
+            hb_script_t script;
+
+            bool operator==(preshaped_key const&) const = default;
+        };
+        struct preshaped_key_hash
+        {
+            std::size_t operator()(preshaped_key const& aKey) const
+            {
+                std::size_t result = std::hash<std::u32string>{}(aKey.text);
+                result ^= std::hash<hb_font_t*>{}(aKey.font) + 0x9e3779b9u + (result << 6) + (result >> 2);
+                result ^= static_cast<std::size_t>(aKey.script) + (static_cast<std::size_t>(aKey.direction) << 1) + (aKey.kerning ? 1u : 0u);
+                return result;
+            }
+        };
+        struct preshaped_run
+        {
+            std::vector<hb_glyph_info_t> glyphInfo;
+            std::vector<hb_glyph_position_t> glyphPos;
+        };
+        typedef std::unordered_map<preshaped_key, preshaped_run, preshaped_key_hash> preshaped_cache;
+    public:
+        static constexpr std::size_t ParallelShapingMinCodePoints = 4096u;
+        static constexpr std::size_t ParallelShapingRunsPerWorker = 8u;
+        static constexpr std::size_t PreshapedCacheCapacity = 1024u * 1024u; // code points
     public:
         glyph_text create_glyph_text() override;
         glyph_text create_glyph_text(font const& aFont) override;
         glyph_text to_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) override;
         glyph_text to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines = true) override;
+        void preshape(char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector) override;
+    private:
+        bool make_runs(std::optional<char32_t> const& aMnemonic, char32_t const* aCodePoints, std::size_t aCodePointCount, i_font_selector const& aFontSelector, 
+            std::vector<character_type>& aTextDirections, run_list& aRuns) const;
+    private:
+        std::mutex iPreshapedMutex;
+        preshaped_cache iPreshaped;
+        std::size_t iPreshapedCodePoints = 0u;
     };
 
     class glyph_shapes
@@ -205,17 +249,37 @@ namespace neogfx
         {
         public:
             glyphs(const i_graphics_context& aParent, const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun) :
+                glyphs{ aParent, static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzFont, aFont.kerning(), aGlyphRun,
+                    static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzBuf }
+            {
+            }
+            glyphs(const i_graphics_context& aParent, hb_font_t* aFont, bool aKerning, const glyph_text_factory::glyph_run& aGlyphRun, hb_buffer_t* aBuf) :
                 iParent{ aParent },
-                iFont{ static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzFont },
+                iFont{ aFont },
                 iGlyphRun{ aGlyphRun },
-                iBuf{ static_cast<font_face_handle*>(aFont.native_font_face().handle())->harfbuzzBuf },
                 iGlyphCount{ 0u }
             {
-                hb_buffer_set_direction(iBuf, aGlyphRun.direction == text_direction::RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
-                hb_buffer_set_script(iBuf, aGlyphRun.script);
-                hb_buffer_set_cluster_level(iBuf, HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
-                hb_buffer_add_utf32(iBuf, reinterpret_cast<const std::uint32_t*>(aGlyphRun.start), static_cast<int>(aGlyphRun.end - aGlyphRun.start), 0, static_cast<int>(aGlyphRun.end - aGlyphRun.start));
-                scoped_kerning sk{ aFont.kerning() };
+                shape(iFont, aKerning, aGlyphRun, aBuf, iGlyphInfo, iGlyphPos);
+                iGlyphCount = static_cast<std::uint32_t>(iGlyphInfo.size());
+            }
+            glyphs(const i_graphics_context& aParent, hb_font_t* aFont, const glyph_text_factory::glyph_run& aGlyphRun, glyph_text_factory::preshaped_run const& aPreshaped) :
+                iParent{ aParent },
+                iFont{ aFont },
+                iGlyphRun{ aGlyphRun },
+                iGlyphCount{ static_cast<std::uint32_t>(aPreshaped.glyphInfo.size()) },
+                iGlyphInfo{ aPreshaped.glyphInfo },
+                iGlyphPos{ aPreshaped.glyphPos }
+            {
+            }
+        public:
+            static void shape(hb_font_t* aFont, bool aKerning, const glyph_text_factory::glyph_run& aGlyphRun, hb_buffer_t* aBuf, 
+                std::vector<hb_glyph_info_t>& aGlyphInfo, std::vector<hb_glyph_position_t>& aGlyphPos)
+            {
+                hb_buffer_set_direction(aBuf, aGlyphRun.direction == text_direction::RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
+                hb_buffer_set_script(aBuf, aGlyphRun.script);
+                hb_buffer_set_cluster_level(aBuf, HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
+                hb_buffer_add_utf32(aBuf, reinterpret_cast<const std::uint32_t*>(aGlyphRun.start), static_cast<int>(aGlyphRun.end - aGlyphRun.start), 0, static_cast<int>(aGlyphRun.end - aGlyphRun.start));
+                scoped_kerning sk{ aKerning };
                 /// @todo add ligature support to neogfx::font...
                 static hb_feature_t features[2];
                 static bool init = [](hb_feature_t* features) {
@@ -223,17 +287,13 @@ namespace neogfx
                     hb_feature_from_string("dlig=0", -1, &features[1]); 
                     return true;
                     }(features);
-                hb_shape(iFont, iBuf, features, 2);
+                hb_shape(aFont, aBuf, features, 2);
                 unsigned int glyphCount = 0;
-                auto glyphInfo = hb_buffer_get_glyph_infos(iBuf, &glyphCount);
-                iGlyphInfo.assign(glyphInfo, glyphInfo + glyphCount);
-                auto glyphPos = hb_buffer_get_glyph_positions(iBuf, &glyphCount);
-                iGlyphPos.assign(glyphPos, glyphPos + glyphCount);
-                iGlyphCount = glyphCount;
-            }
-            ~glyphs()
-            {
-                hb_buffer_clear_contents(iBuf);
+                auto glyphInfo = hb_buffer_get_glyph_infos(aBuf, &glyphCount);
+                aGlyphInfo.assign(glyphInfo, glyphInfo + glyphCount);
+                auto glyphPos = hb_buffer_get_glyph_positions(aBuf, &glyphCount);
+                aGlyphPos.assign(glyphPos, glyphPos + glyphCount);
+                hb_buffer_clear_contents(aBuf);
             }
         public:
             std::uint32_t glyph_count() const
@@ -262,7 +322,6 @@ namespace neogfx
             const i_graphics_context& iParent;
             hb_font_t* iFont;
             const glyph_text_factory::glyph_run& iGlyphRun;
-            hb_buffer_t* iBuf;
             std::uint32_t iGlyphCount;
             std::vector<hb_glyph_info_t> iGlyphInfo;
             std::vector<hb_glyph_position_t> iGlyphPos;
@@ -270,12 +329,16 @@ namespace neogfx
         typedef std::list<glyphs> glyphs_list;
         typedef std::vector<std::pair<glyphs_list::const_iterator, std::uint32_t>> result_type;
     public:
-        glyph_shapes(const i_graphics_context& aParent, const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun)
+        glyph_shapes(const i_graphics_context& aParent, const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun) :
+            glyph_shapes{ aParent, aFont, aGlyphRun, glyphs{ aParent, aFont, aGlyphRun } }
+        {
+        }
+        glyph_shapes(const i_graphics_context& aParent, const font& aFont, const glyph_text_factory::glyph_run& aGlyphRun, glyphs&& aPrimary)
         {
             thread_local std::vector<font> fontsTried;
             auto tryFont = aFont;
             fontsTried.push_back(aFont);
-            iGlyphsList.emplace_back(glyphs{ aParent, tryFont, aGlyphRun });
+            iGlyphsList.push_back(std::move(aPrimary));
             while (iGlyphsList.back().needs_fallback_font())
             {
                 if (tryFont.has_fallback() && std::find(fontsTried.begin(), fontsTried.end(), tryFont.fallback()) == fontsTried.end())
@@ -393,44 +456,19 @@ namespace neogfx
         } }, aAlignBaselines);
     }
 
-    glyph_text glyph_text_factory::to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines)
+    bool glyph_text_factory::make_runs(std::optional<char32_t> const& aMnemonic, char32_t const* aCodePoints, std::size_t aCodePointCount, i_font_selector const& aFontSelector, 
+        std::vector<character_type>& aTextDirections, run_list& aRuns) const
     {
         auto const& emojiAtlas = service<i_font_manager>().emoji_atlas();
-
-        auto refResult = make_ref<glyph_text_content>(aFontSelector.select_font(0));
-        auto& result = *refResult;
-
-        if (aUtf32End == aUtf32Begin)
-            return result;
-
+        auto const codePoints = aCodePoints;
+        auto const codePointCount = aCodePointCount;
+        auto& textDirections = aTextDirections;
+        auto& runs = aRuns;
         bool hasEmojis = false;
 
-        thread_local std::vector<character_type> textDirections;
-        textDirections.clear();
-
-        std::u32string::size_type codePointCount = aUtf32End - aUtf32Begin;
-
-        thread_local std::vector<std::u32string::size_type> clusters;
-        clusters.clear();
-        for (std::u32string::size_type c = 0; c < codePointCount; ++c)
-            clusters.push_back(c);
-
-        thread_local std::u32string adjustedCodepoints;
-        adjustedCodepoints.clear();
-
-        if (!aGc.password())
-            adjustedCodepoints.assign(aUtf32Begin, aUtf32End);
-        else
-            adjustedCodepoints.assign(codePointCount, neolib::utf8_to_utf32(aGc.password_mask())[0]);
-
-        auto codePoints = &adjustedCodepoints[0];
-
-        thread_local run_list runs;
-        runs.clear();
-
         text_category previousCategory = get_text_category(emojiAtlas, codePoints, codePoints + codePointCount);
-        if (aGc.mnemonic_set() && codePoints[0] == static_cast<char32_t>(aGc.mnemonic()) && 
-            (codePointCount == 1 || codePoints[1] != static_cast<char32_t>(aGc.mnemonic())))
+        if (aMnemonic && codePoints[0] == *aMnemonic && 
+            (codePointCount == 1 || codePoints[1] != *aMnemonic))
             previousCategory = text_category::Mnemonic;
         bool newLine = false;
         bool previousNewLine = false;
@@ -478,8 +516,8 @@ namespace neogfx
             
             text_category currentCategory = get_text_category(emojiAtlas, codePoints + codePointIndex, codePoints + codePointCount);
             
-            if (aGc.mnemonic_set() && codePoints[codePointIndex] == static_cast<char32_t>(aGc.mnemonic()) &&
-                (codePointCount - 1 == codePointIndex || codePoints[codePointIndex + 1] != static_cast<char32_t>(aGc.mnemonic())))
+            if (aMnemonic && codePoints[codePointIndex] == *aMnemonic &&
+                (codePointCount - 1 == codePointIndex || codePoints[codePointIndex + 1] != *aMnemonic))
                 currentCategory = text_category::Mnemonic;
             
             previousNewLine = newLine;
@@ -557,10 +595,6 @@ namespace neogfx
 
         runs.emplace_back(runStart, &codePoints[lastCodePointIndex + 1], previousLineDirection, previousDirection, previousCategory == text_category::Mnemonic, previousScript);
 
-        float lineStart = 0.0f;
-        vec2f previousAdvance = {};
-        quadf_2d previousCell = {};
-
         auto runFrom = runs.begin();
         for (auto runTo = runs.begin(); runTo != runs.end(); ++runTo)
         {
@@ -574,6 +608,103 @@ namespace neogfx
         if (runFrom->currentLineDirection == text_direction::RTL)
             std::reverse(runFrom, runs.end());
 
+        return hasEmojis;
+    }
+
+    glyph_text glyph_text_factory::to_glyph_text(i_graphics_context const& aGc, char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector, bool aAlignBaselines)
+    {
+        auto const& emojiAtlas = service<i_font_manager>().emoji_atlas();
+
+        auto refResult = make_ref<glyph_text_content>(aFontSelector.select_font(0));
+        auto& result = *refResult;
+
+        if (aUtf32End == aUtf32Begin)
+            return result;
+
+        thread_local std::vector<character_type> textDirections;
+        textDirections.clear();
+
+        std::u32string::size_type codePointCount = aUtf32End - aUtf32Begin;
+
+        thread_local std::vector<std::u32string::size_type> clusters;
+        clusters.clear();
+        for (std::u32string::size_type c = 0; c < codePointCount; ++c)
+            clusters.push_back(c);
+
+        thread_local std::u32string adjustedCodepoints;
+        adjustedCodepoints.clear();
+
+        if (!aGc.password())
+            adjustedCodepoints.assign(aUtf32Begin, aUtf32End);
+        else
+            adjustedCodepoints.assign(codePointCount, neolib::utf8_to_utf32(aGc.password_mask())[0]);
+
+        auto codePoints = &adjustedCodepoints[0];
+
+        thread_local run_list runs;
+        runs.clear();
+
+        std::optional<char32_t> const mnemonic = aGc.mnemonic_set() ? static_cast<char32_t>(aGc.mnemonic()) : std::optional<char32_t>{};
+        bool const hasEmojis = make_runs(mnemonic, codePoints, codePointCount, aFontSelector, textDirections, runs);
+
+        float lineStart = 0.0f;
+        vec2f previousAdvance = {};
+        quadf_2d previousCell = {};
+
+        // primary font shaping of independent runs can proceed concurrently on the shared thread pool; fallback font resolution below stays on this thread
+        std::vector<std::optional<glyph_shapes::glyphs>> preshaped;
+        std::size_t const shapingWorkers = service<i_font_manager>().parallel_shaping() && codePointCount >= ParallelShapingMinCodePoints ?
+            std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), runs.size() / ParallelShapingRunsPerWorker) : 0u;
+        if (shapingWorkers > 1u)
+        {
+            std::vector<std::pair<hb_font_t*, bool>> runFonts(runs.size());
+            for (std::size_t i = 0; i < runs.size(); ++i)
+                if (!runs[i].mnemonic)
+                {
+                    auto const runFont = aFontSelector.select_font(runs[i].start - &codePoints[0]);
+                    runFonts[i] = { static_cast<font_face_handle*>(runFont.native_font_face().handle())->harfbuzzFont, runFont.kerning() };
+                }
+            preshaped.resize(runs.size());
+            std::atomic<std::size_t> nextRun = 0u;
+            auto& shapingRuns = runs; // thread_local so must not be named on a worker
+            auto shape_runs = [&]()
+            {
+                std::unique_ptr<hb_buffer_t, decltype(&hb_buffer_destroy)> buf{ hb_buffer_create(), &hb_buffer_destroy };
+                for (std::size_t i = nextRun++; i < shapingRuns.size(); i = nextRun++)
+                    if (!shapingRuns[i].mnemonic)
+                        preshaped[i].emplace(aGc, runFonts[i].first, runFonts[i].second, shapingRuns[i], buf.get());
+            };
+            std::vector<std::future<void>> workers;
+            for (std::size_t w = 1u; w < shapingWorkers; ++w)
+                workers.push_back(neolib::thread_pool::default_thread_pool().run(shape_runs).first);
+            shape_runs();
+            for (auto& w : workers)
+                w.get();
+        }
+        else if (!aGc.password())
+        {
+            // pick up runs shaped ahead of time by preshape()
+            std::scoped_lock lock{ iPreshapedMutex };
+            if (!iPreshaped.empty())
+            {
+                preshaped.resize(runs.size());
+                preshaped_key key;
+                for (std::size_t i = 0; i < runs.size(); ++i)
+                    if (!runs[i].mnemonic)
+                    {
+                        auto const runFont = aFontSelector.select_font(runs[i].start - &codePoints[0]);
+                        key.text.assign(runs[i].start, runs[i].end);
+                        key.font = static_cast<font_face_handle*>(runFont.native_font_face().handle())->harfbuzzFont;
+                        key.kerning = runFont.kerning();
+                        key.direction = runs[i].direction;
+                        key.script = runs[i].script;
+                        auto const existing = iPreshaped.find(key);
+                        if (existing != iPreshaped.end())
+                            preshaped[i].emplace(aGc, key.font, runs[i], existing->second);
+                    }
+            }
+        }
+
         for (std::size_t i = 0; i < runs.size(); ++i)
         {
             if (runs[i].mnemonic)
@@ -581,7 +712,9 @@ namespace neogfx
             
             bool drawMnemonic = (i > 0 && runs[i - 1].mnemonic);
             std::string::size_type sourceClusterRunStart = runs[i].start - &codePoints[0];
-            glyph_shapes shapes{ aGc, aFontSelector.select_font(sourceClusterRunStart), runs[i] };
+            glyph_shapes shapes = i < preshaped.size() && preshaped[i] ?
+                glyph_shapes{ aGc, aFontSelector.select_font(sourceClusterRunStart), runs[i], std::move(*preshaped[i]) } :
+                glyph_shapes{ aGc, aFontSelector.select_font(sourceClusterRunStart), runs[i] };
 
             for (std::uint32_t j = 0; j < shapes.glyph_count(); ++j)
             {
@@ -820,10 +953,49 @@ namespace neogfx
             return result;
     }
 
+    void glyph_text_factory::preshape(char32_t const* aUtf32Begin, char32_t const* aUtf32End, i_font_selector const& aFontSelector)
+    {
+        if (aUtf32End == aUtf32Begin)
+            return;
+
+        std::vector<character_type> textDirections;
+        run_list runs;
+        make_runs({}, aUtf32Begin, aUtf32End - aUtf32Begin, aFontSelector, textDirections, runs);
+
+        std::unique_ptr<hb_buffer_t, decltype(&hb_buffer_destroy)> buf{ hb_buffer_create(), &hb_buffer_destroy };
+        std::vector<std::pair<preshaped_key, preshaped_run>> shaped;
+        shaped.reserve(runs.size());
+        for (auto const& run : runs)
+        {
+            auto const runFont = aFontSelector.select_font(run.start - aUtf32Begin);
+            auto& entry = shaped.emplace_back(preshaped_key{
+                std::u32string{ run.start, run.end },
+                static_cast<font_face_handle*>(runFont.native_font_face().handle())->harfbuzzFont,
+                runFont.kerning(),
+                run.direction,
+                run.script }, preshaped_run{});
+            glyph_shapes::glyphs::shape(entry.first.font, entry.first.kerning, run, buf.get(), entry.second.glyphInfo, entry.second.glyphPos);
+        }
+
+        std::scoped_lock lock{ iPreshapedMutex };
+        if (iPreshapedCodePoints + static_cast<std::size_t>(aUtf32End - aUtf32Begin) > PreshapedCacheCapacity)
+        {
+            iPreshaped.clear();
+            iPreshapedCodePoints = 0u;
+        }
+        for (auto& entry : shaped)
+        {
+            auto const length = entry.first.text.size();
+            if (iPreshaped.insert(std::move(entry)).second)
+                iPreshapedCodePoints += length;
+        }
+    }
+
     font_manager::font_manager() :
         iGlyphTextFactory{ std::make_unique<neogfx::glyph_text_factory>() },
         iGlyphAtlas{ size{1024.0, 1024.0} },
-        iEmojiAtlas{}
+        iEmojiAtlas{},
+        iShapedTextStats{ 0u, 0u, 0u, 0u, 0u, 4u * 1024u * 1024u }
     {
         FT_Error error = FT_Init_FreeType(&iFontLib);
         if (error)
@@ -897,6 +1069,8 @@ namespace neogfx
 
     font_manager::~font_manager()
     {
+        clear_shaped_text_cache();
+        iPrefetchingFaces.clear();
         iIdCache.clear();
         iFontFamilies.clear();
         iNativeFonts.clear();
@@ -1144,6 +1318,185 @@ namespace neogfx
         return *iGlyphTextFactory;
     }
 
+    std::size_t font_manager::shaped_text_key_hash::operator()(shaped_text_key const& aKey) const noexcept
+    {
+        auto result = std::hash<std::string>{}(aKey.text);
+        result ^= std::hash<std::uint64_t>{}((static_cast<std::uint64_t>(aKey.font) << 32u) | aKey.flags) + 0x9e3779b9u + (result << 6u) + (result >> 2u);
+        return result;
+    }
+
+    glyph_text font_manager::cached_glyph_text(i_graphics_context const& aGc, char const* aUtf8Begin, char const* aUtf8End, font const& aFont)
+    {
+        // password text is never retained and tab stops are not part of the key
+        if (aGc.password() || aGc.has_tab_stops() || iShapedTextStats.capacity == 0u)
+            return glyph_text_factory().to_glyph_text(aGc, aUtf8Begin, aUtf8End, font_selector{ [&aFont](std::size_t) { return aFont; } });
+
+        thread_local shaped_text_key key;
+        key.text.assign(aUtf8Begin, aUtf8End);
+        key.font = aFont.id();
+        key.flags = static_cast<std::uint32_t>(aGc.logical_coordinate_system()) |
+            (aGc.is_subpixel_rendering_on() ? 0x10u : 0x00u) |
+            (aGc.mnemonic_set() ? 0x20u | (static_cast<std::uint32_t>(static_cast<unsigned char>(aGc.mnemonic())) << 8u) : 0x00u);
+
+        auto existing = iShapedText.find(key);
+        if (existing != iShapedText.end())
+        {
+            ++iShapedTextStats.hits;
+            iShapedTextLru.splice(iShapedTextLru.begin(), iShapedTextLru, existing->second.lru);
+            return to_glyph_text(existing->second, aFont);
+        }
+
+        ++iShapedTextStats.misses;
+        auto result = glyph_text_factory().to_glyph_text(aGc, aUtf8Begin, aUtf8End, font_selector{ [&aFont](std::size_t) { return aFont; } });
+        shaped_text_entry entry{ { result.cbegin(), result.cend() }, {}, result.baseline(), result.extents(), { key.font }, 0u, {} };
+        for (auto const lineBreak : result.line_breaks())
+            entry.lineBreaks.push_back(lineBreak);
+        for (auto const& glyph : entry.glyphs)
+            if (has_font(glyph) && std::find(entry.fonts.begin(), entry.fonts.end(), glyph.font) == entry.fonts.end())
+                entry.fonts.push_back(glyph.font);
+        std::size_t const bytes = sizeof(shaped_text_key) + sizeof(shaped_text_entry) + key.text.size() + entry.glyphs.size() * sizeof(glyph_char) +
+            entry.lineBreaks.size() * sizeof(glyph_text::size_type) + entry.fonts.size() * sizeof(font_id);
+        if (bytes > iShapedTextStats.capacity)
+            return result;
+        entry.bytes = bytes;
+        evict_shaped_text(iShapedTextStats.capacity - bytes);
+        auto const newEntry = iShapedText.emplace(key, std::move(entry)).first;
+        iShapedTextLru.push_front(&newEntry->first);
+        newEntry->second.lru = iShapedTextLru.begin();
+        iShapedTextStats.bytes += bytes;
+        iShapedTextStats.entries = iShapedText.size();
+        return result;
+    }
+
+    shaped_text_cache_statistics font_manager::shaped_text_cache_stats() const
+    {
+        return iShapedTextStats;
+    }
+
+    void font_manager::set_shaped_text_cache_capacity(std::size_t aCapacity)
+    {
+        iShapedTextStats.capacity = aCapacity;
+        evict_shaped_text(aCapacity);
+    }
+
+    void font_manager::clear_shaped_text_cache()
+    {
+        iShapedTextLru.clear();
+        iShapedText.clear();
+        iShapedTextStats.bytes = 0u;
+        iShapedTextStats.entries = 0u;
+    }
+
+    bool font_manager::parallel_shaping() const
+    {
+        return iParallelShaping;
+    }
+
+    void font_manager::set_parallel_shaping(bool aParallelShaping)
+    {
+        iParallelShaping = aParallelShaping;
+    }
+
+    void font_manager::prefetch_glyphs(glyph_text const& aText)
+    {
+        thread_local std::vector<std::uint32_t> glyphIndices;
+        for (auto g = aText.begin(); g != aText.end();)
+        {
+            if (!has_font_glyph(*g))
+            {
+                ++g;
+                continue;
+            }
+            auto const fontId = g->font;
+            glyphIndices.clear();
+            for (; g != aText.end() && (g->font == fontId || !has_font_glyph(*g)); ++g)
+                if (has_font_glyph(*g))
+                    glyphIndices.push_back(g->value);
+            prefetch_glyphs(font_from_id(fontId).native_font_face(), glyphIndices);
+        }
+    }
+
+    void font_manager::prefetch_glyphs(font const& aFont, char32_t const* aCodePointsBegin, char32_t const* aCodePointsEnd)
+    {
+        thread_local std::vector<std::uint32_t> glyphIndices;
+        glyphIndices.clear();
+        auto& face = aFont.native_font_face();
+        for (auto cp = aCodePointsBegin; cp != aCodePointsEnd; ++cp)
+        {
+            auto const glyphIndex = face.glyph_index(*cp);
+            if (glyphIndex != 0u)
+                glyphIndices.push_back(glyphIndex);
+        }
+        prefetch_glyphs(face, glyphIndices);
+    }
+
+    void font_manager::upload_prefetched_glyphs()
+    {
+        std::erase_if(iPrefetchingFaces, [](ref_ptr<i_native_font_face> const& aFace) { return !aFace->upload_prefetched_glyphs(); });
+    }
+
+    i_string const& font_manager::glyph_disk_cache_directory() const
+    {
+        return iGlyphDiskCacheDirectory;
+    }
+
+    void font_manager::set_glyph_disk_cache_directory(i_string const& aDirectory)
+    {
+        iGlyphDiskCacheDirectory = aDirectory;
+    }
+
+    void font_manager::prefetch_glyphs(i_native_font_face& aFace, std::vector<std::uint32_t> const& aGlyphIndices)
+    {
+        if (aGlyphIndices.empty())
+            return;
+        aFace.prefetch_glyphs(aGlyphIndices.data(), aGlyphIndices.data() + aGlyphIndices.size());
+        if (std::find_if(iPrefetchingFaces.begin(), iPrefetchingFaces.end(), [&](ref_ptr<i_native_font_face> const& aExisting) { return &*aExisting == &aFace; }) == iPrefetchingFaces.end())
+            iPrefetchingFaces.push_back(ref_ptr<i_native_font_face>{ aFace });
+    }
+
+    void font_manager::evict_shaped_text(std::size_t aCapacity)
+    {
+        while (iShapedTextStats.bytes > aCapacity && !iShapedTextLru.empty())
+        {
+            auto const oldest = iShapedText.find(*iShapedTextLru.back());
+            iShapedTextStats.bytes -= oldest->second.bytes;
+            iShapedTextLru.pop_back();
+            iShapedText.erase(oldest);
+            ++iShapedTextStats.evictions;
+        }
+        iShapedTextStats.entries = iShapedText.size();
+    }
+
+    void font_manager::evict_shaped_text(std::vector<font_id> const& aFonts)
+    {
+        for (auto entry = iShapedTextLru.begin(); entry != iShapedTextLru.end();)
+        {
+            auto const existing = iShapedText.find(**entry);
+            auto const& fonts = existing->second.fonts;
+            if (std::find_first_of(fonts.begin(), fonts.end(), aFonts.begin(), aFonts.end()) != fonts.end())
+            {
+                iShapedTextStats.bytes -= existing->second.bytes;
+                entry = iShapedTextLru.erase(entry);
+                iShapedText.erase(existing);
+                ++iShapedTextStats.evictions;
+            }
+            else
+                ++entry;
+        }
+        iShapedTextStats.entries = iShapedText.size();
+    }
+
+    glyph_text font_manager::to_glyph_text(shaped_text_entry const& aEntry, font const& aFont)
+    {
+        glyph_text result{ aFont };
+        result.insert(result.cend(), aEntry.glyphs.data(), aEntry.glyphs.data() + aEntry.glyphs.size());
+        for (auto const lineBreak : aEntry.lineBreaks)
+            result.line_breaks().push_back(lineBreak);
+        result.set_baseline(aEntry.baseline);
+        result.set_extents(aEntry.extents);
+        return result;
+    }
+
     const i_texture_atlas& font_manager::glyph_atlas() const
     {
         return iGlyphAtlas;
@@ -1311,13 +1664,21 @@ namespace neogfx
 
     void font_manager::cleanup()
     {
+        thread_local std::vector<font_id> releasedIds;
+        releasedIds.clear();
         for (auto i = iIdCache.begin(); i != iIdCache.end();)
         {
             auto& cacheEntry = *i;
             if (cacheEntry.native_font_face().use_count() == 1)
+            {
+                releasedIds.push_back(cacheEntry.id());
                 i = iIdCache.erase(i);
+            }
             else
                 ++i;
         }
+        // released font ids are reused so shaped text keyed on them must go too
+        if (!releasedIds.empty())
+            evict_shaped_text(releasedIds);
     }
 }
\ No newline at end of file
@@ -0,0 +1,280 @@
+// glyph_disk_cache.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2015, 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+#include "glyph_disk_cache.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        // FNV-1a over 64-bit words (then any trailing bytes) as font files can be large
+        std::uint64_t fnv1a(void const* aData, std::size_t aSize, std::uint64_t aHash = 14695981039346656037ull)
+        {
+            auto const bytes = static_cast<std::uint8_t const*>(aData);
+            std::size_t i = 0;
+            for (; i + sizeof(std::uint64_t) <= aSize; i += sizeof(std::uint64_t))
+            {
+                std::uint64_t word;
+                std::memcpy(&word, bytes + i, sizeof(word));
+                aHash ^= word;
+                aHash *= 1099511628211ull;
+            }
+            for (; i < aSize; ++i)
+            {
+                aHash ^= bytes[i];
+                aHash *= 1099511628211ull;
+            }
+            return aHash;
+        }
+
+        constexpr std::size_t padded(std::size_t aSize)
+        {
+            return (aSize + 3u) & ~std::size_t{ 3u };
+        }
+    }
+
+    glyph_disk_cache_file::glyph_disk_cache_file(std::filesystem::path const& aDirectory, glyph_disk_cache_key const& aKey) :
+        iKey{ aKey }
+    {
+        std::ostringstream fileName;
+        fileName << std::hex << std::setw(16) << std::setfill('0') << fnv1a(&aKey, sizeof(aKey)) << ".glyphs";
+        iPath = aDirectory / fileName.str();
+        std::error_code ec;
+        std::filesystem::create_directories(aDirectory, ec);
+        bool const writer = lock();
+        map();
+        auto const validSize = index();
+        if (!writer)
+            return;
+        if (validSize == 0u)
+        {
+            unmap();
+            create();
+        }
+        else if (validSize != iDataSize)
+        {
+            unmap();
+            std::filesystem::resize_file(iPath, validSize, ec);
+            map();
+            index();
+        }
+        iAppend.open(iPath, std::ios::binary | std::ios::out | std::ios::app);
+    }
+
+    glyph_disk_cache_file::~glyph_disk_cache_file()
+    {
+        iAppend.close();
+        unmap();
+        unlock();
+    }
+
+    std::uint64_t glyph_disk_cache_file::font_hash(void const* aFontData, std::size_t aFontDataSize)
+    {
+        return fnv1a(aFontData, aFontDataSize);
+    }
+
+    bool glyph_disk_cache_file::contains(std::uint32_t aGlyphIndex) const
+    {
+        return iRecords.find(aGlyphIndex) != iRecords.end();
+    }
+
+    bool glyph_disk_cache_file::find(std::uint32_t aGlyphIndex, rendered_glyph& aResult) const
+    {
+        auto existing = iRecords.find(aGlyphIndex);
+        if (existing == iRecords.end())
+            return false;
+        auto const& record = *existing->second;
+        aResult.index = record.glyphIndex;
+        aResult.subpixel = record.subpixel != 0u;
+        aResult.pixelMode = static_cast<glyph_pixel_mode>(record.pixelMode);
+        aResult.metrics = glyph_metrics{ vec2{ record.extents[0], record.extents[1] }, vec2{ record.bearing[0], record.bearing[1] } };
+        aResult.extents = neogfx::size{ static_cast<dimension>(record.width), static_cast<dimension>(record.height) };
+        auto const pixels = reinterpret_cast<std::uint8_t const*>(&record + 1);
+        aResult.pixels.assign(pixels, pixels + record.pixelBytes);
+        return true;
+    }
+
+    void glyph_disk_cache_file::add(rendered_glyph const& aGlyph)
+    {
+        if (!iAppend.is_open() || !iAppend || contains(aGlyph.index))
+            return;
+        record_header record = {};
+        record.glyphIndex = aGlyph.index;
+        record.subpixel = aGlyph.subpixel ? 1u : 0u;
+        record.pixelMode = static_cast<std::uint8_t>(aGlyph.pixelMode);
+        record.extents[0] = static_cast<float>(aGlyph.metrics.extents.x);
+        record.extents[1] = static_cast<float>(aGlyph.metrics.extents.y);
+        record.bearing[0] = static_cast<float>(aGlyph.metrics.bearing.x);
+        record.bearing[1] = static_cast<float>(aGlyph.metrics.bearing.y);
+        record.width = static_cast<std::uint32_t>(aGlyph.extents.cx);
+        record.height = static_cast<std::uint32_t>(aGlyph.extents.cy);
+        record.pixelBytes = static_cast<std::uint32_t>(aGlyph.pixels.size());
+        if (!valid(record))
+            return;
+        iAppend.write(reinterpret_cast<char const*>(&record), sizeof(record));
+        iAppend.write(reinterpret_cast<char const*>(aGlyph.pixels.data()), aGlyph.pixels.size());
+        std::uint8_t const padding[3] = {};
+        iAppend.write(reinterpret_cast<char const*>(padding), padded(aGlyph.pixels.size()) - aGlyph.pixels.size());
+        iAppend.flush();
+    }
+
+    std::size_t glyph_disk_cache_file::index()
+    {
+        iRecords.clear();
+        if (iDataSize < sizeof(file_header))
+            return 0u;
+        file_header header;
+        std::memcpy(&header, iData, sizeof(header));
+        if (header.magic != Magic || header.version != Version || header.key != iKey)
+            return 0u;
+        std::size_t validSize = sizeof(file_header);
+        while (iDataSize - validSize >= sizeof(record_header))
+        {
+            auto const record = reinterpret_cast<record_header const*>(iData + validSize);
+            if (iDataSize - validSize - sizeof(record_header) < padded(record->pixelBytes))
+                break;
+            if (valid(*record))
+                iRecords.emplace(record->glyphIndex, record);
+            validSize += sizeof(record_header) + padded(record->pixelBytes);
+        }
+        return validSize;
+    }
+
+    bool glyph_disk_cache_file::valid(record_header const& aRecord)
+    {
+        if (aRecord.pixelMode > static_cast<std::uint8_t>(glyph_pixel_mode::BGRA) || aRecord.subpixel > 1u ||
+            (aRecord.subpixel != 0u && aRecord.pixelMode != static_cast<std::uint8_t>(glyph_pixel_mode::LCD)))
+            return false;
+        if (aRecord.width > MaxGlyphExtent || aRecord.height > MaxGlyphExtent)
+            return false;
+        // pixels are one byte per pixel or, for sub-pixel glyphs, four
+        std::size_t const bytesPerPixel = aRecord.subpixel != 0u ? 4u : 1u;
+        return static_cast<std::size_t>(aRecord.pixelBytes) == std::size_t{ aRecord.width } * aRecord.height * bytesPerPixel;
+    }
+
+    bool glyph_disk_cache_file::lock()
+    {
+        auto lockPath = iPath;
+        lockPath += ".lock";
+#ifdef _WIN32
+        // no sharing: a second process fails to open the lock file until the first closes it
+        iLockHandle = ::CreateFileW(lockPath.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        if (iLockHandle == INVALID_HANDLE_VALUE)
+        {
+            iLockHandle = nullptr;
+            return false;
+        }
+        return true;
+#else
+        iLockDescriptor = ::open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (iLockDescriptor == -1)
+            return false;
+        if (::flock(iLockDescriptor, LOCK_EX | LOCK_NB) != 0)
+        {
+            ::close(iLockDescriptor);
+            iLockDescriptor = -1;
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    void glyph_disk_cache_file::unlock()
+    {
+#ifdef _WIN32
+        if (iLockHandle != nullptr)
+            ::CloseHandle(iLockHandle);
+        iLockHandle = nullptr;
+#else
+        if (iLockDescriptor != -1)
+            ::close(iLockDescriptor);
+        iLockDescriptor = -1;
+#endif
+    }
+
+    void glyph_disk_cache_file::map()
+    {
+        std::error_code ec;
+        auto const fileSize = std::filesystem::file_size(iPath, ec);
+        if (ec || fileSize == 0u)
+            return;
+#ifdef _WIN32
+        iFileHandle = ::CreateFileW(iPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (iFileHandle == INVALID_HANDLE_VALUE)
+        {
+            iFileHandle = nullptr;
+            return;
+        }
+        iMappingHandle = ::CreateFileMappingW(iFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (iMappingHandle != nullptr)
+        {
+            iData = static_cast<std::uint8_t const*>(::MapViewOfFile(iMappingHandle, FILE_MAP_READ, 0, 0, 0));
+            if (iData != nullptr)
+                iDataSize = static_cast<std::size_t>(fileSize);
+        }
+#else
+        iUnmappedData.resize(static_cast<std::size_t>(fileSize));
+        std::ifstream file{ iPath, std::ios::binary };
+        if (file.read(reinterpret_cast<char*>(iUnmappedData.data()), iUnmappedData.size()))
+        {
+            iData = iUnmappedData.data();
+            iDataSize = iUnmappedData.size();
+        }
+#endif
+    }
+
+    void glyph_disk_cache_file::unmap()
+    {
+#ifdef _WIN32
+        if (iData != nullptr)
+            ::UnmapViewOfFile(iData);
+        if (iMappingHandle != nullptr)
+            ::CloseHandle(iMappingHandle);
+        if (iFileHandle != nullptr)
+            ::CloseHandle(iFileHandle);
+        iMappingHandle = nullptr;
+        iFileHandle = nullptr;
+#else
+        iUnmappedData.clear();
+        iUnmappedData.shrink_to_fit();
+#endif
+        iData = nullptr;
+        iDataSize = 0u;
+    }
+
+    void glyph_disk_cache_file::create()
+    {
+        std::ofstream file{ iPath, std::ios::binary | std::ios::out | std::ios::trunc };
+        file_header const header{ Magic, Version, iKey };
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    }
+}
@@ -0,0 +1,114 @@
+// glyph_disk_cache.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2015, 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <unordered_map>
+#include <fstream>
+#include <filesystem>
+#include <neogfx/core/geometrical.hpp>
+#include <neogfx/gfx/text/i_glyph.hpp>
+
+namespace neogfx
+{
+    struct rendered_glyph
+    {
+        std::uint32_t index;
+        bool subpixel;
+        glyph_pixel_mode pixelMode;
+        glyph_metrics metrics;
+        neogfx::size extents;
+        std::vector<std::uint8_t> pixels;
+    };
+
+    struct glyph_disk_cache_key
+    {
+        std::uint64_t fontHash;
+        std::uint64_t faceIndex;
+        std::uint64_t charSize;
+        std::uint64_t strikeIndex;
+        std::uint64_t horizontalDpi;
+        std::uint64_t verticalDpi;
+        std::uint64_t style;
+        std::uint64_t subpixel;
+
+        bool operator==(glyph_disk_cache_key const&) const = default;
+    };
+
+    // Append-only file of rendered glyphs for one font face; existing records are memory mapped and
+    // only copied out when a glyph is first needed. A truncated final record (e.g. after the process
+    // was killed mid-write) is ignored and overwritten; records that fail validation are dropped.
+    // Only the process holding the file's lock writes to it, other processes use it read-only.
+    class glyph_disk_cache_file
+    {
+    private:
+        struct file_header
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            glyph_disk_cache_key key;
+        };
+        struct record_header
+        {
+            std::uint32_t glyphIndex;
+            std::uint8_t subpixel;
+            std::uint8_t pixelMode;
+            std::uint16_t reserved;
+            float extents[2];
+            float bearing[2];
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t pixelBytes;
+        };
+        static constexpr std::uint32_t Magic = 0x4347474Eu; // "NGGC"
+        static constexpr std::uint32_t Version = 1u;
+        static constexpr std::uint32_t MaxGlyphExtent = 4096u;
+    public:
+        glyph_disk_cache_file(std::filesystem::path const& aDirectory, glyph_disk_cache_key const& aKey);
+        ~glyph_disk_cache_file();
+    public:
+        static std::uint64_t font_hash(void const* aFontData, std::size_t aFontDataSize);
+    public:
+        bool contains(std::uint32_t aGlyphIndex) const;
+        bool find(std::uint32_t aGlyphIndex, rendered_glyph& aResult) const;
+        void add(rendered_glyph const& aGlyph);
+    private:
+        static bool valid(record_header const& aRecord);
+        bool lock();
+        void unlock();
+        void map();
+        void unmap();
+        std::size_t index();
+        void create();
+    private:
+        std::filesystem::path iPath;
+        glyph_disk_cache_key iKey;
+        void* iFileHandle = nullptr;
+        void* iMappingHandle = nullptr;
+        void* iLockHandle = nullptr;
+        int iLockDescriptor = -1;
+        std::vector<std::uint8_t> iUnmappedData;
+        std::uint8_t const* iData = nullptr;
+        std::size_t iDataSize = 0u;
+        std::unordered_map<std::uint32_t, record_header const*> iRecords;
+        std::ofstream iAppend;
+    };
+}
@@ -80,5 +80,7 @@ namespace neogfx
         virtual void* handle() const = 0;
         virtual glyph_index_t glyph_index(char32_t aCodePoint) const = 0;
         virtual i_glyph& glyph(const glyph_char& aGlyphChar) const = 0;
+        virtual void prefetch_glyphs(glyph_index_t const* aFirst, glyph_index_t const* aLast) const = 0;
+        virtual bool upload_prefetched_glyphs() const = 0;
     };
 }
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include <neogfx/gfx/text/i_font_manager.hpp>
 #include "native_font.hpp"
 #include "native_font_face.hpp"
+#include "glyph_disk_cache.hpp"
 
 namespace neogfx
 {
@@ -153,6 +154,21 @@ namespace neogfx
             return create_face(aFontInfo.style(), aFontInfo.size(), aFontInfo.outline(), aDevice, aResult);
     }
 
+    std::uint64_t native_font::content_hash() const
+    {
+        // hashing a font file is expensive so is done once per file rather than once per face
+        if (iContentHash == std::nullopt)
+        {
+            if (std::holds_alternative<filename_type>(iSource) && !iCache.empty())
+                iContentHash = glyph_disk_cache_file::font_hash(iCache.data(), iCache.size());
+            else if (std::holds_alternative<memory_block_type>(iSource))
+                iContentHash = glyph_disk_cache_file::font_hash(std::get<memory_block_type>(iSource).first, std::get<memory_block_type>(iSource).second);
+            else
+                throw font_not_loaded();
+        }
+        return *iContentHash;
+    }
+
     native_font::style_map::const_iterator native_font::find_style(font_style aStyle) const
     {
         return std::find_if(iStyleMap.begin(), iStyleMap.end(), [aStyle](auto const& s) { return s.first.first == aStyle; });
@@ -46,6 +46,7 @@ namespace neogfx
     public:
         struct failed_to_load_font : std::runtime_error { failed_to_load_font() : std::runtime_error("neogfx::native_font::failed_to_load_font") {} };
         struct no_matching_style_found : std::runtime_error { no_matching_style_found() : std::runtime_error("neogfx::native_font::no_matching_style_found") {} };
+        struct font_not_loaded : std::logic_error { font_not_loaded() : std::logic_error("neogfx::native_font::font_not_loaded") {} };
     public:
         native_font(FT_Library aFontLib, const std::string aFileName);
         native_font(FT_Library aFontLib, const void* aData, std::size_t aSizeInBytes);
@@ -61,6 +62,7 @@ namespace neogfx
         void create_face(font_style aStyle, font::point_size aSize, stroke aOutline, i_device_resolution const& aDevice, i_ref_ptr<i_native_font_face>& aResult) final;
         void create_face(font_style aStyle, i_string const& aStyleName, font::point_size aSize, stroke aOutline, i_device_resolution const& aDevice, i_ref_ptr<i_native_font_face>& aResult) final;
         void create_face(font_info const& aFontIinfo, i_device_resolution const& aDevice, i_ref_ptr<i_native_font_face>& aResult) final;
+        std::uint64_t content_hash() const final;
     private:
         style_map::const_iterator find_style(font_style aStyle) const;
         void register_faces();
@@ -77,5 +79,6 @@ namespace neogfx
         FT_Long iFaceCount;
         style_map iStyleMap;
         face_map iFaces;
+        mutable std::optional<std::uint64_t> iContentHash;
     };
 }
\ No newline at end of file
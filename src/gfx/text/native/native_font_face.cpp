@@ -20,7 +20,10 @@
 #include <neogfx/neogfx.hpp>
 
 #include <unordered_map>
+#include <thread>
+#include <atomic>
 #include <boost/functional/hash.hpp>
+#include <neolib/task/thread_pool.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
@@ -44,6 +47,8 @@ namespace neogfx
         typedef std::unordered_map<std::pair<FT_UInt, FT_Int32>, FT_Fixed, boost::hash<std::pair<FT_UInt, FT_Int32>>> get_advance_cache_face;
         typedef std::unordered_map<FT_Face, get_advance_cache_face> get_advance_cache;
         get_advance_cache sGetAdvanceCache;
+        // glyph prefetching shares the default thread pool so the number of tasks in flight is limited process-wide
+        std::atomic<std::size_t> sPrefetchTasksRunning = 0u;
     }
 
     bool& kerning_enabled_flag()
@@ -92,6 +97,13 @@ namespace neogfx
 
     native_font_face::~native_font_face()
     {
+        for (auto& task : iPrefetchTasks)
+            task.wait();
+        for (auto const& context : iPrefetchContexts)
+        {
+            FT_Done_Face(context.face);
+            FT_Done_FreeType(context.library);
+        }
         if (iHandle.freetypeFace != nullptr)
             sGetAdvanceCache.erase(sGetAdvanceCache.find(iHandle.freetypeFace));
         FT_Done_Face(iHandle.freetypeFace);
@@ -217,6 +229,8 @@ namespace neogfx
     {
         if (!iHasKerning)
             return 0.0;
+        // may be called from HarfBuzz on a parallel shaping worker
+        std::scoped_lock lock{ iKerningMutex };
         auto existing = iKerningTable.find(std::make_pair(aLeftGlyphIndex, aRightGlyphIndex));
         if (existing != iKerningTable.end())
             return existing->second;
@@ -342,12 +356,14 @@ namespace neogfx
          
     i_glyph& native_font_face::glyph(const glyph_char& aGlyphChar) const
     {
-        // todo: investigate why turning off sub-pixel doesn't produce same grayscale bitmap as Windows with ClearType disabled
-        bool useSubpixelFiltering = true;
-
         thread_local bool tRenderOutlineGlyph = false;
 
         auto existingGlyph = iGlyphs.find(aGlyphChar.value);
+        if (existingGlyph == iGlyphs.end() && !iPrefetchTasks.empty())
+        {
+            upload_prefetched_glyphs();
+            existingGlyph = iGlyphs.find(aGlyphChar.value);
+        }
         if (existingGlyph != iGlyphs.end())
         {
             if (!tRenderOutlineGlyph)
@@ -359,96 +375,242 @@ namespace neogfx
                 throw std::logic_error( "neogfx::native_font_face::glyph" );
         }
 
-        FT_Bitmap* bitmap = nullptr;
+        thread_local rendered_glyph tRendered;
 
-        try
+        auto const diskCache = !tRenderOutlineGlyph ? disk_cache() : nullptr;
+        if (diskCache == nullptr || !diskCache->find(aGlyphChar.value, tRendered))
         {
             try
             {
-                if (useSubpixelFiltering)
-                {
-                    freetypeCheck(FT_Load_Glyph(iHandle.freetypeFace, aGlyphChar.value, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_LCD | FT_LOAD_NO_BITMAP));
-                }
-                else
-                {
-                    freetypeCheck(FT_Load_Glyph(iHandle.freetypeFace, aGlyphChar.value, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_NORMAL | FT_LOAD_NO_BITMAP));
-                }
+                render_glyph(iFontLib, iHandle.freetypeFace, aGlyphChar.value, tRenderOutlineGlyph, tRendered);
             }
-            catch (freetype_error fe)
+            catch (freetype_load_glyph_error const&)
             {
                 service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot load font glyph" << std::endl;
-                throw freetype_load_glyph_error(fe.what());
+                return replacement_glyph(aGlyphChar);
             }
-            if (!tRenderOutlineGlyph)
+            catch (freetype_render_glyph_error const&)
             {
-                try
+                if (!tRenderOutlineGlyph)
+                    service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot render font glyph" << std::endl;
+                else
+                    service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot render font outline glyph" << std::endl;
+                return replacement_glyph(aGlyphChar);
+            }
+            catch (...)
+            {
+                return replacement_glyph(aGlyphChar);
+            }
+            if (diskCache != nullptr)
+                diskCache->add(tRendered);
+        }
+
+        i_glyph& theGlyph = add_glyph(tRendered, tRenderOutlineGlyph);
+
+        if (outline().radius != 0.0 && !tRenderOutlineGlyph)
+        {
+            neolib::scoped_flag sf{ tRenderOutlineGlyph };
+            (void) glyph(aGlyphChar);
+        }
+
+        return theGlyph;
+    }
+
+    void native_font_face::prefetch_glyphs(glyph_index_t const* aFirst, glyph_index_t const* aLast) const
+    {
+        // outline glyphs are stroked on demand
+        if (outline().radius != 0.0 || iHandle.freetypeFace->stream->base == nullptr)
+            return;
+        for (auto g = aFirst; g != aLast; ++g)
+            if (iGlyphs.find(*g) == iGlyphs.end() && (disk_cache() == nullptr || !disk_cache()->contains(*g)) && iPrefetching.insert(*g).second)
+                iPrefetchQueue.push_back(*g);
+        if (iPrefetchQueue.size() >= PrefetchTaskMinGlyphs)
+            launch_prefetch_tasks();
+    }
+
+    bool native_font_face::upload_prefetched_glyphs() const
+    {
+        // retire finished tasks before collecting so that none of their results are left behind
+        std::erase_if(iPrefetchTasks, [](std::future<void>& aTask) { return aTask.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready; });
+        thread_local rendered_glyphs tReady;
+        tReady.clear();
+        {
+            std::scoped_lock lock{ iPrefetchMutex };
+            tReady.swap(iPrefetched);
+        }
+        for (auto const& rendered : tReady)
+            if (iGlyphs.find(rendered.index) == iGlyphs.end())
+            {
+                add_glyph(rendered, false);
+                if (disk_cache() != nullptr)
+                    disk_cache()->add(rendered);
+            }
+        launch_prefetch_tasks();
+        if (iPrefetchTasks.empty() && iPrefetchQueue.empty())
+            iPrefetching.clear();
+        else
+            for (auto const& rendered : tReady)
+                iPrefetching.erase(rendered.index);
+        // glyphs still queued because the process-wide task limit was reached keep this face polled
+        return !iPrefetchTasks.empty() || !iPrefetchQueue.empty();
+    }
+
+    void native_font_face::launch_prefetch_tasks() const
+    {
+        std::size_t const maxTasks = std::max(std::thread::hardware_concurrency(), 1u);
+        while (!iPrefetchQueue.empty())
+        {
+            if (sPrefetchTasksRunning.fetch_add(1u) >= maxTasks)
+            {
+                --sPrefetchTasksRunning;
+                break;
+            }
+            auto const end = std::next(iPrefetchQueue.begin(), std::min(iPrefetchQueue.size(), PrefetchTaskMaxGlyphs));
+            iPrefetchTasks.push_back(neolib::thread_pool::default_thread_pool().run([this, 
+                glyphIndices = std::vector<glyph_index_t>{ iPrefetchQueue.begin(), end }]()
+            {
+                auto const context = acquire_prefetch_context();
+                if (context.face != nullptr)
                 {
-                    if (useSubpixelFiltering)
-                    {
-                        freetypeCheck(FT_Render_Glyph(iHandle.freetypeFace->glyph, FT_RENDER_MODE_LCD));
-                    }
-                    else
+                    rendered_glyphs results;
+                    results.reserve(glyphIndices.size());
+                    for (auto glyphIndex : glyphIndices)
                     {
-                        freetypeCheck(FT_Render_Glyph(iHandle.freetypeFace->glyph, FT_RENDER_MODE_NORMAL));
+                        try
+                        {
+                            render_glyph(context.library, context.face, glyphIndex, false, results.emplace_back());
+                        }
+                        catch (...)
+                        {
+                            results.pop_back();
+                        }
                     }
-                    bitmap = &iHandle.freetypeFace->glyph->bitmap;
-                }
-                catch (freetype_error fe)
-                {
-                    service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot render font glyph" << std::endl;
-                    throw freetype_render_glyph_error(fe.what());
+                    std::scoped_lock lock{ iPrefetchMutex };
+                    std::move(results.begin(), results.end(), std::back_inserter(iPrefetched));
                 }
+                release_prefetch_context(context);
+                --sPrefetchTasksRunning;
+            }).first);
+            iPrefetchQueue.erase(iPrefetchQueue.begin(), end);
+        }
+    }
+
+    native_font_face::prefetch_context native_font_face::acquire_prefetch_context() const
+    {
+        // FreeType libraries and faces are not thread-safe so a task renders with a library and face of its own;
+        // these are kept by the face once the task finishes and reused by its later tasks rather than being
+        // recreated every time
+        {
+            std::scoped_lock lock{ iPrefetchMutex };
+            if (!iPrefetchContexts.empty())
+            {
+                auto const result = iPrefetchContexts.back();
+                iPrefetchContexts.pop_back();
+                return result;
+            }
+        }
+        prefetch_context result{ nullptr, nullptr };
+        if (FT_Init_FreeType(&result.library) != FT_Err_Ok)
+            return prefetch_context{ nullptr, nullptr };
+        FT_Library_SetLcdFilter(result.library, FT_LCD_FILTER_NONE);
+        if (FT_New_Memory_Face(result.library, iHandle.freetypeFace->stream->base, static_cast<FT_Long>(iHandle.freetypeFace->stream->size),
+            iHandle.freetypeFace->face_index, &result.face) != FT_Err_Ok)
+            result.face = nullptr;
+        else if ((iStrikeIndex ? FT_Select_Size(result.face, *iStrikeIndex) :
+            FT_Set_Char_Size(result.face, 0, iCharSize, static_cast<FT_UInt>(iPixelDensityDpi.cx), static_cast<FT_UInt>(iPixelDensityDpi.cy))) != FT_Err_Ok)
+        {
+            FT_Done_Face(result.face);
+            result.face = nullptr;
+        }
+        return result;
+    }
+
+    void native_font_face::release_prefetch_context(prefetch_context const& aContext) const
+    {
+        if (aContext.face != nullptr)
+        {
+            std::scoped_lock lock{ iPrefetchMutex };
+            iPrefetchContexts.push_back(aContext);
+        }
+        else if (aContext.library != nullptr)
+            FT_Done_FreeType(aContext.library);
+    }
+
+    void native_font_face::render_glyph(FT_Library aFontLib, FT_Face aFace, glyph_index_t aGlyphIndex, bool aOutlineGlyph, rendered_glyph& aResult) const
+    {
+        // todo: investigate why turning off sub-pixel doesn't produce same grayscale bitmap as Windows with ClearType disabled
+        bool useSubpixelFiltering = true;
+
+        FT_Bitmap* bitmap = nullptr;
+        FT_Glyph glyphDescStroke = nullptr;
+
+        try
+        {
+            if (useSubpixelFiltering)
+            {
+                freetypeCheck(FT_Load_Glyph(aFace, aGlyphIndex, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_LCD | FT_LOAD_NO_BITMAP));
             }
             else
             {
-                try
+                freetypeCheck(FT_Load_Glyph(aFace, aGlyphIndex, FT_LOAD_FORCE_AUTOHINT | FT_LOAD_TARGET_NORMAL | FT_LOAD_NO_BITMAP));
+            }
+        }
+        catch (freetype_error fe)
+        {
+            throw freetype_load_glyph_error(fe.what());
+        }
+        if (!aOutlineGlyph)
+        {
+            try
+            {
+                if (useSubpixelFiltering)
                 {
-                    FT_Glyph glyphDescStroke;
-                    freetypeCheck(FT_Get_Glyph(iHandle.freetypeFace->glyph, &glyphDescStroke));
-                    FT_Stroker stroker;
-                    freetypeCheck(FT_Stroker_New(iFontLib, &stroker));
-                    FT_Stroker_Set(stroker,
-                        static_cast<FT_Fixed>(outline().radius * static_cast<float>(1 << 6)),
-                        from_stroke_line_cap(outline().lineCap), from_stroke_line_join(outline().lineJoin), 
-                        static_cast<FT_Fixed>(outline().miterLimit * static_cast<float>(1 << 6)));
-                    freetypeCheck(FT_Glyph_Stroke(&glyphDescStroke, stroker, true));
-                    FT_Stroker_Done(stroker);
-                    if (useSubpixelFiltering)
-                    {
-                        freetypeCheck(FT_Glyph_To_Bitmap(&glyphDescStroke, FT_RENDER_MODE_LCD, 0, 1));
-                    }
-                    else
-                    {
-                        freetypeCheck(FT_Glyph_To_Bitmap(&glyphDescStroke, FT_RENDER_MODE_NORMAL, 0, 1));
-                    }
-                    bitmap = &reinterpret_cast<FT_BitmapGlyph>(glyphDescStroke)->bitmap;
+                    freetypeCheck(FT_Render_Glyph(aFace->glyph, FT_RENDER_MODE_LCD));
                 }
-                catch (freetype_error fe)
+                else
                 {
-                    service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot render font outline glyph" << std::endl;
-                    throw freetype_render_glyph_error(fe.what());
+                    freetypeCheck(FT_Render_Glyph(aFace->glyph, FT_RENDER_MODE_NORMAL));
                 }
+                bitmap = &aFace->glyph->bitmap;
+            }
+            catch (freetype_error fe)
+            {
+                throw freetype_render_glyph_error(fe.what());
             }
         }
-        catch (...)
+        else
         {
-            thread_local bool inHere = false;
-            if (!inHere)
+            try
             {
-                neolib::scoped_flag sf{ inHere };
-                glyph_char invalid = aGlyphChar;
-                auto const replacementGlyph = FT_Get_Char_Index(iHandle.freetypeFace, 0xFFFD);
-                if (replacementGlyph != 0)
+                freetypeCheck(FT_Get_Glyph(aFace->glyph, &glyphDescStroke));
+                FT_Stroker stroker;
+                freetypeCheck(FT_Stroker_New(aFontLib, &stroker));
+                FT_Stroker_Set(stroker,
+                    static_cast<FT_Fixed>(outline().radius * static_cast<float>(1 << 6)),
+                    from_stroke_line_cap(outline().lineCap), from_stroke_line_join(outline().lineJoin), 
+                    static_cast<FT_Fixed>(outline().miterLimit * static_cast<float>(1 << 6)));
+                freetypeCheck(FT_Glyph_Stroke(&glyphDescStroke, stroker, true));
+                FT_Stroker_Done(stroker);
+                if (useSubpixelFiltering)
+                {
+                    freetypeCheck(FT_Glyph_To_Bitmap(&glyphDescStroke, FT_RENDER_MODE_LCD, 0, 1));
+                }
+                else
                 {
-                    invalid.value = replacementGlyph;
-                    return glyph(invalid);
+                    freetypeCheck(FT_Glyph_To_Bitmap(&glyphDescStroke, FT_RENDER_MODE_NORMAL, 0, 1));
                 }
+                bitmap = &reinterpret_cast<FT_BitmapGlyph>(glyphDescStroke)->bitmap;
+            }
+            catch (freetype_error fe)
+            {
+                if (glyphDescStroke != nullptr)
+                    FT_Done_Glyph(glyphDescStroke);
+                throw freetype_render_glyph_error(fe.what());
             }
-            return invalid_glyph();
         }
 
         if ((style() & (font_style::EmulatedBold)) == font_style::EmulatedBold)
-            FT_Bitmap_Embolden(iFontLib, bitmap, static_cast<FT_F26Dot6>(xn_dpi_scale_factor(iPixelDensityDpi.cx) * 64), 0);
+            FT_Bitmap_Embolden(aFontLib, bitmap, static_cast<FT_F26Dot6>(xn_dpi_scale_factor(iPixelDensityDpi.cx) * 64), 0);
 
         auto pixelMode = to_glyph_pixel_mode(bitmap->pixel_mode);
 
@@ -457,37 +619,23 @@ namespace neogfx
 
         auto subTextureWidth = bitmap->width / (useSubpixelFiltering ? 3 : 1);
 
-        auto& subTexture = service<i_font_manager>().glyph_atlas().create_sub_texture(
-            neogfx::size{ static_cast<dimension>(subTextureWidth), static_cast<dimension>(bitmap->rows) }.ceil(),
-            1.0, texture_sampling::Normal, pixelMode == glyph_pixel_mode::LCD ? texture_data_format::SubPixel : texture_data_format::Red);
-
-        rect glyphRect{ subTexture.atlas_location() };
-        i_glyph& theGlyph = (!tRenderOutlineGlyph ?
-            iGlyphs.insert(std::make_pair(aGlyphChar.value,
-                neogfx::glyph{
-                    subTexture,
-                    useSubpixelFiltering,
-                    glyph_metrics{
-                        vec2{ iHandle.freetypeFace->glyph->metrics.width / 64.0, iHandle.freetypeFace->glyph->metrics.height / 64.0 }.round(),
-                        vec2{ iHandle.freetypeFace->glyph->metrics.horiBearingX / 64.0, iHandle.freetypeFace->glyph->metrics.horiBearingY / 64.0 }.round() },
-                    pixelMode })).first->second :
-            existingGlyph->second);
-
-        if (tRenderOutlineGlyph)
-            theGlyph.set_outline_texture(subTexture);
-
-        thread_local std::vector<std::uint8_t> glyphTextureData;
-        thread_local std::vector<std::array<std::uint8_t, 4>> subpixelGlyphData;
-        glyphTextureData.clear();
-        subpixelGlyphData.clear();
+        aResult.index = aGlyphIndex;
+        aResult.subpixel = useSubpixelFiltering;
+        aResult.pixelMode = pixelMode;
+        aResult.metrics = glyph_metrics{
+            vec2{ aFace->glyph->metrics.width / 64.0, aFace->glyph->metrics.height / 64.0 }.round(),
+            vec2{ aFace->glyph->metrics.horiBearingX / 64.0, aFace->glyph->metrics.horiBearingY / 64.0 }.round() };
+        aResult.extents = neogfx::size{ static_cast<dimension>(subTextureWidth), static_cast<dimension>(bitmap->rows) }.ceil();
+        aResult.pixels.clear();
 
-        const std::uint8_t* textureData = 0;
+        std::size_t const textureWidth = static_cast<std::size_t>(aResult.extents.cx);
         
         if (subTextureWidth != 0)
         {
             if (useSubpixelFiltering)
             {
-                subpixelGlyphData.resize(static_cast<std::size_t>(glyphRect.cx * glyphRect.cy));
+                aResult.pixels.resize(textureWidth * static_cast<std::size_t>(aResult.extents.cy) * 4u);
+                auto subpixelGlyphData = reinterpret_cast<std::array<std::uint8_t, 4>*>(aResult.pixels.data());
                 // sub-pixel FIR filter.
                 static double coefficients[] = { 1.5 / 16.0, 3.5 / 16.0, 6.0 / 16.0, 3.5 / 16.0, 1.5 / 16.0 };
                 for (std::uint32_t y = 0; y < bitmap->rows; y++)
@@ -501,43 +649,106 @@ namespace neogfx
                             if (s >= 0 && s <= static_cast<std::int32_t>(bitmap->width) - 1)
                                 alpha += static_cast<std::uint8_t>(bitmap->buffer[s + bitmap->pitch * y] * coefficients[z + 2]);
                         }
-                        subpixelGlyphData[(x / 3) + (bitmap->rows - 1 - y) * static_cast<std::size_t>(glyphRect.cx)][x % 3] = alpha;
+                        subpixelGlyphData[(x / 3) + (bitmap->rows - 1 - y) * textureWidth][x % 3] = alpha;
                     }
                 }
-                textureData = &subpixelGlyphData[0][0];
             }
             else
             {
-                glyphTextureData.resize(static_cast<std::size_t>(glyphRect.cx * glyphRect.cy));
+                aResult.pixels.resize(textureWidth * static_cast<std::size_t>(aResult.extents.cy));
+                auto& glyphTextureData = aResult.pixels;
                 for (std::uint32_t y = 0; y < bitmap->rows; y++)
                     switch (bitmap->pixel_mode)
                     {
                     case FT_PIXEL_MODE_MONO: // 1 bit per pixel monochrome
                         for (std::uint32_t x = 0; x < bitmap->width; x += 8)
                             for (std::uint32_t b = 0; b < std::min(bitmap->width - x, 8u); ++b)
-                                glyphTextureData[(x + b) + (bitmap->rows - 1 - y) * static_cast<std::size_t>(glyphRect.cx)] =
+                                glyphTextureData[(x + b) + (bitmap->rows - 1 - y) * textureWidth] =
                                     (x >= bitmap->width || y >= bitmap->rows) ? 0x00 : ((bitmap->buffer[x / 8 + bitmap->pitch * y] & (1 << (7 - b))) != 0 ? 0xFF : 0x00);
                         break;
                     case FT_PIXEL_MODE_GRAY:
                     default:
                         for (std::uint32_t x = 0; x < bitmap->width; x++)
-                            glyphTextureData[x + (bitmap->rows - 1 - y) * static_cast<std::size_t>(glyphRect.cx)] =
+                            glyphTextureData[x + (bitmap->rows - 1 - y) * textureWidth] =
                                 (x >= bitmap->width || y >= bitmap->rows) ? 0x00 : bitmap->buffer[x + bitmap->pitch * y];
                         break;
                     }
-                textureData = &glyphTextureData[0];
             }
-            static_cast<i_native_texture&>((!tRenderOutlineGlyph ? 
-                theGlyph.texture() : theGlyph.outline_texture()).native_texture()).set_pixels(glyphRect, &textureData[0], 0u, 1u);
         }
 
-        if (outline().radius != 0.0 && !tRenderOutlineGlyph)
+        if (glyphDescStroke != nullptr)
+            FT_Done_Glyph(glyphDescStroke);
+    }
+
+    i_glyph& native_font_face::add_glyph(rendered_glyph const& aGlyph, bool aOutlineGlyph) const
+    {
+        auto& subTexture = service<i_font_manager>().glyph_atlas().create_sub_texture(
+            aGlyph.extents, 1.0, texture_sampling::Normal, aGlyph.pixelMode == glyph_pixel_mode::LCD ? texture_data_format::SubPixel : texture_data_format::Red);
+
+        rect glyphRect{ subTexture.atlas_location() };
+        i_glyph& theGlyph = (!aOutlineGlyph ?
+            iGlyphs.insert(std::make_pair(aGlyph.index,
+                neogfx::glyph{
+                    subTexture,
+                    aGlyph.subpixel,
+                    aGlyph.metrics,
+                    aGlyph.pixelMode })).first->second :
+            iGlyphs.find(aGlyph.index)->second);
+
+        if (aOutlineGlyph)
+            theGlyph.set_outline_texture(subTexture);
+
+        if (!aGlyph.pixels.empty())
+            static_cast<i_native_texture&>((!aOutlineGlyph ? 
+                theGlyph.texture() : theGlyph.outline_texture()).native_texture()).set_pixels(glyphRect, aGlyph.pixels.data(), 0u, 1u);
+
+        return theGlyph;
+    }
+
+    glyph_disk_cache_file* native_font_face::disk_cache() const
+    {
+        if (iDiskCache == std::nullopt)
         {
-            neolib::scoped_flag sf{ tRenderOutlineGlyph };
-            (void) glyph(aGlyphChar);
+            iDiskCache.emplace();
+            auto const& directory = service<i_font_manager>().glyph_disk_cache_directory();
+            if (!directory.empty() && iHandle.freetypeFace->stream->base != nullptr)
+            {
+                try
+                {
+                    *iDiskCache = std::make_unique<glyph_disk_cache_file>(std::filesystem::path{ directory.to_std_string_view() }, glyph_disk_cache_key{
+                        iFont.content_hash(),
+                        static_cast<std::uint64_t>(iHandle.freetypeFace->face_index),
+                        static_cast<std::uint64_t>(iCharSize),
+                        iStrikeIndex ? static_cast<std::uint64_t>(*iStrikeIndex) + 1u : 0u,
+                        static_cast<std::uint64_t>(iPixelDensityDpi.cx),
+                        static_cast<std::uint64_t>(iPixelDensityDpi.cy),
+                        static_cast<std::uint64_t>(style()),
+                        1u /* glyphs are always rasterized for LCD sub-pixel filtering */ });
+                }
+                catch (...)
+                {
+                    service<debug::logger>() << neolib::logger::severity::Debug << "neogfx: warning: Cannot open glyph disk cache" << std::endl;
+                }
+            }
         }
+        return iDiskCache->get();
+    }
 
-        return theGlyph;
+    i_glyph& native_font_face::replacement_glyph(const glyph_char& aGlyphChar) const
+    {
+        thread_local bool inHere = false;
+        if (!inHere)
+        {
+            neolib::scoped_flag sf{ inHere };
+            glyph_char invalid = aGlyphChar;
+            auto const replacementGlyph = FT_Get_Char_Index(iHandle.freetypeFace, 0xFFFD);
+            if (replacementGlyph != 0)
+            {
+                invalid.value = replacementGlyph;
+                return glyph(invalid);
+            }
+        }
+        return invalid_glyph();
     }
 
     i_glyph& native_font_face::invalid_glyph() const
@@ -575,7 +786,8 @@ namespace neogfx
         double correction = 1.0;
         if (!is_bitmap_font())
         {
-            freetypeCheck(FT_Set_Char_Size(iHandle.freetypeFace, 0, static_cast<FT_F26Dot6>(requestedSize * 64), static_cast<FT_UInt>(iPixelDensityDpi.cx), static_cast<FT_UInt>(iPixelDensityDpi.cy)));
+            iCharSize = static_cast<FT_F26Dot6>(requestedSize * 64);
+            freetypeCheck(FT_Set_Char_Size(iHandle.freetypeFace, 0, iCharSize, static_cast<FT_UInt>(iPixelDensityDpi.cx), static_cast<FT_UInt>(iPixelDensityDpi.cy)));
             if (heightSpecified)
             {
                 double const gotHeight = iHandle.freetypeFace->size->metrics.height / 64.0;
@@ -583,6 +795,7 @@ namespace neogfx
                 {
                     correction = requestedHeight / gotHeight;
                     auto const corrected = static_cast<FT_F26Dot6>(requestedSize * correction * 64);
+                    iCharSize = corrected;
                     freetypeCheck(FT_Set_Char_Size(iHandle.freetypeFace, 0, corrected, static_cast<FT_UInt>(iPixelDensityDpi.cx), static_cast<FT_UInt>(iPixelDensityDpi.cy)));
                 }
             }
@@ -600,6 +813,7 @@ namespace neogfx
                     strikeIndex = si;
                 }
             }
+            iStrikeIndex = strikeIndex;
             freetypeCheck(FT_Select_Size(iHandle.freetypeFace, strikeIndex));
         }
         if (iMetrics == std::nullopt)
@@ -22,6 +22,9 @@
 #include <neogfx/neogfx.hpp>
 
 #include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <future>
 #include <boost/functional/hash.hpp>
 #include <boost/pool/pool_alloc.hpp>
 #include <ft2build.h>
@@ -45,6 +48,7 @@
 #include <neogfx/gfx/text/glyph_text.hpp>
 #include "i_native_font.hpp"
 #include "i_native_font_face.hpp"
+#include "glyph_disk_cache.hpp"
 
 namespace neogfx
 {
@@ -108,12 +112,21 @@ namespace neogfx
     {
     private:
         typedef std::unordered_map<glyph_index_t, neogfx::glyph> glyph_map;
+        typedef std::vector<rendered_glyph> rendered_glyphs;
+        struct prefetch_context
+        {
+            FT_Library library;
+            FT_Face face;
+        };
         typedef std::pair<glyph_index_t, glyph_index_t> kerning_pair;
         typedef std::unordered_map<kerning_pair, dimension, boost::hash<kerning_pair>, std::equal_to<kerning_pair>,
             boost::fast_pool_allocator<std::pair<const kerning_pair, dimension>>> kerning_table;
     public:
         struct freetype_load_glyph_error : freetype_error { freetype_load_glyph_error(std::string const& aError) : freetype_error(aError) {} };
         struct freetype_render_glyph_error : freetype_error { freetype_render_glyph_error(std::string const& aError) : freetype_error(aError) {} };
+    public:
+        static constexpr std::size_t PrefetchTaskMinGlyphs = 32u;
+        static constexpr std::size_t PrefetchTaskMaxGlyphs = 256u;
     public:
         native_font_face(FT_Library aFontLib, font_id aId, i_native_font& aFont, font_style aStyle, font::point_size aSize, stroke aOutline, neogfx::size aDpiResolution, FT_Face aFreetypeFace, hb_face_t* aHarfbuzzFace);
         ~native_font_face();
@@ -147,7 +160,16 @@ namespace neogfx
         void* handle() const final;
         glyph_index_t glyph_index(char32_t aCodePoint) const final;
         i_glyph& glyph(const glyph_char& aGlyphChar) const final;
+        void prefetch_glyphs(glyph_index_t const* aFirst, glyph_index_t const* aLast) const final;
+        bool upload_prefetched_glyphs() const final;
     private:
+        void launch_prefetch_tasks() const;
+        prefetch_context acquire_prefetch_context() const;
+        void release_prefetch_context(prefetch_context const& aContext) const;
+        void render_glyph(FT_Library aFontLib, FT_Face aFace, glyph_index_t aGlyphIndex, bool aOutlineGlyph, rendered_glyph& aResult) const;
+        i_glyph& add_glyph(rendered_glyph const& aGlyph, bool aOutlineGlyph) const;
+        glyph_disk_cache_file* disk_cache() const;
+        i_glyph& replacement_glyph(const glyph_char& aGlyphChar) const;
         i_glyph& invalid_glyph() const;
         void set_metrics();
     private:
@@ -161,13 +183,23 @@ namespace neogfx
         neogfx::size iPixelDensityDpi;
         mutable font_face_handle iHandle;
         std::optional<FT_Size_Metrics> iMetrics;
+        FT_F26Dot6 iCharSize = 0;
+        std::optional<FT_Int> iStrikeIndex;
         mutable ref_ptr<i_native_font_face> iFallbackFont;
         mutable glyph_map iGlyphs;
         bool iHasKerning = false;
         neogfx::kerning_method iKerningMethod = neogfx::kerning_method::Harfbuzz;
         mutable kerning_table iKerningTable;
+        mutable std::mutex iKerningMutex;
         mutable std::optional<bool> iHasFallback;
         mutable std::optional<neogfx::glyph> iInvalidGlyph;
+        mutable std::unordered_set<glyph_index_t> iPrefetching;
+        mutable std::vector<glyph_index_t> iPrefetchQueue;
+        mutable std::mutex iPrefetchMutex;
+        mutable rendered_glyphs iPrefetched;
+        mutable std::vector<std::future<void>> iPrefetchTasks;
+        mutable std::vector<prefetch_context> iPrefetchContexts;
+        mutable std::optional<std::unique_ptr<glyph_disk_cache_file>> iDiskCache;
     };
 
     bool kerning_enabled();
@@ -21,10 +21,44 @@
 
 #include <neogfx/gfx/texture.hpp>
 #include <neogfx/gfx/texture_manager.hpp>
+#include <neogfx/gfx/i_image.hpp>
+#include <neogfx/gfx/i_image_decoder.hpp>
 #include "native/i_native_texture.hpp"
 
 namespace neogfx
 {
+    namespace
+    {
+        // Uploads each band of rows as it arrives from the image decoder. The handler lives as long as the
+        // decoded image and holds the native texture rather than the texture so that it outlives neither.
+        void follow_decoding(const i_image& aImage, const rect& aImagePart, ref_ptr<i_texture> const& aNativeTexture)
+        {
+            auto const decoding = aImage.decoding();
+            if (!decoding || aNativeTexture == nullptr)
+                return;
+            decoded_image const* const source = &*decoding;
+            point_u32 const partOrigin = aImagePart.position();
+            size_u32 const partExtents = aImagePart.extents();
+            decoding->RowsDecoded([source, partOrigin, partExtents, nativeTexture = aNativeTexture](std::uint32_t aFirstRow, std::uint32_t aRowCount)
+            {
+                std::uint32_t const first = std::max(aFirstRow, partOrigin.y);
+                std::uint32_t const last = std::min(aFirstRow + aRowCount, partOrigin.y + partExtents.cy);
+                if (first >= last || partOrigin.x + partExtents.cx > source->extents().cx)
+                    return;
+                // texture rows are bottom up
+                thread_local std::vector<std::uint8_t> data;
+                data.resize(static_cast<std::size_t>(partExtents.cx) * 4u * (last - first));
+                std::uint32_t const stride = source->stride();
+                for (std::uint32_t y = first; y < last; ++y)
+                    std::copy_n(source->pixels() + y * stride + partOrigin.x * 4u, partExtents.cx * 4u,
+                        data.begin() + static_cast<std::ptrdiff_t>(last - 1u - y) * partExtents.cx * 4u);
+                // staged (the rows are copied now) and uploaded within the frame's texture upload budget
+                nativeTexture->set_pixels_async(rect{ point{ 0.0, static_cast<coordinate>(partOrigin.y + partExtents.cy - last) }, size{ static_cast<dimension>(partExtents.cx), static_cast<dimension>(last - first) } }, 
+                    &data[0], source->format());
+            });
+        }
+    }
+
     texture::texture()
     {
     }
@@ -42,11 +76,13 @@ namespace neogfx
     texture::texture(const i_image& aImage, texture_data_format aDataFormat, texture_data_type aDataType) :
         iNativeTexture{ !aImage.is_empty() ? service<i_texture_manager>().create_texture(aImage, aDataFormat, aDataType) : ref_ptr<i_texture>{} }
     {
+        follow_decoding(aImage, rect{ point{}, aImage.extents() }, iNativeTexture);
     }
 
     texture::texture(const i_image& aImage, const rect& aImagePart, texture_data_format aDataFormat, texture_data_type aDataType) :
         iNativeTexture{ !aImage.is_empty() ? service<i_texture_manager>().create_texture(aImage, aImagePart, aDataFormat, aDataType) : ref_ptr<i_texture>{} }
     {
+        follow_decoding(aImage, aImagePart, iNativeTexture);
     }
 
     texture::texture(const i_sub_texture& aSubTexture) :
@@ -198,6 +234,11 @@ namespace neogfx
         }
     }
 
+    void texture::set_pixels_async(const rect& aRect, void const* aPixelData, texture_data_format aDataFormat, std::function<void()> const& aUploaded, std::uint32_t aStride, std::uint32_t aPackAlignment)
+    {
+        native_texture().set_pixels_async(aRect, aPixelData, aDataFormat, aUploaded, aStride, aPackAlignment);
+    }
+
     void texture::set_pixel(const point& aPosition, const color& aColor)
     {
         if (is_empty())
@@ -26,7 +26,7 @@
 namespace neogfx
 {
     standard_vertex_shader::standard_vertex_shader(std::string const& aName) :
-        vertex_shader{ aName }, iOpacity{ 1.0 }
+        vertex_shader{ aName }, iOpacity{ 1.0 }, iInstanced{ false }
     {
         auto& coord = add_attribute<vec3f>("VertexPosition"_s, 0u);
         auto& color = add_attribute<vec4f>("VertexColor"_s, 1u);
@@ -46,6 +46,7 @@ namespace neogfx
         add_out_variable<vec4f>("Function4"_s, 7u, true).link(function4);
         add_out_variable<vec4f>("Function5"_s, 8u, true).link(function5);
         add_out_variable<vec4f>("Function6"_s, 9u, true).link(function6);
+        uInstanced = false;
     }
 
     void standard_vertex_shader::set_projection_matrix(const optional_mat44& aProjectionMatrix)
@@ -75,6 +76,15 @@ namespace neogfx
         }
     }
 
+    void standard_vertex_shader::set_instanced(bool aInstanced)
+    {
+        if (iInstanced != aInstanced)
+        {
+            iInstanced = aInstanced;
+            uInstanced.uniform().mutable_value();
+        }
+    }
+
     void standard_vertex_shader::prepare_uniforms(const i_rendering_context& aContext, i_shader_program&)
     {
         if (iProjectionMatrix == std::nullopt)
@@ -115,6 +125,9 @@ namespace neogfx
 
         if (uOpacity.uniform().is_dirty())
             uOpacity = static_cast<float>(iOpacity);
+
+        if (uInstanced.uniform().is_dirty())
+            uInstanced = iInstanced;
     }
 
     void standard_vertex_shader::generate_code(const i_shader_program& aProgram, shader_language aLanguage, i_string& aOutput) const
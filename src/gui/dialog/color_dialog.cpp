@@ -709,19 +709,97 @@ namespace neogfx
 
     void color_dialog::yz_picker::update_texture()
     {
-        for (std::uint32_t y = 0; y < 256; ++y)
+        // pixel [z][y] shows the colour at position (y, 255 - z); see color_at_position
+        auto const channel = iOwner.current_channel();
+        bool const hsvChannel = channel == ChannelHue || channel == ChannelSaturation || channel == ChannelValue ||
+            (channel == ChannelAlpha && iOwner.current_mode() == ModeHSV);
+        if (iImage)
         {
+            for (std::uint32_t y = 0; y < 256; ++y)
+            {
+                for (std::uint32_t z = 0; z < 256; ++z)
+                {
+                    auto r = color_at_position(point{ static_cast<coordinate>(y), static_cast<coordinate>(255 - z) });
+                    color rgbColor = (std::holds_alternative<hsv_color>(r) ? static_variant_cast<const hsv_color&>(r).to_rgb<color>() : static_variant_cast<const color&>(r));
+                    iPixels[z][y][0] = rgbColor.red();
+                    iPixels[z][y][1] = rgbColor.green();
+                    iPixels[z][y][2] = rgbColor.blue();
+                    iPixels[z][y][3] = 255; // alpha
+                }
+            }
+        }
+        else if (hsvChannel)
+        {
+            auto const hsv = iOwner.selected_color_as_hsv(true);
+            iHsvPixels.resize(256u * 256u * 4u);
+            auto pixel = iHsvPixels.begin();
             for (std::uint32_t z = 0; z < 256; ++z)
             {
-                auto r = color_at_position(point{ static_cast<coordinate>(y), static_cast<coordinate>(255 - z) });
-                color rgbColor = (std::holds_alternative<hsv_color>(r) ? static_variant_cast<const hsv_color&>(r).to_rgb<color>() : static_variant_cast<const color&>(r));
-                iPixels[z][y][0] = rgbColor.red();
-                iPixels[z][y][1] = rgbColor.green();
-                iPixels[z][y][2] = rgbColor.blue();
-                iPixels[z][y][3] = 255; // alpha
+                for (std::uint32_t y = 0; y < 256; ++y)
+                {
+                    float const across = y / 255.0f;
+                    float const up = z / 255.0f;
+                    switch (channel)
+                    {
+                    case ChannelSaturation:
+                        *pixel++ = across * 360.0f;
+                        *pixel++ = static_cast<float>(hsv.saturation());
+                        *pixel++ = up;
+                        break;
+                    case ChannelValue:
+                        *pixel++ = across * 360.0f;
+                        *pixel++ = up;
+                        *pixel++ = static_cast<float>(hsv.value());
+                        break;
+                    default:
+                        *pixel++ = static_cast<float>(hsv.hue());
+                        *pixel++ = across;
+                        *pixel++ = up;
+                        break;
+                    }
+                    *pixel++ = 1.0f; // alpha
+                }
+            }
+            hsv_color::to_rgb(iHsvPixels, std::span<std::uint8_t>{ &iPixels[0][0][0], iHsvPixels.size() });
+        }
+        else
+        {
+            std::array<color::component, 256> components;
+            for (std::uint32_t i = 0; i < 256; ++i)
+                components[i] = static_cast<color::component>(to_sRGB(*iOwner.iColorSpace, static_cast<scalar>(i), 255.0));
+            auto const rgb = iOwner.selected_color();
+            for (std::uint32_t z = 0; z < 256; ++z)
+            {
+                for (std::uint32_t y = 0; y < 256; ++y)
+                {
+                    auto& pixel = iPixels[z][y];
+                    pixel[0] = rgb.red();
+                    pixel[1] = rgb.green();
+                    pixel[2] = rgb.blue();
+                    pixel[3] = 255; // alpha
+                    switch (channel)
+                    {
+                    case ChannelRed:
+                        pixel[2] = components[y];
+                        pixel[1] = components[z];
+                        break;
+                    case ChannelGreen:
+                        pixel[2] = components[y];
+                        pixel[0] = components[z];
+                        break;
+                    case ChannelBlue:
+                        pixel[0] = components[y];
+                        pixel[1] = components[z];
+                        break;
+                    default:
+                        pixel[2] = components[y];
+                        pixel[1] = components[z];
+                        break;
+                    }
+                }
             }
         }
-        iTexture.set_pixels(rect{ point{}, size{256, 256} }, &iPixels[0][0][0]);
+        iTexture.set_pixels_async(rect{ point{}, size{256, 256} }, &iPixels[0][0][0], texture_data_format::RGBA);
         update();
     }
 
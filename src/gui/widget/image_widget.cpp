@@ -19,48 +19,61 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <neolib/task/thread_pool.hpp>
+
 #include <neogfx/gui/widget/image_widget.hpp>
 
 
 namespace neogfx
 {
+    namespace
+    {
+        std::optional<image> cpu_image(const i_image& aImage)
+        {
+            auto const existing = dynamic_cast<const image*>(&aImage);
+            if (existing != nullptr && !existing->is_empty())
+                return *existing; // shares the pixels and cached mip levels of the source
+            return {};
+        }
+    }
+
     image_widget::image_widget(const i_texture& aTexture, aspect_ratio aAspectRatio, cardinal aPlacement) :
-        iTexture{ aTexture }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }
+        iTexture{ aTexture }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }, iResamplingFilter{ neogfx::resampling_filter::Box }
     {
         set_padding(neogfx::padding{ 0.0 });
         set_ignore_mouse_events(true);
     }
 
     image_widget::image_widget(const i_image& aImage, aspect_ratio aAspectRatio, cardinal aPlacement) :
-        iTexture{ aImage }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }
+        iImage{ cpu_image(aImage) }, iTexture{ iImage ? texture{} : texture{ aImage } }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }, iResamplingFilter{ neogfx::resampling_filter::Box }
     {
         set_padding(neogfx::padding{ 0.0 });
         set_ignore_mouse_events(true);
     }
 
     image_widget::image_widget(i_widget& aParent, const i_texture& aTexture, aspect_ratio aAspectRatio, cardinal aPlacement) :
-        widget{ aParent }, iTexture{ aTexture }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }
+        widget{ aParent }, iTexture{ aTexture }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }, iResamplingFilter{ neogfx::resampling_filter::Box }
     {
         set_padding(neogfx::padding{ 0.0 });
         set_ignore_mouse_events(true);
     }
 
     image_widget::image_widget(i_widget& aParent, const i_image& aImage, aspect_ratio aAspectRatio, cardinal aPlacement) :
-        widget{ aParent }, iTexture{ aImage }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }
+        widget{ aParent }, iImage{ cpu_image(aImage) }, iTexture{ iImage ? texture{} : texture{ aImage } }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }, iResamplingFilter{ neogfx::resampling_filter::Box }
     {
         set_padding(neogfx::padding{ 0.0 });
         set_ignore_mouse_events(true);
     }
 
     image_widget::image_widget(i_layout& aLayout, const i_texture& aTexture, aspect_ratio aAspectRatio, cardinal aPlacement) :
-        widget{ aLayout }, iTexture{ aTexture }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }
+        widget{ aLayout }, iTexture{ aTexture }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }, iResamplingFilter{ neogfx::resampling_filter::Box }
     {
         set_padding(neogfx::padding{ 0.0 });
         set_ignore_mouse_events(true);
     }
 
     image_widget::image_widget(i_layout& aLayout, const i_image& aImage, aspect_ratio aAspectRatio, cardinal aPlacement) :
-        widget{ aLayout }, iTexture{ aImage }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }
+        widget{ aLayout }, iImage{ cpu_image(aImage) }, iTexture{ iImage ? texture{} : texture{ aImage } }, iAspectRatio{ aAspectRatio }, iPlacement{ aPlacement }, iDpiAutoScale{ false }, iResamplingFilter{ neogfx::resampling_filter::Box }
     {
         set_padding(neogfx::padding{ 0.0 });
         set_ignore_mouse_events(true);
@@ -78,23 +91,36 @@ namespace neogfx
 
     size image_widget::minimum_size(optional_size const& aAvailableSpace) const
     {
-        if (has_minimum_size() || iTexture.is_empty() || size_policy() == size_constraint::DefaultMinimumExpanding)
+        if (has_minimum_size() || !has_image() || size_policy() == size_constraint::DefaultMinimumExpanding)
             return widget::minimum_size(aAvailableSpace);
-        size result = units_converter{ *this }.from_device_units(iTexture.extents()) + internal_spacing().size();
+        size result = units_converter{ *this }.from_device_units(image_extents()) + internal_spacing().size();
         if (iDpiAutoScale)
-            result *= (dpi_scale_factor() / iTexture.dpi_scale_factor());
+            result *= (dpi_scale_factor() / image_dpi_scale_factor());
         return to_units(*this, scoped_units::current_units(), result);
     }
 
+    void image_widget::resized()
+    {
+        widget::resized();
+        if (iImage)
+            rescale(iImage->mip_level_for(placement_rect().extents()));
+    }
+
     void image_widget::paint(i_graphics_context& aGc) const
     {
-        if (iTexture.is_empty())
+        if (!has_image())
+            return;
+        auto const placementRect = placement_rect();
+        auto const scaledImage = scaled_image(placementRect.extents());
+        if (scaledImage == nullptr)
             return;
-        aGc.draw_texture(placement_rect(), iTexture, effectively_disabled() ? color(0xFF, 0xFF, 0xFF, 0x80) : iColor, effectively_disabled() ? shader_effect::Monochrome : iColor != none ? shader_effect::Colorize : shader_effect::None);
+        aGc.draw_texture(placementRect, *scaledImage, effectively_disabled() ? color(0xFF, 0xFF, 0xFF, 0x80) : iColor, effectively_disabled() ? shader_effect::Monochrome : iColor != none ? shader_effect::Colorize : shader_effect::None);
     }
 
     const texture& image_widget::image() const
     {
+        if (iImage && iTexture.is_empty())
+            iTexture = texture{ *iImage };
         return iTexture;
     }
 
@@ -110,22 +136,20 @@ namespace neogfx
 
     void image_widget::set_image(const i_image& aImage)
     {
-        set_image(texture{ aImage });
+        auto const oldMinimumSize = minimum_size();
+        auto const oldImageExtents = image_extents();
+        iImage = cpu_image(aImage);
+        iTexture = iImage ? texture{} : texture{ aImage };
+        notify_image_changed(oldMinimumSize, oldImageExtents);
     }
 
     void image_widget::set_image(const i_texture& aTexture)
     {
-        size oldSize = minimum_size();
-        size oldTextureSize = image().extents();
+        auto const oldMinimumSize = minimum_size();
+        auto const oldImageExtents = image_extents();
+        iImage = std::nullopt;
         iTexture = aTexture;
-        ImageChanged();
-        if (oldSize != minimum_size() || oldTextureSize != image().extents())
-        {
-            ImageGeometryChanged();
-            if (visible() || effective_size_policy().ignore_visibility())
-                update_layout(true, true);
-        }
-        update();
+        notify_image_changed(oldMinimumSize, oldImageExtents);
     }
 
     void image_widget::set_image_color(const color_or_gradient& aImageColor)
@@ -164,12 +188,31 @@ namespace neogfx
         }
     }
 
+    neogfx::resampling_filter image_widget::resampling_filter() const
+    {
+        return iResamplingFilter;
+    }
+
+    void image_widget::set_resampling_filter(neogfx::resampling_filter aFilter)
+    {
+        if (iResamplingFilter != aFilter)
+        {
+            iResamplingFilter = aFilter;
+            iRescalingLevel = std::nullopt;
+            iRescaling = {};
+            iUploadingScaledImage = std::nullopt;
+            if (iScaledImage)
+                rescale(iScaledImage->first, true);
+            update();
+        }
+    }
+
     rect image_widget::placement_rect() const
     {
         scoped_units su{ *this, units::Pixels };
-        auto imageExtents = iTexture.extents();
+        auto imageExtents = image_extents();
         if (iDpiAutoScale)
-            imageExtents *= (dpi_scale_factor() / iTexture.dpi_scale_factor());
+            imageExtents *= (dpi_scale_factor() / image_dpi_scale_factor());
         rect placementRect{ point{}, imageExtents };
         auto const clientRect = client_rect();
         if (iAspectRatio == aspect_ratio::Stretch)
@@ -271,4 +314,106 @@ namespace neogfx
         }
         return floor_rasterized(placementRect);
     }
+
+    bool image_widget::has_image() const
+    {
+        return iImage || !iTexture.is_empty();
+    }
+
+    size image_widget::image_extents() const
+    {
+        return iImage ? iImage->extents() : iTexture.extents();
+    }
+
+    dimension image_widget::image_dpi_scale_factor() const
+    {
+        return iImage ? iImage->dpi_scale_factor() : iTexture.dpi_scale_factor();
+    }
+
+    const texture* image_widget::scaled_image(const size& aExtents) const
+    {
+        if (!iImage || iResamplingFilter == neogfx::resampling_filter::None)
+            return &image();
+        auto const level = iImage->mip_level_for(aExtents);
+        if (level == 0u)
+            return &image();
+        // Never resample here; until the wanted level has been uploaded the previous one (if any) is drawn.
+        rescale(level);
+        return iScaledImage ? &iScaledImage->second : nullptr;
+    }
+
+    void image_widget::rescale(std::uint32_t aLevel, bool aForce) const
+    {
+        if (!iImage || iResamplingFilter == neogfx::resampling_filter::None || aLevel == 0u)
+            return;
+        if (iRescalingLevel == aLevel)
+            return;
+        if (!aForce && iScaledImage && iScaledImage->first == aLevel)
+        {
+            // back to the level being drawn so any work on another level is dropped
+            iRescalingLevel = std::nullopt;
+            iRescaling = {};
+            iUploadingScaledImage = std::nullopt;
+            return;
+        }
+        iRescalingLevel = aLevel;
+        iUploadingScaledImage = std::nullopt;
+        // the worker resamples a copy sharing the source pixels; a superseded result is simply dropped
+        iRescaling = neolib::thread_pool::default_thread_pool().run(
+            [source = *iImage, aLevel, filter = iResamplingFilter]()
+            {
+                auto const& level = source.mip_level(aLevel, filter);
+                scaled_pixels result{ level.extents() };
+                std::size_t const rowBytes = static_cast<std::size_t>(result.extents.cx) * 4u;
+                std::size_t const rows = static_cast<std::size_t>(result.extents.cy);
+                result.data.resize(rowBytes * rows);
+                auto const pixels = static_cast<std::uint8_t const*>(level.cpixels());
+                for (std::size_t y = 0u; y < rows; ++y)
+                    std::copy_n(pixels + (rows - 1u - y) * rowBytes, rowBytes, result.data.begin() + y * rowBytes);
+                return result;
+            }).first;
+        if (iRescalingPoller == std::nullopt)
+            iRescalingPoller.emplace(const_cast<image_widget&>(*this), [this](widget_timer& aTimer)
+            {
+                if (!iRescaling.valid())
+                    return;
+                if (iRescaling.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+                    aTimer.again();
+                else
+                    scaled_pixels_ready();
+            }, std::chrono::milliseconds{ 10 });
+        else
+            iRescalingPoller->again_if();
+    }
+
+    void image_widget::scaled_pixels_ready() const
+    {
+        auto const pixels = iRescaling.get();
+        auto const level = iRescalingLevel.value();
+        iUploadingScaledImage.emplace(pixels.extents, iImage->dpi_scale_factor(), iImage->sampling(), texture_data_format::RGBA, texture_data_type::UnsignedByte, iImage->color_space());
+        // destroying the texture before its upload lands cancels this callback
+        iUploadingScaledImage->set_pixels_async(rect{ point{}, pixels.extents }, &pixels.data[0], texture_data_format::RGBA, [this, level]()
+        {
+            iScaledImage.emplace(level, *iUploadingScaledImage);
+            iUploadingScaledImage = std::nullopt;
+            iRescalingLevel = std::nullopt;
+            update();
+        }, 0u, 1u);
+    }
+
+    void image_widget::notify_image_changed(const size& aOldMinimumSize, const size& aOldImageExtents)
+    {
+        iScaledImage = std::nullopt;
+        iRescalingLevel = std::nullopt;
+        iRescaling = {};
+        iUploadingScaledImage = std::nullopt;
+        ImageChanged();
+        if (aOldMinimumSize != minimum_size() || aOldImageExtents != image_extents())
+        {
+            ImageGeometryChanged();
+            if (visible() || effective_size_policy().ignore_visibility())
+                update_layout(true, true);
+        }
+        update();
+    }
 }
\ No newline at end of file
@@ -24,6 +24,7 @@
 
 #include <neogfx/app/i_basic_services.hpp>
 #include <neogfx/app/i_app.hpp>
+#include <neogfx/gfx/text/i_font_manager.hpp>
 #include <neogfx/gui/widget/scrollable_widget.ipp>
 #include <neogfx/gui/widget/terminal.hpp>
 
@@ -34,6 +35,8 @@ namespace neogfx
     terminal::terminal() : 
         iTerminalSize{ 80, 25 },
         iBufferSize{ 80, 250 },
+        iScrollbackByteLimit{ 64u * 1024u * 1024u },
+        iGlyphCacheBudget{ 16u * 1024u * 1024u },
         iCursorAnimationStartTime{ neolib::this_process::elapsed_ms() },
         iAnimator{ *this, [this](widget_timer&)
         {
@@ -48,6 +51,8 @@ namespace neogfx
         base_type{ aParent, scrollbar_style::Normal, frame_style::NoFrame },
         iTerminalSize{ 80, 25 },
         iBufferSize{ 80, 250 },
+        iScrollbackByteLimit{ 64u * 1024u * 1024u },
+        iGlyphCacheBudget{ 16u * 1024u * 1024u },
         iCursorAnimationStartTime{ neolib::this_process::elapsed_ms() },
         iAnimator{ *this, [this](widget_timer&)
         {
@@ -62,6 +67,8 @@ namespace neogfx
         base_type{ aLayout, scrollbar_style::Normal, frame_style::NoFrame },
         iTerminalSize{ 80, 25 },
         iBufferSize{ 80, 250 },
+        iScrollbackByteLimit{ 64u * 1024u * 1024u },
+        iGlyphCacheBudget{ 16u * 1024u * 1024u },
         iCursorAnimationStartTime{ neolib::this_process::elapsed_ms() },
         iAnimator{ *this, [this](widget_timer&)
         {
@@ -112,9 +119,8 @@ namespace neogfx
             auto overflow = std::min(static_cast<dimension_type>(active_buffer().lines.size()), -yDelta);
             if (active_buffer().scrollingRegion)
             {
-                auto eraseStart = std::next(active_buffer().lines.begin(), std::max(0, buffer_origin().y - overflow));
-                auto eraseEnd = std::next(eraseStart, std::min(overflow, static_cast<dimension_type>(std::distance(eraseStart, active_buffer().lines.end()))));
-                active_buffer().lines.erase(eraseStart, eraseEnd);
+                auto const eraseStart = static_cast<std::size_t>(std::max(0, buffer_origin().y - overflow));
+                active_buffer().lines.erase(eraseStart, eraseStart + overflow);
             }
             else
                 set_buffer_origin(buffer_origin() + point_type{ 0, overflow });
@@ -161,61 +167,100 @@ namespace neogfx
 
         scoped_scissor ss{ aGc, cr };
 
-        scalar y = -vertical_scrollbar().position();
+        auto const& lines = active_buffer().lines;
+        auto const scrollPosition = vertical_scrollbar().position();
+        auto const lineCount = lines.size();
+        auto const visibleFirst = std::min(lineCount, static_cast<std::size_t>(
+            std::max<scalar>(0.0, std::ceil((cr.top() + scrollPosition) / ce.cy) - 1.0)));
+        auto const visibleLast = std::max(visibleFirst, std::min(lineCount, static_cast<std::size_t>(
+            std::max<scalar>(0.0, std::ceil((cr.bottom() + scrollPosition) / ce.cy)))));
+        auto const prefetch = visibleLast - visibleFirst;
+        auto const shapeFirst = visibleFirst - std::min(visibleFirst, prefetch);
+        auto const shapeLast = std::min(lineCount, visibleLast + prefetch);
+
+        for (auto lineIndex = shapeFirst; lineIndex < shapeLast; ++lineIndex)
+            if (!lines[lineIndex].shaped())
+                shape_line(aGc, lines[lineIndex]);
+            else
+                (void)lines[lineIndex].glyphs();
+
+        scalar y = -scrollPosition + visibleFirst * ce.cy;
 
-        for (auto const& line : active_buffer().lines)
+        for (auto lineIndex = visibleFirst; lineIndex < visibleLast; ++lineIndex)
         {
-            if (line.glyphs == std::nullopt)
-            {
-                line.glyphs = aGc.to_glyph_text(line.text,
-                    [&](std::size_t n) -> neogfx::font
-                    {
-                        return n < line.attributes.size() ? font(line.attributes[n].style) : normal_font();
-                    });
-                float xPrevious = 0.0f;
-                for (auto& g : *line.glyphs)
-                {
-                    g.cell[0].x = xPrevious;
-                    g.cell[1].x = xPrevious + static_cast<float>(ce.cx);
-                    g.cell[2].x = xPrevious + static_cast<float>(ce.cx);
-                    g.cell[3].x = xPrevious;
-                    xPrevious += static_cast<float>(ce.cx);
-                }
-            }
-            if (y + ce.cy >= cr.top() && y < cr.bottom())
+            auto const& line = lines[lineIndex];
+            thread_local text_format_spans attributes;
+            attributes.clear();
+            auto& glyphs = line.glyphs();
+            for (auto& g : glyphs)
             {
-                thread_local text_format_spans attributes;
-                attributes.clear();
-                for (auto& g : *line.glyphs)
+                auto const& cellAttribute = line.attribute(g.clusters.first);
+                auto ink = cellAttribute.ink;
+                auto paper = cellAttribute.paper;
+                if (cellAttribute.reverse)
+                    std::swap(ink, paper);
+                if (cellAttribute.underline)
+                    set_underline(g, true);
+                optional_text_effect effect;
+                if (iTextFormat)
                 {
-                    auto ink = line.attributes[g.clusters.first].ink;
-                    auto paper = line.attributes[g.clusters.first].paper;
-                    if (line.attributes[g.clusters.first].reverse)
-                        std::swap(ink, paper);
-                    if (line.attributes[g.clusters.first].underline)
-                        set_underline(g, true);
-                    optional_text_effect effect;
-                    if (iTextFormat)
+                    effect = iTextFormat->effect();
+                    if (effect && effect->type() == text_effect_type::Glow)
                     {
-                        effect = iTextFormat->effect();
-                        if (effect && effect->type() == text_effect_type::Glow)
-                        {
-                            if (std::holds_alternative<color>(effect->color()))
-                                effect->set_color(ink.to_hsv().with_saturation(ink.to_hsv().saturation() * 0.7).to_rgb<color>());
-                            ink = ink.to_hsv().with_saturation(ink.to_hsv().saturation() * 0.4).to_rgb<color>();
-                        }
+                        if (std::holds_alternative<color>(effect->color()))
+                            effect->set_color(ink.to_hsv().with_saturation(ink.to_hsv().saturation() * 0.7).to_rgb<color>());
+                        ink = ink.to_hsv().with_saturation(ink.to_hsv().saturation() * 0.4).to_rgb<color>();
                     }
-                    attributes.add(g.clusters.first, ink, paper, effect);
                 }
-                aGc.draw_glyphs(tl + point{ 0, y }, *line.glyphs, attributes);
+                attributes.add(g.clusters.first, ink, paper, effect);
             }
+            aGc.draw_glyphs(tl + point{ 0, y }, glyphs, attributes);
             y += ce.cy;
         }
 
+        evict_glyphs(shapeLast - shapeFirst);
+
         if (has_focus())
             draw_cursor(aGc);
     }
 
+    std::size_t terminal::glyph_cache_budget() const
+    {
+        return iGlyphCacheBudget;
+    }
+
+    void terminal::set_glyph_cache_budget(std::size_t aBudget)
+    {
+        iGlyphCacheBudget = aBudget;
+        if (active_buffer().lines.glyph_cache().usage() > iGlyphCacheBudget)
+            update();
+    }
+
+    std::size_t terminal::scrollback_line_limit() const
+    {
+        return static_cast<std::size_t>(iBufferSize.cy);
+    }
+
+    std::size_t terminal::scrollback_byte_limit() const
+    {
+        return iScrollbackByteLimit;
+    }
+
+    void terminal::set_scrollback_limits(std::size_t aLineLimit, std::size_t aByteLimit)
+    {
+        aLineLimit = std::max(aLineLimit, static_cast<std::size_t>(iTerminalSize.cy));
+        iBufferSize.cy = static_cast<dimension_type>(aLineLimit);
+        iScrollbackByteLimit = aByteLimit;
+        for (auto* scrollback : { &iPrimaryBuffer, &iAlternateBuffer })
+        {
+            scrollback->lines.set_limits(aLineLimit, aByteLimit);
+            auto const lineCount = static_cast<coordinate_type>(scrollback->lines.size());
+            if (scrollback->bufferOrigin.y + iTerminalSize.cy > lineCount)
+                scrollback->bufferOrigin.y = std::max(0, lineCount - iTerminalSize.cy);
+        }
+        update_cursor();
+    }
+
     color terminal::palette_color(color_role aColorRole) const
     {
         if (has_palette_color(aColorRole))
@@ -507,9 +552,37 @@ namespace neogfx
 
         neolib::scoped_flag sf{ iOutputting };
 
-        auto utf32 = neolib::utf8_to_utf32(aOutput.to_std_string_view());
-        for (auto ch : utf32)
+        auto const oldActiveBuffer = &active_buffer();
+        auto const oldBufferOrigin = buffer_origin();
+        auto const oldScrollPosition = vertical_scrollbar().position();
+        auto const oldCursorRect = cursor_rect();
+        iDamagedLines = std::nullopt;
+        iDamagedAll = false;
+
+        auto const printable = [](char32_t aCharacter) { return aCharacter >= U'\x20' && aCharacter != U'\x7F'; };
+
+        auto const utf32 = neolib::utf8_to_utf32(aOutput.to_std_string_view());
+        for (std::size_t index = 0; index < utf32.size(); ++index)
         {
+            auto const ch = utf32[index];
+            if (!iEscapeSequence && printable(ch))
+            {
+                // fast path: write a whole run of printable characters in one go...
+                auto const runEnd = static_cast<std::size_t>(
+                    std::distance(utf32.begin(), std::find_if_not(std::next(utf32.begin(), index), utf32.end(), printable)));
+                std::u32string_view run{ utf32.data() + index, runEnd - index };
+                if (active_buffer().characterSet != character_set::USASCII)
+                {
+                    thread_local std::u32string translated;
+                    translated.clear();
+                    for (auto runCharacter : run)
+                        translated.push_back(to_unicode(runCharacter));
+                    run = translated;
+                }
+                output_characters(run, active_buffer().attribute);
+                index = runEnd - 1;
+                continue;
+            }
 #if 0 // for debugging purposes...
             if (ch >= U' ')
                 std::cout << (char) ch << std::flush;
@@ -520,7 +593,8 @@ namespace neogfx
             if (iEscapeSequence)
             {
                 *iEscapeSequence += static_cast<char>(ch);
-                switch(iEscapeSequence.value()[0])
+                auto const escapeIntroducer = iEscapeSequence.value()[0];
+                switch(escapeIntroducer)
                 {
                 case '7':
                     if (active_buffer().saved.empty())
@@ -544,13 +618,13 @@ namespace neogfx
                     {
                         if (!active_buffer().scrollingRegion)
                         {
-                            active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y + iTerminalSize.cy - 1));
-                            active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_origin().y), buffer_line{});
+                            active_buffer().lines.erase(buffer_origin().y + iTerminalSize.cy - 1);
+                            active_buffer().lines.insert(buffer_origin().y);
                         }
                         else
                         {
-                            active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y + active_buffer().scrollingRegion.value().bottom));
-                            active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_origin().y + active_buffer().scrollingRegion.value().top), buffer_line{});
+                            active_buffer().lines.erase(buffer_origin().y + active_buffer().scrollingRegion.value().bottom);
+                            active_buffer().lines.insert(buffer_origin().y + active_buffer().scrollingRegion.value().top);
                         }
                     }
                     iEscapeSequence = std::nullopt;
@@ -645,7 +719,7 @@ namespace neogfx
                                 auto lines = (params.empty() ? 1 : std::stoi(params[0]));
                                 while (lines--)
                                 {
-                                    active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y));
+                                    active_buffer().lines.erase(buffer_origin().y);
                                     (void)line(buffer_origin().y + iTerminalSize.cy - 1);
                                 }
                             }
@@ -657,8 +731,8 @@ namespace neogfx
                                 auto lines = (params.empty() ? 1 : std::stoi(params[0]));
                                 while (lines--)
                                 {
-                                    active_buffer().lines.erase(std::next(active_buffer().lines.begin(), buffer_origin().y + iTerminalSize.cy - 1));
-                                    active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_origin().y), buffer_line{});
+                                    active_buffer().lines.erase(buffer_origin().y + iTerminalSize.cy - 1);
+                                    active_buffer().lines.insert(buffer_origin().y);
                                 }
                             }
                             catch (...) {}
@@ -668,8 +742,8 @@ namespace neogfx
                             {
                                 coordinate_type n = params.empty() ? 1 : std::stoi(params[0]);
                                 auto& line = terminal::line(buffer_pos().y);
-                                auto repChar = line.text.at(buffer_pos().x - 1);
-                                auto repAttribute = line.attributes.at(buffer_pos().x - 1);
+                                auto repChar = line.character(buffer_pos().x - 1);
+                                auto repAttribute = line.attribute(buffer_pos().x - 1);
                                 while (n--)
                                     output_character(repChar, repAttribute);
                             }
@@ -695,15 +769,12 @@ namespace neogfx
                             {
                                 coordinate_type const n = params.empty() ? 1 : std::stoi(params[0]);
                                 auto& line = terminal::line(buffer_pos().y);
-                                if (!line.text.empty())
+                                if (!line.empty())
                                 {
-                                    coordinate_type const start = std::min(static_cast<coordinate_type>(line.text.size()), buffer_pos().x);
-                                    coordinate_type const end = std::min(static_cast<coordinate_type>(line.text.size()), start + n);
-                                    line.text.erase(std::next(line.text.begin(), start), std::next(line.text.begin(), end));
-                                    line.attributes.erase(std::next(line.attributes.begin(), start), std::next(line.attributes.begin(), end));
-                                    line.text.insert(std::next(line.text.begin(), start), end - start, U' ');
-                                    line.attributes.insert(std::next(line.attributes.begin(), start), end - start, default_attribute());
-                                    line.glyphs = std::nullopt;
+                                    coordinate_type const start = std::min(static_cast<coordinate_type>(line.size()), buffer_pos().x);
+                                    coordinate_type const end = std::min(static_cast<coordinate_type>(line.size()), start + n);
+                                    line.erase(start, end);
+                                    line.insert(start, end - start, U' ', default_attribute());
                                 }
                             }
                             catch (...)
@@ -726,10 +797,8 @@ namespace neogfx
                                 bottom += buffer_origin().y;
                                 while (lines--)
                                 {
-                                    auto inserted = active_buffer().lines.insert(std::next(active_buffer().lines.begin(), buffer_pos().y), buffer_line{});
-                                    inserted->text.reserve(iBufferSize.cx);
-                                    inserted->attributes.reserve(iBufferSize.cx);
-                                    active_buffer().lines.erase(std::next(active_buffer().lines.begin(), bottom + 1));
+                                    active_buffer().lines.erase(bottom);
+                                    active_buffer().lines.insert(buffer_pos().y);
                                 }
                                 set_cursor_pos(cursor_pos().with_x(0));
                             }
@@ -1012,24 +1081,15 @@ namespace neogfx
                                 switch (n)
                                 {
                                 case 0:
-                                    if (!line.text.empty())
-                                    {
-                                        line.text.erase(std::next(line.text.begin(), std::min(static_cast<coordinate_type>(line.text.size()), buffer_pos().x)), line.text.end());
-                                        line.attributes.erase(std::next(line.attributes.begin(), std::min(static_cast<coordinate_type>(line.attributes.size()), buffer_pos().x)), line.attributes.end());
-                                        line.glyphs = std::nullopt;
-                                    }
+                                    if (!line.empty())
+                                        line.truncate(buffer_pos().x);
                                     break;
                                 case 1:
-                                    line.text.erase(line.text.begin(), std::next(line.text.begin(), std::min(static_cast<coordinate_type>(line.text.size()), buffer_pos().x + 1)));
-                                    line.attributes.erase(line.attributes.begin(), std::next(line.attributes.begin(), std::min(static_cast<coordinate_type>(line.attributes.size()), buffer_pos().x + 1)));
-                                    line.text.insert(line.text.begin(), buffer_pos().x + 1, U' ');
-                                    line.attributes.insert(line.attributes.begin(), buffer_pos().x + 1, default_attribute());
-                                    line.glyphs = std::nullopt;
+                                    line.erase(0, buffer_pos().x + 1);
+                                    line.insert(0, buffer_pos().x + 1, U' ', default_attribute());
                                     break;
                                 case 2:
-                                    line.text.clear();
-                                    line.attributes.clear();
-                                    line.glyphs = std::nullopt;
+                                    line.clear();
                                     break;
                                 }
                             }
@@ -1040,11 +1100,8 @@ namespace neogfx
                                 if (!params.empty())
                                     try { n = std::stoi(params[0]); } catch (...) {}
                                 auto& line = terminal::line(buffer_pos().y);
-                                line.text.erase(std::next(line.text.begin(), buffer_pos().x), std::next(line.text.begin(), buffer_pos().x + n));
-                                line.attributes.erase(std::next(line.attributes.begin(), buffer_pos().x), std::next(line.attributes.begin(), buffer_pos().x + n));
-                                line.text.insert(line.text.end(), n, U' ');
-                                line.attributes.insert(line.attributes.end(), n, attribute{});
-                                line.glyphs = std::nullopt;
+                                line.erase(buffer_pos().x, buffer_pos().x + n);
+                                line.insert(line.size(), n, U' ', attribute{});
                             }
                             break;
                         default:
@@ -1060,6 +1117,9 @@ namespace neogfx
                     iEscapeSequence = std::nullopt;
                     break;
                 }
+                // SGR only affects subsequent output; assume anything else may have changed the whole display...
+                if (iEscapeSequence == std::nullopt && !(escapeIntroducer == '[' && ch == U'm'))
+                    iDamagedAll = true;
             }
             else if (ch == U'\x1B')
             {
@@ -1083,8 +1143,9 @@ namespace neogfx
                         set_cursor_pos(cursor_pos().with_y(cursor_pos().y + 1));
                     else
                     {
-                        active_buffer().lines.erase(std::next(active_buffer().lines.begin(), active_buffer().scrollingRegion.value().top + buffer_origin().y));
-                        active_buffer().lines.insert(std::next(active_buffer().lines.begin(), active_buffer().scrollingRegion.value().bottom + buffer_origin().y), buffer_line{});
+                        active_buffer().lines.erase(active_buffer().scrollingRegion.value().top + buffer_origin().y);
+                        active_buffer().lines.insert(active_buffer().scrollingRegion.value().bottom + buffer_origin().y);
+                        iDamagedAll = true;
                     }
                     break;
                 case U'\0':
@@ -1106,7 +1167,25 @@ namespace neogfx
                 }
             }
         }
-        update_cursor();
+
+        position_cursor();
+
+        if (iDamagedAll || &active_buffer() != oldActiveBuffer || buffer_origin() != oldBufferOrigin ||
+            vertical_scrollbar().position() != oldScrollPosition)
+            update();
+        else
+        {
+            auto damage = oldCursorRect.combined(cursor_rect());
+            if (iDamagedLines)
+            {
+                auto const& cr = client_rect(false);
+                auto const& ce = character_extents();
+                damage.combine(rect{
+                    point{ cr.left(), cr.top() + iDamagedLines->first * ce.cy - vertical_scrollbar().position() },
+                    size{ cr.width(), (iDamagedLines->second - iDamagedLines->first + 1) * ce.cy } });
+            }
+            update(damage);
+        }
     }
 
     cursor& terminal::cursor() const
@@ -1120,8 +1199,10 @@ namespace neogfx
         horizontal_scrollbar().set_style(scrollbar_style::None);
         set_ideal_size(padding().size() + character_extents() * size { iTerminalSize } +
             size{ effective_frame_width() } + size{ vertical_scrollbar().width(), horizontal_scrollbar().width() });
+        iPrimaryBuffer.lines.set_limits(iBufferSize.cy, iScrollbackByteLimit);
         iPrimaryBuffer.cursor.set_style(cursor_style::Xor);
         iPrimaryBuffer.cursor.set_width(character_extents().cx);
+        iAlternateBuffer.lines.set_limits(iBufferSize.cy, iScrollbackByteLimit);
         iAlternateBuffer.cursor.set_style(cursor_style::Xor);
         iAlternateBuffer.cursor.set_width(character_extents().cx);
 
@@ -1133,11 +1214,13 @@ namespace neogfx
         iSink += cursor().PositionChanged([this]()
             {
                 iCursorAnimationStartTime = neolib::this_process::elapsed_ms();
-                update();
+                if (!iOutputting)
+                    update();
             });
         iSink += cursor().AnchorChanged([this]()
             {
-                update();
+                if (!iOutputting)
+                    update();
             });
         iSink += cursor().AppearanceChanged([this]()
             {
@@ -1155,7 +1238,8 @@ namespace neogfx
     void terminal::enable_alternate_buffer()
     {
         iActiveBuffer = &iAlternateBuffer;
-        iAlternateBuffer = {};
+        iAlternateBuffer = buffer{};
+        iAlternateBuffer.lines.set_limits(iBufferSize.cy, iScrollbackByteLimit);
         iAlternateBuffer.cursor.set_style(cursor_style::Xor);
         iAlternateBuffer.cursor.set_width(character_extents().cx);
         set_cursor_pos({});
@@ -1259,20 +1343,17 @@ namespace neogfx
         {
             ++lineStart;
             auto& line = terminal::line(aBufferPosStart.y);
-            line.text.erase(std::next(line.text.begin(), aBufferPosStart.x), line.text.end());
-            line.attributes.erase(std::next(line.attributes.begin(), aBufferPosStart.x), line.attributes.end());
+            line.truncate(aBufferPosStart.x);
         }
         if (aBufferPosEnd.x < terminal_size().cx)
         {
             --lineEnd;
             auto& line = terminal::line(aBufferPosStart.y);
-            auto const eol = std::min(static_cast<coordinate_type>(line.text.size()), aBufferPosStart.y != aBufferPosEnd.y ? aBufferPosEnd.x : aBufferPosEnd.x - aBufferPosStart.x);
-            line.text.erase(line.text.begin(), std::next(line.text.begin(), eol));
-            line.attributes.erase(line.attributes.begin(), std::next(line.attributes.begin(), eol));
+            auto const eol = std::min(static_cast<coordinate_type>(line.size()), aBufferPosStart.y != aBufferPosEnd.y ? aBufferPosEnd.x : aBufferPosEnd.x - aBufferPosStart.x);
+            line.erase(0, std::max(0, eol));
         }
-        auto eraseLineStart = std::next(active_buffer().lines.begin(), lineStart);
-        auto eraseLineEnd = std::next(active_buffer().lines.begin(), lineEnd);
-        active_buffer().lines.erase(eraseLineStart, eraseLineEnd);
+        if (lineStart >= 0 && lineStart < lineEnd)
+            active_buffer().lines.erase(lineStart, lineEnd);
     }
 
     char32_t terminal::to_unicode(char32_t aCharacter) const
@@ -1311,50 +1392,104 @@ namespace neogfx
 
     terminal::buffer_line& terminal::line(coordinate_type aLine)
     {
-        auto oldBufferSize = active_buffer().lines.size();
-        auto const desiredBufferSize = aLine + 1;
+        auto& lines = active_buffer().lines;
+        auto const desiredBufferSize = static_cast<std::size_t>(std::max<coordinate_type>(aLine, 0) + 1);
 
-        while (active_buffer().lines.size() < desiredBufferSize)
+        // the ring recycles its oldest line once the line limit is reached...
+        coordinate_type dropped = 0;
+        while (lines.size() + static_cast<std::size_t>(dropped) < desiredBufferSize)
         {
-            active_buffer().lines.emplace_back();
-            active_buffer().lines.back().text.reserve(iBufferSize.cx);
-            active_buffer().lines.back().attributes.reserve(iBufferSize.cx);
+            if (lines.full())
+                ++dropped;
+            (void)lines.push_back();
         }
 
-        if (active_buffer().lines.size() > iBufferSize.cy)
-            active_buffer().lines.erase(active_buffer().lines.begin(), std::next(active_buffer().lines.begin(), active_buffer().lines.size() - iBufferSize.cy));
+        // ... and the byte limit is honoured here, never trimming into the visible terminal area.
+        dropped += static_cast<coordinate_type>(lines.trim(iTerminalSize.cy));
 
-        if (active_buffer().lines.size() - buffer_origin().y > iTerminalSize.cy)
-            set_buffer_origin( buffer_origin() + 
-                point_type{ 0, (static_cast<coordinate_type>(active_buffer().lines.size() - oldBufferSize)) });
+        // lines dropped from the front shift every buffer coordinate (including the requested line) up...
+        auto origin = buffer_origin();
+        if (dropped != 0)
+        {
+            aLine -= dropped;
+            origin.y = std::max<coordinate_type>(origin.y - dropped, 0);
+            iDamagedAll = true;
+        }
 
-        return active_buffer().lines[std::min(static_cast<coordinate_type>(active_buffer().lines.size() - 1), aLine)];
+        // ... and the terminal area scrolls to keep the last line visible.
+        auto const bufferSize = static_cast<coordinate_type>(lines.size());
+        if (bufferSize - origin.y > iTerminalSize.cy)
+            origin.y = bufferSize - iTerminalSize.cy;
+        set_buffer_origin(origin);
+
+        return lines[static_cast<std::size_t>(std::clamp<coordinate_type>(aLine, 0, bufferSize - 1))];
     }
 
-    char32_t& terminal::character(point_type const& aBufferPos)
+    void terminal::output_character(char32_t aCharacter, std::optional<attribute> const& aAttribute)
     {
-        auto& line = terminal::line(aBufferPos.y);
-        if (line.text.size() <= aBufferPos.x)
-            line.text.resize(aBufferPos.x + 1, U' ');
-        if (line.attributes.size() <= aBufferPos.x)
-            line.attributes.resize(aBufferPos.x + 1, default_attribute());
-        line.attributes[aBufferPos.x] = active_attribute();
-        return line.text[aBufferPos.x];
+        output_characters(std::u32string_view{ &aCharacter, 1u }, aAttribute);
     }
 
-    void terminal::output_character(char32_t aCharacter, std::optional<attribute> const& aAttribute)
+    void terminal::output_characters(std::u32string_view aCharacters, std::optional<attribute> const& aAttribute)
     {
-        if (cursor_pos().x == iTerminalSize.cx && active_buffer().autoWrap &&
-            (!active_buffer().scrollingRegion || cursor_pos().y + 1 < active_buffer().scrollingRegion->bottom))
-            set_cursor_pos({ 0, cursor_pos().y + 1 });
-        character(buffer_pos()) = aCharacter;
-        if (aAttribute)
+        auto const cellAttribute = aAttribute ? aAttribute.value() : active_attribute();
+        while (!aCharacters.empty())
         {
-            auto& line = terminal::line(buffer_pos().y);
-            line.attributes.at(buffer_pos().x) = aAttribute.value();
+            if (cursor_pos().x == iTerminalSize.cx && active_buffer().autoWrap &&
+                (!active_buffer().scrollingRegion || cursor_pos().y + 1 < active_buffer().scrollingRegion->bottom))
+                set_cursor_pos({ 0, cursor_pos().y + 1 });
+            auto const bufferPos = buffer_pos();
+            auto& line = terminal::line(bufferPos.y);
+            damage_line(bufferPos.y);
+            auto const columns = static_cast<std::size_t>(std::max(0, iTerminalSize.cx - cursor_pos().x));
+            if (columns == 0u)
+            {
+                // no wrapping so every character lands on (and overwrites) the last column...
+                line.set(bufferPos.x, aCharacters.back(), cellAttribute, default_attribute());
+                break;
+            }
+            auto const count = std::min(columns, aCharacters.size());
+            line.replace(bufferPos.x, aCharacters.substr(0u, count), cellAttribute, default_attribute());
+            aCharacters.remove_prefix(count);
+            set_cursor_pos(cursor_pos().with_x(cursor_pos().x + static_cast<coordinate_type>(count)));
         }
-        line(buffer_pos().y).glyphs = std::nullopt;
-        set_cursor_pos(cursor_pos().with_x(cursor_pos().x + 1));
+    }
+
+    void terminal::damage_line(coordinate_type aLine)
+    {
+        if (!iDamagedLines)
+            iDamagedLines.emplace(aLine, aLine);
+        else
+        {
+            iDamagedLines->first = std::min(iDamagedLines->first, aLine);
+            iDamagedLines->second = std::max(iDamagedLines->second, aLine);
+        }
+    }
+
+    void terminal::shape_line(i_graphics_context& aGc, buffer_line const& aLine) const
+    {
+        auto const& ce = character_extents();
+        auto glyphs = service<i_font_manager>().glyph_text_factory().to_glyph_text(aGc, aLine.text(),
+            [&](std::size_t n) -> neogfx::font
+            {
+                return n < aLine.size() ? font(aLine.attribute(n).style) : normal_font();
+            });
+        float xPrevious = 0.0f;
+        for (auto& g : glyphs)
+        {
+            g.cell[0].x = xPrevious;
+            g.cell[1].x = xPrevious + static_cast<float>(ce.cx);
+            g.cell[2].x = xPrevious + static_cast<float>(ce.cx);
+            g.cell[3].x = xPrevious;
+            xPrevious += static_cast<float>(ce.cx);
+        }
+        aLine.set_glyphs(std::move(glyphs));
+    }
+
+    void terminal::evict_glyphs(std::size_t aKeep) const
+    {
+        // lines are evicted least recently painted first; the aKeep lines just painted or prefetched stay
+        active_buffer().lines.glyph_cache().evict(iGlyphCacheBudget, aKeep);
     }
 
     terminal::point_type terminal::buffer_origin() const
@@ -1402,11 +1537,16 @@ namespace neogfx
         return true;
     }
 
-    void terminal::update_cursor()
+    void terminal::position_cursor()
     {
         cursor().set_position(iTerminalSize.cx * cursor_pos().y + cursor_pos().x);
         update_scrollbar_visibility();
         make_cursor_visible();
+    }
+
+    void terminal::update_cursor()
+    {
+        position_cursor();
         update();
     }
     
@@ -19,10 +19,15 @@
 
 #include <neogfx/neogfx.hpp>
 
+#include <numeric>
+#include <atomic>
+#include <future>
+
 #include <boost/algorithm/string/find.hpp>
 
 #include <neolib/core/scoped.hpp>
 #include <neolib/task/thread.hpp>
+#include <neolib/task/thread_pool.hpp>
 #include <neolib/app/i_power.hpp>
 
 #include <neogfx/app/i_basic_services.hpp>
@@ -80,6 +85,64 @@ namespace neogfx
         scoped_property_transition_suppression iSts2;
     };
 
+    // primary font shaping of the chunk after the shaping frontier runs on the thread pool; glyph assembly stays on the GUI 
+    // thread as it rasterizes glyphs into the atlas.  The job's snapshot of its text and fonts is shared with the task so a
+    // superseded job is cancelled (the task stops at the next paragraph) rather than waited for.
+    class text_edit::preshaping_job
+    {
+    public:
+        typedef std::vector<std::pair<std::size_t, neogfx::font>> font_runs;
+    private:
+        struct snapshot
+        {
+            std::u32string const text;
+            std::vector<std::size_t> const paragraphEnds;
+            font_runs const fonts;
+            std::atomic<bool> cancelled;
+
+            snapshot(std::u32string&& aText, std::vector<std::size_t>&& aParagraphEnds, font_runs&& aFonts) :
+                text{ std::move(aText) }, paragraphEnds{ std::move(aParagraphEnds) }, fonts{ std::move(aFonts) }, cancelled{ false }
+            {
+            }
+        };
+    public:
+        preshaping_job(std::u32string&& aText, std::vector<std::size_t>&& aParagraphEnds, font_runs&& aFonts) :
+            iSnapshot{ std::make_shared<snapshot>(std::move(aText), std::move(aParagraphEnds), std::move(aFonts)) },
+            iResult{ neolib::thread_pool::default_thread_pool().run(
+                [snapshot = iSnapshot, &factory = service<i_font_manager>().glyph_text_factory()]() { run(*snapshot, factory); }).first }
+        {
+        }
+        ~preshaping_job()
+        {
+            iSnapshot->cancelled.store(true, std::memory_order_relaxed);
+        }
+    public:
+        bool ready() const
+        {
+            return iResult.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready;
+        }
+    private:
+        static void run(snapshot const& aSnapshot, i_glyph_text_factory& aFactory)
+        {
+            std::size_t paragraphStart = 0u;
+            for (auto const paragraphEnd : aSnapshot.paragraphEnds)
+            {
+                if (aSnapshot.cancelled.load(std::memory_order_relaxed))
+                    return;
+                aFactory.preshape(aSnapshot.text.data() + paragraphStart, aSnapshot.text.data() + paragraphEnd, font_selector{ [&](std::size_t aSourceIndex) -> neogfx::font
+                {
+                    auto const f = std::prev(std::upper_bound(aSnapshot.fonts.begin(), aSnapshot.fonts.end(), paragraphStart + aSourceIndex,
+                        [](std::size_t aIndex, auto const& aRun) { return aIndex < aRun.first; }));
+                    return f->second;
+                } });
+                paragraphStart = paragraphEnd;
+            }
+        }
+    private:
+        std::shared_ptr<snapshot> iSnapshot;
+        std::future<void> iResult;
+    };
+
     text_edit::character_style::character_style() :
         iSmartUnderline{ false },
         iIgnoreEmoji{ true }
@@ -525,6 +588,222 @@ namespace neogfx
         return result;
     }
 
+    namespace
+    {
+        template <typename T>
+        void fenwick_add(std::vector<T>& aTree, std::size_t aIndex, T aDelta)
+        {
+            for (auto i = aIndex + 1; i < aTree.size(); i += (i & (~i + 1)))
+                aTree[i] += aDelta;
+        }
+
+        template <typename T>
+        T fenwick_prefix(std::vector<T> const& aTree, std::size_t aCount)
+        {
+            T result = {};
+            for (auto i = std::min(aCount, aTree.size() - 1); i > 0; i -= (i & (~i + 1)))
+                result += aTree[i];
+            return result;
+        }
+
+        // The number of leading elements whose sum does not exceed aValue; aValue is reduced by that sum.
+        template <typename T>
+        std::size_t fenwick_find(std::vector<T> const& aTree, T& aValue)
+        {
+            auto const count = aTree.size() - 1;
+            std::size_t step = 1;
+            while (step * 2 <= count)
+                step *= 2;
+            std::size_t result = 0;
+            for (; step != 0; step /= 2)
+                if (result + step <= count && aTree[result + step] <= aValue)
+                {
+                    result += step;
+                    aValue -= aTree[result];
+                }
+            return result;
+        }
+    }
+
+    std::size_t text_edit::paragraph_positions::size() const
+    {
+        return iSize;
+    }
+
+    void text_edit::paragraph_positions::reset(std::size_t aCount)
+    {
+        iChunks.clear();
+        for (std::size_t first = 0; first < aCount; first += ChunkSize)
+            iChunks.push_back(chunk{ std::vector<dimension>(std::min(ChunkSize, aCount - first), 0.0) });
+        iSize = aCount;
+        iDirty = true;
+        iOffset = 0.0;
+    }
+
+    void text_edit::paragraph_positions::insert(std::size_t aIndex, std::size_t aCount)
+    {
+        if (aCount == 0)
+            return;
+        if (iChunks.empty())
+        {
+            iChunks.emplace_back();
+            iDirty = true;
+        }
+        auto const [chunkIndex, offset] = aIndex < iSize ? 
+            locate(aIndex) : std::make_pair(iChunks.size() - 1, iChunks.back().heights.size());
+        auto& target = iChunks[chunkIndex];
+        target.heights.insert(std::next(target.heights.begin(), offset), aCount, 0.0);
+        iSize += aCount;
+        if (target.heights.size() > ChunkSize * 2)
+            split(chunkIndex);
+        else if (!iDirty)
+            fenwick_add(iCountTree, chunkIndex, static_cast<std::ptrdiff_t>(aCount));
+    }
+
+    void text_edit::paragraph_positions::erase(std::size_t aFirst, std::size_t aLast)
+    {
+        aLast = std::min(aLast, iSize);
+        if (aFirst >= aLast)
+            return;
+        auto [chunkIndex, offset] = locate(aFirst);
+        auto remaining = aLast - aFirst;
+        iSize -= remaining;
+        while (remaining != 0)
+        {
+            auto& target = iChunks[chunkIndex];
+            auto const count = std::min(remaining, target.heights.size() - offset);
+            auto const first = std::next(target.heights.begin(), offset);
+            auto const last = std::next(first, count);
+            auto const removedHeight = std::accumulate(first, last, 0.0);
+            target.heights.erase(first, last);
+            target.total -= removedHeight;
+            remaining -= count;
+            offset = 0;
+            if (target.heights.empty())
+            {
+                iChunks.erase(std::next(iChunks.begin(), chunkIndex));
+                iDirty = true;
+                continue;
+            }
+            if (!iDirty)
+            {
+                fenwick_add(iCountTree, chunkIndex, -static_cast<std::ptrdiff_t>(count));
+                fenwick_add(iHeightTree, chunkIndex, -removedHeight);
+            }
+            ++chunkIndex;
+        }
+    }
+
+    dimension text_edit::paragraph_positions::height(std::size_t aIndex) const
+    {
+        if (aIndex >= iSize)
+            throw std::out_of_range("neogfx::text_edit::paragraph_positions::height");
+        auto const [chunkIndex, offset] = locate(aIndex);
+        return iChunks[chunkIndex].heights[offset];
+    }
+
+    void text_edit::paragraph_positions::set_height(std::size_t aIndex, dimension aHeight)
+    {
+        if (aIndex >= iSize)
+            throw std::out_of_range("neogfx::text_edit::paragraph_positions::set_height");
+        auto const [chunkIndex, offset] = locate(aIndex);
+        auto& target = iChunks[chunkIndex];
+        auto const delta = aHeight - target.heights[offset];
+        target.heights[offset] = aHeight;
+        target.total += delta;
+        if (delta != 0.0)
+            fenwick_add(iHeightTree, chunkIndex, delta);
+    }
+
+    coordinate text_edit::paragraph_positions::ypos(std::size_t aIndex) const
+    {
+        if (aIndex >= iSize)
+            return iOffset + total();
+        auto const [chunkIndex, offset] = locate(aIndex);
+        auto const& heights = iChunks[chunkIndex].heights;
+        return iOffset + fenwick_prefix(iHeightTree, chunkIndex) + std::accumulate(heights.begin(), std::next(heights.begin(), offset), 0.0);
+    }
+
+    dimension text_edit::paragraph_positions::total() const
+    {
+        if (iDirty)
+            rebuild();
+        return fenwick_prefix(iHeightTree, iChunks.size());
+    }
+
+    std::size_t text_edit::paragraph_positions::find(coordinate aYpos) const
+    {
+        if (iSize == 0)
+            return 0;
+        if (iDirty)
+            rebuild();
+        dimension remaining = aYpos - iOffset;
+        auto const chunkIndex = fenwick_find(iHeightTree, remaining);
+        if (chunkIndex >= iChunks.size())
+            return iSize - 1;
+        auto result = static_cast<std::size_t>(fenwick_prefix(iCountTree, chunkIndex));
+        for (auto const height : iChunks[chunkIndex].heights)
+        {
+            if (height > remaining)
+                break;
+            remaining -= height;
+            ++result;
+        }
+        return std::min(result, iSize - 1);
+    }
+
+    coordinate text_edit::paragraph_positions::offset() const
+    {
+        return iOffset;
+    }
+
+    void text_edit::paragraph_positions::set_offset(coordinate aOffset)
+    {
+        iOffset = aOffset;
+    }
+
+    std::pair<std::size_t, std::size_t> text_edit::paragraph_positions::locate(std::size_t aIndex) const
+    {
+        if (iDirty)
+            rebuild();
+        auto remaining = static_cast<std::ptrdiff_t>(aIndex);
+        auto const chunkIndex = fenwick_find(iCountTree, remaining);
+        return { chunkIndex, static_cast<std::size_t>(remaining) };
+    }
+
+    void text_edit::paragraph_positions::split(std::size_t aChunk)
+    {
+        auto const heights = std::move(iChunks[aChunk].heights);
+        std::vector<chunk> pieces;
+        for (std::size_t first = 0; first < heights.size(); first += ChunkSize)
+        {
+            auto& piece = pieces.emplace_back();
+            piece.heights.assign(std::next(heights.begin(), first), std::next(heights.begin(), std::min(first + ChunkSize, heights.size())));
+            piece.total = std::accumulate(piece.heights.begin(), piece.heights.end(), 0.0);
+        }
+        iChunks[aChunk] = std::move(pieces[0]);
+        iChunks.insert(std::next(iChunks.begin(), aChunk + 1), std::make_move_iterator(std::next(pieces.begin())), std::make_move_iterator(pieces.end()));
+        iDirty = true;
+    }
+
+    void text_edit::paragraph_positions::rebuild() const
+    {
+        iCountTree.assign(iChunks.size() + 1, 0);
+        iHeightTree.assign(iChunks.size() + 1, 0.0);
+        for (std::size_t i = 1; i <= iChunks.size(); ++i)
+        {
+            iCountTree[i] += static_cast<std::ptrdiff_t>(iChunks[i - 1].heights.size());
+            iHeightTree[i] += iChunks[i - 1].total;
+            auto const parent = i + (i & (~i + 1));
+            if (parent <= iChunks.size())
+            {
+                iCountTree[parent] += iCountTree[i];
+                iHeightTree[parent] += iHeightTree[i];
+            }
+        }
+        iDirty = false;
+    }
+
     text_edit::text_edit(text_edit_caps aCaps, frame_style aFrameStyle) :
         framed_scrollable_widget{ (aCaps & text_edit_caps::MultiLine) == text_edit_caps::MultiLine ? scrollbar_style::Normal : scrollbar_style::None, aFrameStyle, 2.0 },
         iCaps{ aCaps },
@@ -700,7 +979,9 @@ namespace neogfx
             scoped_scissor scissor2{ aGc, columnClipRect };
 
             auto const& lines = glyphColumn.lines;
-            auto line = std::lower_bound(lines.begin(), lines.end(), top,
+            auto const firstParagraphLine = std::lower_bound(lines.begin(), lines.end(), iParagraphPositions.find(top),
+                [](const glyph_line& left, std::size_t right) { return left.paragraph_index() < right; });
+            auto line = std::lower_bound(firstParagraphLine, lines.end(), top,
                 [](const glyph_line& left, coordinate const& right) { return left.ypos() < right; });
             if (line != lines.begin() && (line == lines.end() || top < line->ypos()))
                 --line;
@@ -1601,6 +1882,26 @@ namespace neogfx
         }
     }
 
+    bool text_edit::incremental_reflow() const
+    {
+        return IncrementalReflow;
+    }
+
+    void text_edit::set_incremental_reflow(bool aIncrementalReflow)
+    {
+        IncrementalReflow = aIncrementalReflow;
+    }
+
+    bool text_edit::async_shaping() const
+    {
+        return AsyncShaping;
+    }
+
+    void text_edit::set_async_shaping(bool aAsyncShaping)
+    {
+        AsyncShaping = aAsyncShaping;
+    }
+
     std::uint32_t text_edit::grow_lines() const
     {
         return GrowLines;
@@ -1888,15 +2189,6 @@ namespace neogfx
         auto const& columnRectSansPadding = column_rect(columnIndex);
         point adjustedPosition = (aAdjustForScrollPosition ? aPosition + point{ horizontal_scrollbar().position(), vertical_scrollbar().position() } : aPosition) - columnRectSansPadding.top_left();
         adjustedPosition = adjustedPosition.max(point{});
-        auto paragraph = std::lower_bound(iGlyphParagraphs.begin(), iGlyphParagraphs.end(), adjustedPosition.y,
-            [](glyph_paragraph const& p, coordinate y)
-            {
-                return p.ypos < y;
-            });
-        if (paragraph == iGlyphParagraphs.end())
-            paragraph = std::prev(paragraph);
-        if (paragraph != iGlyphParagraphs.begin() && adjustedPosition.y < paragraph->ypos)
-            paragraph = std::prev(paragraph);
         auto const& column = iGlyphColumns.at(columnIndex);
         auto const& lines = column.lines;
         auto line = std::lower_bound(lines.begin(), lines.end(), adjustedPosition.y,
@@ -1962,7 +2254,7 @@ namespace neogfx
             if (glyphParagraph != iGlyphParagraphs.end())
                 return glyphParagraph->text_begin_index() + glyphs()[glyphPosition].clusters.first;
         }
-        return iText.size();
+        return shaped_text_size();
     }
 
     bool text_edit::same_word(position_type aTextPositionLeft, position_type aTextPositionRight) const
@@ -2011,6 +2303,7 @@ namespace neogfx
         iText.clear();
         glyphs().clear();
         iGlyphParagraphs.clear();
+        iShapingPosition = std::nullopt;
         iUtf8TextCache = std::nullopt;
         refresh_columns();
         if (iPreviousText != iText)
@@ -2304,6 +2597,7 @@ namespace neogfx
         
         iSink += cursor().PositionChanged([this]()
         {
+            ensure_shaped(static_cast<position_type>(std::max(cursor().position(), cursor().anchor())));
             if (neolib::service<i_keyboard>().layout().ime_active(*this))
                 neolib::service<i_keyboard>().layout().update_ime_position(cursor_rect().bottom_left());
             iNextStyle = std::nullopt;
@@ -2522,8 +2816,9 @@ namespace neogfx
 
     std::pair<text_edit::document_text::size_type, text_edit::document_text::size_type> text_edit::from_glyph(document_glyphs::const_iterator aWhere) const
     {
+        auto const shapedSize = static_cast<document_text::size_type>(shaped_text_size());
         if (aWhere == glyphs().end())
-            return std::make_pair(iText.size(), iText.size());
+            return std::make_pair(shapedSize, shapedSize);
         auto paragraph = glyph_to_paragraph(aWhere - glyphs().begin());
         if (paragraph == iGlyphParagraphs.end() && paragraph != iGlyphParagraphs.begin() && aWhere <= (paragraph - 1)->glyph_end())
             --paragraph;
@@ -2535,7 +2830,7 @@ namespace neogfx
             auto const& clusters = aWhere->clusters;
             return std::make_pair(textStart + clusters.first, textStart + clusters.second);
         }
-        return std::make_pair(iText.size(), iText.size());
+        return std::make_pair(shapedSize, shapedSize);
     }
 
     std::optional<text_edit::glyph_lines::const_iterator> text_edit::next_line(std::optional<glyph_lines::const_iterator> const& aFrom) const
@@ -2561,6 +2856,21 @@ namespace neogfx
         if (iUpdatingDocument)
             return;
 
+        if (iShapingPosition && aDelta != 0)
+        {
+            auto const where = std::distance(iText.cbegin(), aWhere);
+            if (where >= *iShapingPosition)
+            {
+                // edit is confined to text that has yet to be shaped
+                update();
+                return;
+            }
+            else if (aDelta > 0 || where - aDelta < *iShapingPosition)
+                *iShapingPosition += aDelta;
+            else
+                aDelta = 0;
+        }
+
         document_text::const_iterator first;
         document_text::const_iterator last;
         document_glyphs::const_iterator glyphsInsertPos;
@@ -2569,6 +2879,10 @@ namespace neogfx
         std::ptrdiff_t charsInserted = 0;
         std::ptrdiff_t glyphsInserted = 0;
 
+        bool partial = false;
+        std::size_t firstParagraph = 0;
+        std::size_t removedParagraphs = 0;
+
         if (aDelta == 0 || iGlyphParagraphs.empty())
         {
             (void)aWhere;
@@ -2578,6 +2892,27 @@ namespace neogfx
             last = iText.end();
             glyphsInsertPos = glyphs().end();
             glyphParagraphsInsertPos = iGlyphParagraphs.end();
+            iShapingPosition = std::nullopt;
+            iPreshaper = nullptr;
+            if (async_shaping() && iText.size() >= AsyncShapingThreshold)
+            {
+                auto const visibleLines = static_cast<std::size_t>(std::ceil(client_rect(false).cy / font().height())) + 1u;
+                last = shaping_boundary(first, visibleLines, AsyncShapingChunkSize);
+                if (last != iText.end())
+                {
+                    iShapingPosition = std::distance(iText.cbegin(), last);
+                    preshape_chunk(last, shaping_boundary(last, AsyncShapingChunkSize / 256u, AsyncShapingChunkSize));
+                    if (!iShaper)
+                        iShaper.emplace(*this, [this](widget_timer& aTimer)
+                        {
+                            shape_next_chunk();
+                            if (iShapingPosition)
+                                aTimer.again();
+                        }, std::chrono::milliseconds{ 1 });
+                    else
+                        iShaper->again_if();
+                }
+            }
         }
         else if (aDelta > 0)
         {   
@@ -2588,6 +2923,9 @@ namespace neogfx
                 std::next(glyphs().begin(), fromParagraph.paragraphSpan.glyphsFirst), 
                 std::next(glyphs().begin(), fromParagraph.paragraphSpan.glyphsLast));
             glyphParagraphsInsertPos = iGlyphParagraphs.erase(std::next(iGlyphParagraphs.begin(), fromParagraph.paragraphIndex));
+            partial = true;
+            firstParagraph = fromParagraph.paragraphIndex;
+            removedParagraphs = 1;
             charsInserted -= (fromParagraph.paragraphSpan.textLast - fromParagraph.paragraphSpan.textFirst);
             glyphsInserted -= (fromParagraph.paragraphSpan.glyphsLast - fromParagraph.paragraphSpan.glyphsFirst);
         }
@@ -2603,37 +2941,57 @@ namespace neogfx
             glyphParagraphsInsertPos = iGlyphParagraphs.erase(
                 std::next(iGlyphParagraphs.begin(), fromParagraph.paragraphIndex),
                 std::next(iGlyphParagraphs.begin(), toParagraph.paragraphIndex + 1));
+            partial = true;
+            firstParagraph = fromParagraph.paragraphIndex;
+            removedParagraphs = toParagraph.paragraphIndex + 1 - fromParagraph.paragraphIndex;
             charsInserted -= (toParagraph.paragraphSpan.textLast - fromParagraph.paragraphSpan.textFirst);
             glyphsInserted -= (toParagraph.paragraphSpan.glyphsLast - fromParagraph.paragraphSpan.glyphsFirst);
         }
 
+        auto const columnCount = shape_paragraphs(first, last, glyphsInsertPos, glyphParagraphsInsertPos, charsInserted, glyphsInserted);
+
+        for (auto paragraphToAdjust = std::next(iGlyphParagraphs.begin(), std::distance(iGlyphParagraphs.cbegin(), glyphParagraphsInsertPos)); 
+            paragraphToAdjust != iGlyphParagraphs.end(); ++paragraphToAdjust)
+        {
+            auto& p = *paragraphToAdjust;
+            p.span.textFirst += charsInserted;
+            p.span.textLast += charsInserted;
+            p.span.glyphsFirst += glyphsInserted;
+            p.span.glyphsLast += glyphsInserted;
+            for (auto& entry : p.heightMap)
+                entry.glyphIndex += glyphsInserted;
+        }
+
+        bool const reflow = partial && incremental_reflow() && columnCount <= iGlyphColumns.size();
+        iGlyphColumns.resize(std::max(columnCount, iGlyphColumns.size()), { this });
+
+        if (iPasswordBits)
+            iPasswordBits.value().showPassword.show(!iText.empty());
+
+        refresh_paragraphs(firstParagraph, removedParagraphs, std::distance(iGlyphParagraphs.cbegin(), glyphParagraphsInsertPos) - firstParagraph, reflow);
+    }
+
+    std::size_t text_edit::shape_paragraphs(document_text::const_iterator aFirst, document_text::const_iterator aLast, document_glyphs::const_iterator& aGlyphsInsertPos, 
+        glyph_paragraphs::const_iterator& aParagraphsInsertPos, std::ptrdiff_t& aCharsInserted, std::ptrdiff_t& aGlyphsInserted)
+    {
         graphics_context gc{ *this, graphics_context::type::Unattached };
 
         if (password() && (!iPasswordBits || !iPasswordBits.value().showPassword.is_pressed()))
             gc.set_password(true, PasswordMask.value().empty() ? "\xE2\x97\x8F"_s : PasswordMask);
 
-        auto nextParagraph = first;
+        auto nextParagraph = aFirst;
         thread_local std::vector<std::u32string::difference_type> cachedColumnDelimiters;
         auto& columnDelimiters = cachedColumnDelimiters;
  
         auto fs = [this, &nextParagraph, &columnDelimiters](std::u32string::size_type aSourceIndex)
         {
-            auto characterStyle = iStyleMap.find(std::next(nextParagraph, aSourceIndex)->style);
-            std::size_t indexColumn = std::lower_bound(columnDelimiters.begin(), columnDelimiters.end(), 
-                static_cast<std::u32string::difference_type>(aSourceIndex)) - columnDelimiters.begin();
-            if (indexColumn > columns() - 1)
-                indexColumn = columns() - 1;
-            auto const& columnStyle = column_style(indexColumn);
-            auto const& style =
-                characterStyle != iStyleMap.end() ? **characterStyle :
-                columnStyle.character().font() != std::nullopt ? columnStyle : iDefaultStyle;
-            return style.character().font() != std::nullopt ? style.character().font().value() : font();
+            return character_font(nextParagraph, columnDelimiters, aSourceIndex);
         };
         
         columnDelimiters.clear();
         std::size_t columnCount = 0;
 
-        for (auto iterChar = first; iterChar != last; ++iterChar)
+        for (auto iterChar = aFirst; iterChar != aLast; ++iterChar)
         {
             auto ch = iterChar->character;
 
@@ -2644,7 +3002,7 @@ namespace neogfx
             
             bool newParagraph = (ch == U'\n');
             
-            if (newParagraph || iterChar == std::prev(last))
+            if (newParagraph || iterChar == std::prev(aLast))
             {
                 thread_local std::u32string paragraphBuffer;
                 paragraphBuffer.assign(nextParagraph, std::next(iterChar));
@@ -2652,8 +3010,9 @@ namespace neogfx
                 auto gt = service<i_font_manager>().glyph_text_factory().to_glyph_text(gc, std::u32string_view{ paragraphBuffer.begin(), paragraphBuffer.end() }, fs, false);
                 if (gt.cbegin() != gt.cend())
                 {
-                    auto const paragraphGlyphs = glyphs().insert(glyphsInsertPos, gt.cbegin(), gt.cend());
-                    glyphsInsertPos = std::next(paragraphGlyphs, gt.size());
+                    service<i_font_manager>().prefetch_glyphs(gt);
+                    auto const paragraphGlyphs = glyphs().insert(aGlyphsInsertPos, gt.cbegin(), gt.cend());
+                    aGlyphsInsertPos = std::next(paragraphGlyphs, gt.size());
                     for (auto& newGlyph : gt)
                         glyphs().glyph_font(newGlyph);
                     document_span const span{
@@ -2661,12 +3020,12 @@ namespace neogfx
                         std::distance(iText.cbegin(), std::next(iterChar)),
                         std::distance(glyphs().begin(), paragraphGlyphs),
                         std::distance(glyphs().begin(), std::next(paragraphGlyphs, gt.size())) };
-                    auto const paragraph = iGlyphParagraphs.emplace(glyphParagraphsInsertPos, this, span);
+                    auto const paragraph = iGlyphParagraphs.emplace(aParagraphsInsertPos, this, span);
                     paragraph->columnBreaks.assign(columnDelimiters.begin(), columnDelimiters.end());
                     paragraph->lineBreaks.assign(gt.content().line_breaks().begin(), gt.content().line_breaks().end());
-                    glyphParagraphsInsertPos = std::next(paragraph);
-                    charsInserted += (paragraph->span.textLast - paragraph->span.textFirst);
-                    glyphsInserted += (paragraph->span.glyphsLast - paragraph->span.glyphsFirst);
+                    aParagraphsInsertPos = std::next(paragraph);
+                    aCharsInserted += (paragraph->span.textLast - paragraph->span.textFirst);
+                    aGlyphsInserted += (paragraph->span.glyphsLast - paragraph->span.glyphsFirst);
                 }
                 nextParagraph = std::next(iterChar);
                 columnCount = std::max(columnCount, columnDelimiters.size() + 1);
@@ -2674,28 +3033,163 @@ namespace neogfx
             }
         }
 
-        for (auto paragraphToAdjust = std::next(iGlyphParagraphs.begin(), std::distance(iGlyphParagraphs.cbegin(), glyphParagraphsInsertPos)); 
-            paragraphToAdjust != iGlyphParagraphs.end(); ++paragraphToAdjust)
+        return columnCount;
+    }
+
+    neogfx::font text_edit::character_font(document_text::const_iterator aParagraph, std::vector<std::u32string::difference_type> const& aColumnDelimiters, std::u32string::size_type aSourceIndex) const
+    {
+        auto characterStyle = iStyleMap.find(std::next(aParagraph, aSourceIndex)->style);
+        std::size_t indexColumn = std::lower_bound(aColumnDelimiters.begin(), aColumnDelimiters.end(), 
+            static_cast<std::u32string::difference_type>(aSourceIndex)) - aColumnDelimiters.begin();
+        if (indexColumn > columns() - 1)
+            indexColumn = columns() - 1;
+        auto const& columnStyle = column_style(indexColumn);
+        auto const& style =
+            characterStyle != iStyleMap.end() ? **characterStyle :
+            columnStyle.character().font() != std::nullopt ? columnStyle : iDefaultStyle;
+        return style.character().font() != std::nullopt ? style.character().font().value() : font();
+    }
+
+    text_edit::document_text::const_iterator text_edit::shaping_boundary(document_text::const_iterator aFrom, std::size_t aMaxParagraphs, std::size_t aMaxCharacters) const
+    {
+        auto const limit = std::next(aFrom, std::min<std::ptrdiff_t>(aMaxCharacters, std::distance(aFrom, iText.cend())));
+        auto next = aFrom;
+        for (std::size_t paragraphs = 0; next != limit && paragraphs < aMaxParagraphs; ++paragraphs)
         {
-            auto& p = *paragraphToAdjust;
-            p.span.textFirst += charsInserted;
-            p.span.textLast += charsInserted;
-            p.span.glyphsFirst += glyphsInserted;
-            p.span.glyphsLast += glyphsInserted;
-            p.heightMap.clear();
-            p.ypos = 0.0;
+            auto const paragraphEnd = std::find_if(next, limit, [](document_char const& aChar) { return aChar.character == U'\n'; });
+            if (paragraphEnd != limit)
+                next = std::next(paragraphEnd);
+            else if (limit == iText.end())
+                next = limit;
+            else
+            {
+                // a paragraph too long for one chunk is shaped in pieces, preferably split after whitespace
+                if (next == aFrom)
+                {
+                    auto const minimum = std::next(aFrom, aMaxCharacters / 2u);
+                    auto split = limit;
+                    while (split != minimum && std::prev(split)->character != U' ' && std::prev(split)->character != U'\t')
+                        --split;
+                    next = (split != minimum ? split : limit);
+                }
+                break;
+            }
         }
+        return next;
+    }
+
+    void text_edit::shape_next_chunk(std::optional<position_type> const& aUntil)
+    {
+        if (!iShapingPosition)
+            return;
+
+        auto const firstParagraph = iGlyphParagraphs.size();
+        std::size_t columnCount = 0;
+
+        auto const start = std::chrono::steady_clock::now();
+        do
+        {
+            if (!aUntil && iPreshaper && !iPreshaper->ready())
+                break;
+            auto const first = std::next(iText.cbegin(), *iShapingPosition);
+            auto const last = shaping_boundary(first, AsyncShapingChunkSize / 256u, AsyncShapingChunkSize);
+            if (!aUntil && last != iText.end())
+                preshape_chunk(last, shaping_boundary(last, AsyncShapingChunkSize / 256u, AsyncShapingChunkSize));
+            document_glyphs::const_iterator glyphsInsertPos = glyphs().end();
+            glyph_paragraphs::const_iterator glyphParagraphsInsertPos = iGlyphParagraphs.end();
+            std::ptrdiff_t charsInserted = 0;
+            std::ptrdiff_t glyphsInserted = 0;
+            columnCount = std::max(columnCount, shape_paragraphs(first, last, glyphsInsertPos, glyphParagraphsInsertPos, charsInserted, glyphsInserted));
+            if (last != iText.end())
+                iShapingPosition = std::distance(iText.cbegin(), last);
+            else
+                iShapingPosition = std::nullopt;
+        } while (iShapingPosition && (aUntil ? *aUntil >= *iShapingPosition : std::chrono::steady_clock::now() - start < AsyncShapingTimeSlice));
 
+        if (iGlyphParagraphs.size() == firstParagraph)
+            return;
+
+        bool const reflow = columnCount <= iGlyphColumns.size();
         iGlyphColumns.resize(std::max(columnCount, iGlyphColumns.size()), { this });
-        for (auto& column : iGlyphColumns)
-            column.lines.clear();
 
-        if (iPasswordBits)
-            iPasswordBits.value().showPassword.show(!iText.empty());
+        refresh_paragraphs(firstParagraph, 0, iGlyphParagraphs.size() - firstParagraph, reflow);
+    }
+
+    void text_edit::preshape_chunk(document_text::const_iterator aFirst, document_text::const_iterator aLast)
+    {
+        if (password())
+            return;
+
+        // snapshot the chunk split into paragraphs exactly as shape_paragraphs() will split it
+        std::u32string text;
+        text.reserve(std::distance(aFirst, aLast));
+        std::vector<std::size_t> paragraphEnds;
+        preshaping_job::font_runs fonts;
+        std::vector<std::u32string::difference_type> columnDelimiters;
+        auto nextParagraph = aFirst;
+        for (auto iterChar = aFirst; iterChar != aLast; ++iterChar)
+        {
+            auto ch = iterChar->character;
+            text.push_back(ch);
+
+            auto& column = iColumns[std::min(columnDelimiters.size(), iColumns.size() - 1)];
+
+            if (ch == column.info.delimiter && columnDelimiters.size() + 1 < iColumns.size())
+                columnDelimiters.push_back(std::distance(nextParagraph, iterChar));
+
+            if (ch == U'\n' || iterChar == std::prev(aLast))
+            {
+                auto const paragraphStart = text.size() - std::distance(nextParagraph, std::next(iterChar));
+                for (std::size_t sourceIndex = 0; paragraphStart + sourceIndex < text.size(); ++sourceIndex)
+                {
+                    auto const f = character_font(nextParagraph, columnDelimiters, sourceIndex);
+                    if (fonts.empty() || fonts.back().second != f)
+                        fonts.emplace_back(paragraphStart + sourceIndex, f);
+                }
+                paragraphEnds.push_back(text.size());
+                nextParagraph = std::next(iterChar);
+                columnDelimiters.clear();
+            }
+        }
+
+        iPreshaper = std::make_unique<preshaping_job>(std::move(text), std::move(paragraphEnds), std::move(fonts));
+    }
+
+    text_edit::position_type text_edit::shaped_text_size() const
+    {
+        return iShapingPosition ? *iShapingPosition : static_cast<position_type>(iText.size());
+    }
+
+    void text_edit::ensure_shaped(position_type aPosition)
+    {
+        if (iUpdatingDocument || !iShapingPosition || aPosition < *iShapingPosition)
+            return;
+        shape_next_chunk(aPosition);
+    }
+
+    void text_edit::refresh_paragraphs(std::size_t aFirstParagraph, std::size_t aRemovedParagraphs, std::size_t aAddedParagraphs, bool aReflow)
+    {
+        if (aReflow && reflow_paragraphs(aFirstParagraph, aRemovedParagraphs, aAddedParagraphs))
+        {
+            if ((iCaps & text_edit_caps::LINES_MASK) == text_edit_caps::GrowLines)
+                update_layout();
+            update_scrollbar_visibility(UsvStageDone);
+            update();
+            return;
+        }
+
+        for (auto& column : iGlyphColumns)
+            column.clear();
 
         refresh_columns();
     }
 
+    void text_edit::estimate_text_extents()
+    {
+        if (iShapingPosition && *iShapingPosition > 0 && iTextExtents)
+            iTextExtents->cy = std::max(iTextExtents->cy, std::ceil(iTextExtents->cy * iText.size() / *iShapingPosition));
+    }
+
     void text_edit::refresh_columns()
     {
         iTextExtents = std::nullopt;
@@ -2718,7 +3212,7 @@ namespace neogfx
 
             /* simple (naive) implementation just to get things moving... */
             for (auto& column : iGlyphColumns)
-                column.lines.clear();
+                column.clear();
             
             dimension availableWidth = column_rect(0).width(); // todo: columns
             dimension availableHeight = column_rect(0).height();
@@ -2726,277 +3220,15 @@ namespace neogfx
             bool showHorizontalScrollbar = false;
 
             iTextExtents = size{};
+            iParagraphPositions.reset(iGlyphParagraphs.size());
             
             std::uint32_t pass = 1;
             dimension yposParagraph = 0.0;
 
             for (auto iterParagraph = iGlyphParagraphs.begin(); iterParagraph != iGlyphParagraphs.end();)
             {
-                auto& paragraph = *iterParagraph;
-
-                paragraph.ypos = yposParagraph;
-                dimension yColumn = 0.0;
-
-                for (auto& column : iGlyphColumns)
-                {
-                    dimension yLine = 0.0;
-
-                    auto const columnIndex = std::distance(&iGlyphColumns[0], &column);
-                    auto& lines = column.lines;
-
-                    thread_local std::vector<std::pair<document_glyphs::difference_type, document_glyphs::difference_type>> paragraphLines;
-                    paragraphLines.clear();
-
-                    // todo: line segments to correct column
-
-                    glyph_text::size_type lastBreak = 0;
-                    for (auto lineBreak : paragraph.lineBreaks)
-                    {
-                        paragraphLines.emplace_back(lastBreak + paragraph.span.glyphsFirst, lineBreak + paragraph.span.glyphsFirst);
-                        lastBreak = lineBreak + 1;
-                    }
-                    paragraphLines.emplace_back(lastBreak + paragraph.span.glyphsFirst, paragraph.span.glyphsLast);
-                    if (paragraphLines.back().first != paragraphLines.back().second &&
-                        is_line_breaking_whitespace(glyphs().back()) && std::next(iterParagraph) == iGlyphParagraphs.end())
-                        paragraphLines.emplace_back(paragraph.span.glyphsLast, paragraph.span.glyphsLast);
-
-                    auto const& paragraphStyle = glyph_style(paragraph.glyph_begin(), iColumns[columnIndex]);
-
-                    if (paragraphStyle.paragraph().padding())
-                        yLine += paragraphStyle.paragraph().padding().value().top;
-
-                    bool first = true;
-
-                    for (auto const& paragraphLine : paragraphLines)
-                    {
-                        auto const paragraphLineStart = std::next(glyphs().begin(), paragraphLine.first);
-                        auto const paragraphLineEnd = std::next(glyphs().begin(), paragraphLine.second);
-
-                        if (!first)
-                        {
-                            if (paragraphStyle.paragraph().line_spacing())
-                                yLine += paragraphStyle.paragraph().line_spacing().value();
-                        }
-                        else
-                            first = false;
-
-                        if (paragraphLineStart == paragraphLineEnd || is_line_breaking_whitespace(*paragraphLineStart))
-                        {
-                            auto lineStart = paragraphLineStart;
-                            auto lineEnd = (paragraphLineStart == paragraphLineEnd || !is_line_breaking_whitespace(*paragraphLineStart)) ? 
-                                paragraphLineEnd : paragraphLineStart;
-
-                            auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
-
-                            glyph_char::cluster_range clusters{
-                                static_cast<glyph_char::cluster_index>(from_glyph(lineStart).first),
-                                static_cast<glyph_char::cluster_index>(from_glyph(lineEnd).second) };
-                            if (alignBaselinesResult.clusters)
-                            {
-                                clusters.first = std::min(clusters.first, alignBaselinesResult.clusters.value().first + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
-                                clusters.second = std::max(clusters.second, alignBaselinesResult.clusters.value().second + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
-                            }
-                            auto textLineStart = static_cast<position_type>(clusters.first) - paragraph.span.textFirst;
-                            auto textLineEnd = static_cast<position_type>(clusters.second) - paragraph.span.textFirst;
-                            if (lineStart != lineEnd && std::prev(lineEnd)->clusters.first < lineStart->clusters.first) // RTL
-                                textLineStart = std::prev(lineEnd)->clusters.first;
-
-                            document_span const span{
-                                textLineStart,
-                                textLineEnd,
-                                lineStart - glyphs().begin() - paragraph.span.glyphsFirst,
-                                lineEnd - glyphs().begin() - paragraph.span.glyphsFirst };
-
-                            lines.emplace_back(
-                                this,
-                                std::distance(iGlyphParagraphs.begin(), iterParagraph),
-                                column.index(),
-                                span,
-                                yLine,
-                                size{ 
-                                    lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, 
-                                    alignBaselinesResult.yExtent },
-                                alignBaselinesResult.majorFont,
-                                alignBaselinesResult.baseline);
-
-                            yLine += lines.back().extents.cy;
-                            iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
-                        }
-                        else if (WordWrap && static_cast<coordinate>((paragraphLineEnd - 1)->cell[0].x) + static_cast<coordinate>((paragraphLineEnd - 1)->cell_extents().x) > availableWidth)
-                        {
-                            auto add_line = [&](auto first, auto last)
-                            {
-                                if (last != first && is_line_breaking_whitespace(*(last - 1)))
-                                    --last;
-
-                                auto const alignBaselinesResult = glyphs().align_baselines(first, last, true);
-
-                                glyph_char::cluster_range clusters{
-                                    static_cast<glyph_char::cluster_index>(from_glyph(first).first),
-                                    static_cast<glyph_char::cluster_index>(from_glyph(last).second) };
-                                if (alignBaselinesResult.clusters)
-                                {
-                                    clusters.first = std::min(clusters.first, alignBaselinesResult.clusters.value().first + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
-                                    clusters.second = std::max(clusters.second, alignBaselinesResult.clusters.value().second + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
-                                }
-                                auto textLineStart = static_cast<position_type>(clusters.first) - paragraph.span.textFirst;
-                                auto textLineEnd = static_cast<position_type>(clusters.second) - paragraph.span.textFirst;
-                                if (first != last && std::prev(last)->clusters.first < first->clusters.first) // RTL
-                                    textLineStart = std::prev(last)->clusters.first;
-
-                                document_span const span{
-                                    textLineStart,
-                                    textLineEnd,
-                                    first - glyphs().begin() - paragraph.span.glyphsFirst,
-                                    last - glyphs().begin() - paragraph.span.glyphsFirst };
-
-                                lines.emplace_back(
-                                    this,
-                                    std::distance(iGlyphParagraphs.begin(), iterParagraph),
-                                    column.index(),
-                                    span,
-                                    yLine,
-                                    size{
-                                        last != first ? (last - 1)->cell[1].x - (first)->cell[0].x : 0.0f,
-                                        alignBaselinesResult.yExtent },
-                                    alignBaselinesResult.majorFont,
-                                    alignBaselinesResult.baseline);
-
-                                yLine += lines.back().extents.cy;
-                                iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
-                            };
-
-                            if (glyph_text_direction(paragraphLineStart, paragraphLineEnd) == text_direction::LTR)
-                            {
-                                auto next = paragraphLineStart;
-                                auto lineStart = next;
-                                auto lineEnd = paragraphLineEnd;
-                                coordinate offset = (lineEnd != lineStart ? lineStart->cell[0].x : 0.0);
-                                while (next != paragraphLineEnd)
-                                {
-                                    glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset + availableWidth, 0.0f }, vec2{ offset + availableWidth, 0.0f } }, {} };
-                                    auto split = std::lower_bound(next, paragraphLineEnd, key, [](auto const& lhs, auto const& rhs) { return lhs.cell[0].x < rhs.cell[0].x; });
-                                    if (split != next)
-                                    {
-                                        if (split != paragraphLineEnd)
-                                            --split;
-                                        else
-                                        {
-                                            auto const& previousChar = *(split - 1);
-                                            auto const xPrevious = static_cast<coordinate>(previousChar.cell[0].x);
-                                            auto const cxPrevious = static_cast<coordinate>(previousChar.cell_extents().x);
-                                            if (xPrevious + cxPrevious >= offset + availableWidth)
-                                                --split;
-                                        }
-                                    }
-                                    if (split == next)
-                                        ++split;
-                                    if (split != paragraphLineEnd)
-                                    {
-                                        auto wordBreak = word_break(lineStart, split, paragraphLineEnd);
-                                        if (wordBreak.first != lineStart)
-                                        {
-                                            lineEnd = wordBreak.first;
-                                            next = wordBreak.second;
-                                        }
-                                        else
-                                            next = lineEnd = split;
-                                    }
-                                    else
-                                        next = paragraphLineEnd;
-                                    add_line(lineStart, lineEnd);
-                                    lineStart = next;
-                                    if (lineStart != paragraphLineEnd)
-                                        offset = lineStart->cell[0].x;
-                                    lineEnd = paragraphLineEnd;
-                                }
-                            }
-                            else // RTL
-                            {
-                                auto next = std::reverse_iterator{ paragraphLineEnd };
-                                auto lineStart = next;
-                                auto lineEnd = std::reverse_iterator{ paragraphLineStart };
-                                coordinate const rightmost = (lineEnd != lineStart ? lineStart->cell[1].x : 0.0);
-                                coordinate offset = rightmost;
-                                while (next != std::reverse_iterator{ paragraphLineStart })
-                                {
-                                    glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset - availableWidth, 0.0f } }, {} };
-                                    auto split = std::lower_bound(next, std::reverse_iterator{ paragraphLineStart }, key, [=](auto const& lhs, auto const& rhs) { return offset - lhs.cell[0].x < offset - rhs.cell[0].x; });
-                                    if (split != next && (split != std::reverse_iterator{ paragraphLineStart } || static_cast<coordinate>((split - 1)->cell[0].x) + static_cast<coordinate>((split - 1)->cell_extents().x) >= rightmost - offset + availableWidth))
-                                        --split;
-                                    if (split == next)
-                                        ++split;
-                                    if (split != std::reverse_iterator{ paragraphLineStart })
-                                    {
-                                        auto wordBreak = word_break(lineStart, split, std::reverse_iterator{ paragraphLineStart });
-                                        if (wordBreak.first != lineStart)
-                                        {
-                                            lineEnd = wordBreak.first;
-                                            next = wordBreak.second;
-                                        }
-                                        else
-                                            next = lineEnd = split;
-                                    }
-                                    else
-                                        next = std::reverse_iterator{ paragraphLineStart };
-                                    add_line(lineEnd.base(), lineStart.base());
-                                    lineStart = next;
-                                    if (lineStart != std::reverse_iterator{ paragraphLineStart })
-                                        offset = lineStart->cell[1].x;
-                                    lineEnd = std::reverse_iterator{ paragraphLineStart };
-                                }
-                            }
-                        }
-                        else
-                        {
-                            auto lineStart = paragraphLineStart;
-                            auto lineEnd = paragraphLineEnd;
-                            if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
-                                --lineEnd;
-
-                            auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
-
-                            glyph_char::cluster_range clusters{
-                                static_cast<glyph_char::cluster_index>(from_glyph(lineStart).first),
-                                static_cast<glyph_char::cluster_index>(from_glyph(lineEnd).second) };
-                            if (alignBaselinesResult.clusters)
-                            {
-                                clusters.first = std::min(clusters.first, alignBaselinesResult.clusters.value().first + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
-                                clusters.second = std::max(clusters.second, alignBaselinesResult.clusters.value().second + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
-                            }
-                            auto textLineStart = static_cast<position_type>(clusters.first) - paragraph.span.textFirst;
-                            auto textLineEnd = static_cast<position_type>(clusters.second) - paragraph.span.textFirst;
-                            if (lineEnd != lineStart && std::prev(lineEnd)->clusters.first < lineStart->clusters.first) // RTL
-                                textLineStart = std::prev(lineEnd)->clusters.first;
-                            
-                            document_span const span{
-                                textLineStart,
-                                textLineEnd,
-                                lineStart - glyphs().begin() - paragraph.span.glyphsFirst,
-                                lineEnd - glyphs().begin() - paragraph.span.glyphsFirst };
-
-                            lines.emplace_back(
-                                this,
-                                std::distance(iGlyphParagraphs.begin(), iterParagraph),
-                                column.index(),
-                                span,
-                                yLine,
-                                size{
-                                    lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f,
-                                    alignBaselinesResult.yExtent },
-                                alignBaselinesResult.majorFont,
-                                alignBaselinesResult.baseline);
-                            
-                            yLine += lines.back().extents.cy;
-                            iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
-                        }
-                    }
-
-                    if (paragraphStyle.paragraph().padding())
-                        yLine += paragraphStyle.paragraph().padding().value().bottom;
-
-                    yColumn = std::max(yColumn, yLine);
-                }
+                auto const yColumn = layout_paragraph(iterParagraph, availableWidth);
+                iParagraphPositions.set_height(std::distance(iGlyphParagraphs.begin(), iterParagraph), yColumn);
 
                 yposParagraph += yColumn;
                 iTextExtents->cy = std::max(iTextExtents->cy, yposParagraph);
@@ -3006,7 +3238,7 @@ namespace neogfx
                         if (pass <= 3)
                         {
                             for (auto& c : iGlyphColumns)
-                                c.lines.clear();
+                                c.clear();
                             yposParagraph = 0.0;
                             iTextExtents = size{};
                             iterParagraph = iGlyphParagraphs.begin();
@@ -3042,28 +3274,369 @@ namespace neogfx
                 }
             }
 
-            if (iTextExtents->cy < client_rect(false).cy)
+            estimate_text_extents();
+            align_paragraphs();
+        }
+        catch (std::bad_alloc)
+        {
+            iParagraphPositions.reset(iGlyphParagraphs.size());
+            for (auto& column : iGlyphColumns)
+                column.clear();
+            iOutOfMemory = true;
+        }
+    }
+
+    bool text_edit::reflow_paragraphs(std::size_t aFirstParagraph, std::size_t aRemovedParagraphs, std::size_t aAddedParagraphs)
+    {
+        if (!iTextExtents || iOutOfMemory || iParagraphPositions.size() + aAddedParagraphs != iGlyphParagraphs.size() + aRemovedParagraphs)
+            return false;
+
+        // the layout of the final paragraph depends on it being final
+        if (aFirstParagraph + aAddedParagraphs == iGlyphParagraphs.size() && aFirstParagraph > 0)
+        {
+            --aFirstParagraph;
+            ++aRemovedParagraphs;
+            ++aAddedParagraphs;
+        }
+
+        try
+        {
+            thread_local std::vector<std::pair<std::size_t, std::size_t>> insertionPoints;
+            insertionPoints.clear();
+
+            // stored line paragraph indices are still those from before the edit...
+            auto const oldParagraphCount = iGlyphParagraphs.size() + aRemovedParagraphs - aAddedParagraphs;
+
+            for (auto& column : iGlyphColumns)
+            {
+                auto& lines = column.lines;
+                auto const byParagraph = [&](glyph_line const& aLine, std::size_t aParagraphIndex) 
+                    { return column.paragraph_index(aLine, oldParagraphCount) < aParagraphIndex; };
+                auto const firstLine = std::lower_bound(lines.begin(), lines.end(), aFirstParagraph, byParagraph);
+                auto const lastLine = std::lower_bound(firstLine, lines.end(), aFirstParagraph + aRemovedParagraphs, byParagraph);
+                auto const first = static_cast<std::size_t>(std::distance(lines.begin(), firstLine));
+                auto const last = static_cast<std::size_t>(std::distance(lines.begin(), lastLine));
+                // ... so moving the split to the edit keeps the lines that follow it valid without renumbering them
+                column.move_split(first, oldParagraphCount);
+                lines.erase(std::next(lines.begin(), first), std::next(lines.begin(), last));
+                insertionPoints.emplace_back(first, lines.size());
+            }
+
+            iParagraphPositions.erase(aFirstParagraph, aFirstParagraph + aRemovedParagraphs);
+            iParagraphPositions.insert(aFirstParagraph, aAddedParagraphs);
+
+            dimension const availableWidth = column_rect(0).width(); // todo: columns
+            for (auto paragraphIndex = aFirstParagraph; paragraphIndex != aFirstParagraph + aAddedParagraphs; ++paragraphIndex)
+                iParagraphPositions.set_height(paragraphIndex, layout_paragraph(std::next(iGlyphParagraphs.begin(), paragraphIndex), availableWidth));
+
+            for (auto& column : iGlyphColumns)
             {
-                auto const space = client_rect(false).cy - iTextExtents->cy;
-                auto const defaultAlignment = default_style().paragraph().alignment().as_std_optional().value_or(neogfx::alignment::Left | neogfx::alignment::Top);
-                auto const adjust =
-                    ((defaultAlignment & neogfx::alignment::Vertical) == neogfx::alignment::Bottom) ? space :
-                    ((defaultAlignment & neogfx::alignment::Vertical) == neogfx::alignment::VCenter) ? std::floor(space / 2.0) : 0.0;
-                if (adjust != 0.0)
-                    for (auto& paragraph : iGlyphParagraphs)
-                        paragraph.ypos += adjust;
+                auto& lines = column.lines;
+                auto const& insertionPoint = insertionPoints[column.index()];
+                std::rotate(std::next(lines.begin(), insertionPoint.first), std::next(lines.begin(), insertionPoint.second), lines.end());
+                column.split = insertionPoint.first + (lines.size() - insertionPoint.second);
             }
+
+            // text extents width is not reduced here as it is a maximum over all lines; a full refresh will recalculate it
+            iTextExtents->cy = iParagraphPositions.total();
+            estimate_text_extents();
+            align_paragraphs();
+
+            // fall back to a full refresh if scrollbar visibility (and hence available space) would change
+            if ((scroll_area().cy > scroll_page().cy) != vertical_scrollbar().visible() ||
+                (scroll_area().cx > scroll_page().cx) != horizontal_scrollbar().visible())
+                return false;
         }
         catch (std::bad_alloc)
         {
-            for (auto& paragraph : iGlyphParagraphs)
+            return false;
+        }
+
+        return true;
+    }
+
+    dimension text_edit::layout_paragraph(glyph_paragraphs::iterator aParagraph, dimension aAvailableWidth)
+    {
+        auto& paragraph = *aParagraph;
+
+        dimension yColumn = 0.0;
+
+        for (auto& column : iGlyphColumns)
+        {
+            dimension yLine = 0.0;
+
+            auto const columnIndex = std::distance(&iGlyphColumns[0], &column);
+            auto& lines = column.lines;
+
+            thread_local std::vector<std::pair<document_glyphs::difference_type, document_glyphs::difference_type>> paragraphLines;
+            paragraphLines.clear();
+
+            // todo: line segments to correct column
+
+            glyph_text::size_type lastBreak = 0;
+            for (auto lineBreak : paragraph.lineBreaks)
             {
-                paragraph.ypos = 0.0;
-                for (auto& column : iGlyphColumns)
-                    column.lines.clear();
+                paragraphLines.emplace_back(lastBreak + paragraph.span.glyphsFirst, lineBreak + paragraph.span.glyphsFirst);
+                lastBreak = lineBreak + 1;
             }
-            iOutOfMemory = true;
+            paragraphLines.emplace_back(lastBreak + paragraph.span.glyphsFirst, paragraph.span.glyphsLast);
+            if (paragraphLines.back().first != paragraphLines.back().second &&
+                is_line_breaking_whitespace(glyphs().back()) && std::next(aParagraph) == iGlyphParagraphs.end())
+                paragraphLines.emplace_back(paragraph.span.glyphsLast, paragraph.span.glyphsLast);
+
+            auto const& paragraphStyle = glyph_style(paragraph.glyph_begin(), iColumns[columnIndex]);
+
+            if (paragraphStyle.paragraph().padding())
+                yLine += paragraphStyle.paragraph().padding().value().top;
+
+            bool first = true;
+
+            for (auto const& paragraphLine : paragraphLines)
+            {
+                auto const paragraphLineStart = std::next(glyphs().begin(), paragraphLine.first);
+                auto const paragraphLineEnd = std::next(glyphs().begin(), paragraphLine.second);
+
+                if (!first)
+                {
+                    if (paragraphStyle.paragraph().line_spacing())
+                        yLine += paragraphStyle.paragraph().line_spacing().value();
+                }
+                else
+                    first = false;
+
+                if (paragraphLineStart == paragraphLineEnd || is_line_breaking_whitespace(*paragraphLineStart))
+                {
+                    auto lineStart = paragraphLineStart;
+                    auto lineEnd = (paragraphLineStart == paragraphLineEnd || !is_line_breaking_whitespace(*paragraphLineStart)) ? 
+                        paragraphLineEnd : paragraphLineStart;
+
+                    auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
+
+                    glyph_char::cluster_range clusters{
+                        static_cast<glyph_char::cluster_index>(from_glyph(lineStart).first),
+                        static_cast<glyph_char::cluster_index>(from_glyph(lineEnd).second) };
+                    if (alignBaselinesResult.clusters)
+                    {
+                        clusters.first = std::min(clusters.first, alignBaselinesResult.clusters.value().first + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
+                        clusters.second = std::max(clusters.second, alignBaselinesResult.clusters.value().second + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
+                    }
+                    auto textLineStart = static_cast<position_type>(clusters.first) - paragraph.span.textFirst;
+                    auto textLineEnd = static_cast<position_type>(clusters.second) - paragraph.span.textFirst;
+                    if (lineStart != lineEnd && std::prev(lineEnd)->clusters.first < lineStart->clusters.first) // RTL
+                        textLineStart = std::prev(lineEnd)->clusters.first;
+
+                    document_span const span{
+                        textLineStart,
+                        textLineEnd,
+                        lineStart - glyphs().begin() - paragraph.span.glyphsFirst,
+                        lineEnd - glyphs().begin() - paragraph.span.glyphsFirst };
+
+                    lines.emplace_back(
+                        this,
+                        std::distance(iGlyphParagraphs.begin(), aParagraph),
+                        column.index(),
+                        span,
+                        yLine,
+                        size{ 
+                            lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f, 
+                            alignBaselinesResult.yExtent },
+                        alignBaselinesResult.majorFont,
+                        alignBaselinesResult.baseline);
+
+                    yLine += lines.back().extents.cy;
+                    iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
+                }
+                else if (WordWrap && static_cast<coordinate>((paragraphLineEnd - 1)->cell[0].x) + static_cast<coordinate>((paragraphLineEnd - 1)->cell_extents().x) > aAvailableWidth)
+                {
+                    auto add_line = [&](auto first, auto last)
+                    {
+                        if (last != first && is_line_breaking_whitespace(*(last - 1)))
+                            --last;
+
+                        auto const alignBaselinesResult = glyphs().align_baselines(first, last, true);
+
+                        glyph_char::cluster_range clusters{
+                            static_cast<glyph_char::cluster_index>(from_glyph(first).first),
+                            static_cast<glyph_char::cluster_index>(from_glyph(last).second) };
+                        if (alignBaselinesResult.clusters)
+                        {
+                            clusters.first = std::min(clusters.first, alignBaselinesResult.clusters.value().first + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
+                            clusters.second = std::max(clusters.second, alignBaselinesResult.clusters.value().second + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
+                        }
+                        auto textLineStart = static_cast<position_type>(clusters.first) - paragraph.span.textFirst;
+                        auto textLineEnd = static_cast<position_type>(clusters.second) - paragraph.span.textFirst;
+                        if (first != last && std::prev(last)->clusters.first < first->clusters.first) // RTL
+                            textLineStart = std::prev(last)->clusters.first;
+
+                        document_span const span{
+                            textLineStart,
+                            textLineEnd,
+                            first - glyphs().begin() - paragraph.span.glyphsFirst,
+                            last - glyphs().begin() - paragraph.span.glyphsFirst };
+
+                        lines.emplace_back(
+                            this,
+                            std::distance(iGlyphParagraphs.begin(), aParagraph),
+                            column.index(),
+                            span,
+                            yLine,
+                            size{
+                                last != first ? (last - 1)->cell[1].x - (first)->cell[0].x : 0.0f,
+                                alignBaselinesResult.yExtent },
+                            alignBaselinesResult.majorFont,
+                            alignBaselinesResult.baseline);
+
+                        yLine += lines.back().extents.cy;
+                        iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
+                    };
+
+                    if (glyph_text_direction(paragraphLineStart, paragraphLineEnd) == text_direction::LTR)
+                    {
+                        auto next = paragraphLineStart;
+                        auto lineStart = next;
+                        auto lineEnd = paragraphLineEnd;
+                        coordinate offset = (lineEnd != lineStart ? lineStart->cell[0].x : 0.0);
+                        while (next != paragraphLineEnd)
+                        {
+                            glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset + aAvailableWidth, 0.0f }, vec2{ offset + aAvailableWidth, 0.0f } }, {} };
+                            auto split = std::lower_bound(next, paragraphLineEnd, key, [](auto const& lhs, auto const& rhs) { return lhs.cell[0].x < rhs.cell[0].x; });
+                            if (split != next)
+                            {
+                                if (split != paragraphLineEnd)
+                                    --split;
+                                else
+                                {
+                                    auto const& previousChar = *(split - 1);
+                                    auto const xPrevious = static_cast<coordinate>(previousChar.cell[0].x);
+                                    auto const cxPrevious = static_cast<coordinate>(previousChar.cell_extents().x);
+                                    if (xPrevious + cxPrevious >= offset + aAvailableWidth)
+                                        --split;
+                                }
+                            }
+                            if (split == next)
+                                ++split;
+                            if (split != paragraphLineEnd)
+                            {
+                                auto wordBreak = word_break(lineStart, split, paragraphLineEnd);
+                                if (wordBreak.first != lineStart)
+                                {
+                                    lineEnd = wordBreak.first;
+                                    next = wordBreak.second;
+                                }
+                                else
+                                    next = lineEnd = split;
+                            }
+                            else
+                                next = paragraphLineEnd;
+                            add_line(lineStart, lineEnd);
+                            lineStart = next;
+                            if (lineStart != paragraphLineEnd)
+                                offset = lineStart->cell[0].x;
+                            lineEnd = paragraphLineEnd;
+                        }
+                    }
+                    else // RTL
+                    {
+                        auto next = std::reverse_iterator{ paragraphLineEnd };
+                        auto lineStart = next;
+                        auto lineEnd = std::reverse_iterator{ paragraphLineStart };
+                        coordinate const rightmost = (lineEnd != lineStart ? lineStart->cell[1].x : 0.0);
+                        coordinate offset = rightmost;
+                        while (next != std::reverse_iterator{ paragraphLineStart })
+                        {
+                            glyph_char const key{ {}, {}, {}, {}, {}, quadf_2d{ vec2{ offset - aAvailableWidth, 0.0f } }, {} };
+                            auto split = std::lower_bound(next, std::reverse_iterator{ paragraphLineStart }, key, [=](auto const& lhs, auto const& rhs) { return offset - lhs.cell[0].x < offset - rhs.cell[0].x; });
+                            if (split != next && (split != std::reverse_iterator{ paragraphLineStart } || static_cast<coordinate>((split - 1)->cell[0].x) + static_cast<coordinate>((split - 1)->cell_extents().x) >= rightmost - offset + aAvailableWidth))
+                                --split;
+                            if (split == next)
+                                ++split;
+                            if (split != std::reverse_iterator{ paragraphLineStart })
+                            {
+                                auto wordBreak = word_break(lineStart, split, std::reverse_iterator{ paragraphLineStart });
+                                if (wordBreak.first != lineStart)
+                                {
+                                    lineEnd = wordBreak.first;
+                                    next = wordBreak.second;
+                                }
+                                else
+                                    next = lineEnd = split;
+                            }
+                            else
+                                next = std::reverse_iterator{ paragraphLineStart };
+                            add_line(lineEnd.base(), lineStart.base());
+                            lineStart = next;
+                            if (lineStart != std::reverse_iterator{ paragraphLineStart })
+                                offset = lineStart->cell[1].x;
+                            lineEnd = std::reverse_iterator{ paragraphLineStart };
+                        }
+                    }
+                }
+                else
+                {
+                    auto lineStart = paragraphLineStart;
+                    auto lineEnd = paragraphLineEnd;
+                    if (lineEnd != lineStart && is_line_breaking_whitespace(*(lineEnd - 1)))
+                        --lineEnd;
+
+                    auto const alignBaselinesResult = glyphs().align_baselines(lineStart, lineEnd, true);
+
+                    glyph_char::cluster_range clusters{
+                        static_cast<glyph_char::cluster_index>(from_glyph(lineStart).first),
+                        static_cast<glyph_char::cluster_index>(from_glyph(lineEnd).second) };
+                    if (alignBaselinesResult.clusters)
+                    {
+                        clusters.first = std::min(clusters.first, alignBaselinesResult.clusters.value().first + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
+                        clusters.second = std::max(clusters.second, alignBaselinesResult.clusters.value().second + static_cast<glyph_char::cluster_index>(paragraph.span.textFirst));
+                    }
+                    auto textLineStart = static_cast<position_type>(clusters.first) - paragraph.span.textFirst;
+                    auto textLineEnd = static_cast<position_type>(clusters.second) - paragraph.span.textFirst;
+                    if (lineEnd != lineStart && std::prev(lineEnd)->clusters.first < lineStart->clusters.first) // RTL
+                        textLineStart = std::prev(lineEnd)->clusters.first;
+                    
+                    document_span const span{
+                        textLineStart,
+                        textLineEnd,
+                        lineStart - glyphs().begin() - paragraph.span.glyphsFirst,
+                        lineEnd - glyphs().begin() - paragraph.span.glyphsFirst };
+
+                    lines.emplace_back(
+                        this,
+                        std::distance(iGlyphParagraphs.begin(), aParagraph),
+                        column.index(),
+                        span,
+                        yLine,
+                        size{
+                            lineEnd != lineStart ? (lineEnd - 1)->cell[1].x - (lineStart)->cell[0].x : 0.0f,
+                            alignBaselinesResult.yExtent },
+                        alignBaselinesResult.majorFont,
+                        alignBaselinesResult.baseline);
+                    
+                    yLine += lines.back().extents.cy;
+                    iTextExtents->cx = std::max(iTextExtents->cx, lines.back().extents.cx);
+                }
+            }
+
+            if (paragraphStyle.paragraph().padding())
+                yLine += paragraphStyle.paragraph().padding().value().bottom;
+
+            yColumn = std::max(yColumn, yLine);
+        }
+
+        return yColumn;
+    }
+
+    void text_edit::align_paragraphs()
+    {
+        coordinate adjust = 0.0;
+        if (iTextExtents && iTextExtents->cy < client_rect(false).cy)
+        {
+            auto const space = client_rect(false).cy - iTextExtents->cy;
+            auto const defaultAlignment = default_style().paragraph().alignment().as_std_optional().value_or(neogfx::alignment::Left | neogfx::alignment::Top);
+            adjust =
+                ((defaultAlignment & neogfx::alignment::Vertical) == neogfx::alignment::Bottom) ? space :
+                ((defaultAlignment & neogfx::alignment::Vertical) == neogfx::alignment::VCenter) ? std::floor(space / 2.0) : 0.0;
         }
+        iParagraphPositions.set_offset(adjust);
     }
 
     void text_edit::animate()
@@ -0,0 +1,151 @@
+// widget_render_cache.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/gfx/i_rendering_engine.hpp>
+#include <neogfx/gui/widget/widget_render_cache.hpp>
+
+std::unique_ptr<neogfx::i_widget_render_cache> sWidgetRenderCache;
+
+template <>
+neogfx::i_widget_render_cache& services::start_service<neogfx::i_widget_render_cache>()
+{
+    static bool created = (sWidgetRenderCache = std::make_unique<neogfx::widget_render_cache>(), true);
+    return *sWidgetRenderCache;
+}
+
+template<> void services::teardown_service<neogfx::i_widget_render_cache>()
+{
+    sWidgetRenderCache.reset();
+}
+
+namespace neogfx
+{
+    namespace
+    {
+        std::uint64_t current_frame()
+        {
+            return service<i_rendering_engine>().frame_statistics().frame;
+        }
+
+        std::uint64_t texture_bytes(i_texture const& aTexture)
+        {
+            auto const extents = aTexture.storage_extents();
+            return static_cast<std::uint64_t>(extents.cx) * static_cast<std::uint64_t>(extents.cy) * 4ull * std::max<std::uint64_t>(aTexture.samples(), 1ull);
+        }
+    }
+
+    widget_render_cache::widget_render_cache() :
+        iBudget{ DefaultBudget },
+        iUsage{ 0ull }
+    {
+    }
+
+    std::uint64_t widget_render_cache::budget() const
+    {
+        return iBudget;
+    }
+
+    void widget_render_cache::set_budget(std::uint64_t aBudget)
+    {
+        iBudget = aBudget;
+        evict(iBudget);
+    }
+
+    std::uint64_t widget_render_cache::usage() const
+    {
+        return iUsage;
+    }
+
+    std::uint32_t widget_render_cache::count() const
+    {
+        return static_cast<std::uint32_t>(iEntries.size());
+    }
+
+    i_texture const* widget_render_cache::find(i_widget const& aWidget)
+    {
+        auto existing = iIndex.find(&aWidget);
+        if (existing == iIndex.end())
+            return nullptr;
+        existing->second->lastUsedFrame = current_frame();
+        iEntries.splice(iEntries.begin(), iEntries, existing->second);
+        return &existing->second->texture;
+    }
+
+    i_texture const* widget_render_cache::acquire(i_widget const& aWidget, size const& aExtents)
+    {
+        auto const extents = aExtents.ceil();
+        if (extents.empty())
+            return nullptr;
+        auto existing = iIndex.find(&aWidget);
+        if (existing != iIndex.end())
+        {
+            if (existing->second->texture.extents() == extents)
+                return find(aWidget);
+            erase(existing->second);
+        }
+        if (static_cast<std::uint64_t>(extents.cx) * static_cast<std::uint64_t>(extents.cy) * 4ull > iBudget)
+            return nullptr;
+        neogfx::texture newTexture{ extents, 1.0, texture_sampling::Multisample };
+        auto const bytes = texture_bytes(newTexture);
+        if (bytes > iBudget || !evict(iBudget - bytes))
+            return nullptr;
+        iEntries.push_front(entry{ &aWidget, newTexture, bytes, current_frame() });
+        iIndex[&aWidget] = iEntries.begin();
+        iUsage += bytes;
+        return &iEntries.front().texture;
+    }
+
+    void widget_render_cache::release(i_widget const& aWidget)
+    {
+        auto existing = iIndex.find(&aWidget);
+        if (existing != iIndex.end())
+            erase(existing->second);
+    }
+
+    void widget_render_cache::clear()
+    {
+        iEntries.clear();
+        iIndex.clear();
+        iUsage = 0ull;
+    }
+
+    bool widget_render_cache::evict(std::uint64_t aBudget)
+    {
+        // entries composited during the current frame may still be referenced by queued draw operations...
+        auto const frame = current_frame();
+        for (auto e = iEntries.end(); iUsage > aBudget && e != iEntries.begin();)
+        {
+            --e;
+            if (e->lastUsedFrame == frame)
+                continue;
+            auto const victim = e++;
+            erase(victim);
+        }
+        return iUsage <= aBudget;
+    }
+
+    void widget_render_cache::erase(entry_list::iterator aEntry)
+    {
+        iUsage -= aEntry->bytes;
+        iIndex.erase(aEntry->widget);
+        iEntries.erase(aEntry);
+    }
+}
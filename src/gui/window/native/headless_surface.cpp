@@ -0,0 +1,141 @@
+// headless_surface.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/hid/i_surface_window.hpp>
+#include <neogfx/gfx/i_image.hpp>
+#include <neogfx/gfx/i_rendering_context.hpp>
+#include "../../../gfx/native/software/software_rendering_context.hpp"
+#include "headless_surface.hpp"
+
+namespace neogfx
+{
+    namespace
+    {
+        std::array<std::uint8_t, 4> unpremultiplied(std::uint32_t aPixel)
+        {
+            std::uint32_t const alpha = aPixel >> 24u;
+            if (alpha == 0u)
+                return {};
+            auto channel = [&](std::uint32_t aShift)
+            {
+                return static_cast<std::uint8_t>(std::min<std::uint32_t>(((aPixel >> aShift) & 0xFFu) * 255u + alpha / 2u, 255u * alpha) / alpha);
+            };
+            return { channel(0u), channel(8u), channel(16u), static_cast<std::uint8_t>(alpha) };
+        }
+    }
+
+    headless_surface::headless_surface(i_rendering_engine& aRenderingEngine, i_surface_window& aWindow) :
+        native_surface{ aRenderingEngine, aWindow }
+    {
+    }
+
+    headless_surface::~headless_surface()
+    {
+        set_destroyed();
+    }
+
+    pixel_format_t headless_surface::pixel_format() const
+    {
+        // there is no native device so no native pixel format
+        return 0;
+    }
+
+    const i_texture& headless_surface::target_texture() const
+    {
+        throw no_target_texture();
+    }
+
+    rect_i32 headless_surface::viewport() const
+    {
+        return iViewport;
+    }
+
+    rect_i32 headless_surface::set_viewport(const rect_i32& aViewport) const
+    {
+        auto const oldViewport = iViewport;
+        iViewport = aViewport;
+        return oldViewport;
+    }
+
+    color headless_surface::read_pixel(const point& aPosition) const
+    {
+        basic_point<std::int32_t> const pos{ aPosition };
+        if (pos.x < 0 || pos.y < 0 || pos.x >= iBitmap.width() || pos.y >= iBitmap.height())
+            return color{};
+        auto const pixel = unpremultiplied(iBitmap.row(pos.y)[pos.x]);
+        return color{ pixel[0], pixel[1], pixel[2], pixel[3] };
+    }
+
+    void headless_surface::snapshot(i_image& aImage) const
+    {
+        if (iBitmap.width() == 0 || iBitmap.height() == 0)
+            throw nothing_rendered();
+        aImage.resize(size{ static_cast<dimension>(iBitmap.width()), static_cast<dimension>(iBitmap.height()) });
+        auto pixels = static_cast<std::uint8_t*>(aImage.pixels());
+        for (std::int32_t y = 0; y < iBitmap.height(); ++y)
+        {
+            auto const row = iBitmap.row(y);
+            for (std::int32_t x = 0; x < iBitmap.width(); ++x, pixels += 4)
+            {
+                auto const pixel = unpremultiplied(row[x]);
+                std::copy(pixel.begin(), pixel.end(), pixels);
+            }
+        }
+    }
+
+    std::unique_ptr<i_rendering_context> headless_surface::create_graphics_context(blending_mode) const
+    {
+        return std::make_unique<software_rendering_context>(*this, iBitmap);
+    }
+
+    std::unique_ptr<i_rendering_context> headless_surface::create_graphics_context(const i_widget& aWidget, blending_mode) const
+    {
+        return std::make_unique<software_rendering_context>(*this, aWidget, iBitmap);
+    }
+
+    graphics_operation::i_queue& headless_surface::graphics_operation_queue() const
+    {
+        if (iQueue == nullptr)
+            iQueue = std::make_unique<graphics_operation::queue>();
+        return *iQueue;
+    }
+
+    void headless_surface::do_activate_target() const
+    {
+        // nothing to bind; rendering contexts write straight into the bitmap
+    }
+
+    void headless_surface::do_render()
+    {
+        auto const bitmapExtents = extents().ceil().as<std::int32_t>();
+        if (iBitmap.width() != bitmapExtents.cx || iBitmap.height() != bitmapExtents.cy)
+            iBitmap.resize(bitmapExtents.cx, bitmapExtents.cy);
+
+        set_viewport(rect_i32{ point_i32{ 0, 0 }, bitmapExtents });
+
+        for (auto const& region : rendering_regions())
+        {
+            set_rendering_region(region);
+            surface_window().native_window_render(region);
+        }
+        set_rendering_region({});
+    }
+}
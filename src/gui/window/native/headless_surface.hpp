@@ -0,0 +1,63 @@
+// headless_surface.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include "../../../gfx/native/software/software_rasterizer.hpp"
+#include "native_surface.hpp"
+
+namespace neogfx
+{
+    class i_surface_window;
+
+    // A surface with no desktop presence: frames are rasterized on the CPU into an offscreen bitmap
+    // which can be read back with snapshot(). It needs no GPU so works with any rendering engine;
+    // with the software renderer (selected by --offscreen) glyphs and textures are sampled from
+    // host memory, otherwise textures are read back from the GPU when first drawn in a frame.
+    class headless_surface : public native_surface
+    {
+    public:
+        struct no_target_texture : std::logic_error { no_target_texture() : std::logic_error("neogfx::headless_surface::no_target_texture") {} };
+    public:
+        headless_surface(i_rendering_engine& aRenderingEngine, i_surface_window& aWindow);
+        ~headless_surface();
+    public:
+        pixel_format_t pixel_format() const override;
+        const i_texture& target_texture() const override;
+    public:
+        rect_i32 viewport() const override;
+        rect_i32 set_viewport(const rect_i32& aViewport) const override;
+    public:
+        color read_pixel(const point& aPosition) const override;
+        void snapshot(i_image& aImage) const override;
+    public:
+        std::unique_ptr<i_rendering_context> create_graphics_context(blending_mode aBlendingMode) const override;
+        std::unique_ptr<i_rendering_context> create_graphics_context(const i_widget& aWidget, blending_mode aBlendingMode) const override;
+        graphics_operation::i_queue& graphics_operation_queue() const final;
+    private:
+        void do_activate_target() const override;
+        void do_render() override;
+    private:
+        mutable software_bitmap iBitmap;
+        mutable rect_i32 iViewport;
+        mutable std::unique_ptr<graphics_operation::i_queue> iQueue;
+    };
+}
@@ -0,0 +1,373 @@
+// headless_window.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2020 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <neogfx/app/i_app.hpp>
+#include <neogfx/hid/i_surface_manager.hpp>
+#include <neogfx/hid/i_surface_window.hpp>
+#include <neogfx/gui/widget/i_widget.hpp>
+#include <neogfx/gui/window/i_window.hpp>
+#include "headless_window.hpp"
+
+namespace neogfx
+{
+    headless_window::headless_window(i_rendering_engine& aRenderingEngine, i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const basic_size<int>& aDimensions, std::string const& aWindowTitle, window_style aStyle) :
+        headless_window{ aRenderingEngine, aSurfaceManager, aWindow, basic_point<int>{}, aDimensions, aWindowTitle, aStyle }
+    {
+    }
+
+    headless_window::headless_window(i_rendering_engine& aRenderingEngine, i_surface_manager& aSurfaceManager, i_surface_window& aWindow, const basic_point<int>& aPosition, const basic_size<int>& aDimensions, std::string const& aWindowTitle, window_style aStyle) :
+        native_window{ aRenderingEngine, aSurfaceManager, aWindow },
+        iPosition{ aPosition },
+        iExtents{ aDimensions },
+        iEnabled{ true },
+        iVisible{ (aStyle & window_style::InitiallyHidden) != window_style::InitiallyHidden },
+        iOpacity{ 1.0 },
+        iActive{ false },
+        iState{ window_state::Normal },
+        iCapturingMouse{ false },
+        iNonClientCapturing{ false },
+        iReady{ false }
+    {
+        native_window::set_title_text(string{ aWindowTitle });
+        surface_window().set_native_window(*this);
+    }
+
+    headless_window::~headless_window()
+    {
+        set_destroyed();
+    }
+
+    void headless_window::set_destroying()
+    {
+        if (!is_alive())
+            return;
+        native_window::set_destroying();
+        release_capture();
+        surface_window().native_window_closing();
+    }
+
+    void headless_window::set_destroyed()
+    {
+        native_window::set_destroyed();
+        surface_window().native_window_closed();
+    }
+
+    void* headless_window::target_handle() const
+    {
+        return nullptr;
+    }
+
+    void* headless_window::target_device_handle() const
+    {
+        return nullptr;
+    }
+
+    bool headless_window::has_parent() const
+    {
+        return false;
+    }
+
+    const i_native_window& headless_window::parent() const
+    {
+        throw no_parent();
+    }
+
+    i_native_window& headless_window::parent()
+    {
+        throw no_parent();
+    }
+
+    bool headless_window::is_nested() const
+    {
+        return false;
+    }
+
+    bool headless_window::initialising() const
+    {
+        return !iReady;
+    }
+
+    void headless_window::initialisation_complete()
+    {
+        iReady = true;
+    }
+
+    void* headless_window::handle() const
+    {
+        return nullptr;
+    }
+
+    void* headless_window::native_handle() const
+    {
+        return nullptr;
+    }
+
+    point headless_window::surface_position() const
+    {
+        return iPosition;
+    }
+
+    void headless_window::move_surface(const point& aPosition)
+    {
+        if (iPosition != aPosition)
+        {
+            iPosition = aPosition;
+            push_event(window_event{ window_event_type::Moved, iPosition });
+        }
+    }
+
+    size headless_window::surface_extents() const
+    {
+        return iExtents;
+    }
+
+    void headless_window::resize_surface(const size& aExtents)
+    {
+        if (iExtents != aExtents)
+        {
+            iExtents = aExtents;
+            push_event(window_event{ window_event_type::Resized, iExtents });
+        }
+    }
+
+    bool headless_window::resizing_or_moving() const
+    {
+        return false;
+    }
+
+    bool headless_window::can_render() const
+    {
+        return visible() && attached() && attachment().can_render();
+    }
+
+    void headless_window::render(bool aOOBRequest)
+    {
+        if (can_render())
+            attachment().render(aOOBRequest);
+    }
+
+    void headless_window::display()
+    {
+        // nothing to present; the frame stays in the surface's bitmap
+    }
+
+    void headless_window::close(bool aForce)
+    {
+        if (is_alive() && (aForce || surface_window().native_window_can_close()))
+        {
+            set_destroying();
+            set_destroyed();
+        }
+    }
+
+    bool headless_window::visible() const
+    {
+        return iVisible;
+    }
+
+    void headless_window::show(bool aActivate)
+    {
+        if (iVisible)
+            return;
+        iVisible = true;
+        if (attached())
+            attachment().invalidate(rect{ surface_extents() });
+        if (aActivate)
+            activate();
+    }
+
+    void headless_window::hide()
+    {
+        iVisible = false;
+    }
+
+    double headless_window::opacity() const
+    {
+        return iOpacity;
+    }
+
+    void headless_window::set_opacity(double aOpacity)
+    {
+        iOpacity = aOpacity;
+    }
+
+    double headless_window::transparency() const
+    {
+        return 1.0 - opacity();
+    }
+
+    void headless_window::set_transparency(double aTransparency)
+    {
+        set_opacity(1.0 - aTransparency);
+    }
+
+    bool headless_window::is_effectively_active() const
+    {
+        return iActive;
+    }
+
+    bool headless_window::is_active() const
+    {
+        return iActive;
+    }
+
+    void headless_window::activate()
+    {
+        if ((surface_window().style() & window_style::NoActivate) == window_style::NoActivate)
+            return;
+        if (!enabled())
+            return;
+        if (is_active())
+            return;
+        if (!visible())
+            show();
+
+        iActive = true;
+        surface_window().as_window().activated()();
+        surface_window().as_widget().update(true);
+    }
+
+    void headless_window::deactivate()
+    {
+        if (!is_active())
+            return;
+        iActive = false;
+        surface_window().as_window().deactivated()();
+        surface_window().as_widget().update(true);
+    }
+
+    bool headless_window::is_iconic() const
+    {
+        return iState == window_state::Iconized;
+    }
+
+    void headless_window::iconize()
+    {
+        if (iState != window_state::Iconized)
+        {
+            iState = window_state::Iconized;
+            push_event(window_event{ window_event_type::Iconized });
+        }
+    }
+
+    bool headless_window::is_maximized() const
+    {
+        return iState == window_state::Maximized;
+    }
+
+    void headless_window::maximize()
+    {
+        if (iState != window_state::Maximized)
+        {
+            iState = window_state::Maximized;
+            push_event(window_event{ window_event_type::Maximized });
+        }
+    }
+
+    bool headless_window::is_restored() const
+    {
+        return iState == window_state::Normal;
+    }
+
+    void headless_window::restore()
+    {
+        if (iState != window_state::Normal)
+        {
+            iState = window_state::Normal;
+            push_event(window_event{ window_event_type::Restored });
+        }
+    }
+
+    bool headless_window::is_fullscreen() const
+    {
+        return false;
+    }
+
+    void headless_window::enter_fullscreen(const video_mode& aVideoMode)
+    {
+        resize_surface(size{ static_cast<dimension>(aVideoMode.resolution().cx), static_cast<dimension>(aVideoMode.resolution().cy) });
+    }
+
+    bool headless_window::enabled() const
+    {
+        return iEnabled;
+    }
+
+    void headless_window::enable(bool aEnable)
+    {
+        if (iEnabled != aEnable)
+        {
+            iEnabled = aEnable;
+            if (aEnable)
+                push_event(window_event(window_event_type::Enabled));
+            else
+                push_event(window_event(window_event_type::Disabled));
+        }
+    }
+
+    bool headless_window::is_capturing() const
+    {
+        return iCapturingMouse;
+    }
+
+    // there is no system mouse to capture; synthetic mouse events are pushed straight to the window
+
+    void headless_window::set_capture()
+    {
+        iCapturingMouse = true;
+        iNonClientCapturing = false;
+    }
+
+    void headless_window::release_capture()
+    {
+        iCapturingMouse = false;
+        iNonClientCapturing = false;
+    }
+
+    void headless_window::non_client_set_capture()
+    {
+        iCapturingMouse = true;
+        iNonClientCapturing = true;
+    }
+
+    void headless_window::non_client_release_capture()
+    {
+        iCapturingMouse = false;
+        iNonClientCapturing = false;
+    }
+
+    void headless_window::set_title_text(i_string const& aTitleText)
+    {
+        native_window::set_title_text(aTitleText);
+        push_event(window_event{ window_event_type::TitleTextChanged });
+    }
+
+    border headless_window::border_thickness() const
+    {
+        iBorderThickness = border{ 1.0, 1.0, 1.0, 1.0 };
+        if ((surface_window().style() & window_style::Resize) == window_style::Resize)
+        {
+            iBorderThickness += service<i_app>().current_style().border(border_role::Window);
+            iBorderThickness += service<i_app>().current_style().padding(padding_role::Window);
+        }
+        return iBorderThickness;
+    }
+}
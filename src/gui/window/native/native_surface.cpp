@@ -33,6 +33,27 @@
 
 namespace neogfx
 {
+    namespace
+    {
+        // Maximum number of disjoint damage regions kept per surface; beyond this the
+        // cheapest pair is combined.
+        std::size_t constexpr MaxDamageRegions = 8u;
+        // Estimated cost, in pixels, of an extra rendering pass for a separate region.
+        scalar constexpr DamageRegionPassCost = 64.0 * 64.0;
+
+        scalar combining_cost(const rect& aLeft, const rect& aRight)
+        {
+            auto const combined = aLeft.combined(aRight);
+            auto const overlap = aLeft.intersection(aRight);
+            return combined.cx * combined.cy - (aLeft.cx * aLeft.cy + aRight.cx * aRight.cy - overlap.cx * overlap.cy);
+        }
+
+        bool worth_combining(const rect& aLeft, const rect& aRight)
+        {
+            return !aLeft.intersection(aRight).empty() || combining_cost(aLeft, aRight) <= DamageRegionPassCost;
+        }
+    }
+
     native_surface::native_surface(i_rendering_engine& aRenderingEngine, i_surface_window& aWindow) :
         iRenderingEngine{ aRenderingEngine },
         iSurfaceWindow{ aWindow },
@@ -225,6 +246,51 @@ namespace neogfx
                 iInvalidatedArea = aInvalidatedRect.ceil();
             else
                 iInvalidatedArea = invalidated_area().combined(aInvalidatedRect).ceil();
+            // Regions are kept disjoint; a new rect absorbs any region it overlaps or that
+            // costs less to repaint as part of a combined rect than as a separate pass.
+            rect damage = aInvalidatedRect.ceil();
+            for (auto region = iInvalidatedRegions.begin(); region != iInvalidatedRegions.end();)
+            {
+                if (worth_combining(*region, damage))
+                {
+                    damage = region->combined(damage).ceil();
+                    iInvalidatedRegions.erase(region);
+                    region = iInvalidatedRegions.begin();
+                }
+                else
+                    ++region;
+            }
+            iInvalidatedRegions.push_back(damage);
+            while (iInvalidatedRegions.size() > MaxDamageRegions)
+            {
+                std::optional<std::pair<std::size_t, std::size_t>> cheapest;
+                scalar cheapestCost = 0.0;
+                for (std::size_t i = 0; i < iInvalidatedRegions.size(); ++i)
+                    for (std::size_t j = i + 1; j < iInvalidatedRegions.size(); ++j)
+                    {
+                        auto const cost = combining_cost(iInvalidatedRegions[i], iInvalidatedRegions[j]);
+                        if (!cheapest || cost < cheapestCost)
+                        {
+                            cheapest.emplace(i, j);
+                            cheapestCost = cost;
+                        }
+                    }
+                damage = iInvalidatedRegions[cheapest->first].combined(iInvalidatedRegions[cheapest->second]).ceil();
+                iInvalidatedRegions.erase(std::next(iInvalidatedRegions.begin(), cheapest->second));
+                iInvalidatedRegions.erase(std::next(iInvalidatedRegions.begin(), cheapest->first));
+                for (auto region = iInvalidatedRegions.begin(); region != iInvalidatedRegions.end();)
+                {
+                    if (!region->intersection(damage).empty())
+                    {
+                        damage = region->combined(damage).ceil();
+                        iInvalidatedRegions.erase(region);
+                        region = iInvalidatedRegions.begin();
+                    }
+                    else
+                        ++region;
+                }
+                iInvalidatedRegions.push_back(damage);
+            }
         }
     }
 
@@ -235,22 +301,66 @@ namespace neogfx
 
     const rect& native_surface::invalidated_area() const
     {
+        if (iRenderingRegion)
+            return *iRenderingRegion;
         if (has_invalidated_area())
             return *iInvalidatedArea;
         throw no_invalidated_area();
     }
 
+    std::size_t native_surface::invalidated_region_count() const
+    {
+        return iInvalidatedRegions.size();
+    }
+
+    const rect& native_surface::invalidated_region(std::size_t aIndex) const
+    {
+        if (aIndex >= iInvalidatedRegions.size())
+            throw no_invalidated_area();
+        return iInvalidatedRegions[aIndex];
+    }
+
     rect native_surface::validate()
     {
         if (has_invalidated_area())
         {
             rect validatedArea = invalidated_area();
             iInvalidatedArea = std::nullopt;
+            iInvalidatedRegions.clear();
             return validatedArea;
         }
         throw no_invalidated_area();
     }
 
+    void native_surface::validate_rendering_regions()
+    {
+        // damage added during rendering that was not covered by a rendered region is kept for the next frame
+        std::erase_if(iInvalidatedRegions, [&](rect const& aRegion)
+        {
+            return std::any_of(iRenderingRegions.begin(), iRenderingRegions.end(), [&](rect const& aRendered) { return aRendered.contains(aRegion); });
+        });
+        iRenderingRegions.clear();
+        if (iInvalidatedRegions.empty())
+        {
+            iInvalidatedArea = std::nullopt;
+            return;
+        }
+        rect remaining = iInvalidatedRegions[0];
+        for (auto const& region : iInvalidatedRegions)
+            remaining = remaining.combined(region).ceil();
+        iInvalidatedArea = remaining;
+    }
+
+    const std::vector<rect>& native_surface::rendering_regions() const
+    {
+        return iRenderingRegions;
+    }
+
+    void native_surface::set_rendering_region(const optional_rect& aRegion)
+    {
+        iRenderingRegion = aRegion;
+    }
+
     bool native_surface::can_render() const
     {
         return !iPaused && 
@@ -324,6 +434,13 @@ namespace neogfx
 
         surface_window().rendering()();
 
+        // rendering() handlers may add damage so the regions to render are only fixed now
+        iRenderingRegions = iInvalidatedRegions;
+        auto& statistics = rendering_engine().frame_statistics();
+        statistics.damageRegions += static_cast<std::uint32_t>(iRenderingRegions.size());
+        for (auto const& region : iRenderingRegions)
+            statistics.pixelsRepainted += static_cast<std::uint64_t>(region.cx * region.cy);
+
         scoped_render_target srt{ *this };
 
         do_render();
@@ -331,7 +448,7 @@ namespace neogfx
         surface_window().native_window().display();
 
         iRendering = false;
-        validate();
+        validate_rendering_regions();
 
         surface_window().rendering_finished()();
 
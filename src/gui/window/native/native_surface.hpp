@@ -85,6 +85,8 @@ namespace neogfx
         void invalidate(const rect& aInvalidatedRect) override;
         bool has_invalidated_area() const override;
         const rect& invalidated_area() const override;
+        std::size_t invalidated_region_count() const override;
+        const rect& invalidated_region(std::size_t aIndex) const override;
         rect validate() override;
         bool can_render() const override;
         void pause() override;
@@ -96,10 +98,14 @@ namespace neogfx
     protected:
         void set_destroying() override;
         void set_destroyed() override;
+    protected:
+        const std::vector<rect>& rendering_regions() const;
+        void set_rendering_region(const optional_rect& aRegion);
     private:
         virtual void do_activate_target() const = 0;
         virtual void do_render() = 0;
     private:
+        void validate_rendering_regions();
         void debug_message(std::string const& aMessage);
     private:
         i_rendering_engine& iRenderingEngine;
@@ -108,6 +114,9 @@ namespace neogfx
         neogfx::logical_coordinate_system iLogicalCoordinateSystem;
         mutable std::optional<neogfx::logical_coordinates> iLogicalCoordinates;
         std::optional<rect> iInvalidatedArea;
+        std::vector<rect> iInvalidatedRegions;
+        std::vector<rect> iRenderingRegions;
+        optional_rect iRenderingRegion;
         std::uint64_t iFrameCounter;
         typedef std::chrono::time_point<std::chrono::high_resolution_clock> frame_time_point;
         typedef std::pair<frame_time_point, frame_time_point> frame_times;
@@ -236,6 +236,16 @@ namespace neogfx
         return parent().invalidated_area();
     }
 
+    std::size_t virtual_surface::invalidated_region_count() const
+    {
+        return parent().invalidated_region_count();
+    }
+
+    const rect& virtual_surface::invalidated_region(std::size_t aIndex) const
+    {
+        return parent().invalidated_region(aIndex);
+    }
+
     rect virtual_surface::validate()
     {
         return parent().validate();
@@ -266,6 +276,11 @@ namespace neogfx
         return parent().is_rendering();
     }
 
+    void virtual_surface::snapshot(i_image& aImage) const
+    {
+        parent().snapshot(aImage);
+    }
+
     void virtual_surface::debug(bool aEnableDebug)
     {
         iDebug = aEnableDebug;
@@ -92,12 +92,15 @@ namespace neogfx
         void invalidate(const rect& aInvalidatedRect) final;
         bool has_invalidated_area() const final;
         const rect& invalidated_area() const final;
+        std::size_t invalidated_region_count() const final;
+        const rect& invalidated_region(std::size_t aIndex) const final;
         rect validate() final;
         bool can_render() const final;
         void render(bool aOOBRequest = false) final;
         void pause() final;
         void resume() final;
         bool is_rendering() const final;
+        void snapshot(i_image& aImage) const final;
     public:
         void debug(bool aEnableDebug) final;
     private:
@@ -242,6 +242,11 @@ namespace neogfx
         if (has_parent() && (ultimate_ancestor().is_fullscreen() || service<i_app>().program_options().nest()) && &ultimate_ancestor() != this)
             iStyle |= window_style::Nested;
 
+        // children of an offscreen window have no desktop to appear on either so are offscreen too
+        if (service<i_app>().program_options().offscreen() ||
+            (has_parent() && (ultimate_ancestor().style() & window_style::Offscreen) == window_style::Offscreen))
+            iStyle |= window_style::Offscreen;
+
         if (aPlacement.video_mode())
         {
             if (is_nested())
@@ -0,0 +1,82 @@
+// benchmark.hpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// A minimal benchmark harness: each benchmark source registers one or more named functions with a
+// static benchmarks::registration and reports its measurements with benchmarks::report. The driver
+// (main.cpp) creates an offscreen app so that widgets and fonts are available and runs each
+// registered benchmark in turn; a benchmark name (or prefix) on the command line selects a subset.
+
+namespace benchmarks
+{
+    struct benchmark
+    {
+        std::string name;
+        std::function<void()> run;
+    };
+
+    inline std::vector<benchmark>& registry()
+    {
+        static std::vector<benchmark> sRegistry;
+        return sRegistry;
+    }
+
+    struct registration
+    {
+        registration(std::string const& aName, std::function<void()> const& aRun)
+        {
+            registry().push_back(benchmark{ aName, aRun });
+        }
+    };
+
+    // Returns the median wall clock time in milliseconds of aRuns calls of aFunction.
+    template <typename Function>
+    double median_ms(std::uint32_t aRuns, Function&& aFunction)
+    {
+        std::vector<double> times;
+        times.reserve(aRuns);
+        for (std::uint32_t run = 0u; run < aRuns; ++run)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            aFunction();
+            auto const end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>{ end - start }.count());
+        }
+        std::nth_element(times.begin(), times.begin() + times.size() / 2u, times.end());
+        return times[times.size() / 2u];
+    }
+
+    inline void report(std::string const& aBenchmark, std::string const& aMeasurement, double aValue, std::string const& aUnit)
+    {
+        std::cout << std::left << std::setw(24) << aBenchmark << std::setw(48) << aMeasurement <<
+            std::right << std::setw(12) << std::fixed << std::setprecision(3) << aValue << ' ' << aUnit << std::endl;
+    }
+}
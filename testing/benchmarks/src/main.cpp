@@ -0,0 +1,63 @@
+// main.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <neogfx/app/app.hpp>
+#include "benchmark.hpp"
+
+int main(int argc, char* argv[])
+{
+    // benchmark names are taken from the command line; everything else is passed to the app which always
+    // runs offscreen so that results do not depend on a display or GPU driver
+    std::vector<std::string> selected;
+    std::vector<char*> appArguments{ argv[0] };
+    static char offscreen[] = "--offscreen";
+    appArguments.push_back(offscreen);
+    for (int argi = 1; argi < argc; ++argi)
+        if (argv[argi][0] == '-')
+            appArguments.push_back(argv[argi]);
+        else
+            selected.push_back(argv[argi]);
+    neogfx::app app{ static_cast<int>(appArguments.size()), appArguments.data(), "neoGFX Benchmarks" };
+
+    int failures = 0;
+    for (auto const& benchmark : benchmarks::registry())
+    {
+        if (!selected.empty() && std::none_of(selected.begin(), selected.end(), [&](std::string const& aName)
+            { return benchmark.name.compare(0, aName.size(), aName) == 0; }))
+            continue;
+        try
+        {
+            benchmark.run();
+        }
+        catch (std::exception const& e)
+        {
+            std::cerr << benchmark.name << ": failed with exception: " << e.what() << std::endl;
+            ++failures;
+        }
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
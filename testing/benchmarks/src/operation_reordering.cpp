@@ -0,0 +1,113 @@
+// operation_reordering.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <neogfx/gfx/graphics_operations.hpp>
+#include "benchmark.hpp"
+
+// Measures what graphics_operation::reorder saves and costs on synthetic frames of widgets that each draw
+// a filled background rect followed by an underline (the interleaved rect, line, rect, line ... sequence
+// that adjacent-only batching turns into one draw per primitive) and checks that every pair of
+// overlapping operations is still drawn in its original (painter's) order.
+
+namespace
+{
+    using namespace neogfx;
+
+    graphics_operation::queue widget_frame(std::uint32_t aColumns, std::uint32_t aRows, point const& aPitch)
+    {
+        graphics_operation::queue result;
+        for (std::uint32_t row = 0u; row < aRows; ++row)
+            for (std::uint32_t column = 0u; column < aColumns; ++column)
+            {
+                point const origin{ column * aPitch.x, row * aPitch.y };
+                result.push_back(graphics_operation::draw_rect{ rect{ origin, size{ 56.0, 26.0 } }, pen{}, color::DarkSlateGray });
+                result.push_back(graphics_operation::draw_line{ origin + point{ 4.0, 20.0 }, origin + point{ 52.0, 20.0 }, pen{ color::White, 1.0 } });
+            }
+        return result;
+    }
+
+    typedef std::tuple<std::size_t, coordinate, coordinate, dimension, dimension> operation_key;
+
+    operation_key key(graphics_operation::operation const& aOperation)
+    {
+        auto const bounds = graphics_operation::bounding_rect(aOperation).value();
+        return operation_key{ aOperation.index(), bounds.x, bounds.y, bounds.cx, bounds.cy };
+    }
+
+    void check_painters_order(graphics_operation::queue const& aOriginal, graphics_operation::queue const& aReordered)
+    {
+        std::map<operation_key, std::size_t> newPosition;
+        for (std::size_t i = 0u; i < aReordered.size(); ++i)
+            newPosition[key(aReordered[i])] = i;
+        if (newPosition.size() != aOriginal.size())
+            throw std::runtime_error("reorder lost or duplicated operations");
+        std::vector<rect> bounds;
+        std::vector<std::size_t> positions;
+        for (auto const& operation : aOriginal)
+        {
+            bounds.push_back(graphics_operation::bounding_rect(operation).value());
+            positions.push_back(newPosition.at(key(operation)));
+        }
+        for (std::size_t i = 0u; i < aOriginal.size(); ++i)
+            for (std::size_t j = i + 1u; j < aOriginal.size(); ++j)
+                if (bounds[i].intersects(bounds[j]) && positions[i] > positions[j])
+                    throw std::runtime_error("reorder moved operation " + std::to_string(j) + " before overlapping operation " + std::to_string(i));
+    }
+
+    void measure(std::string const& aName, graphics_operation::queue const& aFrame)
+    {
+        auto reordered = aFrame;
+        auto const batchesBefore = graphics_operation::batch_count(reordered);
+        auto const saved = graphics_operation::reorder(reordered);
+        auto const batchesAfter = graphics_operation::batch_count(reordered);
+        check_painters_order(aFrame, reordered);
+        graphics_operation::queue work;
+        auto const cost = benchmarks::median_ms(101u, [&]()
+        {
+            work = aFrame;
+            graphics_operation::reorder(work);
+        });
+        auto const copying = benchmarks::median_ms(101u, [&]() { work = aFrame; });
+        benchmarks::report("operation_reordering", aName + ": operations", static_cast<double>(aFrame.size()), "");
+        benchmarks::report("operation_reordering", aName + ": draw calls before", static_cast<double>(batchesBefore), "");
+        benchmarks::report("operation_reordering", aName + ": draw calls after", static_cast<double>(batchesAfter), "");
+        benchmarks::report("operation_reordering", aName + ": draw calls saved", static_cast<double>(saved), "");
+        benchmarks::report("operation_reordering", aName + ": reorder cost", (cost - copying) * 1000.0, "us/frame");
+    }
+
+    void operation_reordering()
+    {
+        // separate widgets: everything but each widget's own rect and underline commutes
+        measure("20x10 widget grid", widget_frame(20u, 10u, point{ 60.0, 30.0 }));
+        measure("40x40 widget grid", widget_frame(40u, 40u, point{ 60.0, 30.0 }));
+        // widgets overlapping their neighbours: little or nothing may move
+        measure("20x10 overlapping widgets", widget_frame(20u, 10u, point{ 20.0, 10.0 }));
+    }
+
+    benchmarks::registration const sOperationReordering{ "operation_reordering", &operation_reordering };
+}
@@ -0,0 +1,116 @@
+// parallel_shaping.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <neogfx/app/app.hpp>
+#include <neogfx/gfx/graphics_context.hpp>
+#include <neogfx/gfx/text/i_font_manager.hpp>
+#include <neogfx/gfx/text/glyph_text.hpp>
+#include <neogfx/gui/window/window.hpp>
+#include "benchmark.hpp"
+
+// Compares serial and parallel HarfBuzz shaping (i_font_manager::parallel_shaping) of the RTL unit test
+// input, of that input repeated into a long document and of a large synthetic multi-script corpus.
+
+namespace
+{
+    using namespace neogfx;
+
+    std::string rtl_test_input()
+    {
+        // the working directory is either the repository root or the benchmarks project directory
+        for (char const* path : { "testing/unit_tests/rtl_test.txt", "../../../../unit_tests/rtl_test.txt" })
+            if (std::filesystem::exists(path))
+            {
+                std::ifstream input{ path, std::ios::binary };
+                std::ostringstream result;
+                result << input.rdbuf();
+                return result.str();
+            }
+        throw std::runtime_error("rtl_test.txt not found");
+    }
+
+    std::string repeated(std::string const& aText, std::size_t aBytes)
+    {
+        std::string result;
+        result.reserve(aBytes + aText.size());
+        while (result.size() < aBytes)
+            result += aText;
+        return result;
+    }
+
+    std::string multi_script_corpus(std::size_t aBytes)
+    {
+        static char const* const sSentences[] =
+        {
+            "The quick brown fox jumps over the lazy dog. ",
+            "\xD9\x88\xD9\x8A\xD9\x82\xD9\x81\xD8\xB2 \xD8\xA7\xD9\x84\xD8\xAB\xD8\xB9\xD9\x84\xD8\xA8 \xD8\xA7\xD9\x84\xD8\xA8\xD9\x86\xD9\x8A. ",
+            "\xD7\x98\xD7\xA7\xD7\xA1\xD7\x98 \xD7\x9C\xD7\x93\xD7\x95\xD7\x92\xD7\x9E\xD7\x90 123. ",
+            "\xE7\xA4\xBA\xE4\xBE\x8B\xE6\x96\x87\xE6\x9C\xAC\xE3\x80\x82 ",
+            "\xD0\xA1\xD1\x8A\xD0\xB5\xD1\x88\xD1\x8C \xD0\xB6\xD0\xB5 \xD0\xB5\xD1\x89\xD1\x91 \xD1\x8D\xD1\x82\xD0\xB8\xD1\x85 \xD0\xB1\xD1\x83\xD0\xBB\xD0\xBE\xD0\xBA. ",
+            "\xE0\xA4\xA8\xE0\xA4\xAE\xE0\xA4\xB8\xE0\xA5\x8D\xE0\xA4\xA4\xE0\xA5\x87 \xE0\xA4\xA6\xE0\xA5\x81\xE0\xA4\xA8\xE0\xA4\xBF\xE0\xA4\xAF\xE0\xA4\xBE\xE0\xA5\xA4\n"
+        };
+        std::string result;
+        result.reserve(aBytes + 256u);
+        for (std::size_t sentence = 0u; result.size() < aBytes; ++sentence)
+            result += sSentences[sentence % std::size(sSentences)];
+        return result;
+    }
+
+    void shape(i_graphics_context const& aGc, font const& aFont, std::string const& aName, std::string const& aText, std::uint32_t aRuns)
+    {
+        auto& fontManager = service<i_font_manager>();
+        auto const shapeAll = [&]()
+        {
+            auto const glyphs = fontManager.glyph_text_factory().to_glyph_text(aGc, std::string_view{ aText }, [&](std::size_t) { return aFont; });
+            if (glyphs.empty() && !aText.empty())
+                throw std::runtime_error("no glyphs shaped");
+        };
+        fontManager.set_parallel_shaping(false);
+        auto const serial = benchmarks::median_ms(aRuns, shapeAll);
+        fontManager.set_parallel_shaping(true);
+        auto const parallel = benchmarks::median_ms(aRuns, shapeAll);
+        fontManager.set_parallel_shaping(false);
+        benchmarks::report("parallel_shaping", aName + ": serial", serial, "ms");
+        benchmarks::report("parallel_shaping", aName + ": parallel", parallel, "ms");
+        benchmarks::report("parallel_shaping", aName + ": speedup", serial / parallel, "x");
+    }
+
+    void parallel_shaping()
+    {
+        window benchmarkWindow{ size{ 1280.0, 720.0 } };
+        app::instance().process_events();
+        graphics_context gc{ benchmarkWindow, graphics_context::type::Unattached };
+        font const textFont = benchmarkWindow.font();
+        std::string const rtlTest = rtl_test_input();
+        shape(gc, textFont, "rtl_test.txt", rtlTest, 101u);
+        shape(gc, textFont, "rtl_test.txt x 1 MB", repeated(rtlTest, 1024u * 1024u), 5u);
+        shape(gc, textFont, "multi-script corpus 4 MB", multi_script_corpus(4u * 1024u * 1024u), 3u);
+    }
+
+    benchmarks::registration const sParallelShaping{ "parallel_shaping", &parallel_shaping };
+}
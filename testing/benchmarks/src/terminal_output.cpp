@@ -0,0 +1,170 @@
+// terminal_output.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <neogfx/app/app.hpp>
+#include <neogfx/gui/window/window.hpp>
+#include <neogfx/gui/widget/terminal.hpp>
+#include "benchmark.hpp"
+
+// Measures terminal::output throughput in MB/s of ANSI text, first into an empty scrollback and then
+// into one that is full so that every new line recycles the oldest, and the raw append rate of the
+// scrollback ring itself against the line storage it replaced.
+
+namespace
+{
+    using namespace neogfx;
+
+    std::string ansi_text(std::size_t aBytes)
+    {
+        static char const* const sColors[] = { "\x1b[31m", "\x1b[32m", "\x1b[33m", "\x1b[1;34m", "\x1b[7m" };
+        std::string result;
+        result.reserve(aBytes + 256u);
+        for (std::uint32_t line = 0u; result.size() < aBytes; ++line)
+        {
+            result += sColors[line % std::size(sColors)];
+            result += "[" + std::to_string(line) + "]";
+            result += "\x1b[0m the quick brown fox jumps over the lazy dog ";
+            result += sColors[(line + 2u) % std::size(sColors)];
+            result += "0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+            result += "\x1b[0m\r\n";
+        }
+        return result;
+    }
+
+    void terminal_output()
+    {
+        window benchmarkWindow{ size{ 1280.0, 720.0 } };
+        terminal benchmarkTerminal{ benchmarkWindow.client_layout() };
+        app::instance().process_events();
+        std::size_t const lineLimit = 10000u;
+        benchmarkTerminal.set_scrollback_limits(lineLimit, 64u * 1024u * 1024u);
+        string const text{ ansi_text(16u * 1024u * 1024u) };
+        double const megabytes = text.size() / (1024.0 * 1024.0);
+        auto const filling = benchmarks::median_ms(1u, [&]() { benchmarkTerminal.output(text); });
+        benchmarks::report("terminal_output", "16 MB into empty scrollback", megabytes / (filling / 1000.0), "MB/s");
+        auto const full = benchmarks::median_ms(3u, [&]() { benchmarkTerminal.output(text); });
+        benchmarks::report("terminal_output", "16 MB into full 10000 line scrollback", megabytes / (full / 1000.0), "MB/s");
+    }
+
+    struct attribute
+    {
+        std::uint32_t ink;
+        std::uint32_t paper;
+
+        bool operator==(attribute const&) const = default;
+    };
+
+    // The line storage terminal used before basic_terminal_scrollback: a std::vector of lines, each with
+    // its own text and per-cell attributes, trimmed to the line limit by erasing from the front.
+    class previous_scrollback
+    {
+    public:
+        struct buffer_line
+        {
+            std::u32string text;
+            std::vector<attribute> attributes;
+        };
+    public:
+        previous_scrollback(std::size_t aLineLimit, std::size_t aLineWidth) :
+            iLineLimit{ aLineLimit }, iLineWidth{ aLineWidth }
+        {
+        }
+    public:
+        buffer_line& push_back()
+        {
+            iLines.emplace_back();
+            iLines.back().text.reserve(iLineWidth);
+            iLines.back().attributes.reserve(iLineWidth);
+            if (iLines.size() > iLineLimit)
+                iLines.erase(iLines.begin(), std::next(iLines.begin(), iLines.size() - iLineLimit));
+            return iLines.back();
+        }
+        std::size_t bytes() const
+        {
+            std::size_t result = iLines.capacity() * sizeof(buffer_line);
+            for (auto const& line : iLines)
+                result += line.text.capacity() * sizeof(char32_t) + line.attributes.capacity() * sizeof(attribute);
+            return result;
+        }
+    private:
+        std::size_t iLineLimit;
+        std::size_t iLineWidth;
+        std::vector<buffer_line> iLines;
+    };
+
+    void terminal_scrollback()
+    {
+        std::size_t const lineLimit = 100000u;
+        std::u32string const text = U"the quick brown fox jumps over the lazy dog 0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        attribute const plain{ 0xFFFFFFu, 0x000000u };
+        attribute const highlight{ 0xFF0000u, 0x000000u };
+        auto append = [&](auto& aScrollback, std::size_t aLines)
+        {
+            for (std::size_t line = 0u; line < aLines; ++line)
+            {
+                auto& next = aScrollback.push_back();
+                next.replace(0u, text, plain, plain);
+                next.set_attribute(4u, 9u, highlight);
+            }
+        };
+        auto previous_append = [&](previous_scrollback& aScrollback, std::size_t aLines)
+        {
+            for (std::size_t line = 0u; line < aLines; ++line)
+            {
+                auto& next = aScrollback.push_back();
+                next.text = text;
+                next.attributes.assign(text.size(), plain);
+                std::fill(std::next(next.attributes.begin(), 4u), std::next(next.attributes.begin(), 9u), highlight);
+            }
+        };
+
+        basic_terminal_scrollback<attribute> scrollback{ lineLimit, 64u * 1024u * 1024u };
+        std::size_t const lines = 1000000u;
+        auto const ring = benchmarks::median_ms(3u, [&]() { append(scrollback, lines); });
+        benchmarks::report("terminal_scrollback", "append 1M lines (100000 line ring)", lines / (ring / 1000.0) / 1.0e6, "Mlines/s");
+        benchmarks::report("terminal_scrollback", "bytes in use", scrollback.bytes() / (1024.0 * 1024.0), "MB");
+
+        // erasing from the front of the previous storage moves every remaining line so the comparison uses
+        // the 10000 line limit of terminal_output and 100000 lines, most of which trim, to stay in seconds
+        std::size_t const comparedLimit = 10000u;
+        std::size_t const comparedLines = 100000u;
+        auto const current = benchmarks::median_ms(3u, [&]()
+        {
+            basic_terminal_scrollback<attribute> compared{ comparedLimit, 64u * 1024u * 1024u };
+            append(compared, comparedLines);
+        });
+        previous_scrollback previousScrollback{ comparedLimit, text.size() };
+        auto const previous = benchmarks::median_ms(1u, [&]() { previous_append(previousScrollback, comparedLines); });
+        benchmarks::report("terminal_scrollback", "append 100000 lines (10000 line ring)", comparedLines / (current / 1000.0) / 1.0e6, "Mlines/s");
+        benchmarks::report("terminal_scrollback", "append 100000 lines (previous storage)", comparedLines / (previous / 1000.0) / 1.0e6, "Mlines/s");
+        benchmarks::report("terminal_scrollback", "speedup", previous / current, "x");
+        benchmarks::report("terminal_scrollback", "bytes in use (previous storage)", previousScrollback.bytes() / (1024.0 * 1024.0), "MB");
+    }
+
+    benchmarks::registration const sTerminalOutput{ "terminal_output", &terminal_output };
+    benchmarks::registration const sTerminalScrollback{ "terminal_scrollback", &terminal_scrollback };
+}
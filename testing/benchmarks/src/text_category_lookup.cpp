@@ -0,0 +1,130 @@
+// text_category_lookup.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <neogfx/gfx/text/i_font_manager.hpp>
+#include <neogfx/gfx/text/text_category_map.hpp>
+#include "benchmark.hpp"
+
+// Compares get_text_category (two-stage tables for categories and single code point emoji) with the
+// implementation it replaced (a std::map lookup of a one code point std::u32string for emoji followed
+// by a std::lower_bound over text_category_MAP), after checking that both agree on every code point.
+
+namespace
+{
+    using namespace neogfx;
+
+    text_category previous_get_text_category(i_emoji_atlas const& aEmojiAtlas, char32_t aCodePoint)
+    {
+        thread_local std::u32string str;
+        str = aCodePoint;
+        if (aEmojiAtlas.is_emoji(str))
+            return text_category::Emoji;
+        else if (aCodePoint == 0xFE0F || aCodePoint == 0xFE0E)
+            return text_category::Control;
+        auto const mapEnd = &detail::text_category_MAP[0] + detail::text_category_MAP_SIZE;
+        auto rangeStart = std::lower_bound(&detail::text_category_MAP[0], mapEnd,
+            detail::text_category_MAP_VALUE_TYPE(aCodePoint, text_category::Unknown),
+            [](detail::text_category_MAP_VALUE_TYPE const& lhs, detail::text_category_MAP_VALUE_TYPE const& rhs) -> bool
+        {
+            return lhs.first < rhs.first;
+        });
+        if (rangeStart != &detail::text_category_MAP[0] && (rangeStart == mapEnd || aCodePoint < rangeStart->first))
+            --rangeStart;
+        return rangeStart->second;
+    }
+
+    std::vector<char32_t> ascii_text(std::size_t aCount)
+    {
+        std::u32string const sentence = U"The quick brown fox jumps over the lazy dog, 0123456789 times.\n";
+        std::vector<char32_t> result;
+        result.reserve(aCount);
+        while (result.size() < aCount)
+            result.push_back(sentence[result.size() % sentence.size()]);
+        return result;
+    }
+
+    std::vector<char32_t> multi_script_text(std::size_t aCount)
+    {
+        std::u32string const sentence = U"Fox \u064A\u0642\u0641\u0632 \u05D8\u05E7\u05E1\u05D8 \u793A\u4F8B\u6587\u672C \u0421\u044A\u0435\u0448\u044C \u0928\u092E\u0938\u094D\u0924\u0947 \U0001F600\u2764\uFE0F 42.\n";
+        std::vector<char32_t> result;
+        result.reserve(aCount);
+        while (result.size() < aCount)
+            result.push_back(sentence[result.size() % sentence.size()]);
+        return result;
+    }
+
+    std::vector<char32_t> random_code_points(std::size_t aCount)
+    {
+        std::mt19937 generator{ 42u };
+        std::uniform_int_distribution<std::uint32_t> codePoint{ 0u, 0x10FFFFu };
+        std::vector<char32_t> result;
+        result.reserve(aCount);
+        while (result.size() < aCount)
+            result.push_back(static_cast<char32_t>(codePoint(generator)));
+        return result;
+    }
+
+    template <typename Lookup>
+    double nanoseconds_per_code_point(std::vector<char32_t> const& aText, Lookup&& aLookup)
+    {
+        std::uint32_t checksum = 0u;
+        auto const ms = benchmarks::median_ms(5u, [&]()
+        {
+            for (auto ch : aText)
+                checksum += static_cast<std::uint32_t>(aLookup(ch));
+        });
+        if (checksum == 0xFFFFFFFFu) // keep the lookups from being optimized away
+            std::cout << ' ';
+        return ms * 1.0e6 / aText.size();
+    }
+
+    void text_category_lookup()
+    {
+        auto const& emojiAtlas = service<i_font_manager>().emoji_atlas();
+        for (char32_t ch = 0u; ch < 0x110000u; ++ch)
+            if (get_text_category(emojiAtlas, ch) != previous_get_text_category(emojiAtlas, ch))
+                throw std::runtime_error("get_text_category disagrees with the previous implementation at U+" + std::to_string(static_cast<std::uint32_t>(ch)));
+        std::size_t const count = 4u * 1024u * 1024u;
+        std::pair<std::string, std::vector<char32_t>> const inputs[] =
+        {
+            { "ASCII text", ascii_text(count) },
+            { "multi-script text", multi_script_text(count) },
+            { "random code points", random_code_points(count) }
+        };
+        for (auto const& input : inputs)
+        {
+            auto const previous = nanoseconds_per_code_point(input.second, [&](char32_t ch) { return previous_get_text_category(emojiAtlas, ch); });
+            auto const current = nanoseconds_per_code_point(input.second, [&](char32_t ch) { return get_text_category(emojiAtlas, ch); });
+            benchmarks::report("text_category_lookup", input.first + ": previous", previous, "ns/code point");
+            benchmarks::report("text_category_lookup", input.first + ": two-stage tables", current, "ns/code point");
+            benchmarks::report("text_category_lookup", input.first + ": speedup", previous / current, "x");
+        }
+    }
+
+    benchmarks::registration const sTextCategoryLookup{ "text_category_lookup", &text_category_lookup };
+}
@@ -0,0 +1,90 @@
+// text_edit_latency.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cstdint>
+#include <string>
+
+#include <neogfx/app/app.hpp>
+#include <neogfx/gui/window/window.hpp>
+#include <neogfx/gui/widget/text_edit.hpp>
+#include "benchmark.hpp"
+
+// Measures keystroke to paint latency in the middle of 1 MB, 10 MB and 50 MB plain text documents with
+// and without incremental (paragraph-local) reflow. A keystroke is a text_input() of one character
+// followed by processing events until the resulting repaint is done.
+
+namespace
+{
+    using namespace neogfx;
+
+    std::string log_document(std::size_t aBytes)
+    {
+        std::string result;
+        result.reserve(aBytes + 128u);
+        for (std::uint32_t line = 0u; result.size() < aBytes; ++line)
+        {
+            result += "2024-01-01 12:00:00.000 [worker ";
+            result += std::to_string(line % 16u);
+            result += "] request ";
+            result += std::to_string(line);
+            result += " completed in 12.5 ms; the quick brown fox jumps over the lazy dog\n";
+        }
+        return result;
+    }
+
+    void text_edit_latency(std::size_t aMegabytes, bool aIncrementalReflow)
+    {
+        window benchmarkWindow{ size{ 1280.0, 720.0 } };
+        text_edit editor{ benchmarkWindow.client_layout() };
+        editor.set_incremental_reflow(aIncrementalReflow);
+        app::instance().process_events();
+        std::string const document = log_document(aMegabytes * 1024u * 1024u);
+        std::string const what = std::to_string(aMegabytes) + " MB" + (aIncrementalReflow ? " incremental" : " full");
+        auto const load = benchmarks::median_ms(1u, [&]() { editor.set_text(document); app::instance().process_events(); });
+        benchmarks::report("text_edit_latency", what + ": load", load, "ms");
+        editor.cursor().set_position(document.size() / 2u);
+        string const keystroke{ "x" };
+        auto const typing = benchmarks::median_ms(aMegabytes >= 50u ? 5u : 21u, [&]()
+        {
+            editor.text_input(keystroke);
+            app::instance().process_events();
+        });
+        benchmarks::report("text_edit_latency", what + ": keystroke to paint", typing, "ms");
+        string const newline{ "\n" };
+        auto const splitting = benchmarks::median_ms(aMegabytes >= 50u ? 5u : 21u, [&]()
+        {
+            editor.insert_text(newline, true);
+            app::instance().process_events();
+        });
+        benchmarks::report("text_edit_latency", what + ": paragraph split to paint", splitting, "ms");
+    }
+
+    void text_edit_latency()
+    {
+        for (std::size_t megabytes : { 1u, 10u, 50u })
+        {
+            text_edit_latency(megabytes, false);
+            text_edit_latency(megabytes, true);
+        }
+    }
+
+    benchmarks::registration const sTextEditLatency{ "text_edit_latency", static_cast<void(*)()>(&text_edit_latency) };
+}
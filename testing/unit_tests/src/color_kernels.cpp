@@ -0,0 +1,300 @@
+// color_kernels.cpp
+/*
+  neogfx C++ App/Game Engine
+  Copyright (c) 2026 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../../../src/core/cpu_features.hpp"
+#include "../../../src/gfx/color_conversion.hpp"
+
+// Runs every RGBA pixel buffer colour kernel, for each dispatch path the host supports, over all 8-bit
+// inputs and compares the results with a double precision std::pow reference (or the exact result
+// for premultiplication). The HSV and HSL kernels promise results identical to their scalar versions
+// so those are compared with the scalar path's. Buffers are a few pixels longer than a multiple of
+// the widest vector so that the scalar tails are exercised too.
+
+namespace
+{
+    using namespace neogfx;
+
+    int sFailures = 0;
+
+    template <typename T>
+    bool check(std::string const& aPath, std::string const& aKernel, std::size_t aIndex, T aActual, T aExpected)
+    {
+        if (aActual == aExpected)
+            return true;
+        if constexpr (std::is_floating_point_v<T>)
+            if (std::isnan(aActual) && std::isnan(aExpected))
+                return true;
+        std::cerr << aPath << ": " << aKernel << " index " << aIndex << ": got " << +aActual << ", expected " << +aExpected << std::endl;
+        ++sFailures;
+        return false;
+    }
+
+    double reference_sRGB_to_linear(double aValue)
+    {
+        return aValue <= 0.04045 ? aValue / 12.92 : std::pow((aValue + 0.055) / 1.055, 2.4);
+    }
+
+    std::uint8_t reference_linear_to_sRGB(float aValue)
+    {
+        double const value = std::isnan(aValue) ? 0.0 : std::min(std::max(static_cast<double>(aValue), 0.0), 1.0);
+        double const encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+        return static_cast<std::uint8_t>(std::floor(encoded * 255.0 + 0.5));
+    }
+
+    void test_sRGB_to_linear(std::string const& aPath, detail::color_kernels const& aKernels)
+    {
+        std::size_t const pixels = 256u + 3u;
+        std::vector<std::uint8_t> source(pixels * 4u);
+        for (std::size_t i = 0u; i < source.size(); ++i)
+            source[i] = static_cast<std::uint8_t>((i / 4u + i % 4u * 64u) % 256u);
+        std::vector<float> destination(source.size());
+        aKernels.sRGBToLinear(source.data(), destination.data(), source.size());
+        for (std::size_t i = 0u; i < source.size(); ++i)
+        {
+            float const expected = i % 4u == 3u ?
+                source[i] * (1.0f / 255.0f) :
+                static_cast<float>(reference_sRGB_to_linear(source[i] / 255.0));
+            if (!check(aPath, "sRGB_to_linear", i, destination[i], expected))
+                return;
+        }
+    }
+
+    void test_linear_to_sRGB(std::string const& aPath, detail::color_kernels const& aKernels)
+    {
+        // every 8-bit value's linear intensity, the floats either side of each rounding threshold, an
+        // even sweep of the unit interval and out of range values
+        std::vector<float> values;
+        for (int value = 0; value < 256; ++value)
+        {
+            values.push_back(static_cast<float>(reference_sRGB_to_linear(value / 255.0)));
+            if (value > 0)
+            {
+                float const threshold = static_cast<float>(reference_sRGB_to_linear((value - 0.5) / 255.0));
+                values.push_back(std::nextafter(threshold, 0.0f));
+                values.push_back(threshold);
+                values.push_back(std::nextafter(threshold, 1.0f));
+            }
+        }
+        for (int step = 0; step <= 65536; ++step)
+            values.push_back(step / 65536.0f);
+        for (float value : { -1.0f, -0.0f, 1.0f, 1.5f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() })
+            values.push_back(value);
+        while (values.size() % 4u != 0u || values.size() % 32u == 0u)
+            values.push_back(0.5f);
+        std::vector<std::uint8_t> destination(values.size());
+        aKernels.linearToSRGB(values.data(), destination.data(), values.size());
+        for (std::size_t i = 0u; i < values.size(); ++i)
+        {
+            auto const expected = i % 4u == 3u ? detail::to_component(values[i]) : reference_linear_to_sRGB(values[i]);
+            if (!check(aPath, "linear_to_sRGB", i, destination[i], expected))
+                return;
+        }
+    }
+
+    // Every colour component with every alpha plus a three pixel tail.
+    std::vector<std::uint8_t> all_component_alpha_pairs()
+    {
+        std::vector<std::uint8_t> pixels;
+        for (std::uint32_t alpha = 0u; alpha < 256u; ++alpha)
+            for (std::uint32_t component = 0u; component < 256u; ++component)
+                pixels.insert(pixels.end(), { static_cast<std::uint8_t>(component), static_cast<std::uint8_t>(255u - component), static_cast<std::uint8_t>(component), static_cast<std::uint8_t>(alpha) });
+        pixels.insert(pixels.end(), { 200u, 100u, 50u, 128u, 1u, 2u, 3u, 4u, 255u, 0u, 255u, 255u });
+        return pixels;
+    }
+
+    std::vector<float> to_float(std::vector<std::uint8_t> const& aPixels)
+    {
+        std::vector<float> result(aPixels.size());
+        for (std::size_t i = 0u; i < aPixels.size(); ++i)
+            result[i] = aPixels[i] / 255.0f;
+        return result;
+    }
+
+    void test_premultiply(std::string const& aPath, detail::color_kernels const& aKernels)
+    {
+        auto const source = all_component_alpha_pairs();
+        auto pixels = source;
+        aKernels.premultiply8(pixels.data(), pixels.size());
+        for (std::size_t i = 0u; i < pixels.size(); ++i)
+        {
+            auto const alpha = source[i - i % 4u + 3u];
+            auto const expected = i % 4u == 3u ? alpha : static_cast<std::uint8_t>(std::lround(source[i] * alpha / 255.0));
+            if (!check(aPath, "premultiply (8-bit)", i, pixels[i], expected))
+                break;
+        }
+        auto const floatSource = to_float(source);
+        auto floatPixels = floatSource;
+        aKernels.premultiplyFloat(floatPixels.data(), floatPixels.size());
+        for (std::size_t i = 0u; i < floatPixels.size(); ++i)
+        {
+            auto const alpha = floatSource[i - i % 4u + 3u];
+            auto const expected = i % 4u == 3u ? alpha : floatSource[i] * alpha;
+            if (!check(aPath, "premultiply (float)", i, floatPixels[i], expected))
+                break;
+        }
+    }
+
+    void test_unpremultiply(std::string const& aPath, detail::color_kernels const& aKernels)
+    {
+        auto const source = all_component_alpha_pairs();
+        auto pixels = source;
+        aKernels.unpremultiply8(pixels.data(), pixels.size());
+        for (std::size_t i = 0u; i < pixels.size(); ++i)
+        {
+            auto const alpha = source[i - i % 4u + 3u];
+            auto const expected = i % 4u == 3u ? alpha : alpha == 0u ? std::uint8_t{} :
+                static_cast<std::uint8_t>(std::min(std::floor(source[i] * 255.0 / alpha + 0.5), 255.0));
+            if (!check(aPath, "unpremultiply (8-bit)", i, pixels[i], expected))
+                break;
+        }
+        auto const floatSource = to_float(source);
+        auto floatPixels = floatSource;
+        aKernels.unpremultiplyFloat(floatPixels.data(), floatPixels.size());
+        for (std::size_t i = 0u; i < floatPixels.size(); ++i)
+        {
+            auto const alpha = floatSource[i - i % 4u + 3u];
+            auto const expected = i % 4u == 3u ? alpha : alpha == 0.0f ? 0.0f : floatSource[i] / alpha;
+            if (!check(aPath, "unpremultiply (float)", i, floatPixels[i], expected))
+                break;
+        }
+    }
+
+    void test_swap_red_blue(std::string const& aPath, detail::color_kernels const& aKernels)
+    {
+        auto const source = all_component_alpha_pairs();
+        auto pixels = source;
+        aKernels.swapRedBlue(pixels.data(), pixels.size());
+        for (std::size_t i = 0u; i < pixels.size(); ++i)
+        {
+            auto const expected = i % 4u == 0u ? source[i + 2u] : i % 4u == 2u ? source[i - 2u] : source[i];
+            if (!check(aPath, "swap_red_blue", i, pixels[i], expected))
+                break;
+        }
+    }
+
+    // Hues across and beyond the colour wheel (every sextant boundary included) with a grid of
+    // saturations and values/lightnesses, a fine hue sweep and a tail.
+    std::vector<float> hue_inputs()
+    {
+        std::vector<float> pixels;
+        for (int hue = -360; hue <= 720; hue += 15)
+            for (int saturation = 0; saturation <= 4; ++saturation)
+                for (int level = 0; level <= 4; ++level)
+                    pixels.insert(pixels.end(), { static_cast<float>(hue), saturation / 4.0f, level / 4.0f, 0.5f });
+        for (int step = 0; step < 3600; ++step)
+            pixels.insert(pixels.end(), { step / 10.0f, 0.75f, 0.6f, 1.0f });
+        pixels.insert(pixels.end(), { 359.99f, 1.0f, 1.0f, 0.25f, 60.0f, 0.5f, 0.5f, 0.0f });
+        while (pixels.size() % 16u == 0u)
+            pixels.insert(pixels.end(), { 300.0f, 0.3f, 0.9f, 1.0f });
+        return pixels;
+    }
+
+    // A grid of RGB colours (greys and primaries included) and every colour component with every alpha.
+    std::vector<float> rgb_inputs()
+    {
+        std::vector<std::uint8_t> pixels;
+        for (std::uint32_t red = 0u; red < 256u; red += 17u)
+            for (std::uint32_t green = 0u; green < 256u; green += 17u)
+                for (std::uint32_t blue = 0u; blue < 256u; blue += 17u)
+                    pixels.insert(pixels.end(), { static_cast<std::uint8_t>(red), static_cast<std::uint8_t>(green), static_cast<std::uint8_t>(blue), 255u });
+        auto const pairs = all_component_alpha_pairs();
+        pixels.insert(pixels.end(), pairs.begin(), pairs.end());
+        return to_float(pixels);
+    }
+
+    void test_hue_kernels(std::string const& aPath, std::string const& aName, detail::hue_kernels const& aKernels, detail::hue_kernels const& aScalar)
+    {
+        auto const hues = hue_inputs();
+        std::vector<float> expected(hues.size());
+        std::vector<float> actual(hues.size());
+        aScalar.toRgb(hues.data(), expected.data(), hues.size());
+        aKernels.toRgb(hues.data(), actual.data(), hues.size());
+        for (std::size_t i = 0u; i < hues.size(); ++i)
+            if (!check(aPath, aName + " to_rgb (float)", i, actual[i], expected[i]))
+                break;
+        std::vector<std::uint8_t> expected8(hues.size());
+        std::vector<std::uint8_t> actual8(hues.size());
+        aScalar.toRgb8(hues.data(), expected8.data(), hues.size());
+        aKernels.toRgb8(hues.data(), actual8.data(), hues.size());
+        for (std::size_t i = 0u; i < hues.size(); ++i)
+            if (!check(aPath, aName + " to_rgb (8-bit)", i, actual8[i], expected8[i]))
+                break;
+        auto const colors = rgb_inputs();
+        expected.resize(colors.size());
+        actual.resize(colors.size());
+        aScalar.fromRgb(colors.data(), expected.data(), colors.size());
+        aKernels.fromRgb(colors.data(), actual.data(), colors.size());
+        for (std::size_t i = 0u; i < colors.size(); ++i)
+            if (!check(aPath, aName + " from_rgb", i, actual[i], expected[i]))
+                break;
+    }
+}
+
+int main()
+{
+    auto const& host = neogfx::host_cpu_features();
+    struct dispatch_path
+    {
+        std::string name;
+        neogfx::cpu_features features;
+        bool supported;
+    };
+    dispatch_path const paths[] =
+    {
+        { "scalar", { false, false, false }, true },
+        { "SSE2", { true, false, false }, host.sse2 },
+        { "AVX2", { true, host.sse41, true }, host.sse2 && host.avx2 }
+    };
+    auto const scalarHsv = neogfx::detail::hsv_kernels_for(paths[0].features);
+    auto const scalarHsl = neogfx::detail::hsl_kernels_for(paths[0].features);
+    for (auto const& path : paths)
+    {
+        if (!path.supported)
+        {
+            std::cout << path.name << ": not supported by this CPU, skipped" << std::endl;
+            continue;
+        }
+        auto const kernels = neogfx::detail::color_kernels_for(path.features);
+        test_sRGB_to_linear(path.name, kernels);
+        test_linear_to_sRGB(path.name, kernels);
+        test_premultiply(path.name, kernels);
+        test_unpremultiply(path.name, kernels);
+        test_swap_red_blue(path.name, kernels);
+        test_hue_kernels(path.name, "hsv_color", neogfx::detail::hsv_kernels_for(path.features), scalarHsv);
+        test_hue_kernels(path.name, "hsl_color", neogfx::detail::hsl_kernels_for(path.features), scalarHsl);
+        std::cout << path.name << ": done" << std::endl;
+    }
+    if (sFailures != 0)
+    {
+        std::cerr << sFailures << " failure(s)" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "all colour kernels passed" << std::endl;
+    return EXIT_SUCCESS;
+}